@@ -0,0 +1,98 @@
+//=============================================================================
+// ClientChecks
+//
+// Correctness checks and benchmarks of the SampleClient3D data path, run
+// without a server or a window:
+//
+//   decoder     bitstream version specialized frame decoders and the
+//               frame view of raw packets
+//   transform   batched pose transform against the per entity conversions
+//   policies    every FusedTransform instantiation against the per entity
+//               conversions
+//   skeleton    local to global and back against a double reference
+//   euler       batched Euler angles against Eul_FromQuat
+//   matrix      batched pose matrices and inverses against the per body
+//               matrices and the identity
+//
+// Usage: ClientChecks [--quick] [group ...]
+//   --quick     run the checks only, skip the benchmarks
+// Without groups every group runs. The exit code is the number of failed
+// checks.
+//
+// Linux: g++ -std=c++14 -O2 -I../../include -I../SampleClient3D -I../NatNetStandIn ClientChecks.cpp DecoderChecks.cpp EulerChecks.cpp MatrixChecks.cpp SkeletonChecks.cpp TransformChecks.cpp ../SampleClient3D/CompactFrame.cpp ../SampleClient3D/EulerAngles.cpp ../SampleClient3D/FrameDecoder.cpp ../SampleClient3D/FrameView.cpp ../SampleClient3D/PoseEuler.cpp ../SampleClient3D/PoseMatrix.cpp ../SampleClient3D/PoseTransform.cpp ../SampleClient3D/SkeletonHierarchy.cpp ../SampleClient3D/TransformPolicy.cpp -o ClientChecks
+//=============================================================================
+
+#include <cstdio>
+#include <cstring>
+
+#include "ClientChecks.h"
+
+namespace
+{
+  struct CheckGroup
+  {
+    const char* name;
+    int (*run)(bool benchmark);
+  };
+
+  const CheckGroup kGroups[] =
+  {
+    { "decoder", RunDecoderChecks },
+    { "transform", RunTransformChecks },
+    { "policies", RunPolicyChecks },
+    { "skeleton", RunSkeletonChecks },
+    { "euler", RunEulerChecks },
+    { "matrix", RunMatrixChecks },
+  };
+
+  const int kGroupCount = sizeof(kGroups) / sizeof(kGroups[0]);
+
+  bool IsGroup(const char* name)
+  {
+    for (int g = 0; g < kGroupCount; g++)
+      if (strcmp(kGroups[g].name, name) == 0)
+        return true;
+    return false;
+  }
+
+  bool Selected(const char* name, int argc, char** argv)
+  {
+    bool any = false;
+    for (int i = 1; i < argc; i++)
+    {
+      if (argv[i][0] == '-')
+        continue;
+      if (strcmp(argv[i], name) == 0)
+        return true;
+      any = true;
+    }
+    return !any;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bool benchmark = true;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+      benchmark = false;
+    else if (argv[i][0] == '-' || !IsGroup(argv[i]))
+    {
+      fprintf(stderr, "usage: ClientChecks [--quick] [group ...]\n");
+      return 1;
+    }
+  }
+
+  int failures = 0;
+  for (int g = 0; g < kGroupCount; g++)
+  {
+    if (!Selected(kGroups[g].name, argc, argv))
+      continue;
+    printf("%s\n", kGroups[g].name);
+    const int groupFailures = kGroups[g].run(benchmark);
+    printf("%s: %s\n\n", kGroups[g].name, groupFailures == 0 ? "ok" : "FAILED");
+    failures += groupFailures;
+  }
+  return failures;
+}
@@ -0,0 +1,61 @@
+#ifndef _CLIENTCHECKS_H_
+#define _CLIENTCHECKS_H_
+
+#include <chrono>
+#include <cstdio>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Counts and reports the failed checks of one check group.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+struct CheckResults
+{
+  int failures;
+
+  CheckResults() : failures(0) {}
+
+  // Reports <c>what</c> if the condition does not hold.
+  bool Expect(bool condition, const char* what)
+  {
+    if (!condition)
+    {
+      printf("  FAILED: %s\n", what);
+      failures++;
+    }
+    return condition;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Nanoseconds per call of <c>fn</c>: the best of five runs of
+/// <c>calls</c> calls each, after one warm-up run.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+template<typename Fn>
+double NanosecondsPerCall(int calls, Fn fn)
+{
+  double best = 0.0;
+  for (int run = 0; run <= 5; run++)
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+      fn(i);
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    if (run == 1 || (run > 1 && ns < best))
+      best = ns;
+  }
+  return best;
+}
+
+// Check groups. Each returns its number of failed checks; benchmarks
+// only run if <c>benchmark</c> is set.
+int RunDecoderChecks(bool benchmark);
+int RunTransformChecks(bool benchmark);
+int RunPolicyChecks(bool benchmark);
+int RunSkeletonChecks(bool benchmark);
+int RunEulerChecks(bool benchmark);
+int RunMatrixChecks(bool benchmark);
+
+#endif // _CLIENTCHECKS_H_
@@ -0,0 +1,402 @@
+#include <cstdio>
+#include <cstring>
+
+#include "ClientChecks.h"
+#include "FrameDecoder.h"
+#include "FrameView.h"
+#include "PacketWriter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Frame decoder and frame view checks and per version decode cost
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Content of the generated frames.
+  struct FrameContent
+  {
+    int markersPerSet;
+    int otherMarkers;
+    int rigidBodies;
+    int skeletons;
+    int bonesPerSkeleton;
+    int labeledMarkers;
+    int forcePlates;
+    int forcePlateChannels;
+  };
+
+  // Typical full body capture: 20 props, 2 actors, 100 labeled markers.
+  const FrameContent kContent = { 40, 10, 20, 2, 21, 100, 2, 6 };
+
+  // Coordinate of field <c>k</c> of entity <c>i</c> in frame <c>frame</c>.
+  float Value(int32_t frame, int i, int k)
+  {
+    return (float)(frame % 1000) * 0.5f + (float)i + (float)k * 0.125f;
+  }
+
+  template<typename Traits>
+  void WriteRigidBody(PacketWriter& w, int32_t frame, int32_t id, int i)
+  {
+    w.Write<int32_t>(id);
+    for (int k = 0; k < 7; k++)
+      w.Write<float>(Value(frame, i, k));
+
+    // record sizes vary before 3.0
+    if (Traits::kRigidBodyMarkers)
+    {
+      const int nMarkers = 1 + i % 4;
+      w.Write<int32_t>(nMarkers);
+      for (int m = 0; m < 3 * nMarkers; m++)
+        w.Write<float>(Value(frame, i, m));
+      if (Traits::kRigidBodyMarkerInfo)
+      {
+        for (int m = 0; m < nMarkers; m++)
+          w.Write<int32_t>(m);
+        for (int m = 0; m < nMarkers; m++)
+          w.Write<float>(14.0f);
+      }
+    }
+
+    if (Traits::kRigidBodyMeanError)
+      w.Write<float>(0.25f);
+    if (Traits::kRigidBodyParams)
+      w.Write<int16_t>(0x01);
+  }
+
+  // Writes one NAT_FRAMEOFDATA payload in the layout of bitstream version
+  // Major.Minor.
+  template<int Major, int Minor>
+  int WriteFrame(sPacket& packet, const FrameContent& content, int32_t frame)
+  {
+    typedef BitstreamTraits<Major, Minor> Traits;
+    PacketWriter w(packet, NAT_FRAMEOFDATA);
+
+    w.Write<int32_t>(frame);
+
+    w.Write<int32_t>(1);
+    w.WriteString("all");
+    w.Write<int32_t>(content.markersPerSet);
+    for (int i = 0; i < 3 * content.markersPerSet; i++)
+      w.Write<float>(Value(frame, i, 0));
+
+    w.Write<int32_t>(content.otherMarkers);
+    for (int i = 0; i < 3 * content.otherMarkers; i++)
+      w.Write<float>(Value(frame, i, 1));
+
+    w.Write<int32_t>(content.rigidBodies);
+    for (int i = 0; i < content.rigidBodies; i++)
+      WriteRigidBody<Traits>(w, frame, i + 1, i);
+
+    if (Traits::kHasSkeletons)
+    {
+      w.Write<int32_t>(content.skeletons);
+      for (int s = 0; s < content.skeletons; s++)
+      {
+        w.Write<int32_t>(s + 1);
+        w.Write<int32_t>(content.bonesPerSkeleton);
+        for (int b = 0; b < content.bonesPerSkeleton; b++)
+          WriteRigidBody<Traits>(w, frame, ((s + 1) << 16) | (b + 1), b);
+      }
+    }
+
+    if (Traits::kHasLabeledMarkers)
+    {
+      w.Write<int32_t>(content.labeledMarkers);
+      for (int i = 0; i < content.labeledMarkers; i++)
+      {
+        w.Write<int32_t>(i + 1);
+        for (int k = 0; k < 3; k++)
+          w.Write<float>(Value(frame, i, k));
+        w.Write<float>(14.0f);
+        if (Traits::kLabeledMarkerParams)
+          w.Write<int16_t>(0);
+        if (Traits::kLabeledMarkerResidual)
+          w.Write<float>(0.5f);
+      }
+    }
+
+    if (Traits::kHasForcePlates)
+    {
+      w.Write<int32_t>(content.forcePlates);
+      for (int p = 0; p < content.forcePlates; p++)
+      {
+        w.Write<int32_t>(p + 1);
+        w.Write<int32_t>(content.forcePlateChannels);
+        for (int ch = 0; ch < content.forcePlateChannels; ch++)
+        {
+          w.Write<int32_t>(1);
+          w.Write<float>(Value(frame, p, ch));
+        }
+      }
+    }
+
+    if (Traits::kHasDevices)
+      w.Write<int32_t>(0);
+
+    if (Traits::kLatency)
+      w.Write<float>(0.004f);
+
+    w.Write<uint32_t>(0x01020304);
+    w.Write<uint32_t>(5);
+    if (Traits::kDoubleTimestamp)
+      w.Write<double>(frame / 120.0);
+    else
+      w.Write<float>((float)(frame / 120.0));
+    if (Traits::kHighResTimestamps)
+    {
+      w.Write<uint64_t>(1000);
+      w.Write<uint64_t>(2000);
+      w.Write<uint64_t>(3000);
+    }
+    w.Write<int16_t>(0);
+    w.Write<int32_t>(0);   // end of data tag
+
+    return w.Finish();
+  }
+
+  bool SameRigidBody(const sRigidBodyData& a, const sRigidBodyData& b)
+  {
+    return a.ID == b.ID && a.x == b.x && a.y == b.y && a.z == b.z && a.qx == b.qx && a.qy == b.qy &&
+      a.qz == b.qz && a.qw == b.qw && a.MeanError == b.MeanError && a.params == b.params;
+  }
+
+  bool SameAnalog(int32_t idA, int32_t nChannelsA, const sAnalogChannelData* a,
+    int32_t idB, int32_t nChannelsB, const sAnalogChannelData* b)
+  {
+    bool same = idA == idB && nChannelsA == nChannelsB;
+    for (int ch = 0; same && ch < nChannelsA; ch++)
+    {
+      same = a[ch].nFrames == b[ch].nFrames;
+      for (int f = 0; same && f < a[ch].nFrames; f++)
+        same = a[ch].Values[f] == b[ch].Values[f];
+    }
+    return same;
+  }
+
+  // Compares every entity a frame view reads with the decoded frame.
+  void CheckView(CheckResults& results, const FrameView& view, const CompactFrame& frame)
+  {
+    results.Expect(view.FrameNumber() == frame.FrameNumber() && view.Timecode() == frame.Timecode() &&
+      view.TimecodeSubframe() == frame.TimecodeSubframe() && view.Timestamp() == frame.Timestamp() &&
+      view.CameraMidExposureTimestamp() == frame.CameraMidExposureTimestamp() &&
+      view.CameraDataReceivedTimestamp() == frame.CameraDataReceivedTimestamp() &&
+      view.TransmitTimestamp() == frame.TransmitTimestamp() && view.Params() == frame.Params(), "view header");
+
+    bool markersOk = view.MarkerSetCount() == frame.MarkerSetCount() && view.OtherMarkerCount() == frame.OtherMarkerCount();
+    for (int i = 0; markersOk && i < frame.MarkerSetCount(); i++)
+    {
+      markersOk = strcmp(view.MarkerSetName(i), frame.MarkerSetName(i)) == 0 &&
+        view.MarkerSetMarkerCount(i) == frame.MarkerSetMarkerCount(i);
+      for (int m = 0; markersOk && m < frame.MarkerSetMarkerCount(i); m++)
+      {
+        MarkerData marker;
+        view.GetMarkerSetMarker(i, m, marker);
+        markersOk = memcmp(marker, frame.MarkerSetMarkers(i)[m], sizeof(marker)) == 0;
+      }
+    }
+    for (int i = 0; markersOk && i < frame.OtherMarkerCount(); i++)
+    {
+      MarkerData marker;
+      view.GetOtherMarker(i, marker);
+      markersOk = memcmp(marker, frame.OtherMarkers()[i], sizeof(marker)) == 0;
+    }
+    results.Expect(markersOk, "view marker sets and other markers");
+
+    sRigidBodyData rb;
+    bool bodiesOk = view.RigidBodyCount() == frame.RigidBodyCount() && view.SkeletonCount() == frame.SkeletonCount();
+    for (int i = 0; bodiesOk && i < frame.RigidBodyCount(); i++)
+    {
+      view.GetRigidBody(i, rb);
+      bodiesOk = SameRigidBody(rb, frame.RigidBodies()[i]);
+    }
+    for (int i = 0; bodiesOk && i < frame.SkeletonCount(); i++)
+    {
+      bodiesOk = view.SkeletonID(i) == frame.SkeletonID(i) && view.SkeletonBoneCount(i) == frame.SkeletonBoneCount(i);
+      for (int b = 0; bodiesOk && b < frame.SkeletonBoneCount(i); b++)
+      {
+        view.GetSkeletonBone(i, b, rb);
+        bodiesOk = SameRigidBody(rb, frame.SkeletonBones(i)[b]);
+      }
+    }
+    results.Expect(bodiesOk, "view rigid bodies and skeletons");
+
+    bool labeledOk = view.LabeledMarkerCount() == frame.LabeledMarkerCount();
+    for (int i = 0; labeledOk && i < frame.LabeledMarkerCount(); i++)
+    {
+      sMarker marker;
+      view.GetLabeledMarker(i, marker);
+      const sMarker& expected = frame.LabeledMarkers()[i];
+      labeledOk = marker.ID == expected.ID && marker.x == expected.x && marker.y == expected.y &&
+        marker.z == expected.z && marker.size == expected.size && marker.params == expected.params &&
+        marker.residual == expected.residual;
+    }
+    results.Expect(labeledOk, "view labeled markers");
+
+    static sForcePlateData plate, expectedPlate;
+    bool platesOk = view.ForcePlateCount() == frame.ForcePlateCount() && view.DeviceCount() == frame.DeviceCount();
+    for (int i = 0; platesOk && i < frame.ForcePlateCount(); i++)
+    {
+      view.GetForcePlate(i, plate);
+      frame.GetForcePlate(i, expectedPlate);
+      platesOk = SameAnalog(plate.ID, plate.nChannels, plate.ChannelData,
+        expectedPlate.ID, expectedPlate.nChannels, expectedPlate.ChannelData);
+    }
+    results.Expect(platesOk, "view force plates");
+  }
+
+  // Decodes a generated frame of version Major.Minor and compares it with
+  // what was written, and the frame view of it with the decoded frame.
+  template<int Major, int Minor>
+  void CheckVersion(CheckResults& results)
+  {
+    typedef BitstreamTraits<Major, Minor> Traits;
+    static sPacket packet;
+    static sPacket truncated;
+    static FrameView view;
+    CompactFrame frame;
+
+    const uint8_t version[4] = { (uint8_t)Major, (uint8_t)Minor, 0, 0 };
+    const FrameDecodeFn decode = SelectFrameDecoder(version);
+    results.Expect(decode == &DecodeFrame<Major, Minor>, "version selects its specialized decoder");
+
+    const int32_t frameNumber = 4321;
+    if (!results.Expect(WriteFrame<Major, Minor>(packet, kContent, frameNumber) > 0, "frame fits a packet") ||
+      !results.Expect(decode(&packet, FrameSection_All, frame), "frame decodes"))
+      return;
+
+    results.Expect(frame.FrameNumber() == frameNumber, "frame number");
+    results.Expect(frame.MarkerSetCount() == 1 && strcmp(frame.MarkerSetName(0), "all") == 0 &&
+      frame.MarkerSetMarkerCount(0) == kContent.markersPerSet, "marker sets");
+    results.Expect(frame.OtherMarkerCount() == kContent.otherMarkers &&
+      frame.OtherMarkers()[2][0] == Value(frameNumber, 6, 1), "other markers");
+
+    bool bodiesOk = frame.RigidBodyCount() == kContent.rigidBodies;
+    for (int i = 0; bodiesOk && i < kContent.rigidBodies; i++)
+    {
+      const sRigidBodyData& rb = frame.RigidBodies()[i];
+      bodiesOk = rb.ID == i + 1 && rb.x == Value(frameNumber, i, 0) && rb.qw == Value(frameNumber, i, 6) &&
+        rb.MeanError == (Traits::kRigidBodyMeanError ? 0.25f : 0.0f) && rb.params == 0x01;
+    }
+    results.Expect(bodiesOk, "rigid bodies");
+
+    if (Traits::kHasSkeletons)
+    {
+      const int last = kContent.bonesPerSkeleton - 1;
+      results.Expect(frame.SkeletonCount() == kContent.skeletons && frame.SkeletonID(1) == 2 &&
+        frame.SkeletonBoneCount(1) == kContent.bonesPerSkeleton &&
+        frame.SkeletonBones(1)[last].ID == ((2 << 16) | (last + 1)) &&
+        frame.SkeletonBones(1)[last].qz == Value(frameNumber, last, 5), "skeletons");
+    }
+    else
+      results.Expect(frame.SkeletonCount() == 0, "no skeletons before 2.1");
+
+    if (Traits::kHasLabeledMarkers)
+    {
+      const sMarker& m = frame.LabeledMarkers()[kContent.labeledMarkers - 1];
+      results.Expect(frame.LabeledMarkerCount() == kContent.labeledMarkers && m.ID == kContent.labeledMarkers &&
+        m.z == Value(frameNumber, kContent.labeledMarkers - 1, 2) && m.size == 14.0f &&
+        m.residual == (Traits::kLabeledMarkerResidual ? 0.5f : 0.0f), "labeled markers");
+    }
+
+    if (Traits::kHasForcePlates)
+    {
+      static sForcePlateData plate;
+      results.Expect(frame.ForcePlateCount() == kContent.forcePlates, "force plate count");
+      frame.GetForcePlate(1, plate);
+      results.Expect(plate.ID == 2 && plate.nChannels == kContent.forcePlateChannels &&
+        plate.ChannelData[3].nFrames == 1 && plate.ChannelData[3].Values[0] == Value(frameNumber, 1, 3), "force plates");
+    }
+
+    results.Expect(frame.Timecode() == 0x01020304 && frame.TimecodeSubframe() == 5, "timecode");
+    results.Expect(frame.TransmitTimestamp() == (Traits::kHighResTimestamps ? 3000u : 0u), "transmit timestamp");
+
+    if (results.Expect(view.Attach(&packet, version), "view attaches"))
+      CheckView(results, view, frame);
+
+    // unsubscribed sections are skipped and stay empty
+    results.Expect(decode(&packet, FrameSection_RigidBodies, frame) && frame.RigidBodyCount() == kContent.rigidBodies &&
+      frame.RigidBodies()[3].qx == Value(frameNumber, 3, 3) && frame.MarkerSetCount() == 0 &&
+      frame.LabeledMarkerCount() == 0 && frame.SkeletonCount() == 0 && frame.ForcePlateCount() == 0 &&
+      frame.Timecode() == 0x01020304, "rigid bodies only");
+
+    // every truncation is rejected; the end of data tag is not read
+    const int payload = packet.nDataBytes - 4;
+    bool truncationsRejected = true;
+    for (int bytes = 0; bytes < payload; bytes += 3)
+    {
+      memcpy(&truncated, &packet, 4 + bytes);
+      truncated.nDataBytes = (uint16_t)bytes;
+      truncationsRejected &= !decode(&truncated, FrameSection_All, frame) && !view.Attach(&truncated, version);
+    }
+    results.Expect(truncationsRejected, "truncated frames are rejected");
+
+    truncated = packet;
+    truncated.nDataBytes = 0xFFFF;
+    results.Expect(!decode(&truncated, FrameSection_All, frame) && !view.Attach(&truncated, version),
+      "payload size above MAX_PACKETSIZE is rejected");
+  }
+
+  // Prints the decode cost of one frame of version Major.Minor, and the
+  // cost of attaching a view to it and reading the rigid bodies.
+  template<int Major, int Minor>
+  void BenchmarkVersion()
+  {
+    static sPacket packet;
+    static FrameView view;
+    WriteFrame<Major, Minor>(packet, kContent, 1);
+    const uint8_t version[4] = { (uint8_t)Major, (uint8_t)Minor, 0, 0 };
+    CompactFrame frame;
+    volatile int sink = 0;
+
+    const double all = NanosecondsPerCall(20000, [&](int) {
+      DecodeFrame<Major, Minor>(&packet, FrameSection_All, frame);
+      sink += frame.RigidBodyCount();
+    });
+    const double rigidBodies = NanosecondsPerCall(20000, [&](int) {
+      DecodeFrame<Major, Minor>(&packet, FrameSection_RigidBodies, frame);
+      sink += frame.RigidBodyCount();
+    });
+    const double viewed = NanosecondsPerCall(20000, [&](int) {
+      view.Attach(&packet, version);
+      sRigidBodyData rb;
+      for (int i = 0; i < view.RigidBodyCount(); i++)
+      {
+        view.GetRigidBody(i, rb);
+        sink += rb.ID;
+      }
+    });
+    printf("  %d.%-2d %6d bytes  %8.0f ns/frame  %8.0f ns/frame rigid bodies only  %8.0f ns/frame view\n",
+      Major, Minor, (int)packet.nDataBytes, all, rigidBodies, viewed);
+  }
+}
+
+int RunDecoderChecks(bool benchmark)
+{
+  CheckResults results;
+  CheckVersion<2, 0>(results);
+  CheckVersion<2, 3>(results);
+  CheckVersion<2, 6>(results);
+  CheckVersion<2, 7>(results);
+  CheckVersion<2, 9>(results);
+  CheckVersion<2, 11>(results);
+  CheckVersion<3, 0>(results);
+  CheckVersion<3, 1>(results);
+
+  const uint8_t latest[4] = { 0, 0, 0, 0 };
+  const uint8_t unsupported[4] = { 4, 0, 0, 0 };
+  results.Expect(SelectFrameDecoder(latest) == &DecodeFrame<3, 1>, "0.0 selects the latest decoder");
+  results.Expect(SelectFrameDecoder(unsupported) == nullptr, "unsupported version selects no decoder");
+
+  if (benchmark)
+  {
+    printf("  decode cost, %d rigid bodies, %d x %d bones, %d labeled markers:\n",
+      kContent.rigidBodies, kContent.skeletons, kContent.bonesPerSkeleton, kContent.labeledMarkers);
+    BenchmarkVersion<2, 0>();
+    BenchmarkVersion<2, 6>();
+    BenchmarkVersion<2, 11>();
+    BenchmarkVersion<3, 0>();
+    BenchmarkVersion<3, 1>();
+  }
+
+  return results.failures;
+}
@@ -0,0 +1,274 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ClientChecks.h"
+#include "PoseEuler.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseEulerXYZr checks against Eul_FromQuat(q, EulOrdXYZr), from the
+// polynomial atan2 to gimbal lock, and the cost of 1000 poses
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const int kPoses = 1000;
+  const double kPi = 3.14159265358979323846;
+
+  // Linear congruential generator, so every build checks the same poses.
+  struct Random
+  {
+    uint32_t state;
+
+    explicit Random(uint32_t seed) : state(seed) {}
+
+    // Uniform in [0, 1).
+    double Next()
+    {
+      state = state * 1664525u + 1013904223u;
+      return (state >> 8) * (1.0 / 16777216.0);
+    }
+  };
+
+  // Uniformly distributed rotation (Shoemake) scaled to the given norm.
+  Quat RandomQuat(Random& random, double norm)
+  {
+    const double u1 = random.Next();
+    const double u2 = 2.0 * kPi * random.Next();
+    const double u3 = 2.0 * kPi * random.Next();
+    const double a = sqrt(1.0 - u1) * norm;
+    const double b = sqrt(u1) * norm;
+    const Quat q = { (float)(a * sin(u2)), (float)(a * cos(u2)), (float)(b * sin(u3)), (float)(b * cos(u3)) };
+    return q;
+  }
+
+  // Difference of two angles, wrapped to [0, pi].
+  double AngleError(double a, double b)
+  {
+    const double d = fmod(fabs(a - b), 2.0 * kPi);
+    return d > kPi ? 2.0 * kPi - d : d;
+  }
+
+  double EulerError(const EulerAngles& a, const EulerAngles& b)
+  {
+    return fmax(AngleError(a.x, b.x), fmax(AngleError(a.y, b.y), AngleError(a.z, b.z)));
+  }
+
+  double Degrees(double radians)
+  {
+    return radians * 180.0 / kPi;
+  }
+
+  // Structure of arrays quaternions and the batch angles of them.
+  struct Batch
+  {
+    std::vector<float> qx, qy, qz, qw, ax, ay, az;
+
+    explicit Batch(const std::vector<Quat>& quats)
+      : qx(quats.size()), qy(quats.size()), qz(quats.size()), qw(quats.size()),
+        ax(quats.size()), ay(quats.size()), az(quats.size())
+    {
+      for (size_t i = 0; i < quats.size(); i++)
+      {
+        qx[i] = quats[i].x;
+        qy[i] = quats[i].y;
+        qz[i] = quats[i].z;
+        qw[i] = quats[i].w;
+      }
+    }
+
+    void Convert(int first, int count)
+    {
+      PoseEulerXYZr(&qx[first], &qy[first], &qz[first], &qw[first], count, &ax[first], &ay[first], &az[first]);
+    }
+
+    EulerAngles Angles(int i) const
+    {
+      const EulerAngles ea = { ax[i], ay[i], az[i], (float)EulOrdXYZr };
+      return ea;
+    }
+  };
+
+  // The polynomial atan2 against atan2 in double: around the circle at
+  // several radii, tiny and huge ratios, zeros and random pairs.
+  void CheckAtan2(CheckResults& results)
+  {
+    double error = 0.0;
+    const float radii[] = { 1e-30f, 1e-3f, 1.0f, 7.5f, 1e30f };
+    for (float radius : radii)
+    {
+      for (int i = 0; i < 100000; i++)
+      {
+        const double angle = 2.0 * kPi * i / 100000.0 - kPi;
+        const float y = (float)(radius * sin(angle));
+        const float x = (float)(radius * cos(angle));
+        error = fmax(error, fabs(PoseAtan2(y, x) - atan2((double)y, (double)x)));
+      }
+    }
+
+    Random random(7);
+    for (int i = 0; i < 100000; i++)
+    {
+      const float y = (float)((random.Next() - 0.5) * pow(10.0, 12.0 * random.Next() - 6.0));
+      const float x = (float)((random.Next() - 0.5) * pow(10.0, 12.0 * random.Next() - 6.0));
+      error = fmax(error, fabs(PoseAtan2(y, x) - atan2((double)y, (double)x)));
+    }
+
+    const float zeros[][2] = { { 0.0f, 1.0f }, { 0.0f, -1.0f }, { -0.0f, -1.0f }, { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, 0.0f } };
+    for (const float* pair : zeros)
+      error = fmax(error, fabs(PoseAtan2(pair[0], pair[1]) - atan2((double)pair[0], (double)pair[1])));
+
+    printf("  atan2: within %.3e\n", error);
+    results.Expect(error < 2.5e-7, "the polynomial atan2 is within 2.5e-7 of atan2");
+  }
+
+  // Random rotations of the given norms against Eul_FromQuat, away from
+  // gimbal lock (|yaw| < 89 degrees), for the batch and the single pose
+  // version.
+  void CheckRotations(CheckResults& results, double minNorm, double maxNorm, double bound, const char* what)
+  {
+    Random random(11);
+    std::vector<Quat> quats(100000);
+    for (Quat& q : quats)
+      q = RandomQuat(random, minNorm + (maxNorm - minNorm) * random.Next());
+
+    Batch batch(quats);
+    batch.Convert(0, (int)quats.size());
+
+    double error = 0.0, singleError = 0.0;
+    int compared = 0;
+    for (size_t i = 0; i < quats.size(); i++)
+    {
+      const EulerAngles expected = Eul_FromQuat(quats[i], EulOrdXYZr);
+      if (fabs(Degrees(expected.y)) >= 89.0)
+        continue;
+      error = fmax(error, EulerError(batch.Angles((int)i), expected));
+      singleError = fmax(singleError, EulerError(PoseEulerXYZr(quats[i]), expected));
+      compared++;
+    }
+
+    printf("  %s (%d poses): batch within %.1e, single pose within %.1e\n", what, compared, error, singleError);
+    results.Expect(compared > 90000 && error < bound && singleError < bound, what);
+  }
+
+  // Rotations with |yaw| between 89.9 and 89.99 degrees, where every
+  // decomposition is ill-conditioned, and at 90 degrees, where the gimbal
+  // lock branch puts the whole rotation into roll.
+  void CheckGimbalLock(CheckResults& results)
+  {
+    Random random(13);
+    double nearError = 0.0;
+    for (int i = 0; i < 100000; i++)
+    {
+      const double yaw = (89.9 + 0.09 * random.Next()) * kPi / 180.0 * (i % 2 ? -1.0 : 1.0);
+      const EulerAngles ea = Eul_((float)(2.0 * kPi * random.Next() - kPi), (float)yaw,
+        (float)(2.0 * kPi * random.Next() - kPi), EulOrdXYZr);
+      const Quat q = Eul_ToQuat(ea);
+      nearError = fmax(nearError, EulerError(PoseEulerXYZr(q), Eul_FromQuat(q, EulOrdXYZr)));
+    }
+    printf("  |yaw| 89.9 to 89.99 degrees: within %.1e\n", nearError);
+    results.Expect(nearError < 1.4e-3, "near gimbal lock within 1.4e-3 of Eul_FromQuat");
+
+    double lockError = 0.0;
+    bool branchOk = true;
+    for (int i = 0; i < 1000; i++)
+    {
+      const double yaw = kPi / 2.0 * (i % 2 ? -1.0 : 1.0);
+      const EulerAngles ea = Eul_((float)(2.0 * kPi * random.Next() - kPi), (float)yaw,
+        (float)(2.0 * kPi * random.Next() - kPi), EulOrdXYZr);
+      const Quat q = Eul_ToQuat(ea);
+      const EulerAngles expected = Eul_FromQuat(q, EulOrdXYZr);
+      const EulerAngles actual = PoseEulerXYZr(q);
+      branchOk &= expected.x == 0.0f && actual.x == 0.0f;
+      lockError = fmax(lockError, EulerError(actual, expected));
+    }
+    printf("  gimbal lock: within %.1e\n", lockError);
+    results.Expect(branchOk, "gimbal lock puts the rotation into roll");
+    results.Expect(lockError < 1e-5, "gimbal lock within 1e-5 of Eul_FromQuat");
+  }
+
+  // Every pose gives the same bits on the AVX2, SSE2 and scalar paths:
+  // batches of 1 to 24 poses from several offsets put each pose in every
+  // lane and in the tail, against the single pose version.
+  void CheckPaths(CheckResults& results)
+  {
+    Random random(17);
+    std::vector<Quat> quats(64);
+    for (size_t i = 0; i < quats.size(); i++)
+      quats[i] = RandomQuat(random, i % 3 ? 1.0 : 0.5 + 1.5 * random.Next());
+    // gimbal lock and zero quaternions
+    const float h = sqrtf(0.5f);
+    const Quat special[] = { { 0.0f, h, 0.0f, h }, { 0.0f, -h, 0.0f, h }, { 0.5f, 0.5f, -0.5f, 0.5f }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+    for (int i = 0; i < 4; i++)
+      quats[i * 13] = special[i];
+
+    std::vector<EulerAngles> single(quats.size());
+    for (size_t i = 0; i < quats.size(); i++)
+      single[i] = PoseEulerXYZr(quats[i]);
+
+    bool same = true;
+    Batch batch(quats);
+    for (int count = 1; count <= 24; count++)
+    {
+      for (int first = 0; first + count <= (int)quats.size(); first += 7)
+      {
+        batch.Convert(first, count);
+        for (int i = first; i < first + count; i++)
+        {
+          const EulerAngles ea = batch.Angles(i);
+          same &= memcmp(&ea, &single[i], sizeof(ea)) == 0;
+        }
+      }
+    }
+    results.Expect(same, "every path gives the same bits");
+  }
+
+  // Prints the cost of 1000 poses through Eul_FromQuat, the single pose
+  // version and the batch, and checks the batch is the fastest.
+  void BenchmarkEuler(CheckResults& results)
+  {
+    Random random(19);
+    std::vector<Quat> quats(kPoses);
+    for (Quat& q : quats)
+      q = RandomQuat(random, 1.0);
+    Batch batch(quats);
+
+    volatile float sink = 0.0f;
+    const double reference = NanosecondsPerCall(200, [&](int) {
+      float sum = 0.0f;
+      for (const Quat& q : quats)
+        sum += Eul_FromQuat(q, EulOrdXYZr).y;
+      sink = sum;
+    });
+    const double single = NanosecondsPerCall(200, [&](int) {
+      float sum = 0.0f;
+      for (const Quat& q : quats)
+        sum += PoseEulerXYZr(q).y;
+      sink = sum;
+    });
+    const double batched = NanosecondsPerCall(2000, [&](int) { batch.Convert(0, kPoses); });
+    (void)sink;
+
+    printf("  %d poses: Eul_FromQuat %6.1f us, single pose %6.1f us, batch %6.1f us\n",
+      kPoses, reference / 1000.0, single / 1000.0, batched / 1000.0);
+    results.Expect(batched < single && batched < reference, "the batch is the fastest");
+  }
+}
+
+
+int RunEulerChecks(bool benchmark)
+{
+  CheckResults results;
+  CheckAtan2(results);
+  CheckRotations(results, 1.0, 1.0, 5.0e-6, "unit quaternions within 5.0e-6 of Eul_FromQuat");
+  CheckRotations(results, 0.5, 2.0, 6.4e-6, "quaternions of norm 0.5 to 2 within 6.4e-6 of Eul_FromQuat");
+  CheckGimbalLock(results);
+  CheckPaths(results);
+
+  if (benchmark)
+    BenchmarkEuler(results);
+
+  return results.failures;
+}
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ClientChecks.h"
+#include "NATUtils.h"
+#include "PoseMatrix.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseMatrices checks against QaternionToRotationMatrix and a double
+// precision inverse, and the cost of 1000 poses
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const int kPoses = 1000;
+  const double kPi = 3.14159265358979323846;
+
+  // Bounds of the inverse, both for M * M^-1 computed in double against
+  // the identity and for M^-1 against the inverse of M in double: the
+  // rotation block within kRotationBound and the translation within
+  // kTranslationBound * |t|, with translations up to 1000. Against the
+  // double inverse, errors are relative to its largest rotation element,
+  // which grows above 1 for quaternions shorter than unit length.
+  const double kRotationBound = 5e-7;
+  const double kTranslationBound = 5e-7;
+
+  // Cost of the inverses of 1000 poses before PoseMatrices: a general 4x4
+  // cofactor inverse per body.
+  const double kPerBodyInverseNs = 50000.0;
+
+  // Linear congruential generator, so every build checks the same poses.
+  struct Random
+  {
+    uint32_t state;
+
+    explicit Random(uint32_t seed) : state(seed) {}
+
+    // Uniform in [0, 1).
+    double Next()
+    {
+      state = state * 1664525u + 1013904223u;
+      return (state >> 8) * (1.0 / 16777216.0);
+    }
+  };
+
+  // Structure of arrays poses with their matrices and inverses.
+  struct Poses
+  {
+    std::vector<float> x, y, z, qx, qy, qz, qw, matrices, inverses;
+
+    explicit Poses(int count)
+      : x(count), y(count), z(count), qx(count), qy(count), qz(count), qw(count),
+        matrices(16 * count), inverses(16 * count)
+    {
+    }
+
+    int Count() const { return (int)x.size(); }
+
+    // Random translations within +-range and uniformly distributed
+    // rotations (Shoemake) with norms between minNorm and maxNorm.
+    void Randomize(Random& random, double range, double minNorm, double maxNorm)
+    {
+      for (int i = 0; i < Count(); i++)
+      {
+        x[i] = (float)(range * (2.0 * random.Next() - 1.0));
+        y[i] = (float)(range * (2.0 * random.Next() - 1.0));
+        z[i] = (float)(range * (2.0 * random.Next() - 1.0));
+
+        const double norm = minNorm + (maxNorm - minNorm) * random.Next();
+        const double u1 = random.Next();
+        const double u2 = 2.0 * kPi * random.Next();
+        const double u3 = 2.0 * kPi * random.Next();
+        const double a = sqrt(1.0 - u1) * norm;
+        const double b = sqrt(u1) * norm;
+        qx[i] = (float)(a * sin(u2));
+        qy[i] = (float)(a * cos(u2));
+        qz[i] = (float)(b * sin(u3));
+        qw[i] = (float)(b * cos(u3));
+      }
+    }
+
+    void Convert(int first, int count, bool withInverses)
+    {
+      PoseMatrices(&x[first], &y[first], &z[first], &qx[first], &qy[first], &qz[first], &qw[first], count,
+        &matrices[16 * first], withInverses ? &inverses[16 * first] : nullptr);
+    }
+  };
+
+  // The matrix the per body code built: QaternionToRotationMatrix and
+  // the translation.
+  void ReferenceMatrix(const Poses& poses, int i, float* m)
+  {
+    float q[4] = { poses.qx[i], poses.qy[i], poses.qz[i], poses.qw[i] };
+    float r[9];
+    NATUtils::QaternionToRotationMatrix(q, r);
+    m[0] = r[0]; m[4] = r[3]; m[8] = r[6];  m[12] = poses.x[i];
+    m[1] = r[1]; m[5] = r[4]; m[9] = r[7];  m[13] = poses.y[i];
+    m[2] = r[2]; m[6] = r[5]; m[10] = r[8]; m[14] = poses.z[i];
+    m[3] = 0.0f; m[7] = 0.0f; m[11] = 0.0f; m[15] = 1.0f;
+  }
+
+  // Largest errors of M * M^-1 in double against the identity: in the
+  // rotation block and in the translation relative to max(1, |t|).
+  void MeasureProduct(const float* m, const float* inv, double& rotationError, double& translationError)
+  {
+    const double t = fmax(1.0, sqrt((double)m[12] * m[12] + (double)m[13] * m[13] + (double)m[14] * m[14]));
+    for (int c = 0; c < 4; c++)
+    {
+      for (int r = 0; r < 4; r++)
+      {
+        double product = 0.0;
+        for (int k = 0; k < 4; k++)
+          product += (double)m[4 * k + r] * inv[4 * c + k];
+        const double error = fabs(product - (r == c ? 1.0 : 0.0));
+        if (c < 3)
+          rotationError = fmax(rotationError, error);
+        else
+          translationError = fmax(translationError, error / t);
+      }
+    }
+  }
+
+  // Largest errors of inv against the inverse of m in double, the
+  // adjugate of the rotation over its determinant and -R^-1 t, relative
+  // to the largest element of R^-1 where that is above 1.
+  void MeasureReference(const float* m, const float* inv, double& rotationError, double& translationError)
+  {
+    double r[3][3], a[3][3];
+    for (int c = 0; c < 3; c++)
+      for (int k = 0; k < 3; k++)
+        r[k][c] = m[4 * c + k];
+    for (int i = 0; i < 3; i++)
+    {
+      for (int j = 0; j < 3; j++)
+      {
+        // a[i][j] is the cofactor of r[j][i]
+        const int r0 = (j + 1) % 3, r1 = (j + 2) % 3, c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+        a[i][j] = r[r0][c0] * r[r1][c1] - r[r0][c1] * r[r1][c0];
+      }
+    }
+    const double det = r[0][0] * a[0][0] + r[0][1] * a[1][0] + r[0][2] * a[2][0];
+    double scale = 1.0;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        scale = fmax(scale, fabs(a[i][j] / det));
+
+    const double t = fmax(1.0, sqrt((double)m[12] * m[12] + (double)m[13] * m[13] + (double)m[14] * m[14]));
+    for (int i = 0; i < 3; i++)
+    {
+      double translation = 0.0;
+      for (int j = 0; j < 3; j++)
+      {
+        rotationError = fmax(rotationError, fabs(inv[4 * j + i] - a[i][j] / det) / scale);
+        translation -= a[i][j] / det * m[12 + j];
+      }
+      translationError = fmax(translationError, fabs(inv[12 + i] - translation) / (scale * t));
+    }
+  }
+
+  // Forward matrices are the per body matrices to the bit, for unit and
+  // other quaternions.
+  void CheckForward(CheckResults& results)
+  {
+    Random random(23);
+    Poses poses(kPoses + 3);
+    bool same = true;
+    for (int set = 0; set < 2; set++)
+    {
+      poses.Randomize(random, 1000.0, set == 0 ? 1.0 : 0.5, set == 0 ? 1.0 : 2.0);
+      poses.Convert(0, poses.Count(), false);
+      for (int i = 0; i < poses.Count(); i++)
+      {
+        float m[16];
+        ReferenceMatrix(poses, i, m);
+        same &= memcmp(m, &poses.matrices[16 * i], sizeof(m)) == 0;
+      }
+    }
+    results.Expect(same, "matrices are QaternionToRotationMatrix's to the bit");
+  }
+
+  // M * M^-1 against the identity for quaternions of the given norms.
+  void CheckInverse(CheckResults& results, double minNorm, double maxNorm, const char* what)
+  {
+    Random random(29);
+    Poses poses(kPoses + 3);
+    double rotationError = 0.0, translationError = 0.0;
+    double referenceRotationError = 0.0, referenceTranslationError = 0.0;
+    for (int set = 0; set < 20; set++)
+    {
+      poses.Randomize(random, set % 2 ? 1000.0 : 1.0, minNorm, maxNorm);
+      poses.Convert(0, poses.Count(), true);
+      for (int i = 0; i < poses.Count(); i++)
+      {
+        MeasureProduct(&poses.matrices[16 * i], &poses.inverses[16 * i], rotationError, translationError);
+        MeasureReference(&poses.matrices[16 * i], &poses.inverses[16 * i], referenceRotationError, referenceTranslationError);
+      }
+    }
+
+    printf("  %s: M * M^-1 within %.1e and %.1e * |t|, M^-1 within %.1e and %.1e * |t|\n", what,
+      rotationError, translationError, referenceRotationError, referenceTranslationError);
+    results.Expect(rotationError < kRotationBound && translationError < kTranslationBound &&
+      referenceRotationError < kRotationBound && referenceTranslationError < kTranslationBound, what);
+  }
+
+  // A singular matrix gives an inverse of zeros.
+  void CheckSingular(CheckResults& results)
+  {
+    Poses poses(1);
+    poses.x[0] = 1.0f;
+    poses.y[0] = 2.0f;
+    poses.z[0] = 3.0f;
+    poses.qx[0] = 0.5f;
+    poses.qy[0] = 0.5f;
+    poses.qz[0] = 0.0f;
+    poses.qw[0] = 0.0f;
+    poses.Convert(0, 1, true);
+    bool zeros = true;
+    for (int k = 0; k < 16; k++)
+      zeros &= poses.inverses[k] == 0.0f;
+    results.Expect(zeros, "a singular matrix gives an inverse of zeros");
+  }
+
+  // Every pose gives the same bits on the AVX2, SSE2 and scalar paths:
+  // batches of 1 to 24 poses from several offsets put each pose in every
+  // lane and in the tail, against the pose converted alone.
+  void CheckPaths(CheckResults& results)
+  {
+    Random random(31);
+    Poses poses(64);
+    poses.Randomize(random, 1000.0, 0.5, 2.0);
+
+    for (int i = 0; i < poses.Count(); i++)
+      poses.Convert(i, 1, true);
+    const std::vector<float> matrices = poses.matrices;
+    const std::vector<float> inverses = poses.inverses;
+
+    bool same = true;
+    for (int count = 1; count <= 24; count++)
+    {
+      for (int first = 0; first + count <= poses.Count(); first += 7)
+      {
+        std::fill(poses.matrices.begin(), poses.matrices.end(), 0.0f);
+        std::fill(poses.inverses.begin(), poses.inverses.end(), 0.0f);
+        poses.Convert(first, count, true);
+        same &= memcmp(&poses.matrices[16 * first], &matrices[16 * first], 16 * count * sizeof(float)) == 0 &&
+          memcmp(&poses.inverses[16 * first], &inverses[16 * first], 16 * count * sizeof(float)) == 0;
+      }
+    }
+    results.Expect(same, "every path gives the same bits");
+  }
+
+  // Prints the cost of 1000 poses as the per body code built them, and
+  // batched with and without inverses, and checks the inverses cost less
+  // than the per body inverse did.
+  void BenchmarkMatrices(CheckResults& results)
+  {
+    Random random(37);
+    Poses poses(kPoses);
+    poses.Randomize(random, 1000.0, 1.0, 1.0);
+
+    const double reference = NanosecondsPerCall(2000, [&](int) {
+      for (int i = 0; i < kPoses; i++)
+        ReferenceMatrix(poses, i, &poses.matrices[16 * i]);
+    });
+    const double forward = NanosecondsPerCall(2000, [&](int) { poses.Convert(0, kPoses, false); });
+    const double inverse = NanosecondsPerCall(2000, [&](int) { poses.Convert(0, kPoses, true); });
+
+    printf("  %d poses: per body %6.1f us, batch %6.1f us, with inverses %6.1f us\n",
+      kPoses, reference / 1000.0, forward / 1000.0, inverse / 1000.0);
+    results.Expect(inverse < kPerBodyInverseNs, "1000 matrices with inverses take less than 50 us");
+  }
+}
+
+
+int RunMatrixChecks(bool benchmark)
+{
+  CheckResults results;
+  CheckForward(results);
+  CheckInverse(results, 1.0, 1.0, "unit quaternions");
+  CheckInverse(results, 0.8, 1.25, "quaternions of norm 0.8 to 1.25");
+  CheckSingular(results);
+  CheckPaths(results);
+
+  if (benchmark)
+    BenchmarkMatrices(results);
+
+  return results.failures;
+}
@@ -0,0 +1,435 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ClientChecks.h"
+#include "SkeletonHierarchy.h"
+
+//////////////////////////////////////////////////////////////////////////
+// SkeletonHierarchy checks, both directions against a double precision
+// reference, and the solve cost of 100 skeletons of 200 bones
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Parent per bone ID of a 21 bone body (hips, spine, arms, legs), index
+  // 0 unused.
+  const int kBodyParents[22] =
+  {
+    0, 0, 1, 2, 3, 4, 3, 6, 7, 8, 3, 10, 11, 12, 1, 14, 15, 16, 1, 18, 19, 20
+  };
+
+  const int kBodyBones = 21;
+
+  // Frame time at 240 Hz, the budget of one solve with everything else.
+  const double kFrameBudgetNs = 1e9 / 240.0;
+
+  // Skeleton descriptions; the description array points into skeletons.
+  struct Descriptions
+  {
+    std::vector<sSkeletonDescription> skeletons;
+    sDataDescriptions defs;
+
+    explicit Descriptions(int count) : skeletons(count) { defs.nDataDescriptions = 0; }
+
+    // Describes skeleton s with bone IDs 1 to bones and parents[id] as the
+    // parent of bone id, listed children first.
+    sSkeletonDescription& Add(int s, int32_t skeletonID, int bones, const int* parents)
+    {
+      sSkeletonDescription& skeleton = skeletons[s];
+      memset(&skeleton, 0, sizeof(skeleton));
+      sprintf(skeleton.szName, "Skeleton%d", skeletonID);
+      skeleton.skeletonID = skeletonID;
+      skeleton.nRigidBodies = bones;
+      for (int b = 0; b < bones; b++)
+      {
+        sRigidBodyDescription& bone = skeleton.RigidBodies[b];
+        bone.ID = bones - b;
+        bone.parentID = parents[bone.ID];
+        bone.offsetx = 0.01f * bone.ID;
+        bone.offsety = 0.1f;
+        bone.offsetz = -0.02f * bone.ID;
+      }
+
+      sDataDescription& desc = defs.arrDataDescriptions[defs.nDataDescriptions++];
+      desc.type = Descriptor_Skeleton;
+      desc.Data.SkeletonDescription = &skeleton;
+      return skeleton;
+    }
+  };
+
+  // Streamed local poses of a skeleton: unit quaternions and positions
+  // near the bone offsets. Frame data IDs carry the skeleton ID.
+  void MakeBones(int32_t skeletonID, int count, int frame, std::vector<sRigidBodyData>& bones)
+  {
+    bones.assign(count, sRigidBodyData());
+    for (int b = 0; b < count; b++)
+    {
+      sRigidBodyData& bone = bones[b];
+      const int id = b + 1;
+      const float t = (float)(frame * 31 + skeletonID * 7 + id);
+      bone.ID = (skeletonID << 16) | id;
+      bone.x = 0.01f * id + 0.05f * sinf(t);
+      bone.y = 0.1f + 0.05f * cosf(t * 1.3f);
+      bone.z = -0.02f * id + 0.05f * sinf(t * 0.7f);
+
+      const float axis[3] = { sinf(t * 0.9f), cosf(t * 0.4f), 0.6f };
+      const float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+      const float angle = fmodf(t * 0.61f, 6.2f);
+      const float s = sinf(angle / 2.0f) / length;
+      bone.qx = axis[0] * s;
+      bone.qy = axis[1] * s;
+      bone.qz = axis[2] * s;
+      bone.qw = cosf(angle / 2.0f);
+    }
+  }
+
+  struct ReferencePose
+  {
+    double p[3];
+    double q[4];
+  };
+
+  // r = a * b for quaternions x, y, z, w.
+  void Multiply(const double* a, const double* b, double* r)
+  {
+    r[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+    r[1] = a[3] * b[1] + a[1] * b[3] + a[2] * b[0] - a[0] * b[2];
+    r[2] = a[3] * b[2] + a[2] * b[3] + a[0] * b[1] - a[1] * b[0];
+    r[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+  }
+
+  // r = v rotated by the unit quaternion q: v + w t + q.xyz x t with
+  // t = 2 q.xyz x v.
+  void Rotate(const double* q, const double* v, double* r)
+  {
+    const double t[3] =
+    {
+      2.0 * (q[1] * v[2] - q[2] * v[1]),
+      2.0 * (q[2] * v[0] - q[0] * v[2]),
+      2.0 * (q[0] * v[1] - q[1] * v[0])
+    };
+    r[0] = v[0] + q[3] * t[0] + q[1] * t[2] - q[2] * t[1];
+    r[1] = v[1] + q[3] * t[1] + q[2] * t[0] - q[0] * t[2];
+    r[2] = v[2] + q[3] * t[2] + q[0] * t[1] - q[1] * t[0];
+  }
+
+  const sRigidBodyDescription& FindBone(const sSkeletonDescription& skeleton, int id)
+  {
+    int b = 0;
+    while (skeleton.RigidBodies[b].ID != id)
+      b++;
+    return skeleton.RigidBodies[b];
+  }
+
+  ReferencePose ToReference(const sRigidBodyData& bone)
+  {
+    const ReferencePose pose = { { bone.x, bone.y, bone.z }, { bone.qx, bone.qy, bone.qz, bone.qw } };
+    return pose;
+  }
+
+  // Global pose of bone id in double precision: the parent's global pose
+  // times the local one. With restOffsets the local position is the
+  // description offset.
+  ReferencePose ReferenceGlobal(const sSkeletonDescription& skeleton, const std::vector<sRigidBodyData>& local,
+    int id, bool restOffsets)
+  {
+    const sRigidBodyDescription& desc = FindBone(skeleton, id);
+    ReferencePose pose = ToReference(local[id - 1]);
+    if (restOffsets)
+    {
+      pose.p[0] = desc.offsetx;
+      pose.p[1] = desc.offsety;
+      pose.p[2] = desc.offsetz;
+    }
+    if (desc.parentID <= 0)
+      return pose;
+
+    const ReferencePose parent = ReferenceGlobal(skeleton, local, desc.parentID, restOffsets);
+    ReferencePose global;
+    Multiply(parent.q, pose.q, global.q);
+    Rotate(parent.q, pose.p, global.p);
+    for (int c = 0; c < 3; c++)
+      global.p[c] += parent.p[c];
+    return global;
+  }
+
+  // Local pose of bone id in double precision: the inverse of the
+  // parent's global pose times the global one.
+  ReferencePose ReferenceLocal(const sSkeletonDescription& skeleton, const std::vector<sRigidBodyData>& global, int id)
+  {
+    const sRigidBodyDescription& desc = FindBone(skeleton, id);
+    const ReferencePose pose = ToReference(global[id - 1]);
+    if (desc.parentID <= 0)
+      return pose;
+
+    const ReferencePose parent = ToReference(global[desc.parentID - 1]);
+    const double inverse[4] = { -parent.q[0], -parent.q[1], -parent.q[2], parent.q[3] };
+    const double d[3] = { pose.p[0] - parent.p[0], pose.p[1] - parent.p[1], pose.p[2] - parent.p[2] };
+    ReferencePose local;
+    Multiply(inverse, pose.q, local.q);
+    Rotate(inverse, d, local.p);
+    return local;
+  }
+
+  // Largest position and rotation component error of the solved poses of
+  // a skeleton against the reference computed from the streamed ones.
+  void MeasureSolved(const SkeletonHierarchy& hierarchy, const sSkeletonDescription& skeleton,
+    const std::vector<sRigidBodyData>& streamed, bool restOffsets, double& positionError, double& rotationError)
+  {
+    const bool local = hierarchy.StreamedSpace() == SkeletonHierarchy::Space_Local;
+    std::vector<sRigidBodyData> solved = streamed;
+    hierarchy.GetBones(skeleton.skeletonID, solved.data(), (int)solved.size(),
+      local ? SkeletonHierarchy::Space_Global : SkeletonHierarchy::Space_Local);
+    for (size_t b = 0; b < solved.size(); b++)
+    {
+      const ReferencePose expected = local ? ReferenceGlobal(skeleton, streamed, (int)b + 1, restOffsets) :
+        ReferenceLocal(skeleton, streamed, (int)b + 1);
+      const ReferencePose actual = ToReference(solved[b]);
+      for (int c = 0; c < 3; c++)
+        positionError = std::fmax(positionError, std::fabs(actual.p[c] - expected.p[c]));
+      for (int c = 0; c < 4; c++)
+        rotationError = std::fmax(rotationError, std::fabs(actual.q[c] - expected.q[c]));
+    }
+  }
+
+  // Descriptions of 9 bodies, which fill more than one block, and a
+  // skeleton with another hierarchy.
+  void DescribeBodies(Descriptions& descriptions)
+  {
+    int chainParents[kBodyBones + 1];
+    for (int id = 0; id <= kBodyBones; id++)
+      chainParents[id] = id - 1;
+
+    for (int s = 0; s < 9; s++)
+      descriptions.Add(s, s + 1, kBodyBones, kBodyParents);
+    descriptions.Add(9, 10, kBodyBones, chainParents);
+  }
+
+  // Solves the bodies streamed in <c>streamed</c> over 50 frames against
+  // the reference.
+  void CheckSolve(CheckResults& results, SkeletonHierarchy::Space streamed, bool restOffsets)
+  {
+    Descriptions descriptions(10);
+    DescribeBodies(descriptions);
+
+    SkeletonHierarchy hierarchy;
+    hierarchy.Build(&descriptions.defs);
+    hierarchy.SetSpace(streamed, restOffsets);
+    results.Expect(hierarchy.SkeletonCount() == 10 && hierarchy.GroupCount() == 2, "skeletons with the same hierarchy share a group");
+
+    double positionError = 0.0, rotationError = 0.0;
+    std::vector<std::vector<sRigidBodyData> > bones(10);
+    for (int frame = 0; frame < 50; frame++)
+    {
+      for (int s = 0; s < 10; s++)
+      {
+        MakeBones(s + 1, kBodyBones, frame, bones[s]);
+        hierarchy.SetBones(s + 1, bones[s].data(), kBodyBones);
+      }
+      hierarchy.Solve();
+      for (int s = 0; s < 10; s++)
+        MeasureSolved(hierarchy, descriptions.skeletons[s], bones[s], restOffsets, positionError, rotationError);
+    }
+
+    char what[64];
+    sprintf(what, "%s%s", streamed == SkeletonHierarchy::Space_Local ? "local to global" : "global to local",
+      restOffsets ? " at rest offsets" : "");
+    printf("  %s: positions within %.1e, rotations within %.1e\n", what, positionError, rotationError);
+    strcat(what, " matches the reference");
+    results.Expect(positionError < 1e-5 && rotationError < 1e-6, what);
+  }
+
+  // Local poses solved to global ones and back.
+  void CheckRoundTrip(CheckResults& results)
+  {
+    Descriptions descriptions(10);
+    DescribeBodies(descriptions);
+
+    SkeletonHierarchy toGlobal, toLocal;
+    toGlobal.Build(&descriptions.defs);
+    toLocal.Build(&descriptions.defs);
+    toGlobal.SetSpace(SkeletonHierarchy::Space_Local, false);
+    toLocal.SetSpace(SkeletonHierarchy::Space_Global, false);
+
+    double error = 0.0;
+    std::vector<std::vector<sRigidBodyData> > local(10);
+    std::vector<sRigidBodyData> global, back;
+    for (int frame = 0; frame < 50; frame++)
+    {
+      for (int s = 0; s < 10; s++)
+      {
+        MakeBones(s + 1, kBodyBones, frame, local[s]);
+        toGlobal.SetBones(s + 1, local[s].data(), kBodyBones);
+      }
+      toGlobal.Solve();
+      for (int s = 0; s < 10; s++)
+      {
+        global = local[s];
+        toGlobal.GetBones(s + 1, global.data(), kBodyBones, SkeletonHierarchy::Space_Global);
+        toLocal.SetBones(s + 1, global.data(), kBodyBones);
+      }
+      toLocal.Solve();
+      for (int s = 0; s < 10; s++)
+      {
+        back = local[s];
+        toLocal.GetBones(s + 1, back.data(), kBodyBones, SkeletonHierarchy::Space_Local);
+        for (int b = 0; b < kBodyBones; b++)
+        {
+          const ReferencePose expected = ToReference(local[s][b]);
+          const ReferencePose actual = ToReference(back[b]);
+          for (int c = 0; c < 3; c++)
+            error = std::fmax(error, std::fabs(actual.p[c] - expected.p[c]));
+          for (int c = 0; c < 4; c++)
+            error = std::fmax(error, std::fabs(actual.q[c] - expected.q[c]));
+        }
+      }
+    }
+
+    printf("  local to global to local: within %.1e\n", error);
+    results.Expect(error < 1e-5, "local poses survive the round trip");
+  }
+
+  // Bones not in the frame, unknown skeletons, global streaming and
+  // hierarchies with missing parents or cycles.
+  void CheckEdgeCases(CheckResults& results)
+  {
+    // bone 3's parent is missing, bones 1 and 2 are each other's parent
+    int brokenParents[4] = { 0, 2, 1, 99 };
+    Descriptions descriptions(2);
+    descriptions.Add(0, 1, kBodyBones, kBodyParents);
+    descriptions.Add(1, 2, 3, brokenParents);
+
+    SkeletonHierarchy hierarchy;
+    hierarchy.Build(&descriptions.defs);
+    hierarchy.SetSpace(SkeletonHierarchy::Space_Local, false);
+
+    std::vector<sRigidBodyData> body, broken;
+    MakeBones(1, kBodyBones, 0, body);
+    MakeBones(2, 3, 0, broken);
+    hierarchy.SetBones(1, body.data(), kBodyBones);
+    hierarchy.SetBones(2, broken.data(), 3);
+
+    // a frame with only the first five bones keeps the others
+    std::vector<sRigidBodyData> next;
+    MakeBones(1, kBodyBones, 1, next);
+    hierarchy.SetBones(1, next.data(), 5);
+    hierarchy.Solve();
+    float p[3], q[4];
+    results.Expect(hierarchy.GetBone((1 << 16) | 5, SkeletonHierarchy::Space_Local, p, q) && p[0] == next[4].x &&
+      hierarchy.GetBone((1 << 16) | 6, SkeletonHierarchy::Space_Local, p, q) && p[0] == body[5].x,
+      "bones missing from the frame keep their pose");
+
+    results.Expect(!hierarchy.SetBones(3, body.data(), kBodyBones) &&
+      !hierarchy.GetBone((3 << 16) | 1, SkeletonHierarchy::Space_Global, p, q) &&
+      !hierarchy.GetBone((1 << 16) | 22, SkeletonHierarchy::Space_Global, p, q), "unknown skeletons and bones");
+
+    // bone 3 and bone 2, the first of the cycle in description order,
+    // become roots
+    bool rootsOk = true;
+    for (int id = 2; id <= 3; id++)
+    {
+      hierarchy.GetBone((2 << 16) | id, SkeletonHierarchy::Space_Global, p, q);
+      const sRigidBodyData& bone = broken[id - 1];
+      rootsOk &= p[0] == bone.x && p[1] == bone.y && p[2] == bone.z && q[3] == bone.qw;
+    }
+    results.Expect(rootsOk, "bones with missing parents or in cycles become roots");
+
+    // global bones are kept as streamed
+    hierarchy.SetSpace(SkeletonHierarchy::Space_Global, false);
+    hierarchy.SetBones(1, next.data(), kBodyBones);
+    hierarchy.Solve();
+    std::vector<sRigidBodyData> global = next;
+    hierarchy.GetBones(1, global.data(), kBodyBones, SkeletonHierarchy::Space_Global);
+    bool keptOk = true;
+    for (int b = 0; b < kBodyBones; b++)
+    {
+      keptOk &= global[b].x == next[b].x && global[b].y == next[b].y && global[b].z == next[b].z &&
+        global[b].qx == next[b].qx && global[b].qy == next[b].qy && global[b].qz == next[b].qz && global[b].qw == next[b].qw;
+    }
+    results.Expect(keptOk, "global bones are kept as streamed");
+
+    // the local space of a global stream is unknown until solved
+    SkeletonHierarchy unsolved;
+    unsolved.Build(&descriptions.defs);
+    unsolved.SetSpace(SkeletonHierarchy::Space_Global, false);
+    unsolved.SetBones(1, next.data(), kBodyBones);
+    bool unknownOk = !unsolved.GetBones(1, global.data(), kBodyBones, SkeletonHierarchy::Space_Local) &&
+      !unsolved.GetBone((1 << 16) | 1, SkeletonHierarchy::Space_Local, p, q) &&
+      unsolved.GetBones(1, global.data(), kBodyBones, SkeletonHierarchy::Space_Global);
+    unsolved.Solve();
+    unknownOk &= unsolved.GetBones(1, global.data(), kBodyBones, SkeletonHierarchy::Space_Local);
+    unsolved.SetSpace(SkeletonHierarchy::Space_Local, false);
+    unknownOk &= !unsolved.GetBones(1, global.data(), kBodyBones, SkeletonHierarchy::Space_Global);
+    results.Expect(unknownOk, "spaces that were not solved are not read");
+  }
+
+  // Prints the cost of 100 skeletons of 200 bones, both the solve alone
+  // and a whole frame (storing, solving and reading all bones), and checks
+  // the frame fits the 240 Hz budget. distinct gives every skeleton its
+  // own hierarchy.
+  void BenchmarkSolve(CheckResults& results, SkeletonHierarchy::Space streamed, bool distinct)
+  {
+    const int skeletons = 100;
+    const int bones = MAX_SKELRIGIDBODIES;
+
+    Descriptions descriptions(skeletons);
+    for (int s = 0; s < skeletons; s++)
+    {
+      // a binary tree; distinct hierarchies start with a chain of s + 2
+      // bones
+      int parents[MAX_SKELRIGIDBODIES + 1];
+      for (int id = 0; id <= bones; id++)
+        parents[id] = distinct && id <= s + 2 ? id - 1 : id / 2;
+      descriptions.Add(s, s + 1, bones, parents);
+    }
+
+    SkeletonHierarchy hierarchy;
+    hierarchy.Build(&descriptions.defs);
+    hierarchy.SetSpace(streamed, false);
+    const SkeletonHierarchy::Space solved = streamed == SkeletonHierarchy::Space_Local ?
+      SkeletonHierarchy::Space_Global : SkeletonHierarchy::Space_Local;
+
+    std::vector<std::vector<sRigidBodyData> > frames(skeletons);
+    for (int s = 0; s < skeletons; s++)
+      MakeBones(s + 1, bones, 0, frames[s]);
+    std::vector<sRigidBodyData> read(bones);
+
+    const double solve = NanosecondsPerCall(20, [&](int) { hierarchy.Solve(); });
+    const double frame = NanosecondsPerCall(20, [&](int) {
+      for (int s = 0; s < skeletons; s++)
+        hierarchy.SetBones(s + 1, frames[s].data(), bones);
+      hierarchy.Solve();
+      for (int s = 0; s < skeletons; s++)
+        hierarchy.GetBones(s + 1, read.data(), bones, solved);
+    });
+
+    printf("  %s, %d x %d bones, %3d hierarchies: solve %7.0f us, frame %7.0f us\n",
+      streamed == SkeletonHierarchy::Space_Local ? "local to global" : "global to local",
+      skeletons, bones, hierarchy.GroupCount(), solve / 1000.0, frame / 1000.0);
+    results.Expect(frame < kFrameBudgetNs, "a frame of 100 x 200 bones fits 240 Hz");
+  }
+}
+
+
+int RunSkeletonChecks(bool benchmark)
+{
+  CheckResults results;
+  CheckSolve(results, SkeletonHierarchy::Space_Local, false);
+  CheckSolve(results, SkeletonHierarchy::Space_Local, true);
+  CheckSolve(results, SkeletonHierarchy::Space_Global, false);
+  CheckRoundTrip(results);
+  CheckEdgeCases(results);
+
+  if (benchmark)
+  {
+    for (int streamed = SkeletonHierarchy::Space_Global; streamed <= SkeletonHierarchy::Space_Local; streamed++)
+    {
+      BenchmarkSolve(results, (SkeletonHierarchy::Space)streamed, false);
+      BenchmarkSolve(results, (SkeletonHierarchy::Space)streamed, true);
+    }
+  }
+
+  return results.failures;
+}
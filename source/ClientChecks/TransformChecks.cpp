@@ -0,0 +1,326 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "ClientChecks.h"
+#include "PoseTransform.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseTransform and FusedTransform checks against a per pose scalar
+// reference and the cost of transforming 1000 rigid bodies
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const int kPoses = 1000;
+  const float kPi = 3.14159265358979f;
+
+  // Structure of arrays poses; 1003 leaves a tail after the last full
+  // block of every SIMD width.
+  typedef PoseArrays<kPoses + 3> Poses;
+
+  // Conversion sets PoseTransform supports; the up axis conversions are
+  // exclusive.
+  const uint32_t kConversions[] =
+  {
+    0,
+    PoseTransform::Conversion_ZUpToYUp,
+    PoseTransform::Conversion_YUpToZUp,
+    PoseTransform::Conversion_LeftHanded,
+    PoseTransform::Conversion_ZUpToYUp | PoseTransform::Conversion_LeftHanded,
+    PoseTransform::Conversion_YUpToZUp | PoseTransform::Conversion_LeftHanded
+  };
+
+  const int kConversionCount = sizeof(kConversions) / sizeof(kConversions[0]);
+
+  // Rotation of the renderer's z-up to y-up step, as the sample client
+  // computed it per rigid body: q * (-90 degrees about x).
+  void RotateZUpToYUp(float* q)
+  {
+    const float angle = -90.0f * kPi / 180.0f;
+    const float rx = sinf(angle / 2.0f);
+    const float ry = 0.0f;
+    const float rz = 0.0f;
+    const float rw = cosf(angle / 2.0f);
+
+    const float x = q[3] * rx + q[0] * rw + q[1] * rz - q[2] * ry;
+    const float y = q[3] * ry - q[0] * rz + q[1] * rw + q[2] * rx;
+    const float z = q[3] * rz + q[0] * ry - q[1] * rx + q[2] * rw;
+    const float w = q[3] * rw - q[0] * rx - q[1] * ry - q[2] * rz;
+    q[0] = x;
+    q[1] = y;
+    q[2] = z;
+    q[3] = w;
+  }
+
+  // The per entity conversions PoseTransform replaces, one pose at a
+  // time: the renderer's z-up step, OscOptions' yup2zup and leftHanded
+  // and the unit scale.
+  void ReferencePose(uint32_t conversions, float scale, float* p, float* q)
+  {
+    if (conversions & PoseTransform::Conversion_ZUpToYUp)
+    {
+      const float t = p[1];
+      p[1] = p[2];
+      p[2] = -t;
+      RotateZUpToYUp(q);
+    }
+    if (conversions & PoseTransform::Conversion_YUpToZUp)
+    {
+      float t = p[1];
+      p[1] = -p[2];
+      p[2] = t;
+      t = q[1];
+      q[1] = -q[2];
+      q[2] = t;
+    }
+    if (conversions & PoseTransform::Conversion_LeftHanded)
+    {
+      p[0] = -p[0];
+      q[1] = -q[1];
+      q[2] = -q[2];
+    }
+    for (int k = 0; k < 3; k++)
+      p[k] *= scale;
+  }
+
+  // Unit quaternions and positions of all signs for pose i.
+  void MakePose(int i, float* p, float* q)
+  {
+    p[0] = (float)(i % 97) * 13.25f - 600.0f;
+    p[1] = (float)(i % 31) * -7.5f + 100.0f;
+    p[2] = (float)(i % 53) * 3.125f - 80.0f;
+
+    const float angle = (float)i * 0.37f;
+    const float axis[3] = { sinf((float)i), cosf((float)i * 0.5f), 0.5f };
+    const float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    const float s = sinf(angle / 2.0f) / length;
+    q[0] = axis[0] * s;
+    q[1] = axis[1] * s;
+    q[2] = axis[2] * s;
+    q[3] = cosf(angle / 2.0f);
+  }
+
+  void Fill(Poses& poses, int count)
+  {
+    poses.count = count;
+    for (int i = 0; i < Poses::CAPACITY; i++)
+    {
+      float p[3], q[4];
+      MakePose(i, p, q);
+      poses.x[i] = p[0];
+      poses.y[i] = p[1];
+      poses.z[i] = p[2];
+      poses.qx[i] = q[0];
+      poses.qy[i] = q[1];
+      poses.qz[i] = q[2];
+      poses.qw[i] = q[3];
+    }
+  }
+
+  // True if pose i of the arrays equals p and q exactly. The sign of a
+  // zero may differ: the reference mirrors after the z-up rotation, the
+  // fused transform before it.
+  bool SamePose(const Poses& poses, int i, const float* p, const float* q)
+  {
+    return poses.x[i] == p[0] && poses.y[i] == p[1] && poses.z[i] == p[2] &&
+      poses.qx[i] == q[0] && poses.qy[i] == q[1] && poses.qz[i] == q[2] && poses.qw[i] == q[3];
+  }
+
+  void CheckConversions(CheckResults& results, uint32_t conversions, float scale)
+  {
+    char what[128];
+    sprintf(what, "conversions 0x%x, scale %g", conversions, scale);
+    const PoseTransform transform(conversions, scale);
+    static Poses poses;
+
+    // the whole batch and every tail length match the reference; poses
+    // past count are left alone
+    bool batchOk = true;
+    for (int count = 0; count <= Poses::CAPACITY && batchOk; count += (count < 17 ? 1 : 493))
+    {
+      Fill(poses, count);
+      transform.Apply(poses);
+      for (int i = 0; i < Poses::CAPACITY && batchOk; i++)
+      {
+        float p[3], q[4];
+        MakePose(i, p, q);
+        if (i < count)
+          ReferencePose(conversions, scale, p, q);
+        batchOk = SamePose(poses, i, p, q);
+      }
+    }
+    results.Expect(batchOk, what);
+
+    // positions only leave the rotations alone
+    Fill(poses, kPoses);
+    transform.ApplyToPositions(poses.x, poses.y, poses.z, poses.count);
+    bool positionsOk = true;
+    for (int i = 0; i < kPoses && positionsOk; i++)
+    {
+      float p[3], q[4], unchanged[4];
+      MakePose(i, p, q);
+      memcpy(unchanged, q, sizeof(q));
+      ReferencePose(conversions, scale, p, q);
+      positionsOk = SamePose(poses, i, p, unchanged);
+    }
+    sprintf(what, "conversions 0x%x, scale %g, positions only", conversions, scale);
+    results.Expect(positionsOk, what);
+
+    // the SIMD blocks give the bits of the scalar tail, signed zeros
+    // included
+    static Poses single;
+    Fill(poses, kPoses);
+    Fill(single, kPoses);
+    transform.Apply(poses);
+    for (int i = 0; i < kPoses; i++)
+      transform.Apply(single.x + i, single.y + i, single.z + i, single.qx + i, single.qy + i, single.qz + i, single.qw + i, 1);
+    sprintf(what, "conversions 0x%x, scale %g, batch and single poses agree to the bit", conversions, scale);
+    results.Expect(memcmp(&poses, &single, sizeof(poses)) == 0, what);
+  }
+
+  // Prints the cost of transforming kPoses rigid bodies with PoseTransform
+  // and with the per entity reference. Scales alternate between
+  // millimeters and meters, so repeated transforms keep the values finite.
+  void BenchmarkConversions(const char* name, uint32_t conversions)
+  {
+    const PoseTransform toMillimeters(conversions, 1000.0f);
+    const PoseTransform toMeters(conversions, 0.001f);
+    static Poses poses;
+    Fill(poses, kPoses);
+
+    static float p[kPoses][3];
+    static float q[kPoses][4];
+    for (int i = 0; i < kPoses; i++)
+      MakePose(i, p[i], q[i]);
+
+    volatile float sink = 0.0f;
+    const double batch = NanosecondsPerCall(20000, [&](int call) {
+      (call & 1 ? toMeters : toMillimeters).Apply(poses);
+      sink += poses.qw[call % kPoses];
+    });
+    const double reference = NanosecondsPerCall(2000, [&](int call) {
+      const float scale = call & 1 ? 0.001f : 1000.0f;
+      for (int i = 0; i < kPoses; i++)
+        ReferencePose(conversions, scale, p[i], q[i]);
+      sink += q[call % kPoses][3];
+    });
+    printf("  %-22s %8.0f ns batch  %8.0f ns per entity\n", name, batch, reference);
+  }
+
+  // Checks one FusedTransform instantiation per entity against the
+  // reference and, if <c>benchmark</c> is set, prints the cost of its
+  // batch kernel, of its per entity functions and of the reference, which
+  // branches on the conversions for every entity.
+  template<class Transform>
+  void CheckPolicy(CheckResults& results, const char* name, uint32_t conversions, FusedTransformKernel kernel,
+    bool benchmark)
+  {
+    const float scale = Transform::SCALED ? 1000.0f : 1.0f;
+    bool same = true;
+    for (int i = 0; i < kPoses && same; i++)
+    {
+      float p[3], q[4], expectedP[3], expectedQ[4];
+      MakePose(i, p, q);
+      MakePose(i, expectedP, expectedQ);
+      Transform::TransformPosition(p, scale);
+      Transform::TransformRotation(q);
+      ReferencePose(conversions, scale, expectedP, expectedQ);
+      same = p[0] == expectedP[0] && p[1] == expectedP[1] && p[2] == expectedP[2] &&
+        q[0] == expectedQ[0] && q[1] == expectedQ[1] && q[2] == expectedQ[2] && q[3] == expectedQ[3];
+    }
+    results.Expect(same, name);
+
+    if (!benchmark)
+      return;
+
+    // scaled instantiations alternate between millimeters and meters
+    static Poses poses;
+    Fill(poses, kPoses);
+    static float p[kPoses][3];
+    static float q[kPoses][4];
+    for (int i = 0; i < kPoses; i++)
+      MakePose(i, p[i], q[i]);
+
+    volatile float sink = 0.0f;
+    const double batch = NanosecondsPerCall(20000, [&](int call) {
+      kernel(poses.x, poses.y, poses.z, poses.qx, poses.qy, poses.qz, poses.qw, kPoses, call & 1 ? 1.0f / scale : scale);
+      sink += poses.qw[call % kPoses];
+    });
+    const double entity = NanosecondsPerCall(2000, [&](int call) {
+      const float factor = call & 1 ? 1.0f / scale : scale;
+      for (int i = 0; i < kPoses; i++)
+      {
+        Transform::TransformPosition(p[i], factor);
+        Transform::TransformRotation(q[i]);
+      }
+      sink += q[call % kPoses][3];
+    });
+    const double reference = NanosecondsPerCall(2000, [&](int call) {
+      const float factor = call & 1 ? 1.0f / scale : scale;
+      for (int i = 0; i < kPoses; i++)
+        ReferencePose(conversions, factor, p[i], q[i]);
+      sink += q[call % kPoses][3];
+    });
+    printf("  %-30s %8.0f ns batch  %8.0f ns fused  %8.0f ns reference\n", name, batch, entity, reference);
+  }
+
+  struct PolicySelector
+  {
+    typedef void (*Result)(CheckResults& results, const char* name, uint32_t conversions, FusedTransformKernel kernel,
+      bool benchmark);
+
+    template<class Transform>
+    static Result Get() { return &CheckPolicy<Transform>; }
+  };
+}
+
+
+int RunTransformChecks(bool benchmark)
+{
+  CheckResults results;
+  for (int c = 0; c < kConversionCount; c++)
+  {
+    CheckConversions(results, kConversions[c], 1.0f);
+    CheckConversions(results, kConversions[c], 1000.0f);
+  }
+
+  const PoseTransform identity;
+  results.Expect(identity.IsIdentity() && !PoseTransform(0, 1000.0f).IsIdentity(), "identity");
+
+  if (benchmark)
+  {
+    printf("  transform cost, %d rigid bodies:\n", kPoses);
+    BenchmarkConversions("scale only", 0);
+    BenchmarkConversions("z-up to y-up", PoseTransform::Conversion_ZUpToYUp);
+    BenchmarkConversions("y-up to z-up, mirrored", PoseTransform::Conversion_YUpToZUp | PoseTransform::Conversion_LeftHanded);
+  }
+
+  return results.failures;
+}
+
+int RunPolicyChecks(bool benchmark)
+{
+  const UpAxisConversion upAxes[] = { UpAxis_Same, UpAxis_YUpToZUp, UpAxis_ZUpToYUp };
+  const uint32_t upAxisConversions[] = { 0, PoseTransform::Conversion_YUpToZUp, PoseTransform::Conversion_ZUpToYUp };
+  const char* upAxisNames[] = { "same up axis", "y-up to z-up", "z-up to y-up" };
+
+  CheckResults results;
+  if (benchmark)
+    printf("  cost per instantiation, %d rigid bodies:\n", kPoses);
+  for (int u = 0; u < 3; u++)
+  {
+    for (int mirrored = 0; mirrored < 2; mirrored++)
+    {
+      for (int scaled = 0; scaled < 2; scaled++)
+      {
+        char name[64];
+        sprintf(name, "%s%s%s", upAxisNames[u], mirrored ? ", mirrored" : "", scaled ? ", scaled" : "");
+        const uint32_t conversions = upAxisConversions[u] | (mirrored ? PoseTransform::Conversion_LeftHanded : 0);
+        const PolicySelector::Result check = SelectFusedTransform<PolicySelector>(upAxes[u], mirrored != 0, scaled != 0);
+        check(results, name, conversions, SelectFusedTransformKernel(upAxes[u], mirrored != 0, scaled != 0), benchmark);
+      }
+    }
+  }
+  return results.failures;
+}
@@ -0,0 +1,504 @@
+//=============================================================================
+// NatNetStandIn
+//
+// Synthetic stand-in for a Motive server, for load testing NatNet clients
+// and everything downstream of them without a tracking system. Speaks the
+// NatNet 3.1 protocol:
+//
+//   NAT_CONNECT            -> NAT_SERVERINFO (sSender_Server)
+//   NAT_REQUEST_MODELDEF   -> NAT_MODELDEF (generated descriptions)
+//   NAT_REQUEST            -> NAT_RESPONSE for UnitsToMillimeters, UpAxis
+//                             and FrameRate, NAT_UNRECOGNIZED_REQUEST else
+//   NAT_REQUEST_FRAMEOFDATA-> NAT_FRAMEOFDATA (current frame)
+//   NAT_ECHOREQUEST        -> NAT_ECHORESPONSE
+//
+// and streams NAT_FRAMEOFDATA at a fixed rate, to the multicast group or
+// (--unicast) to every connected client. With --fragment, frames larger
+// than the given datagram size are split by FrameFragmenter; only clients
+// reassembling them (SampleClient3D's PacketClient) can receive those.
+//
+// Linux: g++ -std=c++14 -O2 -I../../include -I../SampleClient3D NatNetStandIn.cpp SyntheticScene.cpp ../SampleClient3D/FrameFragmenter.cpp -o NatNetStandIn
+//=============================================================================
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/select.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "NatNetTypes.h"
+#include "FrameFragmenter.h"
+#include "PacketWriter.h"
+#include "SyntheticScene.h"
+
+#ifdef _WIN32
+typedef SOCKET StandInSocket;
+typedef int socklen_t;
+const StandInSocket kInvalidSocket = INVALID_SOCKET;
+void CloseSocket(StandInSocket s) { closesocket(s); }
+#else
+typedef int StandInSocket;
+const StandInSocket kInvalidSocket = -1;
+void CloseSocket(StandInSocket s) { close(s); }
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// Clients that have not sent anything (e.g. keep alives) for this long
+// are no longer streamed to in unicast mode.
+const int kClientTimeoutSeconds = 10;
+
+// Simulated latencies between mid exposure, data received and transmit.
+const uint64_t kExposureToReceivedNs = 2000000;
+const uint64_t kReceivedToTransmitNs = 1000000;
+
+struct Options
+{
+  std::string localIP;
+  std::string multiCastIP;
+  bool unicast;
+  int cmdPort;
+  int dataPort;
+  int fragmentSize;     // 0 sends every frame as one datagram
+  bool verbose;
+  SyntheticScene::Config scene;
+
+  Options()
+    : localIP("127.0.0.1"), multiCastIP(NATNET_DEFAULT_MULTICAST_ADDRESS), unicast(false),
+    cmdPort(NATNET_DEFAULT_PORT_COMMAND), dataPort(NATNET_DEFAULT_PORT_DATA), fragmentSize(0), verbose(false)
+  {
+  }
+};
+
+struct Client
+{
+  sockaddr_in address;
+  Clock::time_point lastSeen;
+};
+
+// Where the fragmenter sends the datagrams of the current frame.
+struct FrameDestination
+{
+  StandInSocket socket;
+  const sockaddr_in* address;
+};
+
+// state
+volatile std::sig_atomic_t running = 1;
+Options options;
+StandInSocket commandSocket = kInvalidSocket;
+StandInSocket dataSocket = kInvalidSocket;
+sockaddr_in multicastAddress;
+std::vector<Client> clients;
+int32_t frameNumber = 0;
+bool modelsChanged = true;
+static sPacket packet;
+FrameFragmenter* fragmenter = nullptr;
+FrameDestination fragmentDestination;
+
+// functions
+void PrintUsage();
+bool ParseOptions(int argc, char* argv[], Options& options);
+bool OpenSockets();
+void HandleCommand(const SyntheticScene& scene, const sPacket& request, const sockaddr_in& from);
+void Reply(int bytes, const sockaddr_in& to);
+void SendFrame(const SyntheticScene& scene);
+void SendFramePacket(StandInSocket s, const sockaddr_in& to, int bytes);
+bool SendDatagram(const uint8_t* data, int bytes, void* pUserData);
+uint64_t HighResNow();
+
+void OnSignal(int)
+{
+  running = 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if (!ParseOptions(argc, argv, options))
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  SyntheticScene scene(options.scene);
+  const SyntheticScene::Config& config = scene.GetConfig();
+  // sPacket::nDataBytes is 16 bit, so no frame, fragmented or not, can be
+  // larger than MAX_PACKETSIZE
+  if (scene.FrameSize() > MAX_PACKETSIZE)
+  {
+    fprintf(stderr, "A frame would be %d bytes, more than MAX_PACKETSIZE (%d). Reduce the counts.\n",
+      scene.FrameSize(), MAX_PACKETSIZE);
+    return 1;
+  }
+  if (scene.FrameSize() + 4 > FrameFragmenter::MAX_DATAGRAM_SIZE && options.fragmentSize == 0)
+    printf("Frames are larger than %d bytes and will be fragmented at the IP level; consider --fragment %d\n",
+      FrameFragmenter::MAX_DATAGRAM_SIZE, FrameFragmenter::MAX_DATAGRAM_SIZE);
+
+  FrameFragmenter frameFragmenter(SendDatagram, &fragmentDestination,
+    options.fragmentSize > 0 ? options.fragmentSize : FrameFragmenter::MAX_DATAGRAM_SIZE);
+  if (options.fragmentSize > 0)
+    fragmenter = &frameFragmenter;
+
+  if (!OpenSockets())
+  {
+    fprintf(stderr, "Could not open the sockets on %s (command port %d).\n", options.localIP.c_str(), options.cmdPort);
+    return 1;
+  }
+
+  if (options.unicast)
+    printf("NatNetStandIn on %s:%d, streaming to connected clients at %.1f Hz\n",
+      options.localIP.c_str(), options.cmdPort, config.frameRate);
+  else
+    printf("NatNetStandIn on %s:%d, streaming to %s:%d at %.1f Hz\n",
+      options.localIP.c_str(), options.cmdPort, options.multiCastIP.c_str(), options.dataPort, config.frameRate);
+  printf("%d rigid bodies, %d skeletons x %d bones, %d labeled markers, %d force plates, %d bytes per frame\n",
+    config.rigidBodies, config.skeletons, config.bonesPerSkeleton, config.labeledMarkers, config.forcePlates,
+    scene.FrameSize());
+  if (fragmenter != nullptr)
+    printf("frames over %d bytes are sent in fragments\n", fragmenter->DatagramSize());
+
+  std::signal(SIGINT, OnSignal);
+
+  const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1.0 / config.frameRate));
+  Clock::time_point nextFrame = Clock::now();
+  Clock::time_point nextReport = nextFrame + std::chrono::seconds(1);
+  uint64_t framesSent = 0, framesLate = 0;
+
+  static sPacket request;
+  while (running)
+  {
+    // wait for commands until the next frame is due; a command handled
+    // while a frame is due does not delay that frame
+    Clock::time_point now = Clock::now();
+    long long waitUs = (nextFrame > now) ? std::chrono::duration_cast<std::chrono::microseconds>(nextFrame - now).count() : 0;
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(commandSocket, &readSet);
+    timeval timeout = { (long)(waitUs / 1000000), (long)(waitUs % 1000000) };
+    if (select((int)commandSocket + 1, &readSet, nullptr, nullptr, &timeout) > 0)
+    {
+      sockaddr_in from;
+      socklen_t fromLength = sizeof(from);
+      int bytes = recvfrom(commandSocket, (char*)&request, sizeof(request), 0, (sockaddr*)&from, &fromLength);
+      if (bytes >= 4 && request.nDataBytes <= bytes - 4)
+        HandleCommand(scene, request, from);
+    }
+
+    now = Clock::now();
+    if (now < nextFrame)
+      continue;
+
+    SendFrame(scene);
+    framesSent++;
+
+    // fell behind by more than a frame - resynchronize instead of bursting
+    nextFrame += period;
+    if (nextFrame + period < now)
+    {
+      framesLate++;
+      nextFrame = now + period;
+    }
+
+    if (options.verbose && now >= nextReport)
+    {
+      printf("frame %d, %llu sent, %llu late, %d clients\n", frameNumber,
+        (unsigned long long)framesSent, (unsigned long long)framesLate, (int)clients.size());
+      nextReport += std::chrono::seconds(1);
+    }
+  }
+
+  CloseSocket(commandSocket);
+  CloseSocket(dataSocket);
+#ifdef _WIN32
+  WSACleanup();
+#endif
+  return 0;
+}
+
+void PrintUsage()
+{
+  printf(
+    "Usage: NatNetStandIn [options]\n"
+    "  --localIP <ip>          (Default: 127.0.0.1) address the server listens on\n"
+    "  --multiCastIP <ip>      (Default: 239.255.42.99) multicast group frames are sent to\n"
+    "  --unicast               send frames to every connected client instead\n"
+    "  --cmdPort <port>        (Default: 1510) command port\n"
+    "  --dataPort <port>       (Default: 1511) data port\n"
+    "  --fragment <bytes>      split frames into datagrams of at most this size (%d - %d)\n"
+    "  --rate <hz>             (Default: 120) frame rate\n"
+    "  --rigidBodies <n>       (Default: 10) rigid bodies (max %d)\n"
+    "  --skeletons <n>         (Default: 0) skeletons (max %d)\n"
+    "  --bones <n>             (Default: 21) bones per skeleton (max %d)\n"
+    "  --labeledMarkers <n>    (Default: 0) labeled markers (max %d)\n"
+    "  --forcePlates <n>       (Default: 0) force plates (max %d)\n"
+    "  --verbose               print statistics every second\n"
+    "  --help                  display this help screen\n",
+    FrameFragmenter::MIN_DATAGRAM_SIZE, FrameFragmenter::MAX_DATAGRAM_SIZE, MAX_RIGIDBODIES, MAX_SKELETONS, MAX_SKELRIGIDBODIES, MAX_LABELED_MARKERS, MAX_FORCEPLATES);
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string name = argv[i];
+    if (name == "--unicast")
+      options.unicast = true;
+    else if (name == "--verbose")
+      options.verbose = true;
+    else if (name == "--help")
+      return false;
+    else if (i + 1 < argc)
+    {
+      const char* value = argv[++i];
+      if (name == "--localIP")
+        options.localIP = value;
+      else if (name == "--multiCastIP")
+        options.multiCastIP = value;
+      else if (name == "--cmdPort")
+        options.cmdPort = atoi(value);
+      else if (name == "--dataPort")
+        options.dataPort = atoi(value);
+      else if (name == "--fragment")
+        options.fragmentSize = atoi(value);
+      else if (name == "--rate")
+        options.scene.frameRate = (float)atof(value);
+      else if (name == "--rigidBodies")
+        options.scene.rigidBodies = atoi(value);
+      else if (name == "--skeletons")
+        options.scene.skeletons = atoi(value);
+      else if (name == "--bones")
+        options.scene.bonesPerSkeleton = atoi(value);
+      else if (name == "--labeledMarkers")
+        options.scene.labeledMarkers = atoi(value);
+      else if (name == "--forcePlates")
+        options.scene.forcePlates = atoi(value);
+      else
+        return false;
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+bool OpenSockets()
+{
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(0x202, &wsaData) != 0)
+    return false;
+#endif
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons((uint16_t)options.cmdPort);
+  if (inet_pton(AF_INET, options.localIP.c_str(), &local.sin_addr) != 1)
+    return false;
+
+  commandSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (commandSocket == kInvalidSocket || bind(commandSocket, (sockaddr*)&local, sizeof(local)) != 0)
+    return false;
+
+  // data socket on an ephemeral port of the same interface
+  local.sin_port = 0;
+  dataSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (dataSocket == kInvalidSocket || bind(dataSocket, (sockaddr*)&local, sizeof(local)) != 0)
+    return false;
+
+  int value = 4 * 1024 * 1024;
+  setsockopt(dataSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&value, sizeof(value));
+  setsockopt(dataSocket, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&local.sin_addr, sizeof(local.sin_addr));
+
+  memset(&multicastAddress, 0, sizeof(multicastAddress));
+  multicastAddress.sin_family = AF_INET;
+  multicastAddress.sin_port = htons((uint16_t)options.dataPort);
+  return inet_pton(AF_INET, options.multiCastIP.c_str(), &multicastAddress.sin_addr) == 1;
+}
+
+void Reply(int bytes, const sockaddr_in& to)
+{
+  if (bytes > 0)
+    sendto(commandSocket, (const char*)&packet, bytes, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+void HandleCommand(const SyntheticScene& scene, const sPacket& request, const sockaddr_in& from)
+{
+  // every message counts as a keep alive
+  Client* client = nullptr;
+  for (size_t i = 0; i < clients.size(); i++)
+  {
+    if (clients[i].address.sin_addr.s_addr == from.sin_addr.s_addr && clients[i].address.sin_port == from.sin_port)
+      client = &clients[i];
+  }
+  if (client != nullptr)
+    client->lastSeen = Clock::now();
+
+  switch (request.iMessage)
+  {
+  case NAT_CONNECT:
+  {
+    if (client == nullptr)
+    {
+      Client newClient;
+      newClient.address = from;
+      newClient.lastSeen = Clock::now();
+      clients.push_back(newClient);
+    }
+
+    sSender_Server server;
+    memset(&server, 0, sizeof(server));
+    snprintf(server.Common.szName, sizeof(server.Common.szName), "NatNetStandIn");
+    server.Common.Version[0] = 1;
+    server.Common.NatNetVersion[0] = 3;
+    server.Common.NatNetVersion[1] = 1;
+    server.HighResClockFrequency = 1000000000;   // HighResNow ticks in nanoseconds
+    server.DataPort = (uint16_t)options.dataPort;
+    server.IsMulticast = !options.unicast;
+    inet_pton(AF_INET, options.multiCastIP.c_str(), server.MulticastGroupAddress);
+
+    PacketWriter writer(packet, NAT_SERVERINFO);
+    writer.Append(&server, sizeof(server));
+    Reply(writer.Finish(), from);
+    if (options.verbose)
+      printf("client connected (%d total)\n", (int)clients.size());
+    break;
+  }
+
+  case NAT_DISCONNECT:
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+      if (&clients[i] == client)
+      {
+        clients.erase(clients.begin() + i);
+        break;
+      }
+    }
+    break;
+
+  case NAT_REQUEST_MODELDEF:
+  {
+    PacketWriter writer(packet, NAT_MODELDEF);
+    scene.WriteDescriptions(writer);
+    Reply(writer.Finish(), from);
+    break;
+  }
+
+  case NAT_REQUEST:
+  {
+    std::string command(request.Data.szData, strnlen(request.Data.szData, request.nDataBytes));
+    const bool known = (command == "UnitsToMillimeters" || command == "UpAxis" || command == "FrameRate");
+    PacketWriter writer(packet, known ? NAT_RESPONSE : NAT_UNRECOGNIZED_REQUEST);
+    if (command == "UnitsToMillimeters")
+      writer.Write<float>(1000.0f);              // the scene is in meters
+    else if (command == "UpAxis")
+      writer.Write<int32_t>(1);                  // y up
+    else if (command == "FrameRate")
+      writer.Write<float>(scene.GetConfig().frameRate);
+    Reply(writer.Finish(), from);
+    break;
+  }
+
+  case NAT_REQUEST_FRAMEOFDATA:
+  {
+    PacketWriter writer(packet, NAT_FRAMEOFDATA);
+    const uint64_t now = HighResNow();
+    scene.WriteFrame(writer, frameNumber,
+      now - kExposureToReceivedNs - kReceivedToTransmitNs, now - kReceivedToTransmitNs, now, 0);
+    Reply(writer.Finish(), from);
+    break;
+  }
+
+  case NAT_ECHOREQUEST:
+  {
+    // the client's timestamp followed by ours
+    PacketWriter writer(packet, NAT_ECHORESPONSE);
+    uint64_t clientTime = 0;
+    memcpy(&clientTime, request.Data.cData, (request.nDataBytes < 8) ? request.nDataBytes : 8);
+    writer.Write<uint64_t>(clientTime);
+    writer.Write<uint64_t>(HighResNow());
+    Reply(writer.Finish(), from);
+    break;
+  }
+
+  case NAT_KEEPALIVE:
+    break;
+
+  default:
+  {
+    PacketWriter writer(packet, NAT_UNRECOGNIZED_REQUEST);
+    Reply(writer.Finish(), from);
+    break;
+  }
+  }
+}
+
+void SendFrame(const SyntheticScene& scene)
+{
+  const uint64_t now = HighResNow();
+
+  PacketWriter writer(packet, NAT_FRAMEOFDATA);
+  scene.WriteFrame(writer, frameNumber++,
+    now - kExposureToReceivedNs - kReceivedToTransmitNs, now - kReceivedToTransmitNs, now,
+    modelsChanged ? 0x02 : 0);
+  modelsChanged = false;
+  const int bytes = writer.Finish();
+
+  if (!options.unicast)
+  {
+    SendFramePacket(dataSocket, multicastAddress, bytes);
+    return;
+  }
+
+  // unicast: to the address each client connected from
+  const Clock::time_point expired = Clock::now() - std::chrono::seconds(kClientTimeoutSeconds);
+  for (size_t i = 0; i < clients.size(); )
+  {
+    if (clients[i].lastSeen < expired)
+    {
+      clients.erase(clients.begin() + i);
+      continue;
+    }
+    SendFramePacket(commandSocket, clients[i].address, bytes);
+    i++;
+  }
+}
+
+// Sends the frame in packet as one datagram, or through the fragmenter.
+void SendFramePacket(StandInSocket s, const sockaddr_in& to, int bytes)
+{
+  if (fragmenter == nullptr)
+  {
+    sendto(s, (const char*)&packet, bytes, 0, (const sockaddr*)&to, sizeof(to));
+    return;
+  }
+  fragmentDestination.socket = s;
+  fragmentDestination.address = &to;
+  fragmenter->Send(&packet, bytes);
+}
+
+bool SendDatagram(const uint8_t* data, int bytes, void* pUserData)
+{
+  const FrameDestination* destination = (const FrameDestination*)pUserData;
+  return sendto(destination->socket, (const char*)data, bytes, 0,
+    (const sockaddr*)destination->address, sizeof(*destination->address)) == bytes;
+}
+
+uint64_t HighResNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,62 @@
+#ifndef _PACKETWRITER_H_
+#define _PACKETWRITER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "NatNetTypes.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Bounds checked writer filling the payload of an <c>sPacket</c>.
+/// Writing past MAX_PACKETSIZE clears <c>ok</c> and drops all further
+/// writes, so a message only has to be checked once when it is finished.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+struct PacketWriter
+{
+  sPacket& packet;
+  int pos;
+  bool ok;
+
+  PacketWriter(sPacket& p, uint16_t message)
+    : packet(p), pos(0), ok(true)
+  {
+    packet.iMessage = message;
+    packet.nDataBytes = 0;
+  }
+
+  void Append(const void* data, int bytes)
+  {
+    if (!ok || bytes < 0 || pos + bytes > MAX_PACKETSIZE)
+    {
+      ok = false;
+      return;
+    }
+    memcpy(packet.Data.cData + pos, data, bytes);
+    pos += bytes;
+  }
+
+  template<typename T>
+  void Write(T value)
+  {
+    Append(&value, sizeof(T));
+  }
+
+  // Writes a null terminated string.
+  void WriteString(const char* str)
+  {
+    Append(str, (int)strlen(str) + 1);
+  }
+
+  // Sets the payload size.
+  // Returns the datagram size (header and payload), 0 if the payload did
+  // not fit.
+  int Finish()
+  {
+    packet.nDataBytes = ok ? (uint16_t)pos : 0;
+    return ok ? 4 + pos : 0;
+  }
+};
+
+#endif // _PACKETWRITER_H_
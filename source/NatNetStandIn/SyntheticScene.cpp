@@ -0,0 +1,241 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "SyntheticScene.h"
+
+//////////////////////////////////////////////////////////////////////////
+// SyntheticScene implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const float kPi = 3.14159265f;
+
+  // Bone length along the parent's y axis (meters).
+  const float kBoneLength = 0.1f;
+
+  const char* kForcePlateChannelNames[SyntheticScene::FORCEPLATE_CHANNELS] = { "Fx", "Fy", "Fz", "Mx", "My", "Mz" };
+
+  int Clamp(int value, int max)
+  {
+    return value < 0 ? 0 : (value > max ? max : value);
+  }
+
+  // Rotation of angle (radians) about one axis as x, y, z, w.
+  void AxisAngle(float ax, float ay, float az, float angle, float q[4])
+  {
+    float s = sinf(0.5f * angle);
+    q[0] = ax * s;
+    q[1] = ay * s;
+    q[2] = az * s;
+    q[3] = cosf(0.5f * angle);
+  }
+
+  void WriteRigidBody(PacketWriter& writer, int32_t id, float x, float y, float z, const float q[4])
+  {
+    writer.Write<int32_t>(id);
+    writer.Write<float>(x);
+    writer.Write<float>(y);
+    writer.Write<float>(z);
+    writer.Append(q, 4 * sizeof(float));
+    writer.Write<float>(0.0002f);        // mean error
+    writer.Write<int16_t>(0x01);         // tracking valid
+  }
+}
+
+
+SyntheticScene::SyntheticScene(const Config& config)
+  :mConfig(config)
+{
+  mConfig.rigidBodies = Clamp(mConfig.rigidBodies, MAX_RIGIDBODIES);
+  mConfig.skeletons = Clamp(mConfig.skeletons, MAX_SKELETONS);
+  mConfig.bonesPerSkeleton = Clamp(mConfig.bonesPerSkeleton, MAX_SKELRIGIDBODIES);
+  mConfig.labeledMarkers = Clamp(mConfig.labeledMarkers, MAX_LABELED_MARKERS);
+  mConfig.forcePlates = Clamp(mConfig.forcePlates, MAX_FORCEPLATES);
+  if (mConfig.frameRate <= 0.0f)
+    mConfig.frameRate = 120.0f;
+}
+
+int SyntheticScene::FrameSize() const
+{
+  const int rigidBodySize = 4 + 7 * 4 + 4 + 2;
+  const int labeledMarkerSize = 4 + 4 * 4 + 2 + 4;
+  const int forcePlateSize = 4 + 4 + FORCEPLATE_CHANNELS * (4 + 4);
+
+  return 4                                                                      // frame number
+    + 4                                                                         // marker sets
+    + 4                                                                         // other markers
+    + 4 + mConfig.rigidBodies * rigidBodySize
+    + 4 + mConfig.skeletons * (4 + 4 + mConfig.bonesPerSkeleton * rigidBodySize)
+    + 4 + mConfig.labeledMarkers * labeledMarkerSize
+    + 4 + mConfig.forcePlates * forcePlateSize
+    + 4                                                                         // devices
+    + 4 + 4                                                                     // timecode
+    + 8 + 3 * 8                                                                 // timestamps
+    + 2                                                                         // params
+    + 4;                                                                        // end of data
+}
+
+//*************************************************************************
+// descriptions
+//
+
+void SyntheticScene::WriteRigidBodyDescription(PacketWriter& writer, const char* name, int32_t id, int32_t parentID,
+  float offsetx, float offsety, float offsetz) const
+{
+  writer.WriteString(name);
+  writer.Write<int32_t>(id);
+  writer.Write<int32_t>(parentID);
+  writer.Write<float>(offsetx);
+  writer.Write<float>(offsety);
+  writer.Write<float>(offsetz);
+  writer.Write<int32_t>(0);              // no markers
+}
+
+void SyntheticScene::WriteDescriptions(PacketWriter& writer) const
+{
+  char name[MAX_NAMELENGTH];
+
+  writer.Write<int32_t>(mConfig.rigidBodies + mConfig.skeletons + mConfig.forcePlates);
+
+  for (int i = 0; i < mConfig.rigidBodies; i++)
+  {
+    writer.Write<int32_t>(Descriptor_RigidBody);
+    snprintf(name, sizeof(name), "RigidBody%d", i + 1);
+    WriteRigidBodyDescription(writer, name, i + 1, -1, 0.0f, 0.0f, 0.0f);
+  }
+
+  for (int s = 0; s < mConfig.skeletons; s++)
+  {
+    writer.Write<int32_t>(Descriptor_Skeleton);
+    snprintf(name, sizeof(name), "Skeleton%d", s + 1);
+    writer.WriteString(name);
+    writer.Write<int32_t>(s + 1);
+    writer.Write<int32_t>(mConfig.bonesPerSkeleton);
+
+    // a chain: bone j + 1 hangs off bone j
+    for (int j = 0; j < mConfig.bonesPerSkeleton; j++)
+    {
+      snprintf(name, sizeof(name), "Skeleton%d_Bone%d", s + 1, j + 1);
+      WriteRigidBodyDescription(writer, name, j + 1, j, 0.0f, (j == 0) ? 0.0f : kBoneLength, 0.0f);
+    }
+  }
+
+  for (int f = 0; f < mConfig.forcePlates; f++)
+  {
+    writer.Write<int32_t>(Descriptor_ForcePlate);
+    writer.Write<int32_t>(f + 1);
+    snprintf(name, sizeof(name), "STANDIN-FP%d", f + 1);
+    writer.WriteString(name);
+    writer.Write<float>(0.6f);           // width
+    writer.Write<float>(0.4f);           // length
+    writer.Write<float>(0.0f);           // origin
+    writer.Write<float>(0.0f);
+    writer.Write<float>(0.0f);
+    for (int r = 0; r < 12; r++)
+      for (int c = 0; c < 12; c++)
+        writer.Write<float>(r == c ? 1.0f : 0.0f);
+
+    // corners, clockwise from +x +y, plates side by side along x
+    const float x0 = f * 0.7f;
+    const float corners[4][3] = { { x0 + 0.6f, 0.4f, 0.0f }, { x0 + 0.6f, 0.0f, 0.0f }, { x0, 0.0f, 0.0f }, { x0, 0.4f, 0.0f } };
+    writer.Append(corners, sizeof(corners));
+
+    writer.Write<int32_t>(2);            // plate type
+    writer.Write<int32_t>(0);            // calibrated force data
+    writer.Write<int32_t>(FORCEPLATE_CHANNELS);
+    for (int ch = 0; ch < FORCEPLATE_CHANNELS; ch++)
+      writer.WriteString(kForcePlateChannelNames[ch]);
+  }
+}
+
+//*************************************************************************
+// frames
+//
+
+void SyntheticScene::WriteFrame(PacketWriter& writer, int32_t frameNumber,
+  uint64_t cameraMidExposure, uint64_t cameraDataReceived, uint64_t transmit, int16_t params) const
+{
+  const double timestamp = frameNumber / (double)mConfig.frameRate;
+  const float t = (float)timestamp;
+  float q[4];
+
+  writer.Write<int32_t>(frameNumber);
+  writer.Write<int32_t>(0);              // marker sets
+  writer.Write<int32_t>(0);              // other markers
+
+  // rigid bodies circle the origin at their own radius and speed, facing
+  // the direction of travel
+  writer.Write<int32_t>(mConfig.rigidBodies);
+  for (int i = 0; i < mConfig.rigidBodies; i++)
+  {
+    const float radius = 0.5f + 0.1f * (i % 10);
+    const float angle = 2.0f * kPi * (0.1f + 0.02f * (i % 7)) * t + 0.5f * i;
+    AxisAngle(0.0f, 1.0f, 0.0f, -angle, q);
+    WriteRigidBody(writer, i + 1, radius * cosf(angle), 1.0f + 0.1f * sinf(3.0f * angle), radius * sinf(angle), q);
+  }
+
+  // skeleton bones in local coordinates: the root moves, every other bone
+  // sways about z relative to its parent
+  writer.Write<int32_t>(mConfig.skeletons);
+  for (int s = 0; s < mConfig.skeletons; s++)
+  {
+    const int32_t skeletonID = s + 1;
+    writer.Write<int32_t>(skeletonID);
+    writer.Write<int32_t>(mConfig.bonesPerSkeleton);
+    for (int j = 0; j < mConfig.bonesPerSkeleton; j++)
+    {
+      const int32_t id = (skeletonID << 16) | (j + 1);
+      if (j == 0)
+      {
+        const float angle = 2.0f * kPi * 0.05f * t + 1.3f * s;
+        AxisAngle(0.0f, 1.0f, 0.0f, -angle, q);
+        WriteRigidBody(writer, id, 2.0f * cosf(angle), 0.0f, 2.0f * sinf(angle), q);
+      }
+      else
+      {
+        AxisAngle(0.0f, 0.0f, 1.0f, 0.2f * sinf(2.0f * kPi * 0.5f * t + 0.3f * j), q);
+        WriteRigidBody(writer, id, 0.0f, kBoneLength, 0.0f, q);
+      }
+    }
+  }
+
+  // labeled markers on a slowly turning sphere
+  writer.Write<int32_t>(mConfig.labeledMarkers);
+  for (int i = 0; i < mConfig.labeledMarkers; i++)
+  {
+    const float theta = kPi * (i + 0.5f) / mConfig.labeledMarkers;
+    const float phi = 2.4f * i + 0.5f * t;
+    writer.Write<int32_t>(i + 1);
+    writer.Write<float>(0.3f * sinf(theta) * cosf(phi));
+    writer.Write<float>(1.5f + 0.3f * cosf(theta));
+    writer.Write<float>(0.3f * sinf(theta) * sinf(phi));
+    writer.Write<float>(0.014f);         // size
+    writer.Write<int16_t>(0);            // params
+    writer.Write<float>(0.0001f);        // residual
+  }
+
+  // one analog sample per channel and frame
+  writer.Write<int32_t>(mConfig.forcePlates);
+  for (int f = 0; f < mConfig.forcePlates; f++)
+  {
+    writer.Write<int32_t>(f + 1);
+    writer.Write<int32_t>(FORCEPLATE_CHANNELS);
+    for (int ch = 0; ch < FORCEPLATE_CHANNELS; ch++)
+    {
+      writer.Write<int32_t>(1);
+      writer.Write<float>(100.0f * sinf(2.0f * kPi * 1.0f * t + ch + f));
+    }
+  }
+
+  writer.Write<int32_t>(0);              // devices
+
+  writer.Write<uint32_t>(0);             // timecode
+  writer.Write<uint32_t>(0);             // timecode subframe
+  writer.Write<double>(timestamp);
+  writer.Write<uint64_t>(cameraMidExposure);
+  writer.Write<uint64_t>(cameraDataReceived);
+  writer.Write<uint64_t>(transmit);
+  writer.Write<int16_t>(params);
+  writer.Write<int32_t>(0);              // end of data
+}
@@ -0,0 +1,88 @@
+#ifndef _SYNTHETICSCENE_H_
+#define _SYNTHETICSCENE_H_
+
+#include <stdint.h>
+
+#include "PacketWriter.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Generated mocap scene streamed by the stand-in server: rigid bodies
+/// moving on circles, skeletons made of bone chains, labeled markers and
+/// force plates with six analog channels each. Motion is a pure function
+/// of the frame number, so two runs with the same settings produce the
+/// same stream.
+/// </summary>
+/// <remarks>Descriptions and frames are written in the NatNet 3.1
+/// bitstream format.</remarks>
+//////////////////////////////////////////////////////////////////////////
+class SyntheticScene
+{
+public:
+  // Analog channels per force plate (Fx, Fy, Fz, Mx, My, Mz).
+  static const int FORCEPLATE_CHANNELS = 6;
+
+  struct Config
+  {
+    int rigidBodies;
+    int skeletons;
+    int bonesPerSkeleton;
+    int labeledMarkers;
+    int forcePlates;
+    float frameRate;
+
+    Config()
+      : rigidBodies(10), skeletons(0), bonesPerSkeleton(21),
+      labeledMarkers(0), forcePlates(0), frameRate(120.0f)
+    {
+    }
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates the scene. Counts are clamped to the MAX_* limits
+  /// of NatNetTypes.h.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  explicit SyntheticScene(const Config& config);
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  const Config& GetConfig() const { return mConfig; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the payload size of every frame of this scene.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  int FrameSize() const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Writes the NAT_MODELDEF payload.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void WriteDescriptions(PacketWriter& writer) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Writes the NAT_FRAMEOFDATA payload of one frame.</summary>
+  /// <param name='cameraMidExposure'>High resolution timestamps of the
+  /// frame, see sFrameOfMocapData.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void WriteFrame(PacketWriter& writer, int32_t frameNumber,
+    uint64_t cameraMidExposure, uint64_t cameraDataReceived, uint64_t transmit, int16_t params) const;
+
+private:
+  void WriteRigidBodyDescription(PacketWriter& writer, const char* name, int32_t id, int32_t parentID,
+    float offsetx, float offsety, float offsetz) const;
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  Config mConfig;
+};
+
+#endif // _SYNTHETICSCENE_H_
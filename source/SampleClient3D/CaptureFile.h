@@ -0,0 +1,48 @@
+#ifndef _CAPTUREFILE_H_
+#define _CAPTUREFILE_H_
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Layout of a NatNet capture file: one CaptureFileHeader followed by
+/// records of one CaptureRecordHeader and the raw datagram bytes, padded
+/// to a multiple of CAPTURE_ALIGNMENT. Datagrams are stored exactly as
+/// received (an <c>sPacket</c> or a fragment), so replaying a capture
+/// exercises the same code as live data. All fields are little endian.
+/// </summary>
+/// <remarks>
+/// Files are append only. A writer that is killed can leave a partial
+/// last record; readers stop at the last complete record.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+
+// Record alignment; keeps every record header and datagram 8 byte aligned
+// in a memory mapped file.
+const int CAPTURE_ALIGNMENT = 8;
+
+const char CAPTURE_MAGIC[8] = { 'N', 'N', 'C', 'A', 'P', 'T', 'U', 'R' };
+const uint32_t CAPTURE_VERSION = 1;
+
+struct CaptureFileHeader
+{
+  char magic[8];                  // CAPTURE_MAGIC
+  uint32_t version;               // CAPTURE_VERSION
+  uint8_t bitstreamVersion[4];    // NatNet bitstream version of the stream
+  uint64_t reserved;
+};
+
+struct CaptureRecordHeader
+{
+  uint64_t receiveTimeNs;         // receive time (steady clock, nanoseconds)
+  uint32_t bytes;                 // datagram size, without padding
+  uint32_t reserved;
+};
+
+// Bytes taken by a record holding a datagram of the given size.
+inline uint64_t CaptureRecordSize(uint32_t bytes)
+{
+  return sizeof(CaptureRecordHeader) + ((bytes + CAPTURE_ALIGNMENT - 1) & ~(uint64_t)(CAPTURE_ALIGNMENT - 1));
+}
+
+#endif // _CAPTUREFILE_H_
@@ -0,0 +1,150 @@
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include "CaptureReader.h"
+
+//////////////////////////////////////////////////////////////////////////
+// CaptureReader implementation
+//////////////////////////////////////////////////////////////////////////
+
+CaptureReader::CaptureReader()
+  :mData(nullptr),
+  mSize(0),
+  mPosition(0),
+  mTruncated(false)
+#ifdef _WIN32
+  , mFile(INVALID_HANDLE_VALUE),
+  mMapping(nullptr)
+#endif
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+  Close();
+}
+
+bool CaptureReader::Open(const char* path)
+{
+  Close();
+
+#ifdef _WIN32
+  mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (mFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(mFile, &size) || size.QuadPart < (LONGLONG)sizeof(CaptureFileHeader))
+  {
+    Close();
+    return false;
+  }
+
+  // a 32 bit process cannot map captures larger than its address space
+  mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mMapping == nullptr)
+  {
+    Close();
+    return false;
+  }
+  mData = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+  mSize = (uint64_t)size.QuadPart;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CaptureFileHeader))
+  {
+    close(fd);
+    return false;
+  }
+
+  // the mapping keeps its own reference to the file
+  void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+  mData = (const uint8_t*)data;
+  mSize = (uint64_t)st.st_size;
+#endif
+
+  if (mData == nullptr)
+  {
+    Close();
+    return false;
+  }
+
+  const CaptureFileHeader* header = (const CaptureFileHeader*)mData;
+  if (memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0 || header->version != CAPTURE_VERSION)
+  {
+    Close();
+    return false;
+  }
+
+  Rewind();
+  return true;
+}
+
+void CaptureReader::Close()
+{
+#ifdef _WIN32
+  if (mData != nullptr)
+    UnmapViewOfFile(mData);
+  if (mMapping != nullptr)
+    CloseHandle(mMapping);
+  if (mFile != INVALID_HANDLE_VALUE)
+    CloseHandle(mFile);
+  mMapping = nullptr;
+  mFile = INVALID_HANDLE_VALUE;
+#else
+  if (mData != nullptr)
+    munmap((void*)mData, (size_t)mSize);
+#endif
+
+  mData = nullptr;
+  mSize = 0;
+  mPosition = 0;
+  mTruncated = false;
+}
+
+const uint8_t* CaptureReader::BitstreamVersion() const
+{
+  return (mData != nullptr) ? ((const CaptureFileHeader*)mData)->bitstreamVersion : nullptr;
+}
+
+bool CaptureReader::Next(Record& record)
+{
+  if (mData == nullptr || mPosition >= mSize)
+    return false;
+
+  // the writer may have been stopped in the middle of a record
+  const CaptureRecordHeader* header = (const CaptureRecordHeader*)(mData + mPosition);
+  if (mSize - mPosition < sizeof(CaptureRecordHeader) ||
+    mSize - mPosition < sizeof(CaptureRecordHeader) + header->bytes ||
+    header->bytes > 0x7FFFFFFF)
+  {
+    mTruncated = true;
+    mPosition = mSize;
+    return false;
+  }
+
+  record.receiveTimeNs = header->receiveTimeNs;
+  record.data = (const uint8_t*)(header + 1);
+  record.bytes = (int)header->bytes;
+
+  mPosition += CaptureRecordSize(header->bytes);
+  return true;
+}
@@ -0,0 +1,95 @@
+#ifndef _CAPTUREREADER_H_
+#define _CAPTUREREADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CaptureFile.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Read only, memory mapped view of a capture file (see CaptureFile.h).
+/// Records are returned as pointers into the mapping, so iterating a
+/// capture copies nothing and pages are only read from disk as they are
+/// touched.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+class CaptureReader
+{
+public:
+  // One captured datagram. <c>data</c> points into the mapping and stays
+  // valid until the reader is closed.
+  struct Record
+  {
+    uint64_t receiveTimeNs;
+    const uint8_t* data;
+    int bytes;
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  CaptureReader();
+  ~CaptureReader();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Maps a capture file.</summary>
+  /// <returns>false if the file cannot be mapped or has no valid header.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Open(const char* path);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Unmaps the file.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Close();
+
+  bool IsOpen() const { return mData != nullptr; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the NatNet bitstream version of the capture, e.g.
+  /// to pick the decoder with SelectFrameDecoder.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  const uint8_t* BitstreamVersion() const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the next record.</summary>
+  /// <returns>false at the end of the capture. Truncated() tells whether
+  /// the capture ended with a partial record.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Next(Record& record);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Restarts iteration at the first record.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Rewind() { mPosition = sizeof(CaptureFileHeader); mTruncated = false; }
+
+  bool Truncated() const { return mTruncated; }
+
+  uint64_t SizeInBytes() const { return mSize; }
+
+private:
+  CaptureReader(const CaptureReader&); // not implemented
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  const uint8_t* mData;
+  uint64_t mSize;
+  uint64_t mPosition;
+  bool mTruncated;
+
+#ifdef _WIN32
+  void* mFile;
+  void* mMapping;
+#endif
+};
+
+#endif // _CAPTUREREADER_H_
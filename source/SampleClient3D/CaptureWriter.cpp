@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstring>
+
+#include "CaptureWriter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// CaptureWriter implementation
+//////////////////////////////////////////////////////////////////////////
+
+CaptureWriter::CaptureWriter()
+  :mFile(nullptr),
+  mBuffer(new char[BUFFER_SIZE]),
+  mRecords(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  Close();
+  delete[] mBuffer;
+}
+
+bool CaptureWriter::Open(const char* path, const uint8_t bitstreamVersion[4])
+{
+  Close();
+
+  // Appending to an existing capture - it has to be of the same stream.
+  // A missing or empty file gets a new header.
+  CaptureFileHeader header;
+  bool writeHeader = true;
+  FILE* existing = fopen(path, "rb");
+  if (existing != nullptr)
+  {
+    size_t read = fread(&header, 1, sizeof(header), existing);
+    fclose(existing);
+    if (read != 0)
+    {
+      if (read != sizeof(header) ||
+        memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CAPTURE_VERSION ||
+        memcmp(header.bitstreamVersion, bitstreamVersion, 4) != 0)
+      {
+        return false;
+      }
+      writeHeader = false;
+    }
+  }
+
+  mFile = fopen(path, "ab");
+  if (mFile == nullptr)
+    return false;
+  setvbuf(mFile, mBuffer, _IOFBF, BUFFER_SIZE);
+
+  if (writeHeader)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    memcpy(header.bitstreamVersion, bitstreamVersion, 4);
+    if (fwrite(&header, sizeof(header), 1, mFile) != 1)
+    {
+      Close();
+      return false;
+    }
+  }
+
+  mRecords = 0;
+  return true;
+}
+
+void CaptureWriter::Close()
+{
+  if (mFile != nullptr)
+  {
+    fclose(mFile);
+    mFile = nullptr;
+  }
+}
+
+bool CaptureWriter::Write(const void* datagram, int bytes, uint64_t receiveTimeNs)
+{
+  static const uint8_t padding[CAPTURE_ALIGNMENT] = { 0 };
+
+  if (mFile == nullptr || bytes < 0)
+    return false;
+
+  CaptureRecordHeader record;
+  record.receiveTimeNs = receiveTimeNs;
+  record.bytes = (uint32_t)bytes;
+  record.reserved = 0;
+
+  const size_t pad = (size_t)(CaptureRecordSize(record.bytes) - sizeof(record) - bytes);
+  if (fwrite(&record, sizeof(record), 1, mFile) != 1 ||
+    fwrite(datagram, 1, bytes, mFile) != (size_t)bytes ||
+    fwrite(padding, 1, pad, mFile) != pad)
+  {
+    return false;
+  }
+
+  mRecords++;
+  return true;
+}
+
+void CaptureWriter::Flush()
+{
+  if (mFile != nullptr)
+    fflush(mFile);
+}
+
+uint64_t CaptureWriter::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,83 @@
+#ifndef _CAPTUREWRITER_H_
+#define _CAPTUREWRITER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "CaptureFile.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Appends raw NatNet datagrams with their receive time to a capture file
+/// (see CaptureFile.h). Writes are buffered; a write does not block on the
+/// disk unless the buffer is full.
+/// </summary>
+/// <remarks>Not thread safe; meant to be called from the receiving
+/// thread.</remarks>
+//////////////////////////////////////////////////////////////////////////
+class CaptureWriter
+{
+public:
+  // stdio buffer size.
+  static const size_t BUFFER_SIZE = 1024 * 1024;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  CaptureWriter();
+  ~CaptureWriter();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Opens a capture file for appending. A new file is created
+  /// with a header for the given bitstream version.</summary>
+  /// <returns>false if the file cannot be opened, or if it exists but is
+  /// not a capture file of the same bitstream version.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Open(const char* path, const uint8_t bitstreamVersion[4]);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Flushes and closes the file.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Close();
+
+  bool IsOpen() const { return mFile != nullptr; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Appends one datagram.</summary>
+  /// <param name='receiveTimeNs'>Receive time, usually Now() taken right
+  /// after the datagram was received.</param>
+  //////////////////////////////////////////////////////////////////////////
+  bool Write(const void* datagram, int bytes, uint64_t receiveTimeNs);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Writes buffered records to the file.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Flush();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the steady clock time in nanoseconds, the time base
+  /// of receive timestamps.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  static uint64_t Now();
+
+  uint64_t RecordCount() const { return mRecords; }
+
+private:
+  CaptureWriter(const CaptureWriter&); // not implemented
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  FILE* mFile;
+  char* mBuffer;
+  uint64_t mRecords;
+};
+
+#endif // _CAPTUREWRITER_H_
@@ -0,0 +1,423 @@
+#include "CompactFrame.h"
+
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////////
+// CompactFrame implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  size_t AlignUp(size_t bytes)
+  {
+    return (bytes + 7) & ~(size_t)7;
+  }
+}
+
+
+CompactFrame::CompactFrame()
+  :mBuffer(nullptr), mSize(0), mCapacity(0)
+{
+  Begin(0);
+}
+
+CompactFrame::CompactFrame(size_t reserveBytes)
+  :mBuffer(nullptr), mSize(0), mCapacity(0)
+{
+  Reserve(reserveBytes);
+  Begin(0);
+}
+
+CompactFrame::CompactFrame(const CompactFrame& other)
+  :mBuffer(nullptr), mSize(0), mCapacity(0)
+{
+  CopyFrom(other);
+}
+
+CompactFrame& CompactFrame::operator=(const CompactFrame& other)
+{
+  if (this != &other)
+    CopyFrom(other);
+  return *this;
+}
+
+CompactFrame::~CompactFrame()
+{
+  delete[] mBuffer;
+}
+
+void CompactFrame::Grow(size_t minCapacity)
+{
+  size_t capacity = (mCapacity < 1024) ? 1024 : mCapacity;
+  while (capacity < minCapacity)
+    capacity *= 2;
+
+  uint64_t* buffer = new uint64_t[capacity / sizeof(uint64_t)];
+  if (mSize > 0)
+    memcpy(buffer, mBuffer, mSize);
+  delete[] mBuffer;
+  mBuffer = buffer;
+  mCapacity = capacity;
+}
+
+void CompactFrame::Reserve(size_t bytes)
+{
+  bytes = AlignUp(bytes);
+  if (bytes > mCapacity)
+    Grow(bytes);
+}
+
+CompactFrame::Offset CompactFrame::Alloc(size_t bytes)
+{
+  size_t offset = mSize;
+  size_t end = offset + AlignUp(bytes);
+  if (end > mCapacity)
+    Grow(end);
+  mSize = end;
+  return (Offset)offset;
+}
+
+void CompactFrame::CopyFrom(const CompactFrame& other)
+{
+  if (other.mSize > mCapacity)
+  {
+    // nothing to preserve
+    mSize = 0;
+    Grow(other.mSize);
+  }
+  memcpy(mBuffer, other.mBuffer, other.mSize);
+  mSize = other.mSize;
+}
+
+//*************************************************************************
+// building
+//
+
+void CompactFrame::Begin(int32_t frameNumber)
+{
+  mSize = 0;
+  Alloc(sizeof(Header));
+  memset(&Head(), 0, sizeof(Header));
+  Head().iFrame = frameNumber;
+}
+
+void CompactFrame::BeginMarkerSets(int count)
+{
+  Offset table = Alloc(count * sizeof(MarkerSetEntry));
+  Head().markerSets = table;
+  Head().nMarkerSets = count;
+}
+
+MarkerData* CompactFrame::SetMarkerSet(int i, const char* name, int numMarkers)
+{
+  size_t nameLength = strlen(name) + 1;
+  Offset nameOffset = Alloc(nameLength);
+  memcpy(At<char>(nameOffset), name, nameLength);
+  Offset markers = Alloc(numMarkers * sizeof(MarkerData));
+
+  MarkerSetEntry& entry = At<MarkerSetEntry>(Head().markerSets)[i];
+  entry.name = nameOffset;
+  entry.nMarkers = numMarkers;
+  entry.markers = markers;
+  return At<MarkerData>(markers);
+}
+
+MarkerData* CompactFrame::SetOtherMarkers(int count)
+{
+  Offset markers = Alloc(count * sizeof(MarkerData));
+  Head().otherMarkers = markers;
+  Head().nOtherMarkers = count;
+  return At<MarkerData>(markers);
+}
+
+sRigidBodyData* CompactFrame::SetRigidBodies(int count)
+{
+  Offset bodies = Alloc(count * sizeof(sRigidBodyData));
+  Head().rigidBodies = bodies;
+  Head().nRigidBodies = count;
+  return At<sRigidBodyData>(bodies);
+}
+
+void CompactFrame::BeginSkeletons(int count)
+{
+  Offset table = Alloc(count * sizeof(SkeletonEntry));
+  Head().skeletons = table;
+  Head().nSkeletons = count;
+}
+
+sRigidBodyData* CompactFrame::SetSkeleton(int i, int32_t skeletonID, int numBones)
+{
+  Offset bones = Alloc(numBones * sizeof(sRigidBodyData));
+
+  SkeletonEntry& entry = At<SkeletonEntry>(Head().skeletons)[i];
+  entry.skeletonID = skeletonID;
+  entry.nBones = numBones;
+  entry.bones = bones;
+  return At<sRigidBodyData>(bones);
+}
+
+sMarker* CompactFrame::SetLabeledMarkers(int count)
+{
+  Offset markers = Alloc(count * sizeof(sMarker));
+  Head().labeledMarkers = markers;
+  Head().nLabeledMarkers = count;
+  return At<sMarker>(markers);
+}
+
+void CompactFrame::BeginForcePlates(int count)
+{
+  Offset table = Alloc(count * sizeof(AnalogEntry));
+  Head().forcePlates = table;
+  Head().nForcePlates = count;
+}
+
+void CompactFrame::SetForcePlate(int i, int32_t id, int numChannels, int16_t params)
+{
+  Offset channels = Alloc(numChannels * sizeof(ChannelEntry));
+
+  AnalogEntry& entry = At<AnalogEntry>(Head().forcePlates)[i];
+  entry.ID = id;
+  entry.nChannels = numChannels;
+  entry.params = params;
+  entry.channels = channels;
+}
+
+float* CompactFrame::SetForcePlateChannel(int i, int channel, int numFrames)
+{
+  return SetAnalogChannel(Head().forcePlates, i, channel, numFrames);
+}
+
+void CompactFrame::BeginDevices(int count)
+{
+  Offset table = Alloc(count * sizeof(AnalogEntry));
+  Head().devices = table;
+  Head().nDevices = count;
+}
+
+void CompactFrame::SetDevice(int i, int32_t id, int numChannels, int16_t params)
+{
+  Offset channels = Alloc(numChannels * sizeof(ChannelEntry));
+
+  AnalogEntry& entry = At<AnalogEntry>(Head().devices)[i];
+  entry.ID = id;
+  entry.nChannels = numChannels;
+  entry.params = params;
+  entry.channels = channels;
+}
+
+float* CompactFrame::SetDeviceChannel(int i, int channel, int numFrames)
+{
+  return SetAnalogChannel(Head().devices, i, channel, numFrames);
+}
+
+float* CompactFrame::SetAnalogChannel(Offset table, int i, int channel, int numFrames)
+{
+  Offset values = Alloc(numFrames * sizeof(float));
+
+  const AnalogEntry& entry = At<AnalogEntry>(table)[i];
+  ChannelEntry& ch = At<ChannelEntry>(entry.channels)[channel];
+  ch.nFrames = numFrames;
+  ch.values = values;
+  return At<float>(values);
+}
+
+void CompactFrame::SetTimecode(uint32_t timecode, uint32_t timecodeSubframe)
+{
+  Head().Timecode = timecode;
+  Head().TimecodeSubframe = timecodeSubframe;
+}
+
+void CompactFrame::SetTimestamps(double timestamp, uint64_t cameraMidExposure, uint64_t cameraDataReceived, uint64_t transmit)
+{
+  Head().fTimestamp = timestamp;
+  Head().CameraMidExposureTimestamp = cameraMidExposure;
+  Head().CameraDataReceivedTimestamp = cameraDataReceived;
+  Head().TransmitTimestamp = transmit;
+}
+
+void CompactFrame::SetParams(int16_t params)
+{
+  Head().params = params;
+}
+
+void CompactFrame::SetReceiveTime(uint64_t receiveTimeNs)
+{
+  Head().receiveTime = receiveTimeNs;
+}
+
+//*************************************************************************
+// access
+//
+
+const char* CompactFrame::MarkerSetName(int i) const
+{
+  return At<char>(At<MarkerSetEntry>(Head().markerSets)[i].name);
+}
+
+int CompactFrame::MarkerSetMarkerCount(int i) const
+{
+  return At<MarkerSetEntry>(Head().markerSets)[i].nMarkers;
+}
+
+const MarkerData* CompactFrame::MarkerSetMarkers(int i) const
+{
+  return At<MarkerData>(At<MarkerSetEntry>(Head().markerSets)[i].markers);
+}
+
+int32_t CompactFrame::SkeletonID(int i) const
+{
+  return At<SkeletonEntry>(Head().skeletons)[i].skeletonID;
+}
+
+int CompactFrame::SkeletonBoneCount(int i) const
+{
+  return At<SkeletonEntry>(Head().skeletons)[i].nBones;
+}
+
+const sRigidBodyData* CompactFrame::SkeletonBones(int i) const
+{
+  return At<sRigidBodyData>(At<SkeletonEntry>(Head().skeletons)[i].bones);
+}
+
+void CompactFrame::GetAnalog(Offset table, int i, int32_t& id, int32_t& nChannels, int16_t& params, sAnalogChannelData* channels) const
+{
+  const AnalogEntry& entry = At<AnalogEntry>(table)[i];
+  id = entry.ID;
+  params = entry.params;
+  nChannels = (entry.nChannels < MAX_ANALOG_CHANNELS) ? entry.nChannels : MAX_ANALOG_CHANNELS;
+
+  const ChannelEntry* ch = At<ChannelEntry>(entry.channels);
+  for (int c = 0; c < nChannels; c++)
+  {
+    int n = (ch[c].nFrames < MAX_ANALOG_SUBFRAMES) ? ch[c].nFrames : MAX_ANALOG_SUBFRAMES;
+    channels[c].nFrames = n;
+    memcpy(channels[c].Values, At<float>(ch[c].values), n * sizeof(float));
+  }
+}
+
+void CompactFrame::GetForcePlate(int i, sForcePlateData& out) const
+{
+  GetAnalog(Head().forcePlates, i, out.ID, out.nChannels, out.params, out.ChannelData);
+}
+
+void CompactFrame::GetDevice(int i, sDeviceData& out) const
+{
+  GetAnalog(Head().devices, i, out.ID, out.nChannels, out.params, out.ChannelData);
+}
+
+//*************************************************************************
+// legacy conversion
+//
+
+void CompactFrame::FromLegacy(const sFrameOfMocapData& src, uint32_t sections)
+{
+  Begin(src.iFrame);
+
+  if (sections & FrameSection_MarkerSets)
+  {
+    BeginMarkerSets(src.nMarkerSets);
+    for (int i = 0; i < src.nMarkerSets; i++)
+    {
+      const sMarkerSetData& ms = src.MocapData[i];
+      MarkerData* markers = SetMarkerSet(i, ms.szName, ms.nMarkers);
+      memcpy(markers, ms.Markers, ms.nMarkers * sizeof(MarkerData));
+    }
+  }
+
+  if ((sections & FrameSection_OtherMarkers) && src.nOtherMarkers > 0)
+    memcpy(SetOtherMarkers(src.nOtherMarkers), src.OtherMarkers, src.nOtherMarkers * sizeof(MarkerData));
+
+  if (sections & FrameSection_RigidBodies)
+    memcpy(SetRigidBodies(src.nRigidBodies), src.RigidBodies, src.nRigidBodies * sizeof(sRigidBodyData));
+
+  if (sections & FrameSection_Skeletons)
+  {
+    BeginSkeletons(src.nSkeletons);
+    for (int i = 0; i < src.nSkeletons; i++)
+    {
+      const sSkeletonData& sk = src.Skeletons[i];
+      memcpy(SetSkeleton(i, sk.skeletonID, sk.nRigidBodies), sk.RigidBodyData, sk.nRigidBodies * sizeof(sRigidBodyData));
+    }
+  }
+
+  if (sections & FrameSection_LabeledMarkers)
+    memcpy(SetLabeledMarkers(src.nLabeledMarkers), src.LabeledMarkers, src.nLabeledMarkers * sizeof(sMarker));
+
+  if (sections & FrameSection_ForcePlates)
+  {
+    BeginForcePlates(src.nForcePlates);
+    for (int i = 0; i < src.nForcePlates; i++)
+    {
+      const sForcePlateData& fp = src.ForcePlates[i];
+      SetForcePlate(i, fp.ID, fp.nChannels, fp.params);
+      for (int c = 0; c < fp.nChannels; c++)
+        memcpy(SetForcePlateChannel(i, c, fp.ChannelData[c].nFrames), fp.ChannelData[c].Values, fp.ChannelData[c].nFrames * sizeof(float));
+    }
+  }
+
+  if (sections & FrameSection_Devices)
+  {
+    BeginDevices(src.nDevices);
+    for (int i = 0; i < src.nDevices; i++)
+    {
+      const sDeviceData& dev = src.Devices[i];
+      SetDevice(i, dev.ID, dev.nChannels, dev.params);
+      for (int c = 0; c < dev.nChannels; c++)
+        memcpy(SetDeviceChannel(i, c, dev.ChannelData[c].nFrames), dev.ChannelData[c].Values, dev.ChannelData[c].nFrames * sizeof(float));
+    }
+  }
+
+  SetTimecode(src.Timecode, src.TimecodeSubframe);
+  SetTimestamps(src.fTimestamp, src.CameraMidExposureTimestamp, src.CameraDataReceivedTimestamp, src.TransmitTimestamp);
+  SetParams(src.params);
+}
+
+void CompactFrame::ToLegacy(sFrameOfMocapData& dst) const
+{
+  const Header& head = Head();
+
+  dst.iFrame = head.iFrame;
+
+  dst.nMarkerSets = head.nMarkerSets;
+  for (int i = 0; i < head.nMarkerSets; i++)
+  {
+    sMarkerSetData& ms = dst.MocapData[i];
+    strncpy(ms.szName, MarkerSetName(i), MAX_NAMELENGTH - 1);
+    ms.szName[MAX_NAMELENGTH - 1] = '\0';
+    ms.nMarkers = MarkerSetMarkerCount(i);
+    ms.Markers = const_cast<MarkerData*>(MarkerSetMarkers(i));
+  }
+
+  dst.nOtherMarkers = head.nOtherMarkers;
+  dst.OtherMarkers = const_cast<MarkerData*>(OtherMarkers());
+
+  dst.nRigidBodies = head.nRigidBodies;
+  memcpy(dst.RigidBodies, RigidBodies(), head.nRigidBodies * sizeof(sRigidBodyData));
+
+  dst.nSkeletons = head.nSkeletons;
+  for (int i = 0; i < head.nSkeletons; i++)
+  {
+    dst.Skeletons[i].skeletonID = SkeletonID(i);
+    dst.Skeletons[i].nRigidBodies = SkeletonBoneCount(i);
+    dst.Skeletons[i].RigidBodyData = const_cast<sRigidBodyData*>(SkeletonBones(i));
+  }
+
+  dst.nLabeledMarkers = head.nLabeledMarkers;
+  memcpy(dst.LabeledMarkers, LabeledMarkers(), head.nLabeledMarkers * sizeof(sMarker));
+
+  dst.nForcePlates = head.nForcePlates;
+  for (int i = 0; i < head.nForcePlates; i++)
+    GetForcePlate(i, dst.ForcePlates[i]);
+
+  dst.nDevices = head.nDevices;
+  for (int i = 0; i < head.nDevices; i++)
+    GetDevice(i, dst.Devices[i]);
+
+  dst.Timecode = head.Timecode;
+  dst.TimecodeSubframe = head.TimecodeSubframe;
+  dst.fTimestamp = head.fTimestamp;
+  dst.CameraMidExposureTimestamp = head.CameraMidExposureTimestamp;
+  dst.CameraDataReceivedTimestamp = head.CameraDataReceivedTimestamp;
+  dst.TransmitTimestamp = head.TransmitTimestamp;
+  dst.params = head.params;
+}
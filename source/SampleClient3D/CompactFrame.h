@@ -0,0 +1,266 @@
+#ifndef _COMPACTFRAME_H_
+#define _COMPACTFRAME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "NatNetTypes.h"
+#include "FrameSubscription.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Variable sized frame of mocap data. Everything - header, marker sets,
+/// rigid bodies, skeleton bones, labeled markers and analog channels - is
+/// stored in one contiguous arena that is only as large as the counts
+/// actually present in the frame. A session with a handful of rigid bodies
+/// needs a few hundred bytes instead of the ~600 KB of a
+/// <c>sFrameOfMocapData</c>.
+/// </summary>
+/// <remarks>
+/// All internal references are offsets into the arena, so copying a frame
+/// is a single memcpy of the used bytes. The arena only grows; once it has
+/// reached the size of the largest frame of a session, filling or copying
+/// a frame does not allocate any more.
+///
+/// Frames are filled section by section in stream order (the same order
+/// NatNet puts them on the wire). Pointers returned by the Set* functions
+/// are only valid until the next Set* call.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class CompactFrame
+{
+public:
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// Default constructor. Resulting frame is empty.
+  //////////////////////////////////////////////////////////////////////////
+  CompactFrame();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// Constructs an empty frame with an arena of at least the given size.
+  //////////////////////////////////////////////////////////////////////////
+  explicit CompactFrame(size_t reserveBytes);
+
+  CompactFrame(const CompactFrame& other);
+  CompactFrame& operator=(const CompactFrame& other);
+  ~CompactFrame();
+
+
+  //*************************************************************************
+  // Member Functions - conversion
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Copies the populated ranges of a legacy frame. Any existing data will
+  /// be lost. Sections not set in <c>sections</c> (a combination of
+  /// FrameSection values) are not copied and stay empty.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  void FromLegacy(const sFrameOfMocapData& src, uint32_t sections = FrameSection_All);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Fills a legacy frame. Only the populated entries of <c>dst</c> are
+  /// written.
+  /// </summary>
+  /// <remarks>The marker set, other marker and skeleton bone pointers of
+  /// <c>dst</c> point into this frame's arena. They stay valid until this
+  /// frame is modified or destroyed.</remarks>
+  //////////////////////////////////////////////////////////////////////////
+  void ToLegacy(sFrameOfMocapData& dst) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Copies another compact frame. Only the used bytes of its arena are
+  /// copied; the arena of self is only reallocated if it is too small.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  void CopyFrom(const CompactFrame& other);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Makes sure the arena can hold at least the given number of
+  /// bytes without reallocating.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Reserve(size_t bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the number of bytes used by the frame.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  size_t SizeInBytes() const { return mSize; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the number of bytes the arena can hold.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  size_t CapacityInBytes() const { return mCapacity; }
+
+
+  //*************************************************************************
+  // Member Functions - building (in stream order)
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts a new frame. Any existing data will be lost.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Begin(int32_t frameNumber);
+
+  void BeginMarkerSets(int count);
+  MarkerData* SetMarkerSet(int i, const char* name, int numMarkers);
+  MarkerData* SetOtherMarkers(int count);
+  sRigidBodyData* SetRigidBodies(int count);
+  void BeginSkeletons(int count);
+  sRigidBodyData* SetSkeleton(int i, int32_t skeletonID, int numBones);
+  sMarker* SetLabeledMarkers(int count);
+  void BeginForcePlates(int count);
+  void SetForcePlate(int i, int32_t id, int numChannels, int16_t params);
+  float* SetForcePlateChannel(int i, int channel, int numFrames);
+  void BeginDevices(int count);
+  void SetDevice(int i, int32_t id, int numChannels, int16_t params);
+  float* SetDeviceChannel(int i, int channel, int numFrames);
+
+  void SetTimecode(uint32_t timecode, uint32_t timecodeSubframe);
+  void SetTimestamps(double timestamp, uint64_t cameraMidExposure, uint64_t cameraDataReceived, uint64_t transmit);
+  void SetParams(int16_t params);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the local time (<c>LatencyMonitor::Now()</c>) the
+  /// frame was received at, 0 if it was not timed. Not part of the NatNet
+  /// frame; only used for latency measurements.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetReceiveTime(uint64_t receiveTimeNs);
+
+
+  //*************************************************************************
+  // Member Functions - access
+  //
+
+  int32_t  FrameNumber() const { return Head().iFrame; }
+  uint32_t Timecode() const { return Head().Timecode; }
+  uint32_t TimecodeSubframe() const { return Head().TimecodeSubframe; }
+  double   Timestamp() const { return Head().fTimestamp; }
+  uint64_t CameraMidExposureTimestamp() const { return Head().CameraMidExposureTimestamp; }
+  uint64_t CameraDataReceivedTimestamp() const { return Head().CameraDataReceivedTimestamp; }
+  uint64_t TransmitTimestamp() const { return Head().TransmitTimestamp; }
+  int16_t  Params() const { return Head().params; }
+  uint64_t ReceiveTime() const { return Head().receiveTime; }
+
+  int MarkerSetCount() const { return Head().nMarkerSets; }
+  const char* MarkerSetName(int i) const;
+  int MarkerSetMarkerCount(int i) const;
+  const MarkerData* MarkerSetMarkers(int i) const;
+
+  int OtherMarkerCount() const { return Head().nOtherMarkers; }
+  const MarkerData* OtherMarkers() const { return At<MarkerData>(Head().otherMarkers); }
+
+  int RigidBodyCount() const { return Head().nRigidBodies; }
+  const sRigidBodyData* RigidBodies() const { return At<sRigidBodyData>(Head().rigidBodies); }
+
+  int SkeletonCount() const { return Head().nSkeletons; }
+  int32_t SkeletonID(int i) const;
+  int SkeletonBoneCount(int i) const;
+  const sRigidBodyData* SkeletonBones(int i) const;
+
+  int LabeledMarkerCount() const { return Head().nLabeledMarkers; }
+  const sMarker* LabeledMarkers() const { return At<sMarker>(Head().labeledMarkers); }
+
+  int ForcePlateCount() const { return Head().nForcePlates; }
+  int DeviceCount() const { return Head().nDevices; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Fills the populated channels of a legacy force plate
+  /// structure.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetForcePlate(int i, sForcePlateData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Fills the populated channels of a legacy device
+  /// structure.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetDevice(int i, sDeviceData& out) const;
+
+private:
+  // Arena offsets are 32 bit; a frame never comes close to 4 GB.
+  typedef uint32_t Offset;
+
+  struct Header
+  {
+    int32_t  iFrame;
+    int32_t  nMarkerSets;
+    int32_t  nOtherMarkers;
+    int32_t  nRigidBodies;
+    int32_t  nSkeletons;
+    int32_t  nLabeledMarkers;
+    int32_t  nForcePlates;
+    int32_t  nDevices;
+    Offset   markerSets;       // MarkerSetEntry[nMarkerSets]
+    Offset   otherMarkers;     // MarkerData[nOtherMarkers]
+    Offset   rigidBodies;      // sRigidBodyData[nRigidBodies]
+    Offset   skeletons;        // SkeletonEntry[nSkeletons]
+    Offset   labeledMarkers;   // sMarker[nLabeledMarkers]
+    Offset   forcePlates;      // AnalogEntry[nForcePlates]
+    Offset   devices;          // AnalogEntry[nDevices]
+    uint32_t Timecode;
+    uint32_t TimecodeSubframe;
+    double   fTimestamp;
+    uint64_t CameraMidExposureTimestamp;
+    uint64_t CameraDataReceivedTimestamp;
+    uint64_t TransmitTimestamp;
+    int16_t  params;
+    uint64_t receiveTime;
+  };
+
+  struct MarkerSetEntry
+  {
+    Offset  name;
+    int32_t nMarkers;
+    Offset  markers;
+  };
+
+  struct SkeletonEntry
+  {
+    int32_t skeletonID;
+    int32_t nBones;
+    Offset  bones;
+  };
+
+  struct ChannelEntry
+  {
+    int32_t nFrames;
+    Offset  values;
+  };
+
+  struct AnalogEntry
+  {
+    int32_t ID;
+    int32_t nChannels;
+    int16_t params;
+    Offset  channels;          // ChannelEntry[nChannels]
+  };
+
+  Offset Alloc(size_t bytes);
+  void Grow(size_t minCapacity);
+  float* SetAnalogChannel(Offset table, int i, int channel, int numFrames);
+  void GetAnalog(Offset table, int i, int32_t& id, int32_t& nChannels, int16_t& params, sAnalogChannelData* channels) const;
+
+  template<typename T> T* At(Offset offset) { return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(mBuffer) + offset); }
+  template<typename T> const T* At(Offset offset) const { return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(mBuffer) + offset); }
+  Header& Head() { return *At<Header>(0); }
+  const Header& Head() const { return *At<Header>(0); }
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  // Arena. uint64_t storage keeps every record 8 byte aligned.
+  uint64_t* mBuffer;
+  // Bytes in use.
+  size_t mSize;
+  // Bytes allocated.
+  size_t mCapacity;
+};
+
+#endif // _COMPACTFRAME_H_
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+
+#include "DeadBandFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// DeadBandFilter implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const float kPi = 3.14159265358979f;
+}
+
+
+DeadBandFilter::DeadBandFilter()
+  :mPositionSquared(0.0f),
+  mCosHalfRotation(1.0f),
+  mKeyframeInterval(0),
+  mPosesSent(0),
+  mPosesSuppressed(0)
+{
+}
+
+bool DeadBandFilter::LessById(const Entry& entry, int32_t id)
+{
+  return entry.id < id;
+}
+
+bool DeadBandFilter::EntryLess(const Entry& a, const Entry& b)
+{
+  return a.id < b.id;
+}
+
+bool DeadBandFilter::SameId(const Entry& a, const Entry& b)
+{
+  return a.id == b.id;
+}
+
+void DeadBandFilter::SetThresholds(float positionMillimeters, float rotationDegrees, int keyframeInterval)
+{
+  const float position = positionMillimeters > 0.0f ? positionMillimeters * 0.001f : 0.0f;
+  const float rotation = rotationDegrees > 0.0f ? rotationDegrees * kPi / 180.0f : 0.0f;
+
+  mPositionSquared = position * position;
+  mCosHalfRotation = cosf(0.5f * rotation);
+  mKeyframeInterval = keyframeInterval > 0 ? keyframeInterval : 0;
+  Reset();
+}
+
+void DeadBandFilter::Prepare(const std::vector<int32_t>& ids)
+{
+  std::vector<Entry> entries;
+  entries.reserve(mEntries.size() + ids.size());
+  entries.assign(mEntries.begin(), mEntries.end());
+  for (size_t i = 0; i < ids.size(); i++)
+  {
+    Entry entry = {};
+    entry.id = ids[i];
+    entries.push_back(entry);
+  }
+
+  // existing entries come first and win over the new ones
+  std::stable_sort(entries.begin(), entries.end(), EntryLess);
+  entries.erase(std::unique(entries.begin(), entries.end(), SameId), entries.end());
+  mEntries.swap(entries);
+}
+
+void DeadBandFilter::Reset()
+{
+  for (size_t i = 0; i < mEntries.size(); i++)
+    mEntries[i].sent = false;
+}
+
+bool DeadBandFilter::Update(int32_t id, const float* p, const float* q, bool tracked, int frame)
+{
+  std::vector<Entry>::iterator it = std::lower_bound(mEntries.begin(), mEntries.end(), id, LessById);
+
+  bool send;
+  if (it == mEntries.end() || it->id != id)
+  {
+    // no description, see Prepare
+    Entry entry = {};
+    entry.id = id;
+    it = mEntries.insert(it, entry);
+    send = true;
+  }
+  else if (!it->sent || tracked != it->tracked)
+    send = true;
+  else if (mKeyframeInterval > 0 && (frame < it->lastFrame || frame - it->lastFrame >= mKeyframeInterval))
+  {
+    // frame numbers going back (Motive restarted or looped a take) make
+    // the keyframe due as well
+    send = true;
+  }
+  else if (!tracked)
+    send = false;
+  else
+  {
+    const float dx = p[0] - it->p[0];
+    const float dy = p[1] - it->p[1];
+    const float dz = p[2] - it->p[2];
+
+    // q and -q are the same rotation; the angle between two unit
+    // quaternions is 2 acos |q1 . q2|
+    const float dot = q[0] * it->q[0] + q[1] * it->q[1] + q[2] * it->q[2] + q[3] * it->q[3];
+
+    send = dx * dx + dy * dy + dz * dz > mPositionSquared || fabsf(dot) < mCosHalfRotation;
+  }
+
+  if (!send)
+  {
+    mPosesSuppressed++;
+    return false;
+  }
+
+  it->lastFrame = frame;
+  it->sent = true;
+  it->tracked = tracked;
+  it->p[0] = p[0];
+  it->p[1] = p[1];
+  it->p[2] = p[2];
+  it->q[0] = q[0];
+  it->q[1] = q[1];
+  it->q[2] = q[2];
+  it->q[3] = q[3];
+  mPosesSent++;
+  return true;
+}
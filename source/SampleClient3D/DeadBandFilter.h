@@ -0,0 +1,99 @@
+#ifndef _DEADBANDFILTER_H_
+#define _DEADBANDFILTER_H_
+
+#include <stdint.h>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Change-only output: remembers the last pose sent per streaming ID and
+/// lets a pose through only if it moved or turned more than a threshold,
+/// its tracking state changed, or its keyframe interval elapsed. The
+/// keyframes let receivers that join late catch up on entities that do
+/// not move.
+/// </summary>
+/// <remarks>
+/// Rigid bodies and skeleton bones share one ID space; bone IDs carry the
+/// skeleton ID in the high word. Entries are kept in a vector sorted by
+/// ID. Prepare creates them for the described IDs when the descriptions
+/// change; only IDs without a description are inserted by Update.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class DeadBandFilter
+{
+public:
+  //*************************************************************************
+  // Constructors
+  //
+
+  DeadBandFilter();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the thresholds and forgets all poses.</summary>
+  /// <param name='positionMillimeters'>Smallest movement sent. Positions
+  /// are in meters, as streamed by NatNet.</param>
+  /// <param name='rotationDegrees'>Smallest rotation sent.</param>
+  /// <param name='keyframeInterval'>Frames after which an unchanged pose
+  /// is sent again; 0 never resends.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void SetThresholds(float positionMillimeters, float rotationDegrees, int keyframeInterval);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decides whether to send a pose, and if so remembers it as
+  /// the last one sent.</summary>
+  /// <param name='p'>Position x, y, z.</param>
+  /// <param name='q'>Rotation as a unit quaternion x, y, z, w.</param>
+  //////////////////////////////////////////////////////////////////////////
+  bool Update(int32_t id, const float* p, const float* q, bool tracked, int frame);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates the entries of the given IDs ahead of their first
+  /// frame, so Update does not insert into the table per new ID. Entries
+  /// that already exist keep their last pose.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Prepare(const std::vector<int32_t>& ids);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Forgets all poses, so every entity is sent with its next
+  /// frame. The entries themselves are kept.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Reset();
+
+  uint64_t PosesSent() const { return mPosesSent; }
+  uint64_t PosesSuppressed() const { return mPosesSuppressed; }
+
+private:
+  struct Entry
+  {
+    int32_t id;
+    int lastFrame;               // frame of the last pose sent
+    bool sent;                   // false until a pose was sent
+    bool tracked;
+    float p[3];
+    float q[4];
+  };
+
+  static bool LessById(const Entry& entry, int32_t id);
+  static bool EntryLess(const Entry& a, const Entry& b);
+  static bool SameId(const Entry& a, const Entry& b);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  float mPositionSquared;        // squared threshold in meters
+  float mCosHalfRotation;        // cos(threshold / 2)
+  int mKeyframeInterval;
+
+  std::vector<Entry> mEntries;   // sorted by id
+
+  uint64_t mPosesSent;
+  uint64_t mPosesSuppressed;
+};
+
+#endif // _DEADBANDFILTER_H_
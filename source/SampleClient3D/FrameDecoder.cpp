@@ -0,0 +1,279 @@
+#include "FrameDecoder.h"
+
+#include "PacketCursor.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Version specialized frame decoders
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  template<typename Traits>
+  void DecodeRigidBodies(PacketCursor& c, sRigidBodyData* bodies, int count)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      sRigidBodyData& rb = bodies[i];
+      rb.ID = c.Read<int32_t>();
+      // x, y, z, qx, qy, qz, qw are contiguous in sRigidBodyData
+      c.Copy(&rb.x, 7 * sizeof(float));
+
+      if (Traits::kRigidBodyMarkers)
+      {
+        int32_t nMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+        c.Skip((int64_t)nMarkers * 12);
+        if (Traits::kRigidBodyMarkerInfo)
+          c.Skip((int64_t)nMarkers * 8);     // marker IDs and sizes
+      }
+
+      rb.MeanError = Traits::kRigidBodyMeanError ? c.Read<float>() : 0.0f;
+      rb.params = Traits::kRigidBodyParams ? c.Read<int16_t>() : (int16_t)0x01;
+    }
+  }
+
+  template<typename Traits>
+  void SkipRigidBodies(PacketCursor& c, int count)
+  {
+    const int64_t recordSize = 4 + 7 * sizeof(float) +
+      (Traits::kRigidBodyMeanError ? 4 : 0) + (Traits::kRigidBodyParams ? 2 : 0);
+
+    // fixed size records from 3.0 on
+    if (!Traits::kRigidBodyMarkers)
+    {
+      c.Skip(recordSize * count);
+      return;
+    }
+
+    for (int i = 0; i < count && c.ok; i++)
+    {
+      c.Skip(4 + 7 * sizeof(float));
+      int32_t nMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+      c.Skip((int64_t)nMarkers * (Traits::kRigidBodyMarkerInfo ? 20 : 12));
+      c.Skip(recordSize - 4 - 7 * sizeof(float));
+    }
+  }
+
+  // Analog channel data of a force plate or device. Every channel is
+  // stored into the buffer returned by the given setter.
+  template<typename SetChannel>
+  void DecodeAnalogChannels(PacketCursor& c, int32_t nChannels, SetChannel setChannel)
+  {
+    for (int ch = 0; ch < nChannels && c.ok; ch++)
+    {
+      int32_t nFrames = c.ReadCount(MAX_PACKETSIZE / 4);
+      if (!c.ok)
+        break;
+      c.Copy(setChannel(ch, nFrames), (int64_t)nFrames * 4);
+    }
+  }
+
+  // Skips the force plates or devices section.
+  void SkipAnalogData(PacketCursor& c, int32_t count)
+  {
+    for (int i = 0; i < count && c.ok; i++)
+    {
+      c.Skip(4);   // ID
+      int32_t nChannels = c.ReadCount(MAX_PACKETSIZE / 4);
+      for (int ch = 0; ch < nChannels && c.ok; ch++)
+        c.Skip((int64_t)c.ReadCount(MAX_PACKETSIZE / 4) * 4);
+    }
+  }
+}
+
+
+template<int Major, int Minor>
+bool DecodeFrame(const sPacket* packet, uint32_t sections, CompactFrame& frame)
+{
+  typedef BitstreamTraits<Major, Minor> Traits;
+
+  // nDataBytes is checked against the received length by the receiver
+  // (PacketClient::Dispatch); never read past the sPacket either way
+  if (packet->iMessage != NAT_FRAMEOFDATA || packet->nDataBytes > MAX_PACKETSIZE)
+    return false;
+
+  PacketCursor c(packet->Data.cData, packet->nDataBytes);
+
+  // Unsubscribed sections are skipped on the wire and stay empty in the
+  // frame (Begin clears all counts). Sections made of fixed size records
+  // are skipped in one step.
+
+  frame.Begin(c.Read<int32_t>());
+
+  // marker sets
+  int32_t nMarkerSets = c.ReadCount(MAX_MARKERSETS);
+  if (sections & FrameSection_MarkerSets)
+  {
+    frame.BeginMarkerSets(nMarkerSets);
+    for (int i = 0; i < nMarkerSets && c.ok; i++)
+    {
+      const char* name = c.ReadString();
+      int32_t nMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+      if (!c.ok)
+        break;
+      c.Copy(frame.SetMarkerSet(i, name, nMarkers), (int64_t)nMarkers * 12);
+    }
+  }
+  else
+  {
+    for (int i = 0; i < nMarkerSets && c.ok; i++)
+    {
+      c.ReadString();
+      c.Skip((int64_t)c.ReadCount(MAX_PACKETSIZE / 12) * 12);
+    }
+  }
+
+  // other markers
+  int32_t nOtherMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+  if (sections & FrameSection_OtherMarkers)
+    c.Copy(frame.SetOtherMarkers(nOtherMarkers), (int64_t)nOtherMarkers * 12);
+  else
+    c.Skip((int64_t)nOtherMarkers * 12);
+
+  // rigid bodies
+  int32_t nRigidBodies = c.ReadCount(MAX_RIGIDBODIES);
+  if (sections & FrameSection_RigidBodies)
+    DecodeRigidBodies<Traits>(c, frame.SetRigidBodies(nRigidBodies), nRigidBodies);
+  else
+    SkipRigidBodies<Traits>(c, nRigidBodies);
+
+  // skeletons
+  if (Traits::kHasSkeletons)
+  {
+    int32_t nSkeletons = c.ReadCount(MAX_SKELETONS);
+    const bool subscribed = (sections & FrameSection_Skeletons) != 0;
+    if (subscribed)
+      frame.BeginSkeletons(nSkeletons);
+    for (int i = 0; i < nSkeletons && c.ok; i++)
+    {
+      int32_t skeletonID = c.Read<int32_t>();
+      int32_t nBones = c.ReadCount(MAX_SKELRIGIDBODIES);
+      if (subscribed)
+        DecodeRigidBodies<Traits>(c, frame.SetSkeleton(i, skeletonID, nBones), nBones);
+      else
+        SkipRigidBodies<Traits>(c, nBones);
+    }
+  }
+
+  // labeled markers
+  if (Traits::kHasLabeledMarkers)
+  {
+    int32_t nLabeledMarkers = c.ReadCount(MAX_LABELED_MARKERS);
+    if (sections & FrameSection_LabeledMarkers)
+    {
+      sMarker* markers = frame.SetLabeledMarkers(nLabeledMarkers);
+      for (int i = 0; i < nLabeledMarkers && c.ok; i++)
+      {
+        sMarker& m = markers[i];
+        m.ID = c.Read<int32_t>();
+        // x, y, z, size are contiguous in sMarker
+        c.Copy(&m.x, 4 * sizeof(float));
+        m.params = Traits::kLabeledMarkerParams ? c.Read<int16_t>() : (int16_t)0;
+        m.residual = Traits::kLabeledMarkerResidual ? c.Read<float>() : 0.0f;
+      }
+    }
+    else
+    {
+      const int64_t recordSize = 4 + 4 * sizeof(float) +
+        (Traits::kLabeledMarkerParams ? 2 : 0) + (Traits::kLabeledMarkerResidual ? 4 : 0);
+      c.Skip(recordSize * nLabeledMarkers);
+    }
+  }
+
+  // force plates
+  if (Traits::kHasForcePlates)
+  {
+    int32_t nForcePlates = c.ReadCount(MAX_FORCEPLATES);
+    if (sections & FrameSection_ForcePlates)
+    {
+      frame.BeginForcePlates(nForcePlates);
+      for (int i = 0; i < nForcePlates && c.ok; i++)
+      {
+        int32_t id = c.Read<int32_t>();
+        int32_t nChannels = c.ReadCount(MAX_PACKETSIZE / 4);
+        if (!c.ok)
+          break;
+        frame.SetForcePlate(i, id, nChannels, 0);
+        DecodeAnalogChannels(c, nChannels, [&](int ch, int nFrames) { return frame.SetForcePlateChannel(i, ch, nFrames); });
+      }
+    }
+    else
+      SkipAnalogData(c, nForcePlates);
+  }
+
+  // devices
+  if (Traits::kHasDevices)
+  {
+    int32_t nDevices = c.ReadCount(MAX_DEVICES);
+    if (sections & FrameSection_Devices)
+    {
+      frame.BeginDevices(nDevices);
+      for (int i = 0; i < nDevices && c.ok; i++)
+      {
+        int32_t id = c.Read<int32_t>();
+        int32_t nChannels = c.ReadCount(MAX_PACKETSIZE / 4);
+        if (!c.ok)
+          break;
+        frame.SetDevice(i, id, nChannels, 0);
+        DecodeAnalogChannels(c, nChannels, [&](int ch, int nFrames) { return frame.SetDeviceChannel(i, ch, nFrames); });
+      }
+    }
+    else
+      SkipAnalogData(c, nDevices);
+  }
+
+  if (Traits::kLatency)
+    c.Read<float>();
+
+  uint32_t timecode = c.Read<uint32_t>();
+  uint32_t timecodeSubframe = c.Read<uint32_t>();
+  frame.SetTimecode(timecode, timecodeSubframe);
+
+  double timestamp = Traits::kDoubleTimestamp ? c.Read<double>() : (double)c.Read<float>();
+  uint64_t midExposure = 0, dataReceived = 0, transmit = 0;
+  if (Traits::kHighResTimestamps)
+  {
+    midExposure = c.Read<uint64_t>();
+    dataReceived = c.Read<uint64_t>();
+    transmit = c.Read<uint64_t>();
+  }
+  frame.SetTimestamps(timestamp, midExposure, dataReceived, transmit);
+
+  frame.SetParams(c.Read<int16_t>());
+
+  return c.ok;
+}
+
+
+FrameDecodeFn SelectFrameDecoder(const uint8_t bitstreamVersion[4])
+{
+  const int major = bitstreamVersion[0];
+  const int minor = bitstreamVersion[1];
+
+  // 0.0 means "latest"
+  if (major == 0 && minor == 0)
+    return &DecodeFrame<3, 1>;
+
+  if (major == 3)
+    return (minor == 0) ? &DecodeFrame<3, 0> : &DecodeFrame<3, 1>;
+
+  if (major == 2)
+  {
+    switch (minor)
+    {
+    case 0:  return &DecodeFrame<2, 0>;
+    case 1:  return &DecodeFrame<2, 1>;
+    case 2:  return &DecodeFrame<2, 2>;
+    case 3:  return &DecodeFrame<2, 3>;
+    case 4:  return &DecodeFrame<2, 4>;
+    case 5:  return &DecodeFrame<2, 5>;
+    case 6:  return &DecodeFrame<2, 6>;
+    case 7:  return &DecodeFrame<2, 7>;
+    case 8:  return &DecodeFrame<2, 8>;
+    case 9:  return &DecodeFrame<2, 9>;
+    case 10: return &DecodeFrame<2, 10>;
+    default: return &DecodeFrame<2, 11>;
+    }
+  }
+
+  return nullptr;
+}
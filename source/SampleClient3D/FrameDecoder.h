@@ -0,0 +1,74 @@
+#ifndef _FRAMEDECODER_H_
+#define _FRAMEDECODER_H_
+
+#include <stdint.h>
+
+#include "NatNetTypes.h"
+#include "CompactFrame.h"
+#include "FrameSubscription.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Decodes the payload of a NAT_FRAMEOFDATA packet into a frame.
+/// Sections not set in <c>sections</c> (a combination of FrameSection
+/// values, usually <c>SubscriptionMask::Get()</c>) are skipped and left
+/// empty.
+/// </summary>
+/// <returns>false if the packet is not a frame, is truncated or claims
+/// more than MAX_PACKETSIZE payload bytes. The frame content is undefined
+/// in that case.</returns>
+//////////////////////////////////////////////////////////////////////////
+typedef bool (*FrameDecodeFn)(const sPacket* packet, uint32_t sections, CompactFrame& frame);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Wire layout of one NatNet bitstream version. Every field is a compile
+/// time constant, so a decoder instantiated for a version contains no
+/// version checks at all.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+template<int Major, int Minor>
+struct BitstreamTraits
+{
+  static const bool kHasSkeletons          = (Major == 2 && Minor > 0) || Major > 2;
+  static const bool kHasLabeledMarkers     = (Major == 2 && Minor >= 3) || Major > 2;
+  static const bool kHasForcePlates        = (Major == 2 && Minor >= 9) || Major > 2;
+  static const bool kHasDevices            = (Major == 2 && Minor >= 11) || Major > 2;
+
+  // per rigid body marker list (removed in 3.0)
+  static const bool kRigidBodyMarkers      = Major < 3;
+  static const bool kRigidBodyMarkerInfo   = Major == 2;
+  static const bool kRigidBodyMeanError    = Major >= 2;
+  static const bool kRigidBodyParams       = (Major == 2 && Minor >= 6) || Major > 2;
+
+  static const bool kLabeledMarkerParams   = (Major == 2 && Minor >= 6) || Major > 2;
+  static const bool kLabeledMarkerResidual = Major >= 3;
+
+  // software latency (removed in 3.0)
+  static const bool kLatency               = Major < 3;
+  static const bool kDoubleTimestamp       = (Major == 2 && Minor >= 7) || Major > 2;
+  static const bool kHighResTimestamps     = Major >= 3;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Frame decoder specialized for one bitstream version.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+template<int Major, int Minor>
+bool DecodeFrame(const sPacket* packet, uint32_t sections, CompactFrame& frame);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Picks the decoder matching the server's bitstream version. Meant to
+/// be called once when the connection is made, e.g. with
+/// <c>sServerDescription::NatNetVersion</c> or the negotiated
+/// <c>sConnectionOptions::BitstreamVersion</c>.
+/// </summary>
+/// <remarks>Supported versions are 2.0 - 2.11, 3.0 and 3.1. Version 0.0
+/// means "latest" and selects 3.1.</remarks>
+/// <returns>nullptr if the version is not supported.</returns>
+//////////////////////////////////////////////////////////////////////////
+FrameDecodeFn SelectFrameDecoder(const uint8_t bitstreamVersion[4]);
+
+#endif // _FRAMEDECODER_H_
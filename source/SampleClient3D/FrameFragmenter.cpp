@@ -0,0 +1,62 @@
+#include <cstring>
+
+#include "FrameFragmenter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FrameFragmenter implementation
+//////////////////////////////////////////////////////////////////////////
+
+FrameFragmenter::FrameFragmenter(DatagramSink sink, void* pUserData, int datagramSize)
+  :mSink(sink),
+  mUserData(pUserData),
+  mDatagramSize(datagramSize),
+  mNextFrameId(0),
+  mFramesSent(0),
+  mFragmentsSent(0)
+{
+  if (mDatagramSize < MIN_DATAGRAM_SIZE)
+    mDatagramSize = MIN_DATAGRAM_SIZE;
+  else if (mDatagramSize > MAX_DATAGRAM_SIZE)
+    mDatagramSize = MAX_DATAGRAM_SIZE;
+}
+
+bool FrameFragmenter::Send(const void* data, int bytes)
+{
+  if (bytes < 0 || bytes > MAX_FRAME_SIZE)
+    return false;
+
+  mFramesSent++;
+
+  // fits - send as is
+  if (bytes <= mDatagramSize)
+  {
+    mFragmentsSent++;
+    return mSink((const uint8_t*)data, bytes, mUserData);
+  }
+
+  const int chunkSize = mDatagramSize - (int)sizeof(FragmentHeader);
+  const int count = (bytes + chunkSize - 1) / chunkSize;
+
+  FragmentHeader header;
+  header.magic = FragmentHeader::MAGIC;
+  header.count = (uint16_t)count;
+  header.chunkSize = (uint16_t)chunkSize;
+  header.frameId = mNextFrameId++;
+
+  // Every fragment is sent even if one fails, so the receiver can still
+  // complete the frame if the failure was transient.
+  bool ok = true;
+  for (int i = 0; i < count; i++)
+  {
+    const int offset = i * chunkSize;
+    const int length = (bytes - offset < chunkSize) ? bytes - offset : chunkSize;
+
+    header.index = (uint16_t)i;
+    memcpy(mDatagram, &header, sizeof(header));
+    memcpy(mDatagram + sizeof(header), (const uint8_t*)data + offset, length);
+    ok = mSink(mDatagram, (int)sizeof(header) + length, mUserData) && ok;
+  }
+  mFragmentsSent += count;
+
+  return ok;
+}
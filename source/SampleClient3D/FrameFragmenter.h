@@ -0,0 +1,111 @@
+#ifndef _FRAMEFRAGMENTER_H_
+#define _FRAMEFRAGMENTER_H_
+
+#include <stdint.h>
+
+// Receives one datagram produced by the fragmenter (or one reassembled
+// frame, see FrameReassembler). Returns false if it could not be sent.
+typedef bool (*DatagramSink)(const uint8_t* data, int bytes, void* pUserData);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Header in front of every fragment. Fragments of one frame share the
+/// frame id; fragment <c>index</c> carries the payload bytes starting at
+/// <c>index * chunkSize</c>. All fields are little endian.
+/// </summary>
+/// <remarks>
+/// <c>magic</c> overlays the <c>iMessage</c> field of an unfragmented
+/// <c>sPacket</c> and is outside of the NatNet message ID range, so a
+/// receiver can tell fragments and whole packets apart by their first
+/// two bytes.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+struct FragmentHeader
+{
+  static const uint16_t MAGIC = 0xF7A6;
+
+  uint16_t magic;
+  uint16_t index;
+  uint16_t count;
+  uint16_t chunkSize;
+  uint32_t frameId;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Splits frames larger than one datagram into MTU sized fragments so
+/// they are never fragmented at the IP level, where the loss of a single
+/// IP fragment silently drops the whole datagram. Frames that fit into
+/// one datagram are passed through unchanged, so receivers that do not
+/// reassemble keep working for small frames.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+class FrameFragmenter
+{
+public:
+  // Largest datagram sent; matches cSlipStream's kSubPacketMaxSize.
+  static const int MAX_DATAGRAM_SIZE = 1400;
+
+  // Smallest datagram every IPv4 path has to carry unfragmented
+  // (576 bytes less the IP and UDP headers).
+  static const int MIN_DATAGRAM_SIZE = 548;
+
+  // Most fragments a frame can be split into.
+  static const int MAX_FRAGMENTS = 128;
+
+  // Largest frame that can be sent.
+  static const int MAX_FRAME_SIZE = MAX_FRAGMENTS * (MIN_DATAGRAM_SIZE - (int)sizeof(FragmentHeader));
+
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates a fragmenter that hands its datagrams to
+  /// <c>sink</c>.</summary>
+  /// <param name='datagramSize'>Largest datagram to send, clamped to
+  /// [MIN_DATAGRAM_SIZE, MAX_DATAGRAM_SIZE].</param>
+  //////////////////////////////////////////////////////////////////////////
+  FrameFragmenter(DatagramSink sink, void* pUserData, int datagramSize = MAX_DATAGRAM_SIZE);
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends one frame, fragmenting it if needed.</summary>
+  /// <returns>false if the frame is too large or the sink failed.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Send(const void* data, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the largest datagram sent, header included.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  int DatagramSize() const { return mDatagramSize; }
+
+  uint64_t FramesSent() const { return mFramesSent; }
+  uint64_t FragmentsSent() const { return mFragmentsSent; }
+
+private:
+  FrameFragmenter(const FrameFragmenter&); // not implemented
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  DatagramSink mSink;
+  void* mUserData;
+  int mDatagramSize;
+  uint32_t mNextFrameId;
+
+  uint64_t mFramesSent;
+  uint64_t mFragmentsSent;
+
+  uint8_t mDatagram[MAX_DATAGRAM_SIZE];
+};
+
+#endif // _FRAMEFRAGMENTER_H_
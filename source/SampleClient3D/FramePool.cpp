@@ -0,0 +1,75 @@
+#include "FramePool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FramePool implementation
+//////////////////////////////////////////////////////////////////////////
+
+FramePool::FramePool(size_t frameBytes)
+  :mPublished(0), mPoolExhausted(0), mOverwritten(0)
+{
+  for (size_t i = 0; i < POOL_SIZE; ++i)
+  {
+    mFrames[i].Reserve(frameBytes);
+    mFree.TryPush(&mFrames[i]);
+  }
+}
+
+CompactFrame* FramePool::Acquire()
+{
+  CompactFrame* frame = nullptr;
+  if (!mFree.TryPop(frame))
+  {
+    mPoolExhausted.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return frame;
+}
+
+void FramePool::Publish(CompactFrame* frame)
+{
+  // Every frame is either free, ready or held by the consumer, and both
+  // rings hold the whole pool, so this cannot fail.
+  mReady.TryPush(frame);
+  mPublished.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool FramePool::Publish(const sFrameOfMocapData& data, uint32_t sections, uint64_t receiveTimeNs)
+{
+  CompactFrame* frame = Acquire();
+  if (frame == nullptr)
+    return false;
+
+  frame->FromLegacy(data, sections);
+  frame->SetReceiveTime(receiveTimeNs);
+  Publish(frame);
+  return true;
+}
+
+CompactFrame* FramePool::Consume()
+{
+  CompactFrame* frame = nullptr;
+  mReady.TryPop(frame);
+  return frame;
+}
+
+CompactFrame* FramePool::ConsumeLatest()
+{
+  CompactFrame* frame = nullptr;
+  CompactFrame* newer = nullptr;
+  if (!mReady.TryPop(frame))
+    return nullptr;
+
+  while (mReady.TryPop(newer))
+  {
+    Release(frame);
+    mOverwritten.fetch_add(1, std::memory_order_relaxed);
+    frame = newer;
+  }
+  return frame;
+}
+
+void FramePool::Release(CompactFrame* frame)
+{
+  if (frame != nullptr)
+    mFree.TryPush(frame);
+}
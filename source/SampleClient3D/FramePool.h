@@ -0,0 +1,123 @@
+#ifndef _FRAMEPOOL_H_
+#define _FRAMEPOOL_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#include "NatNetTypes.h"
+#include "CompactFrame.h"
+#include "SpscRing.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Fixed pool of pre-allocated frames used to hand frames from the NatNet
+/// receive thread to a single consumer thread without locks.
+/// The producer acquires a free frame, fills it and publishes it. The
+/// consumer takes published frames, processes them and releases them back
+/// to the pool. Frames are recycled, so once every frame arena has grown to
+/// the session's frame size no memory is allocated or freed any more.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+class FramePool
+{
+public:
+  // Number of frames in the pool.
+  static const size_t POOL_SIZE = 16;
+
+  // Initial arena size of every frame in the pool.
+  static const size_t DEFAULT_FRAME_BYTES = 64 * 1024;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// Constructs the pool and reserves <c>frameBytes</c> for every frame.
+  //////////////////////////////////////////////////////////////////////////
+  explicit FramePool(size_t frameBytes = DEFAULT_FRAME_BYTES);
+
+
+  //*************************************************************************
+  // Producer side
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Takes a free frame out of the pool.</summary>
+  /// <returns>nullptr if all frames are in use; the pool exhaustion
+  /// counter is incremented in that case.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  CompactFrame* Acquire();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Hands a filled frame to the consumer.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Publish(CompactFrame* frame);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Copies a NatNet frame into a recycled frame and publishes
+  /// it. Meant to be called from the NatNet frame callback. Only the
+  /// sections set in <c>sections</c> are copied. <c>receiveTimeNs</c> is
+  /// stored with the frame, see CompactFrame::SetReceiveTime.</summary>
+  /// <returns>false if the frame was dropped because the pool was
+  /// exhausted.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Publish(const sFrameOfMocapData& data, uint32_t sections = FrameSection_All, uint64_t receiveTimeNs = 0);
+
+
+  //*************************************************************************
+  // Consumer side
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Takes the oldest published frame.</summary>
+  /// <returns>nullptr if no frame is pending.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  CompactFrame* Consume();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Takes the newest published frame. Older pending frames are
+  /// released unprocessed and counted as overwritten.</summary>
+  /// <returns>nullptr if no frame is pending.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  CompactFrame* ConsumeLatest();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns a consumed frame to the pool.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Release(CompactFrame* frame);
+
+
+  //*************************************************************************
+  // Statistics
+  //
+
+  // Number of frames published.
+  uint64_t PublishedCount() const { return mPublished.load(std::memory_order_relaxed); }
+  // Number of times the producer found no free frame (the frame was lost).
+  uint64_t PoolExhaustedCount() const { return mPoolExhausted.load(std::memory_order_relaxed); }
+  // Number of published frames skipped by ConsumeLatest.
+  uint64_t OverwrittenCount() const { return mOverwritten.load(std::memory_order_relaxed); }
+
+private:
+  FramePool(const FramePool&);
+  FramePool& operator=(const FramePool&);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  // Frame storage.
+  CompactFrame mFrames[POOL_SIZE];
+
+  // Frames ready to be acquired by the producer (filled by the consumer).
+  SpscRing<CompactFrame*, POOL_SIZE> mFree;
+
+  // Frames published to the consumer (filled by the producer).
+  SpscRing<CompactFrame*, POOL_SIZE> mReady;
+
+  std::atomic<uint64_t> mPublished;
+  std::atomic<uint64_t> mPoolExhausted;
+  std::atomic<uint64_t> mOverwritten;
+};
+
+#endif // _FRAMEPOOL_H_
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <cstring>
+
+#include "FrameReassembler.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FrameReassembler implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // A frame id this far behind the newest one means the sender restarted.
+  const uint32_t kResyncDistance = 1024;
+
+  int64_t NowMs()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+
+FrameReassembler::FrameReassembler(DatagramSink sink, void* pUserData, int timeoutMs)
+  :mSink(sink),
+  mUserData(pUserData),
+  mTimeoutMs(timeoutMs),
+  mHaveNewest(false),
+  mNewestId(0),
+  mFinishedMask(0),
+  mFramesCompleted(0),
+  mFramesDropped(0),
+  mFragmentsRejected(0)
+{
+  memset(mSlots, 0, sizeof(mSlots));
+  for (int i = 0; i < SLOT_COUNT; i++)
+    mSlots[i].data = new uint8_t[FrameFragmenter::MAX_FRAME_SIZE];
+}
+
+FrameReassembler::~FrameReassembler()
+{
+  for (int i = 0; i < SLOT_COUNT; i++)
+    delete[] mSlots[i].data;
+}
+
+bool FrameReassembler::IsFragment(const void* data, int bytes)
+{
+  uint16_t magic;
+  if (bytes < (int)sizeof(FragmentHeader))
+    return false;
+  memcpy(&magic, data, sizeof(magic));
+  return magic == FragmentHeader::MAGIC;
+}
+
+bool FrameReassembler::Add(const void* data, int bytes)
+{
+  const int64_t nowMs = NowMs();
+
+  FragmentHeader header;
+  if (!IsFragment(data, bytes))
+  {
+    mFragmentsRejected++;
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+
+  const int length = bytes - (int)sizeof(header);
+  const bool last = (header.index == header.count - 1);
+  if (header.count < 2 || header.count > FrameFragmenter::MAX_FRAGMENTS ||
+    header.index >= header.count || header.chunkSize == 0 ||
+    (last ? (length <= 0 || length > header.chunkSize) : length != header.chunkSize) ||
+    header.index * header.chunkSize + length > FrameFragmenter::MAX_FRAME_SIZE)
+  {
+    mFragmentsRejected++;
+    return false;
+  }
+
+  if (mHaveNewest && mNewestId - header.frameId >= kResyncDistance && mNewestId - header.frameId < 0x80000000u)
+  {
+    // sender restarted; forget the old stream
+    for (int i = 0; i < SLOT_COUNT; i++)
+      mSlots[i].used = false;
+    mHaveNewest = false;
+  }
+
+  if (IsFinished(header.frameId))
+  {
+    mFragmentsRejected++;
+    return false;
+  }
+  Advance(header.frameId);
+
+  Expire(nowMs);
+
+  Slot* slot = FindSlot(header, nowMs);
+  if (slot->count != header.count || slot->chunkSize != header.chunkSize ||
+    (slot->mask[header.index / 64] & (1ull << (header.index % 64))) != 0)
+  {
+    mFragmentsRejected++;
+    return false;
+  }
+
+  const int offset = header.index * header.chunkSize;
+  memcpy(slot->data + offset, (const uint8_t*)data + sizeof(header), length);
+  slot->mask[header.index / 64] |= 1ull << (header.index % 64);
+  slot->received++;
+  if (last)
+    slot->bytes = offset + length;
+
+  if (slot->received == slot->count)
+  {
+    slot->used = false;
+    MarkFinished(slot->frameId);
+    mFramesCompleted++;
+    mSink(slot->data, slot->bytes, mUserData);
+  }
+  return true;
+}
+
+void FrameReassembler::ExpireStale()
+{
+  Expire(NowMs());
+}
+
+void FrameReassembler::Expire(int64_t nowMs)
+{
+  for (int i = 0; i < SLOT_COUNT; i++)
+  {
+    if (mSlots[i].used && nowMs - mSlots[i].startedMs > mTimeoutMs)
+      Drop(mSlots[i]);
+  }
+}
+
+FrameReassembler::Slot* FrameReassembler::FindSlot(const FragmentHeader& header, int64_t nowMs)
+{
+  Slot* free = nullptr;
+  Slot* oldest = nullptr;
+  for (int i = 0; i < SLOT_COUNT; i++)
+  {
+    Slot& slot = mSlots[i];
+    if (!slot.used)
+    {
+      if (free == nullptr)
+        free = &slot;
+    }
+    else if (slot.frameId == header.frameId)
+      return &slot;
+    else if (oldest == nullptr || (int32_t)(slot.frameId - oldest->frameId) < 0)
+      oldest = &slot;
+  }
+
+  // all slots busy - the oldest frame is the least likely to complete
+  if (free == nullptr)
+  {
+    Drop(*oldest);
+    free = oldest;
+  }
+
+  free->used = true;
+  free->frameId = header.frameId;
+  free->count = header.count;
+  free->chunkSize = header.chunkSize;
+  free->received = 0;
+  free->bytes = 0;
+  free->startedMs = nowMs;
+  memset(free->mask, 0, sizeof(free->mask));
+  return free;
+}
+
+void FrameReassembler::Drop(Slot& slot)
+{
+  slot.used = false;
+  MarkFinished(slot.frameId);
+  mFramesDropped++;
+}
+
+bool FrameReassembler::IsFinished(uint32_t frameId) const
+{
+  if (!mHaveNewest)
+    return false;
+
+  const uint32_t age = mNewestId - frameId;
+  if (age >= 0x80000000u)
+    return false;   // newer than anything seen
+  if (age >= 64)
+    return true;    // too old to be tracked
+  return ((mFinishedMask >> age) & 1) != 0;
+}
+
+void FrameReassembler::MarkFinished(uint32_t frameId)
+{
+  const uint32_t age = mNewestId - frameId;
+  if (age < 64)
+    mFinishedMask |= 1ull << age;
+}
+
+void FrameReassembler::Advance(uint32_t frameId)
+{
+  if (!mHaveNewest)
+  {
+    mHaveNewest = true;
+    mNewestId = frameId;
+    mFinishedMask = 0;
+    return;
+  }
+
+  const uint32_t ahead = frameId - mNewestId;
+  if (ahead == 0 || ahead >= 0x80000000u)
+    return;
+
+  mFinishedMask = (ahead >= 64) ? 0 : (mFinishedMask << ahead);
+  mNewestId = frameId;
+}
@@ -0,0 +1,114 @@
+#ifndef _FRAMEREASSEMBLER_H_
+#define _FRAMEREASSEMBLER_H_
+
+#include <stdint.h>
+
+#include "FrameFragmenter.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Reassembles frames split by FrameFragmenter. Fragments of up to
+/// SLOT_COUNT frames can be in flight at once; each frame is collected in
+/// a preallocated slot and handed to the sink as soon as its last
+/// fragment arrives, whatever the arrival order.
+/// </summary>
+/// <remarks>
+/// A frame with a missing fragment is dropped when it times out or when
+/// its slot is needed for a newer frame, so a lost fragment costs only
+/// that frame. Stragglers of frames that were already delivered or
+/// dropped are ignored.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class FrameReassembler
+{
+public:
+  // Frames reassembled concurrently.
+  static const int SLOT_COUNT = 4;
+
+  // Time after the first fragment at which an incomplete frame is dropped.
+  static const int DEFAULT_TIMEOUT_MS = 100;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  FrameReassembler(DatagramSink sink, void* pUserData, int timeoutMs = DEFAULT_TIMEOUT_MS);
+  ~FrameReassembler();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns true if the datagram starts with a fragment header.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  static bool IsFragment(const void* data, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Adds one fragment. Calls the sink if it completes a frame.
+  /// </summary>
+  /// <returns>false if the fragment was malformed, late or a duplicate.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Add(const void* data, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Drops incomplete frames that have timed out. Add does this
+  /// as well; call it when no datagrams arrive for a while.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void ExpireStale();
+
+  uint64_t FramesCompleted() const { return mFramesCompleted; }
+  uint64_t FramesDropped() const { return mFramesDropped; }
+  uint64_t FragmentsRejected() const { return mFragmentsRejected; }
+
+private:
+  FrameReassembler(const FrameReassembler&); // not implemented
+
+  static const int MASK_WORDS = FrameFragmenter::MAX_FRAGMENTS / 64;
+
+  struct Slot
+  {
+    bool used;
+    uint32_t frameId;
+    uint16_t count;
+    uint16_t chunkSize;
+    int received;
+    int bytes;
+    int64_t startedMs;
+    uint64_t mask[MASK_WORDS];
+    uint8_t* data;
+  };
+
+  void Expire(int64_t nowMs);
+  Slot* FindSlot(const FragmentHeader& header, int64_t nowMs);
+  void Drop(Slot& slot);
+
+  // Frame id bookkeeping relative to the newest id seen.
+  bool IsFinished(uint32_t frameId) const;
+  void MarkFinished(uint32_t frameId);
+  void Advance(uint32_t frameId);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  DatagramSink mSink;
+  void* mUserData;
+  int mTimeoutMs;
+
+  Slot mSlots[SLOT_COUNT];
+
+  // Bit n is set if frame mNewestId - n was delivered or dropped.
+  bool mHaveNewest;
+  uint32_t mNewestId;
+  uint64_t mFinishedMask;
+
+  uint64_t mFramesCompleted;
+  uint64_t mFramesDropped;
+  uint64_t mFragmentsRejected;
+};
+
+#endif // _FRAMEREASSEMBLER_H_
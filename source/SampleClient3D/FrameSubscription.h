@@ -0,0 +1,67 @@
+#ifndef _FRAMESUBSCRIPTION_H_
+#define _FRAMESUBSCRIPTION_H_
+
+#include <atomic>
+#include <stdint.h>
+
+// Sections of a frame of mocap data a client can subscribe to.
+enum FrameSection
+{
+  FrameSection_MarkerSets     = 1 << 0,
+  FrameSection_OtherMarkers   = 1 << 1,
+  FrameSection_RigidBodies    = 1 << 2,
+  FrameSection_Skeletons      = 1 << 3,
+  FrameSection_LabeledMarkers = 1 << 4,
+  FrameSection_ForcePlates    = 1 << 5,
+  FrameSection_Devices        = 1 << 6,
+
+  FrameSection_All            = 0x7F
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Client side subscription mask (a combination of FrameSection values).
+/// Sections that are not subscribed are skipped when a frame is decoded or
+/// copied. The mask can be changed from any thread at any time; it is
+/// read once per frame, so a change takes effect with the next frame and
+/// does not require a reconnect.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+class SubscriptionMask
+{
+public:
+  explicit SubscriptionMask(uint32_t sections = FrameSection_All) : mSections(sections) {}
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the currently subscribed sections.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  uint32_t Get() const { return mSections.load(std::memory_order_relaxed); }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Replaces the subscribed sections.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Set(uint32_t sections) { mSections.store(sections & FrameSection_All, std::memory_order_relaxed); }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Subscribes or unsubscribes one or more sections.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Enable(uint32_t sections, bool enable)
+  {
+    if (enable)
+      mSections.fetch_or(sections & FrameSection_All, std::memory_order_relaxed);
+    else
+      mSections.fetch_and(~sections, std::memory_order_relaxed);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Flips the subscription of one or more sections.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Toggle(uint32_t sections) { mSections.fetch_xor(sections & FrameSection_All, std::memory_order_relaxed); }
+
+  bool IsEnabled(FrameSection section) const { return (Get() & section) != 0; }
+
+private:
+  std::atomic<uint32_t> mSections;
+};
+
+#endif // _FRAMESUBSCRIPTION_H_
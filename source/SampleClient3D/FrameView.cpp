@@ -0,0 +1,352 @@
+#include "FrameView.h"
+
+#include <cstring>
+
+#include "PacketCursor.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FrameView implementation
+//////////////////////////////////////////////////////////////////////////
+
+FrameView::FrameView()
+{
+  Detach();
+}
+
+void FrameView::Detach()
+{
+  mData = nullptr;
+  mDataBytes = 0;
+  mMajor = mMinor = 0;
+  mRigidBodyStride = 0;
+  mLabeledMarkerStride = 0;
+  mOtherMarkersOffset = mRigidBodiesOffset = mLabeledMarkersOffset = 0;
+  mNumMarkerSets = mNumOtherMarkers = mNumRigidBodies = mNumSkeletons = 0;
+  mNumLabeledMarkers = mNumForcePlates = mNumDevices = 0;
+  mFrameNumber = 0;
+  mTimecode = mTimecodeSubframe = 0;
+  mTimestamp = 0.0;
+  mCameraMidExposureTimestamp = mCameraDataReceivedTimestamp = mTransmitTimestamp = 0;
+  mParams = 0;
+}
+
+bool FrameView::HasRigidBodyParams() const
+{
+  return (mMajor == 2 && mMinor >= 6) || mMajor > 2;
+}
+
+// Skips count rigid body records. Before 3.0 the records vary in size, so
+// their offsets are kept, from mRecordOffsets[record] on.
+bool FrameView::SkipRigidBodies(PacketCursor& c, int count, int& record)
+{
+  if (mRigidBodyStride != 0)
+    return c.Skip((int64_t)count * mRigidBodyStride);
+
+  for (int i = 0; i < count && c.ok; i++)
+  {
+    // the marker count is read before the record is skipped
+    if (record == MAX_RECORDS || c.pos + 4 + 7 * 4 + 4 > c.size)
+    {
+      c.ok = false;
+      break;
+    }
+    mRecordOffsets[record++] = c.pos;
+    c.Skip(RigidBodyRecordSize(c.Current()));
+  }
+  return c.ok;
+}
+
+int FrameView::RigidBodyRecordSize(const uint8_t* p) const
+{
+  if (mRigidBodyStride != 0)
+    return mRigidBodyStride;
+
+  // pre 3.0: ID, pos, quat, marker list, [mean error], [params]
+  int size = 4 + 7 * 4;
+  int32_t nMarkers = PacketRead<int32_t>(p + size);
+  if (nMarkers < 0 || nMarkers > MAX_PACKETSIZE / 20)
+    return MAX_PACKETSIZE + 1;
+  size += 4 + nMarkers * 12;
+  if (mMajor >= 2)
+    size += nMarkers * 8 + 4;
+  if (HasRigidBodyParams())
+    size += 2;
+  return size;
+}
+
+bool FrameView::Attach(const sPacket* packet, const uint8_t bitstreamVersion[4])
+{
+  Detach();
+
+  if (packet == nullptr || packet->iMessage != NAT_FRAMEOFDATA || packet->nDataBytes > MAX_PACKETSIZE)
+    return false;
+
+  // version 0 means "latest" on the wire
+  int major = bitstreamVersion[0];
+  int minor = bitstreamVersion[1];
+  if (major == 0)
+  {
+    major = 3;
+    minor = 1;
+  }
+
+  mMajor = major;
+  mMinor = minor;
+  mRigidBodyStride = (major >= 3) ? (4 + 7 * 4 + 4 + 2) : 0;
+  mLabeledMarkerStride = 4 + 4 * 4 + (HasRigidBodyParams() ? 2 : 0) + (major >= 3 ? 4 : 0);
+
+  PacketCursor c(packet->Data.cData, packet->nDataBytes);
+
+  int32_t frameNumber = c.Read<int32_t>();
+
+  // marker sets
+  int32_t nMarkerSets = c.ReadCount(MAX_MARKERSETS);
+  for (int i = 0; i < nMarkerSets && c.ok; i++)
+  {
+    mMarkerSetOffsets[i] = c.pos;
+    c.ReadString();
+    int32_t nMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+    c.Skip((int64_t)nMarkers * 12);
+  }
+
+  // other markers
+  int32_t nOtherMarkers = c.ReadCount(MAX_PACKETSIZE / 12);
+  int otherMarkersOffset = c.pos;
+  c.Skip((int64_t)nOtherMarkers * 12);
+
+  // rigid bodies
+  int32_t nRigidBodies = c.ReadCount(MAX_RIGIDBODIES);
+  int rigidBodiesOffset = c.pos;
+  int record = 0;
+  SkipRigidBodies(c, nRigidBodies, record);
+
+  // skeletons
+  int32_t nSkeletons = 0;
+  if ((major == 2 && minor > 0) || major > 2)
+  {
+    nSkeletons = c.ReadCount(MAX_SKELETONS);
+    for (int i = 0; i < nSkeletons && c.ok; i++)
+    {
+      mSkeletonOffsets[i] = c.pos;
+      c.Read<int32_t>();
+      int32_t nBones = c.ReadCount(MAX_SKELRIGIDBODIES);
+      mSkeletonRecords[i] = record;
+      SkipRigidBodies(c, nBones, record);
+    }
+  }
+
+  // labeled markers
+  int32_t nLabeledMarkers = 0;
+  int labeledMarkersOffset = c.pos;
+  if ((major == 2 && minor >= 3) || major > 2)
+  {
+    nLabeledMarkers = c.ReadCount(MAX_LABELED_MARKERS);
+    labeledMarkersOffset = c.pos;
+    c.Skip((int64_t)nLabeledMarkers * mLabeledMarkerStride);
+  }
+
+  // force plates
+  int32_t nForcePlates = 0;
+  if ((major == 2 && minor >= 9) || major > 2)
+  {
+    nForcePlates = c.ReadCount(MAX_FORCEPLATES);
+    for (int i = 0; i < nForcePlates && c.ok; i++)
+    {
+      mForcePlateOffsets[i] = c.pos;
+      c.Read<int32_t>();
+      int32_t nChannels = c.ReadCount(MAX_PACKETSIZE / 4);
+      for (int ch = 0; ch < nChannels && c.ok; ch++)
+      {
+        int32_t nFrames = c.ReadCount(MAX_PACKETSIZE / 4);
+        c.Skip((int64_t)nFrames * 4);
+      }
+    }
+  }
+
+  // devices
+  int32_t nDevices = 0;
+  if ((major == 2 && minor >= 11) || major > 2)
+  {
+    nDevices = c.ReadCount(MAX_DEVICES);
+    for (int i = 0; i < nDevices && c.ok; i++)
+    {
+      mDeviceOffsets[i] = c.pos;
+      c.Read<int32_t>();
+      int32_t nChannels = c.ReadCount(MAX_PACKETSIZE / 4);
+      for (int ch = 0; ch < nChannels && c.ok; ch++)
+      {
+        int32_t nFrames = c.ReadCount(MAX_PACKETSIZE / 4);
+        c.Skip((int64_t)nFrames * 4);
+      }
+    }
+  }
+
+  // software latency (removed in 3.0)
+  if (major < 3)
+    c.Read<float>();
+
+  mTimecode = c.Read<uint32_t>();
+  mTimecodeSubframe = c.Read<uint32_t>();
+
+  if ((major == 2 && minor >= 7) || major > 2)
+    mTimestamp = c.Read<double>();
+  else
+    mTimestamp = c.Read<float>();
+
+  if (major >= 3)
+  {
+    mCameraMidExposureTimestamp = c.Read<uint64_t>();
+    mCameraDataReceivedTimestamp = c.Read<uint64_t>();
+    mTransmitTimestamp = c.Read<uint64_t>();
+  }
+
+  mParams = c.Read<int16_t>();
+
+  if (!c.ok)
+  {
+    Detach();
+    return false;
+  }
+
+  mData = packet->Data.cData;
+  mDataBytes = packet->nDataBytes;
+  mFrameNumber = frameNumber;
+  mNumMarkerSets = nMarkerSets;
+  mNumOtherMarkers = nOtherMarkers;
+  mOtherMarkersOffset = otherMarkersOffset;
+  mNumRigidBodies = nRigidBodies;
+  mRigidBodiesOffset = rigidBodiesOffset;
+  mNumSkeletons = nSkeletons;
+  mNumLabeledMarkers = nLabeledMarkers;
+  mLabeledMarkersOffset = labeledMarkersOffset;
+  mNumForcePlates = nForcePlates;
+  mNumDevices = nDevices;
+  return true;
+}
+
+const char* FrameView::MarkerSetName(int i) const
+{
+  return (const char*)(mData + mMarkerSetOffsets[i]);
+}
+
+int FrameView::MarkerSetMarkerCount(int i) const
+{
+  const char* name = MarkerSetName(i);
+  return PacketRead<int32_t>((const uint8_t*)name + strlen(name) + 1);
+}
+
+void FrameView::GetMarkerSetMarker(int i, int m, MarkerData& out) const
+{
+  const char* name = MarkerSetName(i);
+  const uint8_t* p = (const uint8_t*)name + strlen(name) + 1 + 4 + m * 12;
+  memcpy(out, p, 12);
+}
+
+void FrameView::GetOtherMarker(int i, MarkerData& out) const
+{
+  memcpy(out, mData + mOtherMarkersOffset + i * 12, 12);
+}
+
+void FrameView::DecodeRigidBody(const uint8_t* p, sRigidBodyData& out) const
+{
+  out.ID = PacketRead<int32_t>(p);
+  memcpy(&out.x, p + 4, 7 * 4);
+  p += 4 + 7 * 4;
+
+  if (mMajor < 3)
+  {
+    int32_t nMarkers = PacketRead<int32_t>(p);
+    p += 4 + nMarkers * 12;
+    if (mMajor >= 2)
+      p += nMarkers * 8;
+  }
+
+  out.MeanError = (mMajor >= 2) ? PacketRead<float>(p) : 0.0f;
+  if (mMajor >= 2)
+    p += 4;
+  out.params = HasRigidBodyParams() ? PacketRead<int16_t>(p) : 0x01;
+}
+
+const uint8_t* FrameView::RigidBody(int i) const
+{
+  if (mRigidBodyStride != 0)
+    return mData + mRigidBodiesOffset + i * mRigidBodyStride;
+  return mData + mRecordOffsets[i];
+}
+
+void FrameView::GetRigidBody(int i, sRigidBodyData& out) const
+{
+  DecodeRigidBody(RigidBody(i), out);
+}
+
+int32_t FrameView::SkeletonID(int i) const
+{
+  return PacketRead<int32_t>(mData + mSkeletonOffsets[i]);
+}
+
+int FrameView::SkeletonBoneCount(int i) const
+{
+  return PacketRead<int32_t>(mData + mSkeletonOffsets[i] + 4);
+}
+
+const uint8_t* FrameView::SkeletonBone(int i, int b) const
+{
+  if (mRigidBodyStride != 0)
+    return mData + mSkeletonOffsets[i] + 8 + b * mRigidBodyStride;
+  return mData + mRecordOffsets[mSkeletonRecords[i] + b];
+}
+
+void FrameView::GetSkeletonBone(int i, int b, sRigidBodyData& out) const
+{
+  DecodeRigidBody(SkeletonBone(i, b), out);
+}
+
+void FrameView::GetLabeledMarker(int i, sMarker& out) const
+{
+  const uint8_t* p = mData + mLabeledMarkersOffset + i * mLabeledMarkerStride;
+  out.ID = PacketRead<int32_t>(p);
+  memcpy(&out.x, p + 4, 4 * 4);
+  p += 4 + 4 * 4;
+  out.params = 0;
+  out.residual = 0.0f;
+  if (HasRigidBodyParams())
+  {
+    out.params = PacketRead<int16_t>(p);
+    p += 2;
+  }
+  if (mMajor >= 3)
+    out.residual = PacketRead<float>(p);
+}
+
+void FrameView::DecodeAnalogChannels(const uint8_t* p, int32_t& id, int32_t& nChannels, sAnalogChannelData* channels) const
+{
+  id = PacketRead<int32_t>(p);
+  int32_t nStreamed = PacketRead<int32_t>(p + 4);
+  p += 8;
+
+  nChannels = (nStreamed < MAX_ANALOG_CHANNELS) ? nStreamed : MAX_ANALOG_CHANNELS;
+  for (int ch = 0; ch < nStreamed; ch++)
+  {
+    int32_t nFrames = PacketRead<int32_t>(p);
+    p += 4;
+    if (ch < MAX_ANALOG_CHANNELS)
+    {
+      int n = (nFrames < MAX_ANALOG_SUBFRAMES) ? nFrames : MAX_ANALOG_SUBFRAMES;
+      channels[ch].nFrames = n;
+      memcpy(channels[ch].Values, p, n * 4);
+    }
+    p += nFrames * 4;
+  }
+}
+
+void FrameView::GetForcePlate(int i, sForcePlateData& out) const
+{
+  DecodeAnalogChannels(mData + mForcePlateOffsets[i], out.ID, out.nChannels, out.ChannelData);
+  out.params = 0;
+}
+
+void FrameView::GetDevice(int i, sDeviceData& out) const
+{
+  DecodeAnalogChannels(mData + mDeviceOffsets[i], out.ID, out.nChannels, out.ChannelData);
+  out.params = 0;
+}
@@ -0,0 +1,267 @@
+#ifndef _FRAMEVIEW_H_
+#define _FRAMEVIEW_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "NatNetTypes.h"
+
+struct PacketCursor;
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Read-only view onto the payload of a raw NAT_FRAMEOFDATA packet.
+/// Attaching walks the packet once and records where every section (and
+/// every variable sized item inside a section) starts. The individual
+/// marker sets, rigid bodies, skeleton bones, labeled markers, force plates
+/// and devices are only decoded when they are asked for, so a client that
+/// only needs the rigid bodies never pays for copying the rest.
+/// </summary>
+/// <remarks>The view does not copy the packet. The packet has to stay
+/// valid and unchanged for as long as the view is used. Code templated
+/// on the frame type takes a LegacyFrameView for frames of NatNetClient's
+/// callback.</remarks>
+//////////////////////////////////////////////////////////////////////////
+class FrameView
+{
+public:
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// Default constructor. Resulting view is not attached to any packet.
+  //////////////////////////////////////////////////////////////////////////
+  FrameView();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Attaches the view to a packet and computes the section offsets.
+  /// </summary>
+  /// <param name='packet'>Packet as received on the data port.</param>
+  /// <param name='bitstreamVersion'>NatNet bitstream version the server
+  /// is streaming with [major.minor.build.revision], e.g. from
+  /// <c>sServerDescription::NatNetVersion</c>.</param>
+  /// <returns>false if the packet is not a NAT_FRAMEOFDATA message, is
+  /// truncated or claims more than MAX_PACKETSIZE payload bytes. The view
+  /// is detached in that case.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Attach(const sPacket* packet, const uint8_t bitstreamVersion[4]);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Detaches the view from its packet.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Detach();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns true if the view is attached to a valid packet.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool IsValid() const { return mData != nullptr; }
+
+  // frame header and trailer
+  int32_t  FrameNumber() const { return mFrameNumber; }
+  uint32_t Timecode() const { return mTimecode; }
+  uint32_t TimecodeSubframe() const { return mTimecodeSubframe; }
+  double   Timestamp() const { return mTimestamp; }
+  uint64_t CameraMidExposureTimestamp() const { return mCameraMidExposureTimestamp; }
+  uint64_t CameraDataReceivedTimestamp() const { return mCameraDataReceivedTimestamp; }
+  uint64_t TransmitTimestamp() const { return mTransmitTimestamp; }
+  int16_t  Params() const { return mParams; }
+
+  // section sizes
+  int MarkerSetCount() const { return mNumMarkerSets; }
+  int OtherMarkerCount() const { return mNumOtherMarkers; }
+  int RigidBodyCount() const { return mNumRigidBodies; }
+  int SkeletonCount() const { return mNumSkeletons; }
+  int LabeledMarkerCount() const { return mNumLabeledMarkers; }
+  int ForcePlateCount() const { return mNumForcePlates; }
+  int DeviceCount() const { return mNumDevices; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the name of the ith marker set.</summary>
+  /// <remarks>Points into the packet. Always null terminated.</remarks>
+  //////////////////////////////////////////////////////////////////////////
+  const char* MarkerSetName(int i) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the number of markers of the ith marker set.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  int MarkerSetMarkerCount(int i) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes marker <c>m</c> of marker set <c>i</c>.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetMarkerSetMarker(int i, int m, MarkerData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes the ith other (unlabeled) marker.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetOtherMarker(int i, MarkerData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes the ith rigid body.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetRigidBody(int i, sRigidBodyData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the ID of the ith skeleton.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  int32_t SkeletonID(int i) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the number of bones of the ith skeleton.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  int SkeletonBoneCount(int i) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes bone <c>b</c> of skeleton <c>i</c>.</summary>
+  /// <remarks>The ID is returned as streamed, i.e. skeleton ID in the high
+  /// word and bone ID in the low word.</remarks>
+  //////////////////////////////////////////////////////////////////////////
+  void GetSkeletonBone(int i, int b, sRigidBodyData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes the ith labeled marker.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetLabeledMarker(int i, sMarker& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes the ith force plate.</summary>
+  /// <remarks>Channels and subframes beyond the <c>MAX_*</c> limits of
+  /// <c>sForcePlateData</c> are dropped.</remarks>
+  //////////////////////////////////////////////////////////////////////////
+  void GetForcePlate(int i, sForcePlateData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Decodes the ith peripheral device.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void GetDevice(int i, sDeviceData& out) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the size in bytes of a rigid body record in the
+  /// attached bitstream, starting at <c>p</c>.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  int RigidBodyRecordSize(const uint8_t* p) const;
+
+private:
+  // Rigid body and bone records of a pre 3.0 packet; every record takes
+  // at least 36 bytes.
+  static const int MAX_RECORDS = MAX_PACKETSIZE / 36 + 1;
+
+  bool SkipRigidBodies(PacketCursor& c, int count, int& record);
+  void DecodeRigidBody(const uint8_t* p, sRigidBodyData& out) const;
+  void DecodeAnalogChannels(const uint8_t* p, int32_t& id, int32_t& nChannels, sAnalogChannelData* channels) const;
+  const uint8_t* RigidBody(int i) const;
+  const uint8_t* SkeletonBone(int i, int b) const;
+  bool HasRigidBodyParams() const;
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  // Payload of the attached packet, nullptr if detached.
+  const uint8_t* mData;
+  int mDataBytes;
+
+  // Bitstream version of the attached packet.
+  int mMajor;
+  int mMinor;
+
+  // Fixed size of a rigid body record, 0 if the size varies (pre 3.0).
+  int mRigidBodyStride;
+
+  // Size of a labeled marker record.
+  int mLabeledMarkerStride;
+
+  // Section offsets (relative to mData) of the first item in each section.
+  int mMarkerSetOffsets[MAX_MARKERSETS];
+  int mOtherMarkersOffset;
+  int mRigidBodiesOffset;
+  int mSkeletonOffsets[MAX_SKELETONS];
+  int mLabeledMarkersOffset;
+  int mForcePlateOffsets[MAX_FORCEPLATES];
+  int mDeviceOffsets[MAX_DEVICES];
+
+  // Offsets of the variable sized rigid body records before 3.0: the
+  // rigid bodies first, then the bones of every skeleton, which start at
+  // record mSkeletonRecords[i].
+  int mRecordOffsets[MAX_RECORDS];
+  int mSkeletonRecords[MAX_SKELETONS];
+
+  // Section sizes.
+  int mNumMarkerSets;
+  int mNumOtherMarkers;
+  int mNumRigidBodies;
+  int mNumSkeletons;
+  int mNumLabeledMarkers;
+  int mNumForcePlates;
+  int mNumDevices;
+
+  // Frame header and trailer.
+  int32_t  mFrameNumber;
+  uint32_t mTimecode;
+  uint32_t mTimecodeSubframe;
+  double   mTimestamp;
+  uint64_t mCameraMidExposureTimestamp;
+  uint64_t mCameraDataReceivedTimestamp;
+  uint64_t mTransmitTimestamp;
+  int16_t  mParams;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// FrameView's accessors over a frame of NatNetClient's callback, so code
+/// templated on the frame type reads it like a frame received as a raw
+/// packet.
+/// </summary>
+/// <remarks>The frame has to outlive the view.</remarks>
+//////////////////////////////////////////////////////////////////////////
+class LegacyFrameView
+{
+public:
+  explicit LegacyFrameView(const sFrameOfMocapData& data) : mData(data) {}
+
+  // frame header and trailer
+  int32_t  FrameNumber() const { return mData.iFrame; }
+  uint32_t Timecode() const { return mData.Timecode; }
+  uint32_t TimecodeSubframe() const { return mData.TimecodeSubframe; }
+  double   Timestamp() const { return mData.fTimestamp; }
+  uint64_t CameraMidExposureTimestamp() const { return mData.CameraMidExposureTimestamp; }
+  uint64_t CameraDataReceivedTimestamp() const { return mData.CameraDataReceivedTimestamp; }
+  uint64_t TransmitTimestamp() const { return mData.TransmitTimestamp; }
+  int16_t  Params() const { return mData.params; }
+
+  // section sizes
+  int MarkerSetCount() const { return mData.nMarkerSets; }
+  int OtherMarkerCount() const { return mData.nOtherMarkers; }
+  int RigidBodyCount() const { return mData.nRigidBodies; }
+  int SkeletonCount() const { return mData.nSkeletons; }
+  int LabeledMarkerCount() const { return mData.nLabeledMarkers; }
+  int ForcePlateCount() const { return mData.nForcePlates; }
+  int DeviceCount() const { return mData.nDevices; }
+
+  const char* MarkerSetName(int i) const { return mData.MocapData[i].szName; }
+  int MarkerSetMarkerCount(int i) const { return mData.MocapData[i].nMarkers; }
+  void GetMarkerSetMarker(int i, int m, MarkerData& out) const { memcpy(out, mData.MocapData[i].Markers[m], sizeof(MarkerData)); }
+  void GetOtherMarker(int i, MarkerData& out) const { memcpy(out, mData.OtherMarkers[i], sizeof(MarkerData)); }
+  void GetRigidBody(int i, sRigidBodyData& out) const { out = mData.RigidBodies[i]; }
+  int32_t SkeletonID(int i) const { return mData.Skeletons[i].skeletonID; }
+  int SkeletonBoneCount(int i) const { return mData.Skeletons[i].nRigidBodies; }
+  void GetSkeletonBone(int i, int b, sRigidBodyData& out) const { out = mData.Skeletons[i].RigidBodyData[b]; }
+  void GetLabeledMarker(int i, sMarker& out) const { out = mData.LabeledMarkers[i]; }
+  void GetForcePlate(int i, sForcePlateData& out) const { out = mData.ForcePlates[i]; }
+  void GetDevice(int i, sDeviceData& out) const { out = mData.Devices[i]; }
+
+private:
+  LegacyFrameView& operator=(const LegacyFrameView&); // not implemented
+
+  const sFrameOfMocapData& mData;
+};
+
+#endif // _FRAMEVIEW_H_
@@ -0,0 +1,128 @@
+#include <cstring>
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#endif
+
+#include "LatencyHistogram.h"
+
+//////////////////////////////////////////////////////////////////////////
+// LatencyHistogram implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const int kSubBucketCount = 1 << LatencyHistogram::SUB_BUCKET_BITS;
+
+  // Index of the highest set bit. value must not be 0.
+  int HighestBit(uint64_t value)
+  {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32)))
+      return (int)index + 32;
+    _BitScanReverse(&index, (unsigned long)value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  // Value of the first bucket reaching the given rank (1 based).
+  uint64_t ValueAtRank(const uint64_t* counts, uint64_t rank)
+  {
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; i++)
+    {
+      seen += counts[i];
+      if (seen >= rank)
+        return LatencyHistogram::BucketValue(i);
+    }
+    return LatencyHistogram::BucketValue(LatencyHistogram::BUCKET_COUNT - 1);
+  }
+
+  // Rank of the given quantile (0 < quantile <= 1) among count values.
+  uint64_t QuantileRank(uint64_t count, double quantile)
+  {
+    const uint64_t rank = (uint64_t)(quantile * count + 0.999999);
+    return rank == 0 ? 1 : (rank > count ? count : rank);
+  }
+}
+
+
+LatencyHistogram::LatencyHistogram()
+{
+  for (int i = 0; i < BUCKET_COUNT; i++)
+    mCounts[i].store(0, std::memory_order_relaxed);
+  memset(mDrained, 0, sizeof(mDrained));
+}
+
+int LatencyHistogram::BucketIndex(uint64_t ns)
+{
+  if (ns > MAX_VALUE_NS)
+    ns = MAX_VALUE_NS;
+  if (ns < 2 * kSubBucketCount)
+    return (int)ns;
+
+  // ns is in [2^k, 2^(k+1)): drop all but the top SUB_BUCKET_BITS + 1 bits
+  const int shift = HighestBit(ns) - SUB_BUCKET_BITS;
+  return (shift << SUB_BUCKET_BITS) + (int)(ns >> shift);
+}
+
+uint64_t LatencyHistogram::BucketValue(int index)
+{
+  if (index < 2 * kSubBucketCount)
+    return (uint64_t)index;
+
+  const int shift = (index >> SUB_BUCKET_BITS) - 1;
+  const uint64_t sub = (uint64_t)(index - (shift << SUB_BUCKET_BITS));
+  return (sub << shift) + ((1ull << shift) >> 1);
+}
+
+void LatencyHistogram::Record(uint64_t ns)
+{
+  mCounts[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::RecordSeconds(double seconds)
+{
+  if (seconds <= 0.0)
+    Record(0);
+  else if (seconds >= MAX_VALUE_NS * 1e-9)
+    Record(MAX_VALUE_NS);
+  else
+    Record((uint64_t)(seconds * 1e9));
+}
+
+void LatencyHistogram::Drain(LatencySummary& out)
+{
+  memset(&out, 0, sizeof(out));
+
+  int first = -1;
+  int last = -1;
+  for (int i = 0; i < BUCKET_COUNT; i++)
+  {
+    // skip the atomic write for the (many) empty buckets
+    mDrained[i] = mCounts[i].load(std::memory_order_relaxed) == 0 ? 0 : mCounts[i].exchange(0, std::memory_order_relaxed);
+    if (mDrained[i] != 0)
+    {
+      if (first < 0)
+        first = i;
+      last = i;
+      out.count += mDrained[i];
+    }
+  }
+
+  if (out.count == 0)
+    return;
+
+  out.minNs = BucketValue(first);
+  out.maxNs = BucketValue(last);
+  out.p50Ns = ValueAtRank(mDrained, QuantileRank(out.count, 0.5));
+  out.p99Ns = ValueAtRank(mDrained, QuantileRank(out.count, 0.99));
+  out.p999Ns = ValueAtRank(mDrained, QuantileRank(out.count, 0.999));
+}
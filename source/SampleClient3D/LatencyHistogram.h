@@ -0,0 +1,106 @@
+#ifndef _LATENCYHISTOGRAM_H_
+#define _LATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Percentiles and extremes of the latencies recorded during one reporting
+/// interval. All values are in nanoseconds and carry the precision of the
+/// histogram buckets.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+struct LatencySummary
+{
+  uint64_t count;
+  uint64_t minNs;
+  uint64_t p50Ns;
+  uint64_t p99Ns;
+  uint64_t p999Ns;
+  uint64_t maxNs;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Fixed size log-linear latency histogram in the style of HdrHistogram.
+/// Values below 128 ns get a bucket each; above that every power of two
+/// is split into 64 buckets, so any recorded value is reported within
+/// 1/128 (0.8%) of its true value. Values from 0 ns to about 68 s are
+/// covered, larger values are clamped.
+/// </summary>
+/// <remarks>
+/// Recording is lock-free and never allocates, so it can be done from the
+/// NatNet receive thread. Any number of threads may record; only one
+/// thread may call Drain.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class LatencyHistogram
+{
+public:
+  // Buckets per power of two is 1 << SUB_BUCKET_BITS.
+  static const int SUB_BUCKET_BITS = 6;
+
+  // Largest value that is recorded unclamped (2^36 - 1 ns, ~68 s).
+  static const uint64_t MAX_VALUE_NS = (1ull << 36) - 1;
+
+  // Number of buckets needed to cover 0..MAX_VALUE_NS.
+  static const int BUCKET_COUNT = (36 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  LatencyHistogram();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Records one latency.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Record(uint64_t ns);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Records one latency given in seconds. Negative values (clock
+  /// offset errors) are recorded as 0.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void RecordSeconds(double seconds);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Summarizes the latencies recorded since the previous call and clears
+  /// them. Values recorded while draining go either into this interval or
+  /// into the next one; none are lost.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Drain(LatencySummary& out);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the bucket a value is counted in.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  static int BucketIndex(uint64_t ns);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the value reported for a bucket (its midpoint).
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  static uint64_t BucketValue(int index);
+
+private:
+  LatencyHistogram(const LatencyHistogram&);
+  LatencyHistogram& operator=(const LatencyHistogram&);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  std::atomic<uint64_t> mCounts[BUCKET_COUNT];
+
+  // Counts taken out of mCounts by Drain. Only used by the draining thread.
+  uint64_t mDrained[BUCKET_COUNT];
+};
+
+#endif // _LATENCYHISTOGRAM_H_
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstring>
+#include <stdio.h>
+
+#include "LatencyMonitor.h"
+
+//////////////////////////////////////////////////////////////////////////
+// LatencyMonitor implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const char* kStageNames[LatencyStage_Count] =
+  {
+    "exposure->transmit",
+    "transmit->callback",
+    "callback->processed",
+    "processed->sent",
+    "callback->viewer"
+  };
+}
+
+
+LatencyMonitor::LatencyMonitor(uint64_t intervalNs)
+  :mHostClockFrequency(0),
+  mIntervalNs(intervalNs),
+  mIntervalStartNs(Now())
+{
+  memset(mSummaries, 0, sizeof(mSummaries));
+}
+
+void LatencyMonitor::SetHostClockFrequency(uint64_t ticksPerSecond)
+{
+  mHostClockFrequency.store(ticksPerSecond, std::memory_order_relaxed);
+}
+
+void LatencyMonitor::RecordReceived(uint64_t cameraMidExposure, uint64_t transmit, double secondsSinceTransmit)
+{
+  if (transmit == 0)
+    return;
+
+  const uint64_t frequency = mHostClockFrequency.load(std::memory_order_relaxed);
+  if (frequency != 0 && cameraMidExposure != 0 && transmit >= cameraMidExposure)
+    mStages[LatencyStage_ExposureToTransmit].RecordSeconds((double)(transmit - cameraMidExposure) / frequency);
+
+  mStages[LatencyStage_TransmitToCallback].RecordSeconds(secondsSinceTransmit);
+}
+
+uint64_t LatencyMonitor::RecordSince(LatencyStage stage, uint64_t startNs)
+{
+  if (startNs == 0)
+    return 0;
+
+  const uint64_t now = Now();
+  mStages[stage].Record(now > startNs ? now - startNs : 0);
+  return now;
+}
+
+bool LatencyMonitor::Update()
+{
+  const uint64_t now = Now();
+  if (now - mIntervalStartNs < mIntervalNs)
+    return false;
+
+  for (int i = 0; i < LatencyStage_Count; i++)
+    mStages[i].Drain(mSummaries[i]);
+  mIntervalStartNs = now;
+  return true;
+}
+
+void LatencyMonitor::FormatSummary(LatencyStage stage, char* buffer, int size) const
+{
+  const LatencySummary& s = mSummaries[stage];
+  if (s.count == 0)
+  {
+    snprintf(buffer, size, "%-20s  no samples", kStageNames[stage]);
+    return;
+  }
+
+  snprintf(buffer, size, "%-20s  p50 %7.3f  p99 %7.3f  p99.9 %7.3f  max %7.3f ms  (%llu)",
+    kStageNames[stage], s.p50Ns * 1e-6, s.p99Ns * 1e-6, s.p999Ns * 1e-6, s.maxNs * 1e-6, (unsigned long long)s.count);
+}
+
+const char* LatencyMonitor::StageName(LatencyStage stage)
+{
+  return kStageNames[stage];
+}
+
+uint64_t LatencyMonitor::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
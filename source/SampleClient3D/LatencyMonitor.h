@@ -0,0 +1,139 @@
+#ifndef _LATENCYMONITOR_H_
+#define _LATENCYMONITOR_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#include "LatencyHistogram.h"
+
+// Stages of a frame's way from the cameras to our output. The first four
+// follow each other on the receiving thread, so they add up to the latency
+// from exposure to output; the viewer stage branches off at the callback.
+enum LatencyStage
+{
+  LatencyStage_ExposureToTransmit = 0,   // Motive: mid exposure to frame sent (host clock)
+  LatencyStage_TransmitToCallback,       // network and NatNet: frame sent to our callback
+  LatencyStage_CallbackToProcessed,      // this process: callback to frame encoded and handed off
+  LatencyStage_ProcessedToSent,          // output: frame handed off to output sent
+  LatencyStage_CallbackToViewer,         // viewer: callback to frame processed by the frame thread
+  LatencyStage_Count
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Per stage latency histograms of the frames flowing through the client,
+/// summarized once per reporting interval. Tells whether a latency spike
+/// comes from Motive, the network or our own processing.
+/// </summary>
+/// <remarks>
+/// Local stages are timed with <c>Now()</c> (steady clock, nanoseconds).
+/// The Motive stage is computed from the frame's host clock timestamps and
+/// the server's clock frequency; the network stage needs NatNet's estimate
+/// of the host clock (<c>NatNetClient::SecondsSinceHostTimestamp</c>).
+/// Each stage may be recorded from a different thread; Update and Summary
+/// belong to a single reporting thread.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class LatencyMonitor
+{
+public:
+  // Default reporting interval.
+  static const uint64_t DEFAULT_INTERVAL_NS = 1000000000ull;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  explicit LatencyMonitor(uint64_t intervalNs = DEFAULT_INTERVAL_NS);
+
+
+  //*************************************************************************
+  // Recording
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the server's high resolution clock frequency
+  /// (<c>sServerDescription::HighResClockFrequency</c>). The Motive stage
+  /// is not recorded while it is 0.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetHostClockFrequency(uint64_t ticksPerSecond);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Records the Motive and network stages of a received frame. Frames
+  /// without host timestamps (e.g. from servers older than NatNet 3.0) are
+  /// ignored.
+  /// </summary>
+  /// <param name='secondsSinceTransmit'>Age of the frame's transmit
+  /// timestamp when the callback was entered.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void RecordReceived(uint64_t cameraMidExposure, uint64_t transmit, double secondsSinceTransmit);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Records a stage that ended now and started at
+  /// <c>startNs</c> (a value of <c>Now()</c>). A start of 0 means the
+  /// frame was not timed and is ignored.</summary>
+  /// <returns>The end of the stage, to be passed as the start of the
+  /// next one; 0 if the frame was not timed.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  uint64_t RecordSince(LatencyStage stage, uint64_t startNs);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Records a stage latency.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Record(LatencyStage stage, uint64_t ns) { mStages[stage].Record(ns); }
+
+
+  //*************************************************************************
+  // Reporting
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Drains all stages into new summaries once the reporting
+  /// interval has elapsed. Meant to be called regularly, e.g. from a UI
+  /// timer.</summary>
+  /// <returns>true if new summaries are available.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Update();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the summary of a stage over the last complete
+  /// reporting interval.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  const LatencySummary& Summary(LatencyStage stage) const { return mSummaries[stage]; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Formats the summary of a stage as one line of text, in
+  /// milliseconds.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void FormatSummary(LatencyStage stage, char* buffer, int size) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the display name of a stage.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  static const char* StageName(LatencyStage stage);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the time in nanoseconds of a steady local clock.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  static uint64_t Now();
+
+private:
+  LatencyMonitor(const LatencyMonitor&);
+  LatencyMonitor& operator=(const LatencyMonitor&);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  LatencyHistogram mStages[LatencyStage_Count];
+  LatencySummary mSummaries[LatencyStage_Count];
+
+  std::atomic<uint64_t> mHostClockFrequency;
+
+  uint64_t mIntervalNs;
+  uint64_t mIntervalStartNs;
+};
+
+#endif // _LATENCYMONITOR_H_
@@ -10,7 +10,7 @@ MarkerPositionCollection::MarkerPositionCollection()
   ;
 }
 
-void MarkerPositionCollection::AppendMarkerPositions(float markerData[][3], size_t numMarkers)
+void MarkerPositionCollection::AppendMarkerPositions(const float markerData[][3], size_t numMarkers)
 {
   for (size_t i = 0; i < numMarkers; ++i)
   {
@@ -20,7 +20,7 @@ void MarkerPositionCollection::AppendMarkerPositions(float markerData[][3], size
   mMarkerPositionCount += numMarkers;
 }
 
-void MarkerPositionCollection::AppendLabledMarkers(sMarker markers[], size_t numMarkers)
+void MarkerPositionCollection::AppendLabledMarkers(const sMarker markers[], size_t numMarkers)
 {
   for (size_t i = 0; i < numMarkers; ++i)
   {
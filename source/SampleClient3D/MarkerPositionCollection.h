@@ -96,7 +96,7 @@ public:
   /// <param name='numRigidBodies'>Number of markers.</param>
   /// <remarks>The order of the marker positions is preserved.</remarks>
   //////////////////////////////////////////////////////////////////////////
-  void AppendMarkerPositions(float markerData[][3], size_t numMarkers);
+  void AppendMarkerPositions(const float markerData[][3], size_t numMarkers);
   
   //////////////////////////////////////////////////////////////////////////
   /// <summary>
@@ -107,7 +107,7 @@ public:
   /// </param>
   /// <param name='numMarkers'>Number of marker positions.<param>
   //////////////////////////////////////////////////////////////////////////
-  void SetMarkerPositions(float markerData[][3], size_t numMarkers)
+  void SetMarkerPositions(const float markerData[][3], size_t numMarkers)
   {
     mMarkerPositionCount = 0;
     AppendMarkerPositions(markerData, numMarkers);
@@ -120,7 +120,7 @@ public:
   /// <param name='markers'>Array of labeled marker data structures.</param>
   /// <param name='numMarkers'>Number of labeled markers.</param>
   //////////////////////////////////////////////////////////////////////////
-  void AppendLabledMarkers(sMarker markers[], size_t numMarkers);
+  void AppendLabledMarkers(const sMarker markers[], size_t numMarkers);
 
   //////////////////////////////////////////////////////////////////////////
   /// <summary>
@@ -130,7 +130,7 @@ public:
   /// <param name='markers'>Array of labeled marker data structures.</param>
   /// <param name='numMarkers'>Number of labeled markers.</param>
   //////////////////////////////////////////////////////////////////////////
-  void SetLabledMarkers(sMarker markers[], size_t numMarkers) 
+  void SetLabledMarkers(const sMarker markers[], size_t numMarkers) 
   { 
     mLabledMarkerCount = 0; 
     AppendLabledMarkers(markers, numMarkers);
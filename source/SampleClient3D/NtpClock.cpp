@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cmath>
+
+#include "NtpClock.h"
+
+//////////////////////////////////////////////////////////////////////////
+// NtpClock implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Weight of a new sample in the smoothed offset.
+  const double kSmoothing = 1.0 / 64.0;
+
+  // Samples further off than this are outliers; as many in a row mean
+  // the clocks jumped.
+  const double kJumpLimitSeconds = 0.05;
+  const int kJumpSamples = 8;
+}
+
+
+NtpClock::NtpClock()
+  :mFrequency(0),
+  mOffsetFrequency(0),
+  mOffset(0.0),
+  mSamples(0),
+  mOutliers(0)
+{
+}
+
+void NtpClock::SetHostClockFrequency(uint64_t ticksPerSecond)
+{
+  mFrequency = ticksPerSecond;
+}
+
+void NtpClock::Update(uint64_t transmit, double secondsSinceTransmit)
+{
+  // a new frequency (server) restarts the estimate
+  const uint64_t frequency = mFrequency.load(std::memory_order_relaxed);
+  if (frequency != mOffsetFrequency)
+  {
+    mOffsetFrequency = frequency;
+    mSamples = 0;
+    mOutliers = 0;
+  }
+  if (frequency == 0 || transmit == 0)
+    return;
+
+  // Split the ticks so large uptimes keep full precision.
+  const double hostSeconds = (double)(transmit / frequency) + (double)(transmit % frequency) / frequency;
+  const double sample = WallClockNow() - secondsSinceTransmit - hostSeconds;
+
+  if (mSamples > 0 && fabs(sample - mOffset) > kJumpLimitSeconds)
+  {
+    if (++mOutliers < kJumpSamples)
+      return;
+    mSamples = 0;
+  }
+  mOutliers = 0;
+
+  if (mSamples == 0)
+    mOffset = sample;
+  else
+  {
+    // average the first samples evenly, then smooth exponentially
+    const double weight = mSamples < 64 ? 1.0 / (double)(mSamples + 1) : kSmoothing;
+    mOffset += (sample - mOffset) * weight;
+  }
+  mSamples++;
+}
+
+double NtpClock::ToWallClock(uint64_t hostTicks) const
+{
+  if (mOffsetFrequency == 0)
+    return 0.0;
+  return mOffset + (double)(hostTicks / mOffsetFrequency) + (double)(hostTicks % mOffsetFrequency) / mOffsetFrequency;
+}
+
+uint64_t NtpClock::ToNtp(uint64_t hostTicks) const
+{
+  if (!Calibrated())
+    return 0;
+  return WallClockToNtp(ToWallClock(hostTicks));
+}
+
+double NtpClock::WallClockNow()
+{
+  const std::chrono::system_clock::duration sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(sinceEpoch).count();
+}
+
+uint64_t NtpClock::WallClockToNtp(double unixSeconds)
+{
+  if (unixSeconds <= 0.0)
+    return 0;
+  const double whole = floor(unixSeconds);
+  const uint64_t seconds = (uint64_t)whole + NTP_UNIX_OFFSET;
+  const uint64_t fraction = (uint64_t)((unixSeconds - whole) * 4294967296.0);
+  return (seconds << 32) | (fraction & 0xFFFFFFFFull);
+}
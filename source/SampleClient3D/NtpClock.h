@@ -0,0 +1,90 @@
+#ifndef _NTPCLOCK_H_
+#define _NTPCLOCK_H_
+
+#include <atomic>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Maps Motive host clock timestamps (<c>CameraMidExposureTimestamp</c>,
+/// <c>TransmitTimestamp</c>) to local wall clock time as NTP timestamps,
+/// the format of OSC timetags.
+/// </summary>
+/// <remarks>
+/// The offset between the host clock and the local wall clock is
+/// estimated continuously from every received frame: NatNet's estimate of
+/// the age of the transmit timestamp (<c>SecondsSinceHostTimestamp</c>)
+/// tells which local time the transmit tick corresponds to. The samples
+/// are smoothed; a sustained jump, e.g. after Motive restarts or the
+/// local clock is set, restarts the estimate.
+///
+/// SetHostClockFrequency may be called from any thread; update and
+/// convert on the NatNet receive thread.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class NtpClock
+{
+public:
+  // Seconds from the NTP epoch (1900) to the Unix epoch (1970).
+  static const uint64_t NTP_UNIX_OFFSET = 2208988800ull;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  NtpClock();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the server's high resolution clock frequency
+  /// (<c>sServerDescription::HighResClockFrequency</c>) and restarts the
+  /// estimate.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetHostClockFrequency(uint64_t ticksPerSecond);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Adds an offset sample from a received frame.</summary>
+  /// <param name='transmit'>The frame's <c>TransmitTimestamp</c>.</param>
+  /// <param name='secondsSinceTransmit'>Age of the transmit timestamp,
+  /// taken just before this call.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void Update(uint64_t transmit, double secondsSinceTransmit);
+
+  // True once an offset has been estimated.
+  bool Calibrated() const { return mSamples > 0; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Converts a host clock timestamp to an NTP timestamp (32.32
+  /// fixed point seconds since 1900).</summary>
+  /// <returns>0 if not calibrated.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  uint64_t ToNtp(uint64_t hostTicks) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the local wall clock time, in seconds since the Unix
+  /// epoch, that corresponds to a host clock timestamp.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  double ToWallClock(uint64_t hostTicks) const;
+
+  // Local wall clock, seconds since the Unix epoch.
+  static double WallClockNow();
+
+  static uint64_t WallClockToNtp(double unixSeconds);
+
+private:
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  std::atomic<uint64_t> mFrequency;  // host ticks per second, 0 if unknown
+  uint64_t mOffsetFrequency;     // frequency the offset was estimated with
+  double mOffset;                // wall clock seconds at host tick 0
+  uint64_t mSamples;
+  int mOutliers;                 // consecutive samples off by more than the jump limit
+};
+
+#endif // _NTPCLOCK_H_
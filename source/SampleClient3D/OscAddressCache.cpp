@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+
+#include "OscAddressCache.h"
+#include "OscEncoder.h"
+
+//////////////////////////////////////////////////////////////////////////
+// OscAddressCache implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Scratch space for one prefix, enough for two names and a few
+  // arguments. Sparck marker messages size it to their marker count.
+  const int kScratchSize = 4 * MAX_NAMELENGTH + 256;
+
+  // Appends the encoded message to the arena.
+  OscAddressCache::Prefix Store(std::vector<uint8_t>& arena, OscEncoder& encoder)
+  {
+    OscAddressCache::Prefix prefix;
+    prefix.offset = (uint32_t)arena.size();
+    prefix.bytes = (uint32_t)encoder.Finish();
+    arena.insert(arena.end(), encoder.Data(), encoder.Data() + prefix.bytes);
+    encoder.Reset();
+    return prefix;
+  }
+
+  template<typename Entry>
+  bool LessById(const Entry& entry, int32_t id)
+  {
+    return entry.id < id;
+  }
+
+  template<typename Entry>
+  bool SameId(const Entry& a, const Entry& b)
+  {
+    return a.id == b.id;
+  }
+
+  template<typename Entry>
+  bool EntryLess(const Entry& a, const Entry& b)
+  {
+    return a.id < b.id;
+  }
+
+  template<typename Entry>
+  const Entry* Find(const std::vector<Entry>& entries, int32_t id)
+  {
+    typename std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), id, LessById<Entry>);
+    return (it != entries.end() && it->id == id) ? &*it : nullptr;
+  }
+
+  // Sorts the entries by id; of several entries with one id the first is kept.
+  template<typename Entry>
+  void SortUnique(std::vector<Entry>& entries)
+  {
+    std::stable_sort(entries.begin(), entries.end(), EntryLess<Entry>);
+    entries.erase(std::unique(entries.begin(), entries.end(), SameId<Entry>), entries.end());
+  }
+}
+
+
+OscAddressCache::OscAddressCache()
+{
+}
+
+void OscAddressCache::Build(const sDataDescriptions* pDataDefs, const OscOptions& options)
+{
+  mArena.clear();
+  mRigidBodies.clear();
+  mBones.clear();
+
+  if (pDataDefs == nullptr)
+    return;
+
+  const uint32_t modes = options.modes;
+  const bool matrices = options.matrix || options.invMatrix;
+  std::vector<uint8_t> scratch(kScratchSize);
+  OscEncoder encoder(scratch.data(), (int)scratch.size());
+  char address[kScratchSize];
+
+  for (int i = 0; i < pDataDefs->nDataDescriptions; i++)
+  {
+    const sDataDescription& desc = pDataDefs->arrDataDescriptions[i];
+
+    if (desc.type == Descriptor_RigidBody)
+    {
+      const sRigidBodyDescription* pRB = desc.Data.RigidBodyDescription;
+      const int32_t id = pRB->ID;
+
+      RigidBodyEntry entry;
+      memset(&entry, 0, sizeof(entry));
+      entry.id = id;
+
+      if (modes & OscMode_Max)
+      {
+        encoder.BeginMessage("/rigidbody", "isi");
+        encoder.Int32(id);
+        encoder.String("tracked");
+        entry.messages[RigidBody_MaxTracked] = Store(mArena, encoder);
+
+        encoder.BeginMessage("/rigidbody", "isfff");
+        encoder.Int32(id);
+        encoder.String("position");
+        entry.messages[RigidBody_MaxPosition] = Store(mArena, encoder);
+
+        encoder.BeginMessage("/rigidbody", "isffff");
+        encoder.Int32(id);
+        encoder.String("quat");
+        entry.messages[RigidBody_MaxQuat] = Store(mArena, encoder);
+
+        if (matrices)
+        {
+          encoder.BeginMessage("/rigidbody", "is", 'f', 16);
+          encoder.Int32(id);
+          encoder.String("matrix");
+          entry.messages[RigidBody_MaxMatrix] = Store(mArena, encoder);
+        }
+        if (options.invMatrix)
+        {
+          encoder.BeginMessage("/rigidbody", "is", 'f', 16);
+          encoder.Int32(id);
+          encoder.String("invmatrix");
+          entry.messages[RigidBody_MaxInvMatrix] = Store(mArena, encoder);
+        }
+      }
+
+      if (modes & (OscMode_Isadora | OscMode_Touch))
+      {
+        snprintf(address, sizeof(address), "/rigidbody/%d/tracked", id);
+        encoder.BeginMessage(address, "i");
+        entry.messages[RigidBody_Tracked] = Store(mArena, encoder);
+
+        if (matrices)
+        {
+          snprintf(address, sizeof(address), "/rigidbody/%d/matrix", id);
+          encoder.BeginMessage(address, "", 'f', 16);
+          entry.messages[RigidBody_Matrix] = Store(mArena, encoder);
+        }
+        if (options.invMatrix)
+        {
+          snprintf(address, sizeof(address), "/rigidbody/%d/invmatrix", id);
+          encoder.BeginMessage(address, "", 'f', 16);
+          entry.messages[RigidBody_InvMatrix] = Store(mArena, encoder);
+        }
+      }
+
+      if (modes & OscMode_Isadora)
+      {
+        snprintf(address, sizeof(address), "/rigidbody/%d/position", id);
+        encoder.BeginMessage(address, "fff");
+        entry.messages[RigidBody_Position] = Store(mArena, encoder);
+
+        snprintf(address, sizeof(address), "/rigidbody/%d/quat", id);
+        encoder.BeginMessage(address, "ffff");
+        entry.messages[RigidBody_Quat] = Store(mArena, encoder);
+      }
+
+      if (modes & OscMode_Touch)
+      {
+        snprintf(address, sizeof(address), "/rigidbody/%d/transformation", id);
+        encoder.BeginMessage(address, "fffffff");
+        entry.messages[RigidBody_Transformation] = Store(mArena, encoder);
+      }
+
+      if (modes & OscMode_Ambi)
+      {
+        encoder.BeginMessage("/icst/ambi/source/xyz", "sfff");
+        encoder.String(pRB->szName);
+        entry.messages[RigidBody_Ambi] = Store(mArena, encoder);
+      }
+
+      if (modes & OscMode_Sparck)
+      {
+        // tracked     -> /rb <rigidbodyID> <datatype = 0> 1/0
+        // marker      -> /rb <rigidbodyID> <datatype = 1> <px1> <py1> <pz1> <px2> <py2> <pz2> ...
+        // rigidbody   -> /rb <rigidbodyID> <datatype = 2> <timestamp> <px> <py> <pz> <qx> <qy> <qz> <qw>
+        encoder.BeginMessage("/rb", "iii");
+        encoder.Int32(id);
+        encoder.Int32(0);
+        entry.messages[RigidBody_SparckTracked] = Store(mArena, encoder);
+
+        if (options.sendMarkerInfo)
+        {
+          // constant per description, so the whole message is cached
+          std::vector<uint8_t> markerScratch(kScratchSize + 8 * (2 + 3 * pRB->nMarkers));
+          OscEncoder markerEncoder(markerScratch.data(), (int)markerScratch.size());
+          markerEncoder.BeginMessage("/rb", "", 'f', 2 + 3 * pRB->nMarkers);
+          markerEncoder.Float((float)id);
+          markerEncoder.Float(1.0f);
+          for (int m = 0; m < pRB->nMarkers; m++)
+          {
+            float x = pRB->MarkerPositions[m][0], y = pRB->MarkerPositions[m][1], z = pRB->MarkerPositions[m][2];
+            options.TransformPosition(x, y, z);
+            markerEncoder.Float(x);
+            markerEncoder.Float(y);
+            markerEncoder.Float(z);
+          }
+          entry.messages[RigidBody_SparckMarkers] = Store(mArena, markerEncoder);
+        }
+
+        encoder.BeginMessage("/rb", "iiifffffff");
+        encoder.Int32(id);
+        encoder.Int32(2);
+        entry.messages[RigidBody_SparckPose] = Store(mArena, encoder);
+      }
+
+      mRigidBodies.push_back(entry);
+    }
+    else if (desc.type == Descriptor_Skeleton && options.sendSkeletons)
+    {
+      const sSkeletonDescription* pSK = desc.Data.SkeletonDescription;
+
+      for (int j = 0; j < pSK->nRigidBodies; j++)
+      {
+        // bone IDs in frame data carry the skeleton ID in the high word
+        const int32_t boneID = pSK->RigidBodies[j].ID;
+
+        BoneEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.id = (pSK->skeletonID << 16) | boneID;
+
+        if (modes & OscMode_Max)
+        {
+          encoder.BeginMessage("/skeleton/bone", "sisfff");
+          encoder.String(pSK->szName);
+          encoder.Int32(boneID);
+          encoder.String("position");
+          entry.messages[Bone_MaxPosition] = Store(mArena, encoder);
+
+          encoder.BeginMessage("/skeleton/bone", "sisffff");
+          encoder.String(pSK->szName);
+          encoder.Int32(boneID);
+          encoder.String("quat");
+          entry.messages[Bone_MaxQuat] = Store(mArena, encoder);
+        }
+
+        if (modes & OscMode_Isadora)
+        {
+          snprintf(address, sizeof(address), "/skeleton/%s/bone/%d/position", pSK->szName, boneID);
+          encoder.BeginMessage(address, "fff");
+          entry.messages[Bone_Position] = Store(mArena, encoder);
+
+          snprintf(address, sizeof(address), "/skeleton/%s/bone/%d/quat", pSK->szName, boneID);
+          encoder.BeginMessage(address, "ffff");
+          entry.messages[Bone_Quat] = Store(mArena, encoder);
+        }
+
+        if (modes & OscMode_Touch)
+        {
+          snprintf(address, sizeof(address), "/skeleton/%s/bone/%d/transformation", pSK->szName, boneID);
+          encoder.BeginMessage(address, "fffffff");
+          entry.messages[Bone_Transformation] = Store(mArena, encoder);
+        }
+
+        if (modes & OscMode_Sparck)
+        {
+          // skeleton -> /skel <skeltonID> <boneID> <timestamp> <px> <py> <pz> <qx> <qy> <qz> <qw>
+          encoder.BeginMessage("/skel", "iiffffffff");
+          encoder.Int32(pSK->skeletonID);
+          encoder.Int32(boneID);
+          entry.messages[Bone_Sparck] = Store(mArena, encoder);
+        }
+
+        mBones.push_back(entry);
+      }
+    }
+  }
+
+  SortUnique(mRigidBodies);
+  SortUnique(mBones);
+}
+
+const OscAddressCache::RigidBodyEntry* OscAddressCache::FindRigidBody(int32_t id) const
+{
+  return Find(mRigidBodies, id);
+}
+
+const OscAddressCache::BoneEntry* OscAddressCache::FindBone(int32_t id) const
+{
+  return Find(mBones, id);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// OscMarkerAddressCache implementation
+//////////////////////////////////////////////////////////////////////////
+
+OscMarkerAddressCache::OscMarkerAddressCache(const char* root)
+  :mRoot(root)
+{
+}
+
+const OscMarkerAddressCache::Entry& OscMarkerAddressCache::Find(int32_t id)
+{
+  std::vector<Entry>::iterator it = std::lower_bound(mEntries.begin(), mEntries.end(), id, LessById<Entry>);
+  if (it != mEntries.end() && it->id == id)
+    return *it;
+
+  if ((int)mEntries.size() >= MAX_ENTRIES)
+  {
+    Clear();
+    it = mEntries.begin();
+  }
+  return Add(it, id);
+}
+
+void OscMarkerAddressCache::Clear()
+{
+  mArena.clear();
+  mEntries.clear();
+}
+
+const OscMarkerAddressCache::Entry& OscMarkerAddressCache::Add(std::vector<Entry>::iterator position, int32_t id)
+{
+  uint8_t scratch[128];
+  OscEncoder encoder(scratch, (int)sizeof(scratch));
+  char address[64];
+
+  Entry entry;
+  entry.id = id;
+
+  encoder.BeginMessage(mRoot, "isfff");
+  encoder.Int32(id);
+  encoder.String("position");
+  entry.max = Store(mArena, encoder);
+
+  snprintf(address, sizeof(address), "%s/%d/position", mRoot, id);
+  encoder.BeginMessage(address, "fff");
+  entry.path = Store(mArena, encoder);
+
+  return *mEntries.insert(position, entry);
+}
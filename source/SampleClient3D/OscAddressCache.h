@@ -0,0 +1,204 @@
+#ifndef _OSCADDRESSCACHE_H_
+#define _OSCADDRESSCACHE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "NatNetTypes.h"
+#include "OscOptions.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Pre-encoded OSC message prefixes of every rigid body and skeleton bone
+/// of a description list. A prefix holds the padded address, the padded
+/// type tags and any arguments that only depend on the entity (IDs,
+/// names, selectors such as "position"), so writing a message is a copy
+/// of its prefix followed by the per frame arguments.
+/// </summary>
+/// <remarks>
+/// Only the messages of the enabled OSC modes are encoded. The cache is
+/// rebuilt when the descriptions or the options change, never per frame.
+/// Markers carry no description; see OscMarkerAddressCache.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class OscAddressCache
+{
+public:
+  // Rigid body messages. Max messages use "/rigidbody <id> <selector>",
+  // isadora and touch messages "/rigidbody/<id>/<selector>".
+  enum RigidBodyMessage
+  {
+    RigidBody_MaxTracked = 0,    // i
+    RigidBody_MaxPosition,       // fff
+    RigidBody_MaxQuat,           // ffff
+    RigidBody_MaxMatrix,         // f x 16
+    RigidBody_MaxInvMatrix,      // f x 16
+    RigidBody_Tracked,           // i
+    RigidBody_Position,          // fff
+    RigidBody_Quat,              // ffff
+    RigidBody_Transformation,    // fffffff
+    RigidBody_Matrix,            // f x 16
+    RigidBody_InvMatrix,         // f x 16
+    RigidBody_Ambi,              // fff (name included)
+    RigidBody_SparckTracked,     // i
+    RigidBody_SparckMarkers,     // complete message: marker offsets of the description
+    RigidBody_SparckPose,        // ifffffff (timestamp, pose)
+    RigidBody_MessageCount
+  };
+
+  // Skeleton bone messages.
+  enum BoneMessage
+  {
+    Bone_MaxPosition = 0,        // fff
+    Bone_MaxQuat,                // ffff
+    Bone_Position,               // fff
+    Bone_Quat,                   // ffff
+    Bone_Transformation,         // fffffff
+    Bone_Sparck,                 // ffffffff (timestamp, pose)
+    Bone_MessageCount
+  };
+
+  // Location of one prefix in the cache; empty if the message is not
+  // sent with the current options.
+  struct Prefix
+  {
+    uint32_t offset;
+    uint32_t bytes;
+  };
+
+  struct RigidBodyEntry
+  {
+    int32_t id;                  // streaming ID
+    Prefix messages[RigidBody_MessageCount];
+  };
+
+  struct BoneEntry
+  {
+    int32_t id;                  // skeleton ID << 16 | bone ID, as in frame data
+    Prefix messages[Bone_MessageCount];
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  OscAddressCache();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Encodes the prefixes of all rigid bodies and skeleton bones
+  /// of a description list for the modes set in <c>options</c>. Any
+  /// previous content is discarded.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Build(const sDataDescriptions* pDataDefs, const OscOptions& options);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Looks up a rigid body by streaming ID.</summary>
+  /// <returns>nullptr if the rigid body has no description.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  const RigidBodyEntry* FindRigidBody(int32_t id) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Looks up a skeleton bone by its frame data ID.</summary>
+  /// <returns>nullptr if the bone has no description.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  const BoneEntry* FindBone(int32_t id) const;
+
+  const uint8_t* Data(const Prefix& prefix) const { return mArena.data() + prefix.offset; }
+
+  int RigidBodyCount() const { return (int)mRigidBodies.size(); }
+  int BoneCount() const { return (int)mBones.size(); }
+  size_t SizeInBytes() const { return mArena.size(); }
+
+private:
+  OscAddressCache(const OscAddressCache&); // not implemented
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  // Encoded prefixes of all entries.
+  std::vector<uint8_t> mArena;
+
+  // Entries sorted by id.
+  std::vector<RigidBodyEntry> mRigidBodies;
+  std::vector<BoneEntry> mBones;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Pre-encoded position message prefixes of labeled or unlabeled markers,
+/// "<root> <id> position" (max) and "<root>/<id>/position" (isadora,
+/// touch). Markers have no descriptions, so the prefixes of an ID are
+/// encoded the first time it is seen and reused for every later frame.
+/// </summary>
+/// <remarks>
+/// Passive marker IDs keep growing over a session, so the cache is
+/// cleared once it holds MAX_ENTRIES IDs. Not thread safe; the cache
+/// belongs to the one shard encoding its markers.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class OscMarkerAddressCache
+{
+public:
+  // Most marker IDs kept at a time.
+  static const int MAX_ENTRIES = 4096;
+
+  struct Entry
+  {
+    int32_t id;
+    OscAddressCache::Prefix max;       // isfff, id and "position" included
+    OscAddressCache::Prefix path;      // fff
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates an empty cache for the addresses under
+  /// <c>root</c> ("/marker" or "/othermarker", a string literal).
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  explicit OscMarkerAddressCache(const char* root);
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the prefixes of a marker ID, encoding them if the
+  /// ID is new. The entry is valid until the next call.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  const Entry& Find(int32_t id);
+
+  void Clear();
+
+  const uint8_t* Data(const OscAddressCache::Prefix& prefix) const { return mArena.data() + prefix.offset; }
+
+  int Count() const { return (int)mEntries.size(); }
+
+private:
+  OscMarkerAddressCache(const OscMarkerAddressCache&); // not implemented
+
+  const Entry& Add(std::vector<Entry>::iterator position, int32_t id);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  const char* mRoot;
+
+  // Encoded prefixes of all entries.
+  std::vector<uint8_t> mArena;
+
+  // Entries sorted by id.
+  std::vector<Entry> mEntries;
+};
+
+#endif // _OSCADDRESSCACHE_H_
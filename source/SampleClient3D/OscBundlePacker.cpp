@@ -0,0 +1,98 @@
+#include <cstring>
+
+#include "OscBundlePacker.h"
+#include "OscEncoder.h"
+
+//////////////////////////////////////////////////////////////////////////
+// OscBundlePacker implementation
+//////////////////////////////////////////////////////////////////////////
+
+OscBundlePacker::OscBundlePacker(DatagramSink sink, void* pUserData, int bundleSize)
+  :mSink(sink),
+  mUserData(pUserData),
+  mBundleSize(MAX_BUNDLE_SIZE),
+  mDatagramSize(0),
+  mDatagramsSent(0)
+{
+  SetBundleSize(bundleSize);
+}
+
+void OscBundlePacker::SetBundleSize(int bundleSize)
+{
+  if (bundleSize < MIN_BUNDLE_SIZE)
+    bundleSize = MIN_BUNDLE_SIZE;
+  else if (bundleSize > MAX_BUNDLE_SIZE)
+    bundleSize = MAX_BUNDLE_SIZE;
+  mBundleSize = bundleSize;
+}
+
+bool OscBundlePacker::Send(const uint8_t* bundle, int bytes)
+{
+  const OscFragment fragment = { bundle, bytes };
+  return Send(&fragment, 1);
+}
+
+bool OscBundlePacker::Send(const OscFragment* fragments, int count)
+{
+  const int headerSize = OscEncoder::BUNDLE_HEADER_SIZE;
+  if (count < 1 || fragments[0].bytes < headerSize || memcmp(fragments[0].data, "#bundle", 8) != 0)
+    return false;
+
+  // fits - send as is
+  if (count == 1 && fragments[0].bytes <= mBundleSize)
+  {
+    mDatagramsSent++;
+    return mSink(fragments[0].data, fragments[0].bytes, mUserData);
+  }
+
+  // "#bundle" and timetag, repeated in every datagram
+  memcpy(mDatagram, fragments[0].data, headerSize);
+  mDatagramSize = headerSize;
+
+  bool ok = true;
+  for (int f = 0; f < count; f++)
+  {
+    const uint8_t* data = fragments[f].data;
+    const int bytes = fragments[f].bytes;
+    int pos = f == 0 ? headerSize : 0;
+    while (pos + 4 <= bytes)
+    {
+      const int size = (int)OscEncoder::Load32(data + pos);
+      const int element = 4 + size;
+      if (size < 0 || element > bytes - pos)
+        return false;
+
+      if (mDatagramSize + element > mBundleSize)
+      {
+        ok = Flush() && ok;
+        if (headerSize + element > mBundleSize)
+        {
+          // too large for any bundle, send the message by itself
+          ok = mSink(data + pos + 4, size, mUserData) && ok;
+          mDatagramsSent++;
+          pos += element;
+          continue;
+        }
+      }
+
+      memcpy(mDatagram + mDatagramSize, data + pos, element);
+      mDatagramSize += element;
+      pos += element;
+    }
+  }
+
+  return Flush() && ok;
+}
+
+// Sends the bundle being filled, if it holds any element.
+bool OscBundlePacker::Flush()
+{
+  const int headerSize = OscEncoder::BUNDLE_HEADER_SIZE;
+  if (mDatagramSize <= headerSize)
+    return true;
+
+  const bool ok = mSink(mDatagram, mDatagramSize, mUserData);
+  mDatagramsSent++;
+  mDatagramSize = headerSize;
+  return ok;
+}
@@ -0,0 +1,99 @@
+#ifndef _OSCBUNDLEPACKER_H_
+#define _OSCBUNDLEPACKER_H_
+
+#include <stdint.h>
+
+#include "FrameFragmenter.h"
+
+// Consecutive bundle elements of an encoded frame. The first fragment of a
+// frame starts with the bundle header.
+struct OscFragment
+{
+  const uint8_t* data;
+  int bytes;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Splits an encoded OSC bundle into as few bundles as possible that each
+/// fit into one datagram. Elements keep their order and every bundle
+/// carries the timetag of the original, so the first bundle starts and
+/// the last one ends with the first and last element of the frame.
+/// </summary>
+/// <remarks>
+/// Bundles are filled greedily in element order, which is the minimum
+/// number of datagrams for an ordered split. An element that does not fit
+/// into an empty bundle is sent on its own as a bare message; bundles and
+/// messages are both valid OSC packets.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class OscBundlePacker
+{
+public:
+  // Largest bundle sent: the MTU sized datagram of FrameFragmenter, which
+  // matches cSlipStream's kSubPacketMaxSize.
+  static const int MAX_BUNDLE_SIZE = FrameFragmenter::MAX_DATAGRAM_SIZE;
+
+  // Smallest bundle size accepted.
+  static const int MIN_BUNDLE_SIZE = 256;
+
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates a packer that hands its datagrams to
+  /// <c>sink</c>.</summary>
+  /// <param name='bundleSize'>Largest bundle to send, clamped to
+  /// [MIN_BUNDLE_SIZE, MAX_BUNDLE_SIZE].</param>
+  //////////////////////////////////////////////////////////////////////////
+  OscBundlePacker(DatagramSink sink, void* pUserData, int bundleSize = MAX_BUNDLE_SIZE);
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  void SetBundleSize(int bundleSize);
+  int BundleSize() const { return mBundleSize; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends a bundle as produced by OscEncoder, split into
+  /// bundles of at most BundleSize() bytes.</summary>
+  /// <returns>false if the bundle is malformed or the sink failed.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Send(const uint8_t* bundle, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends a bundle encoded as several fragments, as if they
+  /// were one buffer. Elements are gathered straight from the fragments.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool Send(const OscFragment* fragments, int count);
+
+  uint64_t DatagramsSent() const { return mDatagramsSent; }
+
+private:
+  OscBundlePacker(const OscBundlePacker&); // not implemented
+
+  bool Flush();
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  DatagramSink mSink;
+  void* mUserData;
+  int mBundleSize;
+
+  // bundle being filled, header included
+  int mDatagramSize;
+
+  uint64_t mDatagramsSent;
+
+  uint8_t mDatagram[MAX_BUNDLE_SIZE];
+};
+
+#endif // _OSCBUNDLEPACKER_H_
@@ -0,0 +1,245 @@
+#ifndef _OSCENCODER_H_
+#define _OSCENCODER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Writes OSC 1.0 bundles and messages straight into a caller owned
+/// buffer: addresses, type tags and strings null terminated and padded to
+/// four bytes, numbers big endian. Nothing is allocated.
+/// </summary>
+/// <remarks>
+/// Writing past the end of the buffer clears <c>Ok()</c> and drops all
+/// further writes, so a packet only has to be checked once when it is
+/// finished. Every message must be given exactly the arguments announced
+/// by its type tags.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class OscEncoder
+{
+public:
+  // Size of "#bundle" and the time tag in front of the bundle elements.
+  static const int BUNDLE_HEADER_SIZE = 16;
+
+  // Time tag meaning "immediately".
+  static const uint64_t TIMETAG_IMMEDIATE = 1;
+
+  OscEncoder(uint8_t* buffer, int capacity)
+    : mBuffer(buffer), mCapacity(capacity), mPos(0), mElement(-1), mInBundle(false), mOk(true)
+  {
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Discards everything written.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Reset()
+  {
+    mPos = 0;
+    mElement = -1;
+    mInBundle = false;
+    mOk = true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts a bundle. Messages written afterwards become its
+  /// elements.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void BeginBundle(uint64_t timetag)
+  {
+    Append("#bundle", 8);
+    Int64((int64_t)timetag);
+    mInBundle = true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts bundle elements without a bundle header, for a
+  /// fragment of a bundle encoded separately (see OscFragment).</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void BeginElements()
+  {
+    mInBundle = true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>
+  /// Starts a message. Inside a bundle the previous element is closed and
+  /// a new one is opened.
+  /// </summary>
+  /// <param name='typeTags'>Type tags without the leading ','.</param>
+  /// <param name='repeatedTag'>Type tag appended <c>repeatCount</c> times
+  /// after <c>typeTags</c>, for variable length argument lists.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void BeginMessage(const char* address, const char* typeTags, char repeatedTag = 0, int repeatCount = 0)
+  {
+    OpenElement();
+    String(address);
+
+    const int tagCount = (int)strlen(typeTags);
+    const int bytes = Padded(1 + tagCount + repeatCount + 1);
+    if (!Reserve(bytes))
+      return;
+    uint8_t* tags = mBuffer + mPos;
+    memset(tags, 0, bytes);
+    tags[0] = ',';
+    memcpy(tags + 1, typeTags, tagCount);
+    if (repeatCount > 0)
+      memset(tags + 1 + tagCount, repeatedTag, repeatCount);
+    mPos += bytes;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts a message with a pre-encoded prefix: address, type
+  /// tags and possibly leading arguments, already padded (see
+  /// OscAddressCache). The remaining arguments follow as usual.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void BeginMessage(const uint8_t* prefix, int bytes)
+  {
+    OpenElement();
+    if (!Reserve(bytes))
+      return;
+    memcpy(mBuffer + mPos, prefix, bytes);
+    mPos += bytes;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Closes the current bundle element. Called implicitly by
+  /// BeginMessage and Finish.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void EndMessage()
+  {
+    if (mElement < 0)
+      return;
+    if (mOk)
+      Store32(mBuffer + mElement, (uint32_t)(mPos - mElement - 4));
+    mElement = -1;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Closes the packet.</summary>
+  /// <returns>The packet size, 0 if it did not fit.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  int Finish()
+  {
+    EndMessage();
+    return mOk ? mPos : 0;
+  }
+
+  // arguments
+
+  void Int32(int32_t value)
+  {
+    if (Reserve(4))
+    {
+      Store32(mBuffer + mPos, (uint32_t)value);
+      mPos += 4;
+    }
+  }
+
+  void Float(float value)
+  {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    Int32((int32_t)bits);
+  }
+
+  void Floats(const float* values, int count)
+  {
+    for (int i = 0; i < count; i++)
+      Float(values[i]);
+  }
+
+  void Int64(int64_t value)
+  {
+    Int32((int32_t)((uint64_t)value >> 32));
+    Int32((int32_t)(uint64_t)value);
+  }
+
+  void String(const char* str)
+  {
+    Append(str, (int)strlen(str) + 1);
+  }
+
+  // Writes a blob: size, data and padding.
+  void Blob(const void* data, int bytes)
+  {
+    Int32(bytes);
+    Append(data, bytes);
+  }
+
+  // Reserves a blob of the given size and returns where to write its
+  // content, nullptr if it does not fit.
+  uint8_t* ReserveBlob(int bytes)
+  {
+    Int32(bytes);
+    const int padded = Padded(bytes);
+    if (!Reserve(padded))
+      return nullptr;
+    uint8_t* data = mBuffer + mPos;
+    memset(data + bytes, 0, padded - bytes);
+    mPos += padded;
+    return data;
+  }
+
+  // Appends raw bytes followed by zero padding to a multiple of four.
+  void Append(const void* data, int bytes)
+  {
+    const int padded = Padded(bytes);
+    if (!Reserve(padded))
+      return;
+    memcpy(mBuffer + mPos, data, bytes);
+    memset(mBuffer + mPos + bytes, 0, padded - bytes);
+    mPos += padded;
+  }
+
+  bool Ok() const { return mOk; }
+  int Size() const { return mPos; }
+  const uint8_t* Data() const { return mBuffer; }
+
+  static int Padded(int bytes) { return (bytes + 3) & ~3; }
+
+  static void Store32(uint8_t* p, uint32_t value)
+  {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+  }
+
+  static uint32_t Load32(const uint8_t* p)
+  {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+  }
+
+private:
+  // Inside a bundle, closes the previous element and opens a new one.
+  void OpenElement()
+  {
+    if (!mInBundle)
+      return;
+    EndMessage();
+    mElement = mPos;
+    Int32(0);                              // element size, patched by EndMessage
+  }
+
+  bool Reserve(int bytes)
+  {
+    if (!mOk || bytes < 0 || mPos + bytes > mCapacity)
+    {
+      mOk = false;
+      return false;
+    }
+    return true;
+  }
+
+  uint8_t* mBuffer;
+  int mCapacity;
+  int mPos;
+  // Offset of the size field of the open bundle element, -1 if none.
+  int mElement;
+  bool mInBundle;
+  bool mOk;
+};
+
+#endif // _OSCENCODER_H_
@@ -0,0 +1,116 @@
+#ifndef _OSCOPTIONS_H_
+#define _OSCOPTIONS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "FrameFragmenter.h"
+
+// OSC message layouts, see readme.md. Several can be combined.
+enum OscMode
+{
+  OscMode_Max     = 0x01,
+  OscMode_Isadora = 0x02,
+  OscMode_Touch   = 0x04,
+  OscMode_Sparck  = 0x08,
+  OscMode_Ambi    = 0x10,
+  OscMode_Blob    = 0x20         // all rigid bodies in one blob, see RigidBodyBlob
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// OSC output settings. Field names follow the command line options of
+/// the OSC bridge.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+struct OscOptions
+{
+  uint32_t modes;                // combination of OscMode values
+  bool sendSkeletons;
+  bool sendMarkerInfo;
+  bool sendOtherMarkerInfo;
+  bool yup2zup;                  // transform y-up to z-up
+  bool leftHanded;               // transform to a left handed coordinate system
+  bool matrix;                   // send the transformation matrix
+  bool invMatrix;                // send the inverse transformation matrix
+  bool bundled;                  // send each frame as OSC bundles
+  int bundleSize;                // largest bundle datagram, see OscBundlePacker
+  int frameModulo;               // send every n-th frame
+  int rigidBodyModulo;           // average and send rigid bodies every n-th frame
+  int skeletonModulo;            // same for skeleton bones
+  int markerModulo;              // same for markers
+  bool deadBand;                 // send only poses that changed, see DeadBandFilter
+  float deadBandPosition;        // millimeters
+  float deadBandRotation;        // degrees
+  int keyframeInterval;          // frames after which unchanged poses are resent
+  int encoderThreads;            // threads besides the caller encoding large frames
+
+  OscOptions()
+    : modes(OscMode_Max), sendSkeletons(false), sendMarkerInfo(false), sendOtherMarkerInfo(false),
+    yup2zup(false), leftHanded(false), matrix(false), invMatrix(false), bundled(false),
+    bundleSize(FrameFragmenter::MAX_DATAGRAM_SIZE), frameModulo(1), rigidBodyModulo(1), skeletonModulo(1),
+    markerModulo(1), deadBand(false), deadBandPosition(1.0f), deadBandRotation(0.5f),
+    keyframeInterval(120), encoderThreads(0)
+  {
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Parses a mode list such as "max,isadora".</summary>
+  /// <returns>The OscMode combination, 0 if no mode was recognized.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  static uint32_t ParseModes(const char* modes)
+  {
+    uint32_t result = 0;
+    if (strstr(modes, "max") != nullptr)
+      result |= OscMode_Max;
+    if (strstr(modes, "isadora") != nullptr)
+      result |= OscMode_Isadora;
+    if (strstr(modes, "touch") != nullptr)
+      result |= OscMode_Touch;
+    if (strstr(modes, "sparck") != nullptr)
+      result |= OscMode_Sparck;
+    if (strstr(modes, "ambi") != nullptr)
+      result |= OscMode_Ambi;
+    if (strstr(modes, "blob") != nullptr)
+      result |= OscMode_Blob;
+    return result;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Applies the yup2zup and leftHanded transforms to a
+  /// position.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void TransformPosition(float& x, float& y, float& z) const
+  {
+    if (yup2zup)
+    {
+      const float t = y;
+      y = -z;
+      z = t;
+    }
+    if (leftHanded)
+      x = -x;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Applies the yup2zup and leftHanded transforms to a
+  /// quaternion stored in x, y, z, w order.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void TransformRotation(float* q) const
+  {
+    if (yup2zup)
+    {
+      const float t = q[1];
+      q[1] = -q[2];
+      q[2] = t;
+    }
+    if (leftHanded)
+    {
+      q[1] = -q[1];
+      q[2] = -q[2];
+    }
+  }
+};
+
+#endif // _OSCOPTIONS_H_
@@ -0,0 +1,957 @@
+#include <algorithm>
+#include <cstring>
+
+#include "OscWriter.h"
+#include "PoseMatrix.h"
+
+//////////////////////////////////////////////////////////////////////////
+// OscWriter implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Milliseconds per day; frame timestamps wrap around after one day.
+  const int64_t kMillisecondsPerDay = 86400000;
+}
+
+
+OscWriter::Shard::Shard(int bufferSize)
+  :buffer(new uint8_t[bufferSize]),
+  encoder(buffer, bufferSize),
+  size(0)
+{
+}
+
+OscWriter::Shard::~Shard()
+{
+  delete[] buffer;
+}
+
+int OscWriter::PoseBatch::Add(const float* p, const float* q)
+{
+  const int k = poses.count++;
+  poses.x[k] = p[0];
+  poses.y[k] = p[1];
+  poses.z[k] = p[2];
+  if (q != nullptr)
+  {
+    poses.qx[k] = q[0];
+    poses.qy[k] = q[1];
+    poses.qz[k] = q[2];
+    poses.qw[k] = q[3];
+  }
+  return k;
+}
+
+OscWriter::OscWriter(DatagramSink sink, void* pUserData, int bufferSize)
+  :mSink(sink),
+  mUserData(pUserData),
+  mTransform(SelectFusedTransformKernel(UpAxis_Same, false, false)),
+  mClock(nullptr),
+  mPool(nullptr),
+  mHeaderEncoder(mHeader, FRAME_MESSAGES_SIZE),
+  mTrailerEncoder(mTrailer, FRAME_MESSAGES_SIZE),
+  mBufferSize(bufferSize),
+  mFrame(nullptr),
+  mTimestamp(0),
+  mFragmentCount(0),
+  mEncodedSize(0),
+  mPacker(sink, pUserData),
+  mDescriptionsStale(false),
+  mOtherMarkerAddresses("/othermarker"),
+  mLabeledMarkerAddresses("/marker"),
+  mFramesSent(0),
+  mFramesDropped(0),
+  mDatagramsSent(0)
+{
+  AllocateShards(1);
+}
+
+OscWriter::~OscWriter()
+{
+  for (size_t i = 0; i < mShards.size(); i++)
+    delete mShards[i];
+}
+
+void OscWriter::SetOptions(const OscOptions& options)
+{
+  mOptions = options;
+  if (mOptions.frameModulo < 1)
+    mOptions.frameModulo = 1;
+  mTransform = SelectFusedTransformKernel(mOptions.yup2zup ? UpAxis_YUpToZUp : UpAxis_Same, mOptions.leftHanded, false);
+  mPacker.SetBundleSize(mOptions.bundleSize);
+  for (size_t i = 0; i < mShards.size(); i++)
+    mShards[i]->deadBand.SetThresholds(mOptions.deadBandPosition, mOptions.deadBandRotation, mOptions.keyframeInterval);
+  mRates.SetDivisor(EntityClass_RigidBody, mOptions.rigidBodyModulo);
+  mRates.SetDivisor(EntityClass_Skeleton, mOptions.skeletonModulo);
+  mRates.SetDivisor(EntityClass_Marker, mOptions.markerModulo);
+}
+
+void OscWriter::SetWorkerPool(WorkerPool* pool)
+{
+  mPool = pool;
+  AllocateShards(pool != nullptr ? pool->Concurrency() : 1);
+}
+
+void OscWriter::SetDescriptions(const sDataDescriptions* pDataDefs)
+{
+  std::lock_guard<std::mutex> lock(mDescriptionLock);
+  mCache.Build(pDataDefs, mOptions);
+  AssignSkeletons(pDataDefs);
+  PrepareDeadBands(pDataDefs);
+}
+
+bool OscWriter::WriteFrame(const sFrameOfMocapData& data)
+{
+  if (Encode(data) == 0)
+    return true;
+  return Send();
+}
+
+int OscWriter::Encode(const sFrameOfMocapData& data)
+{
+  return EncodeFrame(LegacyFrameView(data));
+}
+
+int OscWriter::Encode(const FrameView& frame)
+{
+  return EncodeFrame(frame);
+}
+
+template<class Frame>
+int OscWriter::EncodeFrame(const Frame& frame)
+{
+  mEncodedSize = 0;
+  mFragmentCount = 0;
+  if (frame.Params() & 0x02)
+    mDescriptionsStale = true;
+  if (frame.FrameNumber() % mOptions.frameModulo != 0)
+    return 0;
+
+  mRates.BeginFrame();
+  if (mRates.Averaging())
+    AddToWindows(frame);
+
+  const bool markers = mOptions.sendMarkerInfo || mOptions.sendOtherMarkerInfo;
+  if (!mRates.Due(EntityClass_RigidBody) && !(mOptions.sendSkeletons && mRates.Due(EntityClass_Skeleton)) &&
+    !(markers && mRates.Due(EntityClass_Marker)))
+  {
+    mRates.EndFrame();
+    return 0;
+  }
+
+  const uint32_t modes = mOptions.modes;
+  const bool frameMessages = (modes & (OscMode_Max | OscMode_Isadora | OscMode_Touch)) != 0;
+  const int32_t timestamp = (int32_t)((int64_t)(frame.Timestamp() * 1000.0) % kMillisecondsPerDay);
+
+  OscEncoder& header = mHeaderEncoder;
+  header.Reset();
+  header.BeginBundle(Timetag(frame));
+
+  if (modes & OscMode_Sparck)
+  {
+    header.BeginMessage("/f/s", "i");
+    header.Int32(frame.FrameNumber());
+    header.BeginMessage("/f/t", "i");
+    header.Int32(timestamp);
+  }
+  if (frameMessages)
+  {
+    header.BeginMessage("/frame/start", "i");
+    header.Int32(frame.FrameNumber());
+    header.BeginMessage("/frame/timestamp", "i");
+    header.Int32(timestamp);
+    header.BeginMessage("/frame/timecode", "hh");
+    header.Int64(frame.Timecode());
+    header.Int64(frame.TimecodeSubframe());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mDescriptionLock);
+
+    mFrame = &frame;
+    mTimestamp = timestamp;
+
+    int poses = frame.RigidBodyCount() + frame.LabeledMarkerCount() + frame.OtherMarkerCount();
+    for (int i = 0; i < frame.SkeletonCount(); i++)
+      poses += frame.SkeletonBoneCount(i);
+
+    if (mPool != nullptr && poses >= PARALLEL_MIN_POSES)
+      mPool->Run(EncodeShardTask<Frame>, this, (int)mShards.size());
+    else
+    {
+      for (int i = 0; i < (int)mShards.size(); i++)
+        EncodeShard<Frame>(i);
+    }
+
+    mFrame = nullptr;
+  }
+
+  OscEncoder& trailer = mTrailerEncoder;
+  trailer.Reset();
+  trailer.BeginElements();
+  if (modes & OscMode_Sparck)
+  {
+    trailer.BeginMessage("/f/e", "i");
+    trailer.Int32(frame.FrameNumber());
+  }
+  if (frameMessages)
+  {
+    trailer.BeginMessage("/frame/end", "i");
+    trailer.Int32(frame.FrameNumber());
+  }
+
+  mRates.EndFrame();
+
+  // stitch the fragments in shard order
+  bool fits = header.Ok() && trailer.Ok();
+  AddFragment(mHeader, header.Finish());
+  for (size_t i = 0; i < mShards.size(); i++)
+  {
+    fits = fits && mShards[i]->encoder.Ok();
+    AddFragment(mShards[i]->buffer, mShards[i]->size);
+  }
+  AddFragment(mTrailer, trailer.Finish());
+
+  if (!fits)
+  {
+    mFragmentCount = 0;
+    mEncodedSize = 0;
+    mFramesDropped++;
+  }
+  return mEncodedSize;
+}
+
+bool OscWriter::Send()
+{
+  if (mEncodedSize == 0)
+    return true;
+
+  mFramesSent++;
+
+  if (mOptions.bundled)
+  {
+    const uint64_t sent = mPacker.DatagramsSent();
+    const bool ok = mPacker.Send(mFragments, mFragmentCount);
+    mDatagramsSent += mPacker.DatagramsSent() - sent;
+    return ok;
+  }
+
+  // every bundle element is a complete message
+  bool ok = true;
+  for (int f = 0; f < mFragmentCount; f++)
+  {
+    const uint8_t* data = mFragments[f].data;
+    const int bytes = mFragments[f].bytes;
+    for (int pos = f == 0 ? OscEncoder::BUNDLE_HEADER_SIZE : 0; pos + 4 <= bytes; )
+    {
+      const int size = (int)OscEncoder::Load32(data + pos);
+      ok = mSink(data + pos + 4, size, mUserData) && ok;
+      mDatagramsSent++;
+      pos += 4 + size;
+    }
+  }
+  return ok;
+}
+
+template<class Frame>
+void OscWriter::EncodeShardTask(void* pContext, int index)
+{
+  static_cast<OscWriter*>(pContext)->EncodeShard<Frame>(index);
+}
+
+// Encodes one shard of mFrame. Runs on any pool thread, concurrently with
+// the other shards; only the shard itself is written to.
+template<class Frame>
+void OscWriter::EncodeShard(int index)
+{
+  const Frame& frame = *static_cast<const Frame*>(mFrame);
+  Shard& shard = *mShards[index];
+  OscEncoder& encoder = shard.encoder;
+  encoder.Reset();
+  encoder.BeginElements();
+
+  const bool markersDue = mRates.Due(EntityClass_Marker);
+  if (index == Shard_OtherMarkers)
+  {
+    if (mOptions.sendOtherMarkerInfo && markersDue)
+      WriteOtherMarkers(shard, frame);
+  }
+  else if (index == Shard_LabeledMarkers)
+  {
+    if (mOptions.sendMarkerInfo && markersDue)
+      WriteLabeledMarkers(shard, frame);
+  }
+  else if (index == Shard_RigidBodies)
+  {
+    if (mRates.Due(EntityClass_RigidBody))
+      WriteRigidBodies(shard, frame);
+  }
+  else if (mOptions.sendSkeletons && mRates.Due(EntityClass_Skeleton))
+  {
+    const float timestamp = (float)frame.Timestamp() * 1000.0f;
+    for (int i = 0; i < frame.SkeletonCount(); i++)
+    {
+      if (SkeletonShard(frame.SkeletonID(i)) == index)
+        WriteSkeleton(shard, frame, i, timestamp);
+    }
+  }
+
+  shard.size = encoder.Finish();
+}
+
+// Replaces the shards by the fixed ones and the given number of skeleton
+// shards.
+void OscWriter::AllocateShards(int skeletonShards)
+{
+  if (skeletonShards < 1)
+    skeletonShards = 1;
+  else if (skeletonShards > MAX_SKELETON_SHARDS)
+    skeletonShards = MAX_SKELETON_SHARDS;
+
+  std::lock_guard<std::mutex> lock(mDescriptionLock);
+  for (size_t i = 0; i < mShards.size(); i++)
+    delete mShards[i];
+  mShards.clear();
+  mSkeletonAssignments.clear();
+
+  for (int i = 0; i < Shard_Skeletons + skeletonShards; i++)
+  {
+    mShards.push_back(new Shard(mBufferSize));
+    mShards.back()->deadBand.SetThresholds(mOptions.deadBandPosition, mOptions.deadBandRotation, mOptions.keyframeInterval);
+  }
+}
+
+// Splits the skeletons into runs of about the same number of bones, one per
+// skeleton shard, in description order. Motive streams skeletons in that
+// order, so the shards in turn hold the skeletons in frame order.
+void OscWriter::AssignSkeletons(const sDataDescriptions* pDataDefs)
+{
+  mSkeletonAssignments.clear();
+  if (pDataDefs == nullptr)
+    return;
+
+  int totalBones = 0;
+  for (int i = 0; i < pDataDefs->nDataDescriptions; i++)
+  {
+    if (pDataDefs->arrDataDescriptions[i].type == Descriptor_Skeleton)
+      totalBones += pDataDefs->arrDataDescriptions[i].Data.SkeletonDescription->nRigidBodies;
+  }
+
+  const int skeletonShards = (int)mShards.size() - Shard_Skeletons;
+  int bones = 0;
+  for (int i = 0; i < pDataDefs->nDataDescriptions; i++)
+  {
+    if (pDataDefs->arrDataDescriptions[i].type != Descriptor_Skeleton)
+      continue;
+
+    // shard of the skeleton's middle bone
+    const sSkeletonDescription* pSK = pDataDefs->arrDataDescriptions[i].Data.SkeletonDescription;
+    const int middle = bones + pSK->nRigidBodies / 2;
+    int shard = totalBones > 0 ? (int)((int64_t)middle * skeletonShards / totalBones) : 0;
+    if (shard >= skeletonShards)
+      shard = skeletonShards - 1;
+    bones += pSK->nRigidBodies;
+
+    SkeletonAssignment assignment;
+    assignment.id = pSK->skeletonID;
+    assignment.shard = Shard_Skeletons + shard;
+    mSkeletonAssignments.push_back(assignment);
+  }
+  std::stable_sort(mSkeletonAssignments.begin(), mSkeletonAssignments.end(), AssignmentLess);
+
+  // a skeleton may have moved to another shard; its bones are sent again
+  for (int i = Shard_Skeletons; i < (int)mShards.size(); i++)
+    mShards[i]->deadBand.Reset();
+}
+
+// Creates the dead-band entries of all described rigid bodies and bones in
+// the shards encoding them, so none is inserted while a frame is encoded.
+void OscWriter::PrepareDeadBands(const sDataDescriptions* pDataDefs)
+{
+  if (pDataDefs == nullptr)
+    return;
+
+  std::vector<std::vector<int32_t> > ids(mShards.size());
+  for (int i = 0; i < pDataDefs->nDataDescriptions; i++)
+  {
+    const sDataDescription& desc = pDataDefs->arrDataDescriptions[i];
+    if (desc.type == Descriptor_RigidBody)
+      ids[Shard_RigidBodies].push_back(desc.Data.RigidBodyDescription->ID);
+    else if (desc.type == Descriptor_Skeleton)
+    {
+      const sSkeletonDescription* pSK = desc.Data.SkeletonDescription;
+      const int shard = SkeletonShard(pSK->skeletonID);
+      if (shard < 0)
+        continue;
+      for (int j = 0; j < pSK->nRigidBodies; j++)
+        ids[shard].push_back((pSK->skeletonID << 16) | pSK->RigidBodies[j].ID);
+    }
+  }
+
+  for (size_t i = 0; i < mShards.size(); i++)
+  {
+    if (!ids[i].empty())
+      mShards[i]->deadBand.Prepare(ids[i]);
+  }
+}
+
+// Shard of a skeleton, -1 if it has no description.
+int OscWriter::SkeletonShard(int32_t skeletonID) const
+{
+  std::vector<SkeletonAssignment>::const_iterator it =
+    std::lower_bound(mSkeletonAssignments.begin(), mSkeletonAssignments.end(), skeletonID, AssignmentLessById);
+  return (it != mSkeletonAssignments.end() && it->id == skeletonID) ? it->shard : -1;
+}
+
+bool OscWriter::AssignmentLess(const SkeletonAssignment& a, const SkeletonAssignment& b)
+{
+  return a.id < b.id;
+}
+
+bool OscWriter::AssignmentLessById(const SkeletonAssignment& assignment, int32_t id)
+{
+  return assignment.id < id;
+}
+
+void OscWriter::AddFragment(const uint8_t* data, int bytes)
+{
+  if (bytes == 0)
+    return;
+  mFragments[mFragmentCount].data = data;
+  mFragments[mFragmentCount].bytes = bytes;
+  mFragmentCount++;
+  mEncodedSize += bytes;
+}
+
+// NTP time of the frame's mid exposure (or transmit, if the server does not
+// send the exposure time).
+template<class Frame>
+uint64_t OscWriter::Timetag(const Frame& frame) const
+{
+  const uint64_t midExposure = frame.CameraMidExposureTimestamp();
+  const uint64_t hostTicks = midExposure != 0 ? midExposure : frame.TransmitTimestamp();
+  if (mClock != nullptr && hostTicks != 0 && mClock->Calibrated())
+    return mClock->ToNtp(hostTicks);
+  return (uint64_t)(frame.Timestamp() * 1000.0);
+}
+
+// Dead-band check of a rigid body or bone; always true if disabled.
+bool OscWriter::PoseChanged(DeadBandFilter& deadBand, const sRigidBodyData& rb, bool tracked, int frame) const
+{
+  if (!mOptions.deadBand)
+    return true;
+
+  const float p[3] = { rb.x, rb.y, rb.z };
+  const float q[4] = { rb.qx, rb.qy, rb.qz, rb.qw };
+  return deadBand.Update(rb.ID, p, q, tracked, frame);
+}
+
+// Adds the poses of the decimated classes to their averaging windows.
+template<class Frame>
+void OscWriter::AddToWindows(const Frame& frame)
+{
+  if (mRates.Divisor(EntityClass_RigidBody) > 1)
+  {
+    for (int i = 0; i < frame.RigidBodyCount(); i++)
+    {
+      sRigidBodyData rb;
+      frame.GetRigidBody(i, rb);
+      const float p[3] = { rb.x, rb.y, rb.z };
+      const float q[4] = { rb.qx, rb.qy, rb.qz, rb.qw };
+      mRates.Add(EntityClass_RigidBody, rb.ID, p, q, (rb.params & 0x01) != 0);
+    }
+  }
+
+  if (mOptions.sendSkeletons && mRates.Divisor(EntityClass_Skeleton) > 1)
+  {
+    for (int i = 0; i < frame.SkeletonCount(); i++)
+    {
+      for (int j = 0; j < frame.SkeletonBoneCount(i); j++)
+      {
+        sRigidBodyData bone;
+        frame.GetSkeletonBone(i, j, bone);
+        const float p[3] = { bone.x, bone.y, bone.z };
+        const float q[4] = { bone.qx, bone.qy, bone.qz, bone.qw };
+        mRates.Add(EntityClass_Skeleton, bone.ID, p, q, true);
+      }
+    }
+  }
+
+  // unlabeled markers carry no ID, they are sampled
+  if (mOptions.sendMarkerInfo && mRates.Divisor(EntityClass_Marker) > 1)
+  {
+    for (int i = 0; i < frame.LabeledMarkerCount(); i++)
+    {
+      sMarker marker;
+      frame.GetLabeledMarker(i, marker);
+      const float p[3] = { marker.x, marker.y, marker.z };
+      mRates.Add(EntityClass_Marker, marker.ID, p, nullptr, true);
+    }
+  }
+}
+
+// Replaces the pose of a rigid body or bone by its window mean.
+void OscWriter::Decimate(EntityClass entityClass, sRigidBodyData& rb, bool& tracked) const
+{
+  if (mRates.Divisor(entityClass) == 1)
+    return;
+
+  float p[3] = { rb.x, rb.y, rb.z };
+  float q[4] = { rb.qx, rb.qy, rb.qz, rb.qw };
+  mRates.Mean(entityClass, rb.ID, p, q, tracked);
+  rb.x = p[0];
+  rb.y = p[1];
+  rb.z = p[2];
+  rb.qx = q[0];
+  rb.qy = q[1];
+  rb.qz = q[2];
+  rb.qw = q[3];
+  rb.params = (int16_t)(tracked ? (rb.params | 0x01) : (rb.params & ~0x01));
+}
+
+//*************************************************************************
+// messages
+//
+
+template<class Frame>
+void OscWriter::WriteOtherMarkers(Shard& shard, const Frame& frame)
+{
+  const uint32_t modes = mOptions.modes;
+  PoseBatch& batch = shard.batch;
+
+  if (modes & (OscMode_Max | OscMode_Isadora | OscMode_Touch))
+  {
+    batch.poses.count = 0;
+    for (int i = 0; i < frame.OtherMarkerCount(); i++)
+    {
+      MarkerData p;
+      frame.GetOtherMarker(i, p);
+
+      // Unlabeled markers carry no ID; use the one of a labeled marker at
+      // the same position.
+      int32_t markerID = -1;
+      for (int j = 0; j < frame.LabeledMarkerCount(); j++)
+      {
+        sMarker labeled;
+        frame.GetLabeledMarker(j, labeled);
+        if (labeled.x == p[0] && labeled.y == p[1] && labeled.z == p[2])
+        {
+          markerID = labeled.ID;
+          break;
+        }
+      }
+
+      batch.ids[batch.Add(p, nullptr)] = markerID;
+      if (batch.Full())
+        FlushOtherMarkers(shard);
+    }
+    FlushOtherMarkers(shard);
+  }
+
+  if (modes & OscMode_Sparck)
+  {
+    OscEncoder& encoder = shard.encoder;
+    const int count = frame.OtherMarkerCount();
+    encoder.BeginMessage("/om", "", 'f', 3 * count);
+    for (int i = 0; i < count; i += BATCH_SIZE)
+    {
+      batch.poses.count = 0;
+      for (int j = i; j < count && !batch.Full(); j++)
+      {
+        MarkerData p;
+        frame.GetOtherMarker(j, p);
+        batch.Add(p, nullptr);
+      }
+      Transform(batch, false);
+
+      const PoseArrays<BATCH_SIZE>& poses = batch.poses;
+      for (int k = 0; k < poses.count; k++)
+      {
+        encoder.Float(poses.x[k]);
+        encoder.Float(poses.y[k]);
+        encoder.Float(poses.z[k]);
+      }
+    }
+  }
+}
+
+// Messages of the unlabeled markers gathered in the shard's batch.
+void OscWriter::FlushOtherMarkers(Shard& shard)
+{
+  const uint32_t modes = mOptions.modes;
+  OscEncoder& encoder = shard.encoder;
+  PoseBatch& batch = shard.batch;
+  Transform(batch, false);
+
+  const PoseArrays<BATCH_SIZE>& poses = batch.poses;
+  for (int k = 0; k < poses.count; k++)
+  {
+    const OscMarkerAddressCache::Entry& addresses = mOtherMarkerAddresses.Find(batch.ids[k]);
+    if (modes & OscMode_Max)
+    {
+      encoder.BeginMessage(mOtherMarkerAddresses.Data(addresses.max), (int)addresses.max.bytes);
+      encoder.Float(poses.x[k]);
+      encoder.Float(poses.y[k]);
+      encoder.Float(poses.z[k]);
+    }
+    if (modes & (OscMode_Isadora | OscMode_Touch))
+    {
+      encoder.BeginMessage(mOtherMarkerAddresses.Data(addresses.path), (int)addresses.path.bytes);
+      encoder.Float(poses.x[k]);
+      encoder.Float(poses.y[k]);
+      encoder.Float(poses.z[k]);
+    }
+  }
+  batch.poses.count = 0;
+}
+
+template<class Frame>
+void OscWriter::WriteLabeledMarkers(Shard& shard, const Frame& frame)
+{
+  PoseBatch& batch = shard.batch;
+  batch.poses.count = 0;
+  for (int i = 0; i < frame.LabeledMarkerCount(); i++)
+  {
+    sMarker marker;
+    frame.GetLabeledMarker(i, marker);
+    float p[3] = { marker.x, marker.y, marker.z };
+    bool tracked = true;
+    mRates.Mean(EntityClass_Marker, marker.ID, p, nullptr, tracked);
+
+    batch.ids[batch.Add(p, nullptr)] = marker.ID;
+    if (batch.Full())
+      FlushLabeledMarkers(shard);
+  }
+  FlushLabeledMarkers(shard);
+}
+
+// Messages of the labeled markers gathered in the shard's batch.
+void OscWriter::FlushLabeledMarkers(Shard& shard)
+{
+  const uint32_t modes = mOptions.modes;
+  OscEncoder& encoder = shard.encoder;
+  PoseBatch& batch = shard.batch;
+  Transform(batch, false);
+
+  const PoseArrays<BATCH_SIZE>& poses = batch.poses;
+  for (int k = 0; k < poses.count; k++)
+  {
+    const OscMarkerAddressCache::Entry& addresses = mLabeledMarkerAddresses.Find(batch.ids[k]);
+    if (modes & OscMode_Max)
+    {
+      encoder.BeginMessage(mLabeledMarkerAddresses.Data(addresses.max), (int)addresses.max.bytes);
+      encoder.Float(poses.x[k]);
+      encoder.Float(poses.y[k]);
+      encoder.Float(poses.z[k]);
+    }
+    if (modes & (OscMode_Isadora | OscMode_Touch))
+    {
+      encoder.BeginMessage(mLabeledMarkerAddresses.Data(addresses.path), (int)addresses.path.bytes);
+      encoder.Float(poses.x[k]);
+      encoder.Float(poses.y[k]);
+      encoder.Float(poses.z[k]);
+    }
+  }
+  batch.poses.count = 0;
+}
+
+// Rigid bodies and, in blob mode, the blob holding all of them.
+template<class Frame>
+void OscWriter::WriteRigidBodies(Shard& shard, const Frame& frame)
+{
+  mBlob.Clear();
+  PoseBatch& batch = shard.batch;
+  batch.poses.count = 0;
+  for (int i = 0; i < frame.RigidBodyCount(); i++)
+  {
+    sRigidBodyData rb;
+    frame.GetRigidBody(i, rb);
+    const OscAddressCache::RigidBodyEntry* entry = mCache.FindRigidBody(rb.ID);
+    if (entry == nullptr)
+      continue;
+
+    bool tracked = (rb.params & 0x01) != 0;
+    Decimate(EntityClass_RigidBody, rb, tracked);
+    if (!PoseChanged(shard.deadBand, rb, tracked, frame.FrameNumber()))
+      continue;
+
+    const float p[3] = { rb.x, rb.y, rb.z };
+    const float q[4] = { rb.qx, rb.qy, rb.qz, rb.qw };
+    const int k = batch.Add(p, q);
+    batch.ids[k] = rb.ID;
+    batch.tracked[k] = tracked;
+    batch.rigidBodies[k] = entry;
+    if (batch.Full())
+      FlushRigidBodies(shard);
+  }
+  FlushRigidBodies(shard);
+
+  if (mOptions.modes & OscMode_Blob)
+  {
+    const uint32_t flags = (mOptions.yup2zup ? RigidBodyBlobHeader::FLAG_YUP2ZUP : 0) |
+      (mOptions.leftHanded ? RigidBodyBlobHeader::FLAG_LEFTHANDED : 0);
+    shard.encoder.BeginMessage("/rigidbodies", "b");
+    uint8_t* blob = shard.encoder.ReserveBlob(mBlob.Size());
+    if (blob != nullptr)
+      mBlob.Write(blob, flags, frame.FrameNumber(), mTimestamp);
+  }
+}
+
+// Messages of the rigid bodies gathered in the shard's batch.
+void OscWriter::FlushRigidBodies(Shard& shard)
+{
+  PoseBatch& batch = shard.batch;
+  Transform(batch, true);
+
+  const PoseArrays<BATCH_SIZE>& poses = batch.poses;
+  const bool matrices = mOptions.matrix || mOptions.invMatrix;
+  if (matrices)
+    PoseMatrices(poses, batch.matrices, mOptions.invMatrix ? batch.inverses : nullptr);
+
+  for (int k = 0; k < poses.count; k++)
+  {
+    const float p[3] = { poses.x[k], poses.y[k], poses.z[k] };
+    const float q[4] = { poses.qx[k], poses.qy[k], poses.qz[k], poses.qw[k] };
+    const float* m = matrices ? batch.matrices + 16 * k : nullptr;
+    const float* inv = mOptions.invMatrix ? batch.inverses + 16 * k : nullptr;
+    WriteRigidBody(shard.encoder, batch.ids[k], batch.tracked[k], p, q, m, inv, *batch.rigidBodies[k], mTimestamp);
+  }
+  batch.poses.count = 0;
+}
+
+// Messages of one rigid body; p and q are transformed already, m and inv
+// are its matrix and inverse or nullptr if not sent.
+void OscWriter::WriteRigidBody(OscEncoder& encoder, int32_t id, bool tracked, const float* p, const float* q,
+  const float* m, const float* inv, const OscAddressCache::RigidBodyEntry& entry, int32_t timestamp)
+{
+  typedef OscAddressCache Cache;
+  const uint32_t modes = mOptions.modes;
+  const Cache::Prefix* messages = entry.messages;
+
+  if (!tracked)
+  {
+    if (modes & OscMode_Blob)
+      mBlob.Add(id, false, p, q);
+    if (modes & OscMode_Max)
+    {
+      BeginMessage(encoder, messages[Cache::RigidBody_MaxTracked]);
+      encoder.Int32(0);
+    }
+    if (modes & (OscMode_Isadora | OscMode_Touch))
+    {
+      BeginMessage(encoder, messages[Cache::RigidBody_Tracked]);
+      encoder.Int32(0);
+    }
+    if (modes & OscMode_Sparck)
+    {
+      BeginMessage(encoder, messages[Cache::RigidBody_SparckTracked]);
+      encoder.Int32(0);
+    }
+    return;
+  }
+
+  if (modes & OscMode_Blob)
+    mBlob.Add(id, true, p, q);
+
+  const bool matrices = m != nullptr;
+
+  if (modes & OscMode_Ambi)
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_Ambi]);
+    encoder.Float(p[0]);
+    encoder.Float(p[1]);
+    encoder.Float(p[2]);
+  }
+
+  if (modes & OscMode_Max)
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_MaxTracked]);
+    encoder.Int32(1);
+    BeginMessage(encoder, messages[Cache::RigidBody_MaxPosition]);
+    encoder.Float(p[0]);
+    encoder.Float(p[1]);
+    encoder.Float(p[2]);
+    BeginMessage(encoder, messages[Cache::RigidBody_MaxQuat]);
+    encoder.Float(q[0]);
+    encoder.Float(q[1]);
+    encoder.Float(q[2]);
+    encoder.Float(q[3]);
+    if (matrices)
+    {
+      BeginMessage(encoder, messages[Cache::RigidBody_MaxMatrix]);
+      encoder.Floats(m, 16);
+      if (inv != nullptr)
+      {
+        BeginMessage(encoder, messages[Cache::RigidBody_MaxInvMatrix]);
+        encoder.Floats(inv, 16);
+      }
+    }
+  }
+
+  if (modes & OscMode_Isadora)
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_Tracked]);
+    encoder.Int32(1);
+    BeginMessage(encoder, messages[Cache::RigidBody_Position]);
+    encoder.Float(p[0]);
+    encoder.Float(p[1]);
+    encoder.Float(p[2]);
+    BeginMessage(encoder, messages[Cache::RigidBody_Quat]);
+    encoder.Float(q[0]);
+    encoder.Float(q[1]);
+    encoder.Float(q[2]);
+    encoder.Float(q[3]);
+  }
+
+  if (modes & OscMode_Touch)
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_Tracked]);
+    encoder.Int32(1);
+    BeginMessage(encoder, messages[Cache::RigidBody_Transformation]);
+    encoder.Float(p[0]);
+    encoder.Float(p[1]);
+    encoder.Float(p[2]);
+    encoder.Float(q[0]);
+    encoder.Float(q[1]);
+    encoder.Float(q[2]);
+    encoder.Float(q[3]);
+  }
+
+  if (modes & OscMode_Sparck)
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_SparckTracked]);
+    encoder.Int32(1);
+
+    // marker offsets are constant, the whole message is cached
+    if (mOptions.sendMarkerInfo)
+      BeginMessage(encoder, messages[Cache::RigidBody_SparckMarkers]);
+
+    BeginMessage(encoder, messages[Cache::RigidBody_SparckPose]);
+    encoder.Int32(timestamp);
+    encoder.Float(p[0]);
+    encoder.Float(p[1]);
+    encoder.Float(p[2]);
+    encoder.Float(q[0]);
+    encoder.Float(q[1]);
+    encoder.Float(q[2]);
+    encoder.Float(q[3]);
+  }
+
+  if (matrices && (modes & (OscMode_Isadora | OscMode_Touch)))
+  {
+    BeginMessage(encoder, messages[Cache::RigidBody_Matrix]);
+    encoder.Floats(m, 16);
+    if (inv != nullptr)
+    {
+      BeginMessage(encoder, messages[Cache::RigidBody_InvMatrix]);
+      encoder.Floats(inv, 16);
+    }
+  }
+}
+
+template<class Frame>
+void OscWriter::WriteSkeleton(Shard& shard, const Frame& frame, int skeleton, float timestamp) const
+{
+  PoseBatch& batch = shard.batch;
+  batch.poses.count = 0;
+  for (int i = 0; i < frame.SkeletonBoneCount(skeleton); i++)
+  {
+    sRigidBodyData bone;
+    frame.GetSkeletonBone(skeleton, i, bone);
+    const OscAddressCache::BoneEntry* entry = mCache.FindBone(bone.ID);
+    if (entry == nullptr)
+      continue;
+
+    bool tracked = true;
+    Decimate(EntityClass_Skeleton, bone, tracked);
+    if (!PoseChanged(shard.deadBand, bone, true, frame.FrameNumber()))
+      continue;
+
+    const float p[3] = { bone.x, bone.y, bone.z };
+    const float q[4] = { bone.qx, bone.qy, bone.qz, bone.qw };
+    batch.bones[batch.Add(p, q)] = entry;
+    if (batch.Full())
+      FlushBones(shard, timestamp);
+  }
+  FlushBones(shard, timestamp);
+}
+
+// Messages of the skeleton bones gathered in the shard's batch.
+void OscWriter::FlushBones(Shard& shard, float timestamp) const
+{
+  OscEncoder& encoder = shard.encoder;
+  typedef OscAddressCache Cache;
+  const uint32_t modes = mOptions.modes;
+  PoseBatch& batch = shard.batch;
+  Transform(batch, true);
+
+  const PoseArrays<BATCH_SIZE>& poses = batch.poses;
+  for (int k = 0; k < poses.count; k++)
+  {
+    const Cache::Prefix* messages = batch.bones[k]->messages;
+    const float p[3] = { poses.x[k], poses.y[k], poses.z[k] };
+    const float q[4] = { poses.qx[k], poses.qy[k], poses.qz[k], poses.qw[k] };
+
+    if (modes & OscMode_Max)
+    {
+      BeginMessage(encoder, messages[Cache::Bone_MaxPosition]);
+      encoder.Float(p[0]);
+      encoder.Float(p[1]);
+      encoder.Float(p[2]);
+      BeginMessage(encoder, messages[Cache::Bone_MaxQuat]);
+      encoder.Float(q[0]);
+      encoder.Float(q[1]);
+      encoder.Float(q[2]);
+      encoder.Float(q[3]);
+    }
+
+    if (modes & OscMode_Isadora)
+    {
+      BeginMessage(encoder, messages[Cache::Bone_Position]);
+      encoder.Float(p[0]);
+      encoder.Float(p[1]);
+      encoder.Float(p[2]);
+      BeginMessage(encoder, messages[Cache::Bone_Quat]);
+      encoder.Float(q[0]);
+      encoder.Float(q[1]);
+      encoder.Float(q[2]);
+      encoder.Float(q[3]);
+    }
+
+    if (modes & OscMode_Touch)
+    {
+      BeginMessage(encoder, messages[Cache::Bone_Transformation]);
+      encoder.Float(p[0]);
+      encoder.Float(p[1]);
+      encoder.Float(p[2]);
+      encoder.Float(q[0]);
+      encoder.Float(q[1]);
+      encoder.Float(q[2]);
+      encoder.Float(q[3]);
+    }
+
+    if (modes & OscMode_Sparck)
+    {
+      BeginMessage(encoder, messages[Cache::Bone_Sparck]);
+      encoder.Float(timestamp);
+      encoder.Float(p[0]);
+      encoder.Float(p[1]);
+      encoder.Float(p[2]);
+      encoder.Float(q[0]);
+      encoder.Float(q[1]);
+      encoder.Float(q[2]);
+      encoder.Float(q[3]);
+    }
+  }
+  batch.poses.count = 0;
+}
+
+void OscWriter::Transform(PoseBatch& batch, bool rotations) const
+{
+  PoseArrays<BATCH_SIZE>& poses = batch.poses;
+  if (rotations)
+    mTransform(poses.x, poses.y, poses.z, poses.qx, poses.qy, poses.qz, poses.qw, poses.count, 1.0f);
+  else
+    mTransform(poses.x, poses.y, poses.z, nullptr, nullptr, nullptr, nullptr, poses.count, 1.0f);
+}
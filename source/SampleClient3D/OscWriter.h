@@ -0,0 +1,322 @@
+#ifndef _OSCWRITER_H_
+#define _OSCWRITER_H_
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "NatNetTypes.h"
+#include "DeadBandFilter.h"
+#include "FrameFragmenter.h"
+#include "FrameView.h"
+#include "NtpClock.h"
+#include "OscAddressCache.h"
+#include "OscBundlePacker.h"
+#include "OscEncoder.h"
+#include "OscOptions.h"
+#include "PoseTransform.h"
+#include "RateScheduler.h"
+#include "RigidBodyBlob.h"
+#include "TransformPolicy.h"
+#include "WorkerPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Encodes NatNet frames as OSC in the layouts of the OSC bridge and
+/// hands the resulting datagrams to a sink.
+/// </summary>
+/// <remarks>
+/// A frame is encoded in shards: other markers, labeled markers, rigid
+/// bodies and one range of skeletons per pool thread. Every shard writes
+/// bundle elements into a preallocated buffer of its own, so encoding and
+/// sending a frame does not allocate, and with a WorkerPool set the shards
+/// of large frames are encoded in parallel. The frame is the bundle header,
+/// the shards in that fixed order and the end of frame messages, so the
+/// output does not depend on which thread encoded what. Bundled output
+/// gathers these fragments into bundles of at most <c>bundleSize</c>
+/// bytes (OscBundlePacker); unbundled output sends each bundle element as
+/// its own datagram. Bundles are timetagged with the
+/// camera mid exposure time of the frame once a host clock is set.
+///
+/// Rigid bodies, skeletons and markers can be sent at a fraction of the
+/// frame rate, averaged over the skipped frames (RateScheduler). With
+/// <c>deadBand</c> set, rigid bodies and bones whose pose did not
+/// change beyond the thresholds are left out of the frame (DeadBandFilter).
+///
+/// A shard gathers the poses it sends into arrays and transforms them to
+/// the output coordinate system (<c>yup2zup</c>, <c>leftHanded</c>) a
+/// batch at a time, with the FusedTransform kernel selected by SetOptions.
+///
+/// Rigid bodies and skeleton bones are only sent once their descriptions
+/// are known (SetDescriptions). Their addresses are encoded once per
+/// description list (OscAddressCache), so per frame only the pose is
+/// encoded. Descriptions may be replaced while frames are written from
+/// another thread.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class OscWriter
+{
+public:
+  // Default size of a shard buffer. Frames with a shard that does not fit
+  // are dropped.
+  static const int DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+  // Frames with fewer poses (rigid bodies, bones and markers) are encoded
+  // on the calling thread; waking the pool costs more than it saves.
+  static const int PARALLEL_MIN_POSES = 256;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates a writer that hands its datagrams to
+  /// <c>sink</c>.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  OscWriter(DatagramSink sink, void* pUserData, int bufferSize = DEFAULT_BUFFER_SIZE);
+  ~OscWriter();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the output options. Not synchronized with WriteFrame;
+  /// set them before frames are written. The cached addresses depend on
+  /// the options and are encoded by the next SetDescriptions.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetOptions(const OscOptions& options);
+  const OscOptions& Options() const { return mOptions; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Encodes the addresses of all rigid bodies and skeleton
+  /// bones of a description list, and the rigid body marker offsets sent
+  /// in sparck mode. Splits the skeletons among the skeleton shards, which
+  /// sends every bone once more.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetDescriptions(const sDataDescriptions* pDataDefs);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns and clears the flag set when a frame reports a
+  /// changed model list. The owner should then fetch the descriptions
+  /// again, off the frame callback.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool TakeDescriptionsStale() { return mDescriptionsStale.exchange(false); }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the clock mapping frame timestamps to NTP timetags.
+  /// Without a calibrated clock, bundles carry <c>fTimestamp</c> in
+  /// milliseconds as timetag, as the OSC bridge does.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetClock(const NtpClock* clock) { mClock = clock; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the pool that encodes the shards of large frames,
+  /// nullptr to encode on the calling thread. Skeletons are split into
+  /// one shard per pool thread. Set it before the descriptions; the pool
+  /// must outlive the writer.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetWorkerPool(WorkerPool* pool);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Encodes a frame without sending it. Frames skipped by
+  /// <c>frameModulo</c>, or in which no entity class is due, encode to
+  /// nothing.</summary>
+  /// <returns>The encoded size, 0 if the frame was skipped or did not
+  /// fit into the buffer.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  int Encode(const sFrameOfMocapData& data);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Encodes a frame received as a raw packet, reading every
+  /// entity straight from the packet. The encoded bytes are those of the
+  /// decoded frame.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  int Encode(const FrameView& frame);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends the frame encoded last, as datagram sized bundles or
+  /// as one datagram per message.</summary>
+  /// <returns>false if the sink failed.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Send();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Encodes and sends a frame. Meant to be called from the
+  /// NatNet frame callback.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool WriteFrame(const sFrameOfMocapData& data);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the frame encoded last as consecutive fragments of
+  /// one bundle; the first starts with the bundle header.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  const OscFragment* EncodedFragments() const { return mFragments; }
+  int EncodedFragmentCount() const { return mFragmentCount; }
+  int EncodedSize() const { return mEncodedSize; }
+
+  uint64_t FramesSent() const { return mFramesSent; }
+  uint64_t FramesDropped() const { return mFramesDropped; }
+  uint64_t DatagramsSent() const { return mDatagramsSent; }
+
+private:
+  // Shards in output order; skeleton shards follow Shard_Skeletons.
+  enum ShardIndex
+  {
+    Shard_OtherMarkers = 0,
+    Shard_LabeledMarkers,
+    Shard_RigidBodies,
+    Shard_Skeletons
+  };
+
+  static const int MAX_SKELETON_SHARDS = WorkerPool::MAX_THREADS + 1;
+  static const int MAX_FRAGMENTS = Shard_Skeletons + MAX_SKELETON_SHARDS + 2;
+
+  // Space for the bundle header and the start and end of frame messages.
+  static const int FRAME_MESSAGES_SIZE = 256;
+
+  // Poses transformed per kernel call.
+  static const int BATCH_SIZE = 256;
+
+  // Poses of a shard gathered for the transform kernel, with what their
+  // messages need besides the pose.
+  struct PoseBatch
+  {
+    PoseArrays<BATCH_SIZE> poses;
+    int32_t ids[BATCH_SIZE];
+    bool tracked[BATCH_SIZE];
+    const OscAddressCache::RigidBodyEntry* rigidBodies[BATCH_SIZE];
+    const OscAddressCache::BoneEntry* bones[BATCH_SIZE];
+    // Matrices and inverses for the matrix and invMatrix options, 16
+    // floats per pose as PoseMatrices fills them.
+    float matrices[16 * BATCH_SIZE];
+    float inverses[16 * BATCH_SIZE];
+
+    // Appends a pose; returns its index.
+    int Add(const float* p, const float* q);
+    bool Full() const { return poses.count == BATCH_SIZE; }
+  };
+
+  // Bundle elements of one part of the frame. Poses are only ever
+  // encoded by one shard, so each shard keeps its own dead-band state.
+  struct Shard
+  {
+    explicit Shard(int bufferSize);
+    ~Shard();
+
+    uint8_t* buffer;
+    OscEncoder encoder;
+    int size;
+    DeadBandFilter deadBand;
+    PoseBatch batch;
+
+  private:
+    Shard(const Shard&); // not implemented
+  };
+
+  // Skeleton shard of a skeleton ID.
+  struct SkeletonAssignment
+  {
+    int32_t id;
+    int shard;
+  };
+
+  OscWriter(const OscWriter&); // not implemented
+
+  // Frame readers are instantiated for FrameView and LegacyFrameView.
+  template<class Frame>
+  int EncodeFrame(const Frame& frame);
+  template<class Frame>
+  static void EncodeShardTask(void* pContext, int index);
+  template<class Frame>
+  void EncodeShard(int index);
+  void AllocateShards(int skeletonShards);
+  void AssignSkeletons(const sDataDescriptions* pDataDefs);
+  void PrepareDeadBands(const sDataDescriptions* pDataDefs);
+  int SkeletonShard(int32_t skeletonID) const;
+  static bool AssignmentLess(const SkeletonAssignment& a, const SkeletonAssignment& b);
+  static bool AssignmentLessById(const SkeletonAssignment& assignment, int32_t id);
+  void AddFragment(const uint8_t* data, int bytes);
+
+  template<class Frame>
+  void WriteOtherMarkers(Shard& shard, const Frame& frame);
+  void FlushOtherMarkers(Shard& shard);
+  template<class Frame>
+  void WriteLabeledMarkers(Shard& shard, const Frame& frame);
+  void FlushLabeledMarkers(Shard& shard);
+  template<class Frame>
+  void WriteRigidBodies(Shard& shard, const Frame& frame);
+  void FlushRigidBodies(Shard& shard);
+  void WriteRigidBody(OscEncoder& encoder, int32_t id, bool tracked, const float* p, const float* q,
+    const float* m, const float* inv, const OscAddressCache::RigidBodyEntry& entry, int32_t timestamp);
+  template<class Frame>
+  void WriteSkeleton(Shard& shard, const Frame& frame, int skeleton, float timestamp) const;
+  void FlushBones(Shard& shard, float timestamp) const;
+  void Transform(PoseBatch& batch, bool rotations) const;
+  template<class Frame>
+  uint64_t Timetag(const Frame& frame) const;
+  bool PoseChanged(DeadBandFilter& deadBand, const sRigidBodyData& rb, bool tracked, int frame) const;
+  template<class Frame>
+  void AddToWindows(const Frame& frame);
+  void Decimate(EntityClass entityClass, sRigidBodyData& rb, bool& tracked) const;
+
+  void BeginMessage(OscEncoder& encoder, const OscAddressCache::Prefix& prefix) const
+  {
+    encoder.BeginMessage(mCache.Data(prefix), (int)prefix.bytes);
+  }
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  DatagramSink mSink;
+  void* mUserData;
+  OscOptions mOptions;
+  FusedTransformKernel mTransform; // yup2zup and leftHanded of mOptions
+  const NtpClock* mClock;
+
+  WorkerPool* mPool;
+
+  // Bundle header and start of frame messages, and end of frame messages.
+  uint8_t mHeader[FRAME_MESSAGES_SIZE];
+  uint8_t mTrailer[FRAME_MESSAGES_SIZE];
+  OscEncoder mHeaderEncoder;
+  OscEncoder mTrailerEncoder;
+
+  int mBufferSize;               // size of every shard buffer
+  std::vector<Shard*> mShards;   // indexed by ShardIndex
+
+  // Frame being encoded, shared with the shard tasks; the Frame of
+  // EncodeFrame.
+  const void* mFrame;
+  int32_t mTimestamp;            // milliseconds of the day
+
+  // Frame encoded last.
+  OscFragment mFragments[MAX_FRAGMENTS];
+  int mFragmentCount;
+  int mEncodedSize;
+
+  OscBundlePacker mPacker;
+  RateScheduler mRates;
+  RigidBodyBlob mBlob;           // rigid bodies of the frame in blob mode
+
+  // Encoded addresses by streaming ID and the skeleton shards sorted by
+  // skeleton ID, guarded by mDescriptionLock.
+  std::mutex mDescriptionLock;
+  OscAddressCache mCache;
+  std::vector<SkeletonAssignment> mSkeletonAssignments;
+  std::atomic<bool> mDescriptionsStale;
+
+  // Encoded marker addresses by marker ID; each only touched by the shard
+  // encoding those markers.
+  OscMarkerAddressCache mOtherMarkerAddresses;
+  OscMarkerAddressCache mLabeledMarkerAddresses;
+
+  uint64_t mFramesSent;
+  uint64_t mFramesDropped;
+  uint64_t mDatagramsSent;
+};
+
+#endif // _OSCWRITER_H_
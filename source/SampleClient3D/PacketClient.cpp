@@ -0,0 +1,294 @@
+#ifdef _WIN32
+#  include <winsock2.h>   // must include before windows.h or ws2tcpip.h
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <errno.h>
+#  include <netinet/in.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include "PacketClient.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PacketClient implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+#ifdef _WIN32
+  const PacketSocket kInvalidSocket = (PacketSocket)INVALID_SOCKET;
+
+  void CloseSocket(PacketSocket s) { closesocket((SOCKET)s); }
+#else
+  const PacketSocket kInvalidSocket = -1;
+
+  void CloseSocket(PacketSocket s) { close(s); }
+#endif
+
+  // Size of the sPacket header (iMessage + nDataBytes).
+  const int kPacketHeaderSize = 4;
+
+  // Socket receive buffer; a few hundred large frames.
+  const int kReceiveBufferSize = 4 * 1024 * 1024;
+
+  // True if the last socket call failed without breaking the socket
+  // (interrupted by a signal, or nothing queued after all).
+  bool IsTransientError()
+  {
+#ifdef _WIN32
+    const int error = WSAGetLastError();
+    return error == WSAEINTR || error == WSAEWOULDBLOCK;
+#else
+    return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+  }
+}
+
+
+PacketClient::PacketClient()
+  :mSocket(kInvalidSocket),
+  mBuffers(new uint8_t[BATCH_SIZE * sizeof(sPacket)]),
+  mReassembler(&PacketClient::OnReassembled, this),
+  mCapture(nullptr),
+  mRunning(false),
+  mDatagrams(0),
+  mBatches(0),
+  mMalformed(0)
+{
+  memset(mHandlers, 0, sizeof(mHandlers));
+  memset(&mDefaultHandler, 0, sizeof(mDefaultHandler));
+}
+
+PacketClient::~PacketClient()
+{
+  Close();
+  delete[] mBuffers;
+}
+
+bool PacketClient::Open(const char* localAddress, const char* multicastAddress, uint16_t port)
+{
+  Close();
+
+#ifdef _WIN32
+  static WSADATA WsaData;
+  if (WSAStartup(0x202, &WsaData) != 0)
+    return false;
+#endif
+
+  PacketSocket s = (PacketSocket)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (s == kInvalidSocket)
+    return false;
+
+  int value = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&value, sizeof(value));
+  value = kReceiveBufferSize;
+  setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&value, sizeof(value));
+
+  in_addr local;
+  local.s_addr = htonl(INADDR_ANY);
+  if (localAddress != nullptr && inet_pton(AF_INET, localAddress, &local) != 1)
+  {
+    CloseSocket(s);
+    return false;
+  }
+
+  // Multicast receivers bind to any address so the group traffic is
+  // delivered; unicast receivers bind to the requested interface.
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (multicastAddress != nullptr) ? htonl(INADDR_ANY) : local.s_addr;
+  if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0)
+  {
+    CloseSocket(s);
+    return false;
+  }
+
+  if (multicastAddress != nullptr)
+  {
+    ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_interface = local;
+    if (inet_pton(AF_INET, multicastAddress, &mreq.imr_multiaddr) != 1 ||
+      setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) != 0)
+    {
+      CloseSocket(s);
+      return false;
+    }
+  }
+
+  mSocket = s;
+  return true;
+}
+
+void PacketClient::Close()
+{
+  mRunning = false;
+  if (mThread.joinable())
+    mThread.join();
+
+  if (mSocket != kInvalidSocket)
+  {
+    CloseSocket(mSocket);
+    mSocket = kInvalidSocket;
+  }
+}
+
+uint16_t PacketClient::LocalPort() const
+{
+  if (mSocket == kInvalidSocket)
+    return 0;
+
+  sockaddr_in addr;
+  socklen_t length = sizeof(addr);
+  if (getsockname(mSocket, (sockaddr*)&addr, &length) != 0)
+    return 0;
+  return ntohs(addr.sin_port);
+}
+
+void PacketClient::SetHandler(uint16_t messageID, PacketHandler handler, void* pUserData)
+{
+  if (messageID >= MAX_MESSAGE_ID)
+    return;
+  mHandlers[messageID].handler = handler;
+  mHandlers[messageID].pUserData = pUserData;
+}
+
+void PacketClient::SetDefaultHandler(PacketHandler handler, void* pUserData)
+{
+  mDefaultHandler.handler = handler;
+  mDefaultHandler.pUserData = pUserData;
+}
+
+bool PacketClient::Dispatch(const void* data, int bytes)
+{
+  if (FrameReassembler::IsFragment(data, bytes))
+    return mReassembler.Add(data, bytes);
+  return DispatchPacket(data, bytes);
+}
+
+bool PacketClient::OnReassembled(const uint8_t* data, int bytes, void* pUserData)
+{
+  return ((PacketClient*)pUserData)->DispatchPacket(data, bytes);
+}
+
+bool PacketClient::DispatchPacket(const void* data, int bytes)
+{
+  const sPacket* packet = (const sPacket*)data;
+  if (bytes < kPacketHeaderSize || packet->nDataBytes > bytes - kPacketHeaderSize)
+  {
+    mMalformed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const HandlerEntry& entry = (packet->iMessage < MAX_MESSAGE_ID && mHandlers[packet->iMessage].handler != nullptr)
+    ? mHandlers[packet->iMessage]
+    : mDefaultHandler;
+  if (entry.handler != nullptr)
+    entry.handler(packet, entry.pUserData);
+  return true;
+}
+
+int PacketClient::Poll(int timeoutMs)
+{
+  if (mSocket == kInvalidSocket)
+    return -1;
+
+#ifdef _WIN32
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET((SOCKET)mSocket, &readSet);
+  timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+  int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+  if (ready < 0)
+    return IsTransientError() ? 0 : -1;
+  if (ready == 0)
+    return 0;
+
+  // no recvmmsg on Windows - drain what is queued one datagram at a time
+  u_long nonBlocking = 1;
+  ioctlsocket((SOCKET)mSocket, FIONBIO, &nonBlocking);
+  int received = 0;
+  for (; received < BATCH_SIZE; received++)
+  {
+    int bytes = recvfrom((SOCKET)mSocket, (char*)mBuffers, sizeof(sPacket), 0, nullptr, nullptr);
+    if (bytes == SOCKET_ERROR)
+      break;
+    if (mCapture != nullptr)
+      mCapture->Write(mBuffers, bytes, CaptureWriter::Now());
+    Dispatch(mBuffers, bytes);
+  }
+  nonBlocking = 0;
+  ioctlsocket((SOCKET)mSocket, FIONBIO, &nonBlocking);
+#else
+  pollfd pfd;
+  pfd.fd = mSocket;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int ready = poll(&pfd, 1, timeoutMs);
+  if (ready < 0)
+    return IsTransientError() ? 0 : -1;
+  if (ready == 0)
+    return 0;
+
+  mmsghdr msgs[BATCH_SIZE];
+  iovec iovecs[BATCH_SIZE];
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < BATCH_SIZE; i++)
+  {
+    iovecs[i].iov_base = mBuffers + i * sizeof(sPacket);
+    iovecs[i].iov_len = sizeof(sPacket);
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int received = recvmmsg(mSocket, msgs, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+  if (received < 0)
+    return IsTransientError() ? 0 : -1;
+
+  if (mCapture != nullptr)
+  {
+    // one timestamp for the whole batch
+    const uint64_t receiveTimeNs = CaptureWriter::Now();
+    for (int i = 0; i < received; i++)
+      mCapture->Write(iovecs[i].iov_base, (int)msgs[i].msg_len, receiveTimeNs);
+  }
+
+  for (int i = 0; i < received; i++)
+    Dispatch(iovecs[i].iov_base, (int)msgs[i].msg_len);
+#endif
+
+  if (received > 0)
+  {
+    mDatagrams.fetch_add(received, std::memory_order_relaxed);
+    mBatches.fetch_add(1, std::memory_order_relaxed);
+  }
+  return received;
+}
+
+bool PacketClient::Start()
+{
+  if (mSocket == kInvalidSocket || mRunning.exchange(true))
+    return false;
+  mThread = std::thread(&PacketClient::ReceiveThread, this);
+  return true;
+}
+
+void PacketClient::ReceiveThread()
+{
+  while (mRunning)
+  {
+    // only a broken socket ends the thread; Poll retries interrupted waits
+    int received = Poll(100);
+    if (received < 0)
+      break;
+    if (received == 0)
+      mReassembler.ExpireStale();
+  }
+}
@@ -0,0 +1,172 @@
+#ifndef _PACKETCLIENT_H_
+#define _PACKETCLIENT_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#include "NatNetTypes.h"
+#include "FrameReassembler.h"
+#include "CaptureWriter.h"
+
+// Native socket handle (SOCKET on Windows, file descriptor elsewhere). Kept
+// opaque so this header does not pull in winsock.
+#ifdef _WIN32
+typedef uintptr_t PacketSocket;
+#else
+typedef int PacketSocket;
+#endif
+
+// Receives a complete, length checked NatNet packet.
+typedef void (*PacketHandler)(const sPacket* packet, void* pUserData);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Native NatNet packet client for the data port. Joins the multicast
+/// group (or listens for unicast), receives <c>sPacket</c> datagrams and
+/// dispatches each one to the handler registered for its message ID
+/// (<c>NAT_FRAMEOFDATA</c>, <c>NAT_MODELDEF</c>, <c>NAT_KEEPALIVE</c>, ...).
+/// </summary>
+/// <remarks>
+/// On Linux datagrams are received in batches of up to BATCH_SIZE with a
+/// single <c>recvmmsg</c> call. Other platforms fall back to one
+/// <c>recvfrom</c> per datagram. The receive buffers are allocated once
+/// when the client is constructed.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class PacketClient
+{
+public:
+  // Maximum number of datagrams received per system call.
+  static const int BATCH_SIZE = 32;
+
+  // Handlers can be registered for message IDs below this value.
+  static const int MAX_MESSAGE_ID = NAT_UNRECOGNIZED_REQUEST + 1;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  PacketClient();
+  ~PacketClient();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Opens the data socket.</summary>
+  /// <param name='localAddress'>Local interface address, or nullptr for
+  /// any interface.</param>
+  /// <param name='multicastAddress'>Multicast group to join (e.g.
+  /// NATNET_DEFAULT_MULTICAST_ADDRESS), or nullptr for unicast.</param>
+  /// <param name='port'>Data port.</param>
+  /// <returns>false if the socket could not be set up.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Open(const char* localAddress, const char* multicastAddress, uint16_t port = NATNET_DEFAULT_PORT_DATA);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Stops the receive thread and closes the socket.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Close();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the local port the socket is bound to, 0 if closed.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  uint16_t LocalPort() const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Registers the handler for one message ID. Passing nullptr
+  /// removes it.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetHandler(uint16_t messageID, PacketHandler handler, void* pUserData = nullptr);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Registers the handler for all message IDs without a
+  /// handler of their own.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetDefaultHandler(PacketHandler handler, void* pUserData = nullptr);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Records every received datagram, before it is dispatched,
+  /// to an open capture writer. Passing nullptr stops recording. Must not
+  /// be called while the receive thread is running.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetCapture(CaptureWriter* capture) { mCapture = capture; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Waits up to <c>timeoutMs</c> for datagrams, receives one
+  /// batch and dispatches it.</summary>
+  /// <returns>Number of datagrams received (0 on timeout, signal
+  /// interruption or a spurious wakeup), or -1 if the socket is broken.
+  /// </returns>
+  //////////////////////////////////////////////////////////////////////////
+  int Poll(int timeoutMs);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Validates a raw datagram and dispatches it by message ID.
+  /// Fragments of frames split by FrameFragmenter are reassembled first;
+  /// the packet is dispatched when its last fragment arrives.
+  /// </summary>
+  /// <param name='data'>Datagram bytes (sPacket header and payload).</param>
+  /// <param name='bytes'>Number of bytes in the datagram.</param>
+  /// <returns>false if the datagram is shorter than its header claims or
+  /// is a malformed, late or duplicate fragment.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Dispatch(const void* data, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts a thread calling Poll until Close is called.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool Start();
+
+  // statistics
+  uint64_t DatagramCount() const { return mDatagrams.load(std::memory_order_relaxed); }
+  uint64_t BatchCount() const { return mBatches.load(std::memory_order_relaxed); }
+  uint64_t MalformedCount() const { return mMalformed.load(std::memory_order_relaxed); }
+  // Reassembly statistics; only consistent when read on the receiving thread.
+  const FrameReassembler& Reassembler() const { return mReassembler; }
+
+private:
+  PacketClient(const PacketClient&);
+  PacketClient& operator=(const PacketClient&);
+
+  void ReceiveThread();
+  bool DispatchPacket(const void* data, int bytes);
+  static bool OnReassembled(const uint8_t* data, int bytes, void* pUserData);
+
+  struct HandlerEntry
+  {
+    PacketHandler handler;
+    void* pUserData;
+  };
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  PacketSocket mSocket;
+
+  // BATCH_SIZE receive buffers of sizeof(sPacket) bytes each.
+  uint8_t* mBuffers;
+
+  HandlerEntry mHandlers[MAX_MESSAGE_ID];
+  HandlerEntry mDefaultHandler;
+
+  // Only touched by the thread calling Dispatch.
+  FrameReassembler mReassembler;
+
+  CaptureWriter* mCapture;
+
+  std::thread mThread;
+  std::atomic<bool> mRunning;
+
+  std::atomic<uint64_t> mDatagrams;
+  std::atomic<uint64_t> mBatches;
+  std::atomic<uint64_t> mMalformed;
+};
+
+#endif // _PACKETCLIENT_H_
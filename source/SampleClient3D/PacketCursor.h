@@ -0,0 +1,92 @@
+#ifndef _PACKETCURSOR_H_
+#define _PACKETCURSOR_H_
+
+#include <stdint.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Unaligned read of a little endian value from a NatNet packet.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+template<typename T>
+inline T PacketRead(const uint8_t* p)
+{
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Bounds checked forward cursor over a NatNet packet payload. Reading or
+/// skipping past the end clears <c>ok</c>; all further reads return zero,
+/// so a decoder only has to check <c>ok</c> once at the end.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+struct PacketCursor
+{
+  const uint8_t* begin;
+  int pos;
+  int size;
+  bool ok;
+
+  PacketCursor(const uint8_t* data, int bytes)
+    : begin(data), pos(0), size(bytes), ok(true)
+  {
+  }
+
+  const uint8_t* Current() const { return begin + pos; }
+
+  bool Skip(int64_t bytes)
+  {
+    if (!ok || bytes < 0 || pos + bytes > size)
+      ok = false;
+    else
+      pos += (int)bytes;
+    return ok;
+  }
+
+  template<typename T>
+  T Read()
+  {
+    T value = T();
+    if (Skip(sizeof(T)))
+      memcpy(&value, begin + pos - sizeof(T), sizeof(T));
+    return value;
+  }
+
+  // Copies <c>bytes</c> bytes into <c>dst</c>.
+  bool Copy(void* dst, int64_t bytes)
+  {
+    if (!Skip(bytes))
+      return false;
+    memcpy(dst, begin + pos - bytes, (size_t)bytes);
+    return true;
+  }
+
+  // Reads an element count and validates it against <c>max</c>.
+  int32_t ReadCount(int32_t max)
+  {
+    int32_t n = Read<int32_t>();
+    if (n < 0 || n > max)
+      ok = false;
+    return ok ? n : 0;
+  }
+
+  // Skips a null terminated string and returns it (nullptr on error).
+  const char* ReadString()
+  {
+    const void* end = ok ? memchr(begin + pos, 0, size - pos) : nullptr;
+    if (end == nullptr)
+    {
+      ok = false;
+      return nullptr;
+    }
+    const char* str = (const char*)(begin + pos);
+    pos = (int)((const uint8_t*)end - begin) + 1;
+    return str;
+  }
+};
+
+#endif // _PACKETCURSOR_H_
@@ -0,0 +1,255 @@
+#include <float.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define POSEEULER_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define POSEEULER_SSE2
+#endif
+
+#include "PoseEuler.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseEulerXYZr implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  const float kPi = 3.14159265358979f;
+  const float kHalfPi = 1.57079632679490f;
+  const float kQuarterPi = 0.785398163397448f;
+  const float kThreeQuarterPi = 2.35619449019234f;
+  // multiples of pi/4 less their float values above
+  const float kPiLow = -8.742278e-8f;
+  const float kHalfPiLow = -4.371139e-8f;
+  const float kQuarterPiLow = -2.185570e-8f;
+  const float kThreeQuarterPiLow = -5.962440e-9f;
+  const float kTanEighthPi = 0.414213562373095f;
+
+  // Lanes of the kernel; M is the type of a comparison result.
+#ifdef POSEEULER_AVX2
+  struct Avx2EulerLanes
+  {
+    typedef __m256 V;
+    typedef __m256 M;
+    static const int WIDTH = 8;
+
+    static V Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V Set1(float f) { return _mm256_set1_ps(f); }
+    static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V Min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V Max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V Neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static V Abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static V CopySign(V a, V b)
+    {
+      const __m256 sign = _mm256_set1_ps(-0.0f);
+      return _mm256_or_ps(_mm256_andnot_ps(sign, a), _mm256_and_ps(sign, b));
+    }
+    static M Greater(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M Less(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static V Select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  };
+#endif
+
+#ifdef POSEEULER_SSE2
+  struct Sse2EulerLanes
+  {
+    typedef __m128 V;
+    typedef __m128 M;
+    static const int WIDTH = 4;
+
+    static V Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V Set1(float f) { return _mm_set1_ps(f); }
+    static V Add(V a, V b) { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm_div_ps(a, b); }
+    static V Sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V Min(V a, V b) { return _mm_min_ps(a, b); }
+    static V Max(V a, V b) { return _mm_max_ps(a, b); }
+    static V Neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static V Abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static V CopySign(V a, V b)
+    {
+      const __m128 sign = _mm_set1_ps(-0.0f);
+      return _mm_or_ps(_mm_andnot_ps(sign, a), _mm_and_ps(sign, b));
+    }
+    static M Greater(V a, V b) { return _mm_cmpgt_ps(a, b); }
+    static M Less(V a, V b) { return _mm_cmplt_ps(a, b); }
+    static V Select(M m, V a, V b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+  };
+#endif
+
+  // Min and Max pick as minps and maxps do.
+  struct ScalarEulerLanes
+  {
+    typedef float V;
+    typedef bool M;
+    static const int WIDTH = 1;
+
+    static V Load(const float* p) { return *p; }
+    static void Store(float* p, V v) { *p = v; }
+    static V Set1(float f) { return f; }
+    static V Add(V a, V b) { return a + b; }
+    static V Sub(V a, V b) { return a - b; }
+    static V Mul(V a, V b) { return a * b; }
+    static V Div(V a, V b) { return a / b; }
+    static V Sqrt(V a) { return sqrtf(a); }
+    static V Min(V a, V b) { return a < b ? a : b; }
+    static V Max(V a, V b) { return a > b ? a : b; }
+    static V Neg(V a) { return -a; }
+    static V Abs(V a) { return fabsf(a); }
+    static V CopySign(V a, V b) { return copysignf(a, b); }
+    static M Greater(V a, V b) { return a > b; }
+    static M Less(V a, V b) { return a < b; }
+    static V Select(M m, V a, V b) { return m ? a : b; }
+  };
+
+  // atan2 by octant reduction to atan(t), |t| <= tan(pi/8), and Cephes'
+  // atanf polynomial. atan(a) for a = min/max above tan(pi/8) is
+  // pi/4 + atan((a - 1) / (a + 1)), one division either way. The result
+  // is a multiple of pi/4 plus or minus atan(t), with the multiple in two
+  // parts so only the last addition rounds.
+  template<class Lanes>
+  typename Lanes::V Atan2(typename Lanes::V y, typename Lanes::V x)
+  {
+    typedef typename Lanes::V V;
+    typedef typename Lanes::M M;
+    const V absY = Lanes::Abs(y);
+    const V absX = Lanes::Abs(x);
+    const V low = Lanes::Min(absY, absX);
+    const V high = Lanes::Max(absY, absX);
+
+    const M upper = Lanes::Greater(low, Lanes::Mul(Lanes::Set1(kTanEighthPi), high));
+    const V num = Lanes::Select(upper, Lanes::Sub(low, high), low);
+    const V den = Lanes::Max(Lanes::Select(upper, Lanes::Add(low, high), high), Lanes::Set1(FLT_MIN));
+    const V t = Lanes::Div(num, den);
+    const V z = Lanes::Mul(t, t);
+
+    V p = Lanes::Set1(8.05374449538e-2f);
+    p = Lanes::Sub(Lanes::Mul(p, z), Lanes::Set1(1.38776856032e-1f));
+    p = Lanes::Add(Lanes::Mul(p, z), Lanes::Set1(1.99777106478e-1f));
+    p = Lanes::Sub(Lanes::Mul(p, z), Lanes::Set1(3.33329491539e-1f));
+    V r = Lanes::Add(Lanes::Mul(Lanes::Mul(p, z), t), t);
+
+    // x < 0 gives pi - angle and |y| > |x| gives pi/2 - angle
+    const V zero = Lanes::Set1(0.0f);
+    const M swapped = Lanes::Greater(absY, absX);
+    const M negative = Lanes::Less(x, zero);
+    V offset = Lanes::Select(negative, Lanes::Set1(kPi), zero);
+    V offsetLow = Lanes::Select(negative, Lanes::Set1(kPiLow), zero);
+    offset = Lanes::Select(swapped, Lanes::Set1(kHalfPi), offset);
+    offsetLow = Lanes::Select(swapped, Lanes::Set1(kHalfPiLow), offsetLow);
+    offset = Lanes::Select(upper, Lanes::Select(negative, Lanes::Set1(kThreeQuarterPi), Lanes::Set1(kQuarterPi)), offset);
+    offsetLow = Lanes::Select(upper, Lanes::Select(negative, Lanes::Set1(kThreeQuarterPiLow), Lanes::Set1(kQuarterPiLow)), offsetLow);
+    r = Lanes::Select(swapped, Lanes::Neg(r), r);
+    r = Lanes::Select(negative, Lanes::Neg(r), r);
+    return Lanes::CopySign(Lanes::Add(offset, Lanes::Add(r, offsetLow)), y);
+  }
+
+  // Angles of whole blocks of Lanes::WIDTH poses from index i on, as
+  // Eul_FromHMatrix for EulOrdXYZr (i = z, j = y, k = x, odd parity,
+  // rotating frame) with its sign flips and swap folded in.
+  // Returns the index of the first pose left.
+  template<class Lanes>
+  int EulerLanes(const float* const* source, int i, int count, float* const* angles)
+  {
+    typedef typename Lanes::V V;
+    typedef typename Lanes::M M;
+    const V zero = Lanes::Set1(0.0f);
+    const V one = Lanes::Set1(1.0f);
+    const V two = Lanes::Set1(2.0f);
+    const V gimbal = Lanes::Set1(16 * FLT_EPSILON);
+
+    for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH)
+    {
+      const V qx = Lanes::Load(source[0] + i);
+      const V qy = Lanes::Load(source[1] + i);
+      const V qz = Lanes::Load(source[2] + i);
+      const V qw = Lanes::Load(source[3] + i);
+
+      const V norm = Lanes::Add(Lanes::Add(Lanes::Add(Lanes::Mul(qx, qx), Lanes::Mul(qy, qy)),
+        Lanes::Mul(qz, qz)), Lanes::Mul(qw, qw));
+      const V s = Lanes::Select(Lanes::Greater(norm, zero), Lanes::Div(two, norm), zero);
+      const V xs = Lanes::Mul(qx, s);
+      const V ys = Lanes::Mul(qy, s);
+      const V zs = Lanes::Mul(qz, s);
+      const V wx = Lanes::Mul(qw, xs);
+      const V wy = Lanes::Mul(qw, ys);
+      const V wz = Lanes::Mul(qw, zs);
+      const V xx = Lanes::Mul(qx, xs);
+      const V xy = Lanes::Mul(qx, ys);
+      const V xz = Lanes::Mul(qx, zs);
+      const V yy = Lanes::Mul(qy, ys);
+      const V yz = Lanes::Mul(qy, zs);
+      const V zz = Lanes::Mul(qz, zs);
+
+      // the matrix elements the order reads, M[row][column]
+      const V mxx = Lanes::Sub(one, Lanes::Add(yy, zz));
+      const V mxy = Lanes::Sub(xy, wz);
+      const V mxz = Lanes::Add(xz, wy);
+      const V myx = Lanes::Add(xy, wz);
+      const V myy = Lanes::Sub(one, Lanes::Add(xx, zz));
+      const V myz = Lanes::Sub(yz, wx);
+      const V mzz = Lanes::Sub(one, Lanes::Add(xx, yy));
+
+      const V cy = Lanes::Sqrt(Lanes::Add(Lanes::Mul(mzz, mzz), Lanes::Mul(myz, myz)));
+      const M regular = Lanes::Greater(cy, gimbal);
+
+      // at gimbal lock pitch is 0 and roll takes the whole rotation
+      const V pitch = Lanes::Select(regular, Lanes::Neg(Atan2<Lanes>(myz, mzz)), Lanes::Neg(zero));
+      const V yaw = Atan2<Lanes>(mxz, cy);
+      const V roll = Lanes::Neg(Atan2<Lanes>(Lanes::Select(regular, mxy, Lanes::Neg(myx)),
+        Lanes::Select(regular, mxx, myy)));
+
+      Lanes::Store(angles[0] + i, pitch);
+      Lanes::Store(angles[1] + i, yaw);
+      Lanes::Store(angles[2] + i, roll);
+    }
+    return i;
+  }
+}
+
+
+void PoseEulerXYZr(const float* qx, const float* qy, const float* qz, const float* qw, int count,
+  float* ax, float* ay, float* az)
+{
+  const float* const source[4] = { qx, qy, qz, qw };
+  float* const angles[3] = { ax, ay, az };
+
+  int i = 0;
+#ifdef POSEEULER_AVX2
+  i = EulerLanes<Avx2EulerLanes>(source, i, count, angles);
+#endif
+#ifdef POSEEULER_SSE2
+  i = EulerLanes<Sse2EulerLanes>(source, i, count, angles);
+#endif
+  EulerLanes<ScalarEulerLanes>(source, i, count, angles);
+}
+
+
+EulerAngles PoseEulerXYZr(Quat q)
+{
+  const float* const source[4] = { &q.x, &q.y, &q.z, &q.w };
+  EulerAngles ea;
+  float* const angles[3] = { &ea.x, &ea.y, &ea.z };
+  EulerLanes<ScalarEulerLanes>(source, 0, 1, angles);
+  ea.w = EulOrdXYZr;
+  return ea;
+}
+
+
+float PoseAtan2(float y, float x)
+{
+  return Atan2<ScalarEulerLanes>(y, x);
+}
@@ -0,0 +1,51 @@
+#ifndef _POSEEULER_H_
+#define _POSEEULER_H_
+
+#include "NATUtils.h"
+#include "PoseTransform.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Euler angles in radians, order EulOrdXYZr (Motive's pitch, yaw, roll),
+/// of <c>count</c> quaternions in structure of arrays layout; the batch
+/// version of <c>Eul_FromQuat(q, EulOrdXYZr)</c>.
+/// </summary>
+/// <remarks>
+/// The rotation matrix elements are built straight from the quaternion,
+/// in float. Angles come from a polynomial atan2 (Cephes' atanf on
+/// |t| &lt;= tan(pi/8) after reduction) with an absolute error below
+/// 2.5e-7 radians; near gimbal lock the same branch as Eul_FromHMatrix is
+/// taken per pose. Poses are processed 8 (AVX2) or 4 (SSE2) at a time
+/// where the build allows and the rest with the same approximation, so a
+/// pose gives the same angles to the bit wherever it falls in the batch.
+/// </remarks>
+/// <param name='ax'>Rotation about x (pitch) of each pose.</param>
+/// <param name='ay'>Rotation about y (yaw) of each pose.</param>
+/// <param name='az'>Rotation about z (roll) of each pose.</param>
+//////////////////////////////////////////////////////////////////////////
+void PoseEulerXYZr(const float* qx, const float* qy, const float* qz, const float* qw, int count,
+  float* ax, float* ay, float* az);
+
+template<int Capacity>
+void PoseEulerXYZr(const PoseArrays<Capacity>& poses, float* ax, float* ay, float* az)
+{
+  PoseEulerXYZr(poses.qx, poses.qy, poses.qz, poses.qw, poses.count, ax, ay, az);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Float version of <c>Eul_FromQuat(q, EulOrdXYZr)</c> for one pose. Gives
+/// the same bits as the batch version for the same quaternion.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+EulerAngles PoseEulerXYZr(Quat q);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// The polynomial atan2 of PoseEulerXYZr, within 2.5e-7 radians of
+/// atan2.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+float PoseAtan2(float y, float x);
+
+#endif // _POSEEULER_H_
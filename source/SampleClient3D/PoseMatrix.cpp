@@ -0,0 +1,234 @@
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define POSEMATRIX_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define POSEMATRIX_SSE2
+#endif
+
+#include "PoseMatrix.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseMatrices implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Matrix elements are computed one vector per element across the poses
+  // of a block; StoreMatrices transposes them into one matrix per pose.
+#ifdef POSEMATRIX_AVX2
+  struct Avx2MatrixLanes
+  {
+    typedef __m256 V;
+    typedef __m256 M;
+    static const int WIDTH = 8;
+
+    static V Load(const float* p) { return _mm256_loadu_ps(p); }
+    static V Set1(float f) { return _mm256_set1_ps(f); }
+    static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V Neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static M NotEqual(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+    static V Select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+
+    // Each group of 4 elements is one column of all 8 matrices: 4x4
+    // transposes within the 128 bit halves give the column of poses 0-3
+    // in the low and of poses 4-7 in the high halves. Two columns are
+    // then joined per store.
+    static void StoreMatrices(const V* e, float* out)
+    {
+      __m256 u[4][4];
+      for (int c = 0; c < 4; c++)
+      {
+        const __m256 t0 = _mm256_unpacklo_ps(e[4 * c], e[4 * c + 1]);
+        const __m256 t1 = _mm256_unpackhi_ps(e[4 * c], e[4 * c + 1]);
+        const __m256 t2 = _mm256_unpacklo_ps(e[4 * c + 2], e[4 * c + 3]);
+        const __m256 t3 = _mm256_unpackhi_ps(e[4 * c + 2], e[4 * c + 3]);
+        u[c][0] = _mm256_shuffle_ps(t0, t2, 0x44);
+        u[c][1] = _mm256_shuffle_ps(t0, t2, 0xEE);
+        u[c][2] = _mm256_shuffle_ps(t1, t3, 0x44);
+        u[c][3] = _mm256_shuffle_ps(t1, t3, 0xEE);
+      }
+      for (int k = 0; k < 4; k++)
+      {
+        for (int c = 0; c < 4; c += 2)
+        {
+          _mm256_storeu_ps(out + 16 * k + 4 * c, _mm256_permute2f128_ps(u[c][k], u[c + 1][k], 0x20));
+          _mm256_storeu_ps(out + 16 * (k + 4) + 4 * c, _mm256_permute2f128_ps(u[c][k], u[c + 1][k], 0x31));
+        }
+      }
+    }
+  };
+#endif
+
+#ifdef POSEMATRIX_SSE2
+  struct Sse2MatrixLanes
+  {
+    typedef __m128 V;
+    typedef __m128 M;
+    static const int WIDTH = 4;
+
+    static V Load(const float* p) { return _mm_loadu_ps(p); }
+    static V Set1(float f) { return _mm_set1_ps(f); }
+    static V Add(V a, V b) { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V Div(V a, V b) { return _mm_div_ps(a, b); }
+    static V Neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static M NotEqual(V a, V b) { return _mm_cmpneq_ps(a, b); }
+    static V Select(M m, V a, V b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+    static void StoreMatrices(const V* e, float* out)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        __m128 r0 = e[4 * c], r1 = e[4 * c + 1], r2 = e[4 * c + 2], r3 = e[4 * c + 3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out + 4 * c, r0);
+        _mm_storeu_ps(out + 16 + 4 * c, r1);
+        _mm_storeu_ps(out + 32 + 4 * c, r2);
+        _mm_storeu_ps(out + 48 + 4 * c, r3);
+      }
+    }
+  };
+#endif
+
+  struct ScalarMatrixLanes
+  {
+    typedef float V;
+    typedef bool M;
+    static const int WIDTH = 1;
+
+    static V Load(const float* p) { return *p; }
+    static V Set1(float f) { return f; }
+    static V Add(V a, V b) { return a + b; }
+    static V Sub(V a, V b) { return a - b; }
+    static V Mul(V a, V b) { return a * b; }
+    static V Div(V a, V b) { return a / b; }
+    static V Neg(V a) { return -a; }
+    static M NotEqual(V a, V b) { return a != b; }
+    static V Select(M m, V a, V b) { return m ? a : b; }
+
+    static void StoreMatrices(const V* e, float* out)
+    {
+      for (int i = 0; i < 16; i++)
+        out[i] = e[i];
+    }
+  };
+
+  // Matrices of whole blocks of Lanes::WIDTH poses from index i on.
+  // Returns the index of the first pose left.
+  template<class Lanes>
+  int MatrixLanes(const float* const* source, int i, int count, float* matrices, float* inverses)
+  {
+    typedef typename Lanes::V V;
+    typedef typename Lanes::M M;
+    const V zero = Lanes::Set1(0.0f);
+    const V one = Lanes::Set1(1.0f);
+    const V two = Lanes::Set1(2.0f);
+
+    for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH)
+    {
+      const V tx = Lanes::Load(source[0] + i);
+      const V ty = Lanes::Load(source[1] + i);
+      const V tz = Lanes::Load(source[2] + i);
+      const V qx = Lanes::Load(source[3] + i);
+      const V qy = Lanes::Load(source[4] + i);
+      const V qz = Lanes::Load(source[5] + i);
+      const V qw = Lanes::Load(source[6] + i);
+
+      // products in QaternionToRotationMatrix's order, (2 * a) * b
+      const V x2 = Lanes::Mul(two, qx);
+      const V y2 = Lanes::Mul(two, qy);
+      const V z2 = Lanes::Mul(two, qz);
+      const V w2 = Lanes::Mul(two, qw);
+      const V xx = Lanes::Mul(x2, qx);
+      const V yy = Lanes::Mul(y2, qy);
+      const V zz = Lanes::Mul(z2, qz);
+      const V xy = Lanes::Mul(x2, qy);
+      const V xz = Lanes::Mul(x2, qz);
+      const V yz = Lanes::Mul(y2, qz);
+      const V wx = Lanes::Mul(w2, qx);
+      const V wy = Lanes::Mul(w2, qy);
+      const V wz = Lanes::Mul(w2, qz);
+
+      // rotation, column major
+      const V r0 = Lanes::Sub(Lanes::Sub(one, yy), zz);
+      const V r1 = Lanes::Add(xy, wz);
+      const V r2 = Lanes::Sub(xz, wy);
+      const V r3 = Lanes::Sub(xy, wz);
+      const V r4 = Lanes::Sub(Lanes::Sub(one, xx), zz);
+      const V r5 = Lanes::Add(yz, wx);
+      const V r6 = Lanes::Add(xz, wy);
+      const V r7 = Lanes::Sub(yz, wx);
+      const V r8 = Lanes::Sub(Lanes::Sub(one, xx), yy);
+
+      const V m[16] =
+      {
+        r0, r1, r2, zero,
+        r3, r4, r5, zero,
+        r6, r7, r8, zero,
+        tx, ty, tz, one
+      };
+      Lanes::StoreMatrices(m, matrices + 16 * i);
+
+      if (inverses != nullptr)
+      {
+        // R^-1 as the adjugate over the determinant: R^T for unit
+        // quaternions and the inverse of the matrix given for any other.
+        // a0 to a8 are the cofactors of R in R^-1's column major order.
+        const V a0 = Lanes::Sub(Lanes::Mul(r4, r8), Lanes::Mul(r7, r5));
+        const V a1 = Lanes::Sub(Lanes::Mul(r7, r2), Lanes::Mul(r1, r8));
+        const V a2 = Lanes::Sub(Lanes::Mul(r1, r5), Lanes::Mul(r4, r2));
+        const V a3 = Lanes::Sub(Lanes::Mul(r6, r5), Lanes::Mul(r3, r8));
+        const V a4 = Lanes::Sub(Lanes::Mul(r0, r8), Lanes::Mul(r6, r2));
+        const V a5 = Lanes::Sub(Lanes::Mul(r3, r2), Lanes::Mul(r0, r5));
+        const V a6 = Lanes::Sub(Lanes::Mul(r3, r7), Lanes::Mul(r6, r4));
+        const V a7 = Lanes::Sub(Lanes::Mul(r6, r1), Lanes::Mul(r0, r7));
+        const V a8 = Lanes::Sub(Lanes::Mul(r0, r4), Lanes::Mul(r3, r1));
+        const V det = Lanes::Add(Lanes::Add(Lanes::Mul(r0, a0), Lanes::Mul(r3, a1)), Lanes::Mul(r6, a2));
+
+        // a singular matrix gives zeros, as the general inverse did
+        const M regular = Lanes::NotEqual(det, zero);
+        const V s = Lanes::Select(regular, Lanes::Div(one, det), zero);
+        const V i0 = Lanes::Mul(a0, s), i1 = Lanes::Mul(a1, s), i2 = Lanes::Mul(a2, s);
+        const V i3 = Lanes::Mul(a3, s), i4 = Lanes::Mul(a4, s), i5 = Lanes::Mul(a5, s);
+        const V i6 = Lanes::Mul(a6, s), i7 = Lanes::Mul(a7, s), i8 = Lanes::Mul(a8, s);
+
+        // -R^-1 t: each component is a row of R^-1 dotted with t
+        const V ix = Lanes::Neg(Lanes::Add(Lanes::Add(Lanes::Mul(i0, tx), Lanes::Mul(i3, ty)), Lanes::Mul(i6, tz)));
+        const V iy = Lanes::Neg(Lanes::Add(Lanes::Add(Lanes::Mul(i1, tx), Lanes::Mul(i4, ty)), Lanes::Mul(i7, tz)));
+        const V iz = Lanes::Neg(Lanes::Add(Lanes::Add(Lanes::Mul(i2, tx), Lanes::Mul(i5, ty)), Lanes::Mul(i8, tz)));
+        const V inv[16] =
+        {
+          i0, i1, i2, zero,
+          i3, i4, i5, zero,
+          i6, i7, i8, zero,
+          ix, iy, iz, Lanes::Select(regular, one, zero)
+        };
+        Lanes::StoreMatrices(inv, inverses + 16 * i);
+      }
+    }
+    return i;
+  }
+}
+
+
+void PoseMatrices(const float* x, const float* y, const float* z,
+  const float* qx, const float* qy, const float* qz, const float* qw, int count,
+  float* matrices, float* inverses)
+{
+  const float* const source[7] = { x, y, z, qx, qy, qz, qw };
+
+  int i = 0;
+#ifdef POSEMATRIX_AVX2
+  i = MatrixLanes<Avx2MatrixLanes>(source, i, count, matrices, inverses);
+#endif
+#ifdef POSEMATRIX_SSE2
+  i = MatrixLanes<Sse2MatrixLanes>(source, i, count, matrices, inverses);
+#endif
+  MatrixLanes<ScalarMatrixLanes>(source, i, count, matrices, inverses);
+}
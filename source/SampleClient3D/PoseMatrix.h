@@ -0,0 +1,36 @@
+#ifndef _POSEMATRIX_H_
+#define _POSEMATRIX_H_
+
+#include "PoseTransform.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Fills the 4x4 matrices of <c>count</c> poses in structure of arrays
+/// layout and, optionally, their inverses.
+/// </summary>
+/// <remarks>
+/// Matrices are column major, rotation followed by translation, as
+/// NATUtils::QaternionToRotationMatrix gives it and to the same bits.
+/// A pose is [R t], so its inverse is [R^-1 -R^-1 t]: it is built in the
+/// same pass from the rotation already computed, instead of by a general
+/// 4x4 inverse. R^-1 is the adjugate of R over its determinant, which is
+/// R^T for a unit quaternion and the inverse of the matrix given
+/// for any other quaternion; a singular matrix gives an inverse of zeros.
+/// Poses are processed 8 (AVX2) or 4 (SSE2) at a time where the build
+/// allows; all paths give the same result to the bit.
+/// </remarks>
+/// <param name='matrices'>16 * count floats, matrix k at 16 * k.</param>
+/// <param name='inverses'>16 * count floats, or nullptr for none.</param>
+//////////////////////////////////////////////////////////////////////////
+void PoseMatrices(const float* x, const float* y, const float* z,
+  const float* qx, const float* qy, const float* qz, const float* qw, int count,
+  float* matrices, float* inverses);
+
+template<int Capacity>
+void PoseMatrices(const PoseArrays<Capacity>& poses, float* matrices, float* inverses)
+{
+  PoseMatrices(poses.x, poses.y, poses.z, poses.qx, poses.qy, poses.qz, poses.qw, poses.count,
+    matrices, inverses);
+}
+
+#endif // _POSEMATRIX_H_
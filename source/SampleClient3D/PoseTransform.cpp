@@ -0,0 +1,28 @@
+#include "PoseTransform.h"
+
+//////////////////////////////////////////////////////////////////////////
+// PoseTransform implementation
+//////////////////////////////////////////////////////////////////////////
+
+PoseTransform::PoseTransform(uint32_t conversions, float scale)
+{
+  Set(conversions, scale);
+}
+
+void PoseTransform::Set(uint32_t conversions, float scale)
+{
+  mConversions = conversions;
+  mScale = scale;
+  mIdentity = conversions == 0 && scale == 1.0f;
+
+  // the up axis conversions are exclusive, z-up to y-up wins
+  const UpAxisConversion upAxis = (conversions & Conversion_ZUpToYUp) ? UpAxis_ZUpToYUp :
+    (conversions & Conversion_YUpToZUp) ? UpAxis_YUpToZUp : UpAxis_Same;
+  mKernel = SelectFusedTransformKernel(upAxis, (conversions & Conversion_LeftHanded) != 0, scale != 1.0f);
+}
+
+void PoseTransform::Apply(float* x, float* y, float* z, float* qx, float* qy, float* qz, float* qw, int count) const
+{
+  if (!mIdentity)
+    mKernel(x, y, z, qx, qy, qz, qw, count, mScale);
+}
@@ -0,0 +1,115 @@
+#ifndef _POSETRANSFORM_H_
+#define _POSETRANSFORM_H_
+
+#include <stdint.h>
+
+#include "TransformPolicy.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Poses in structure of arrays layout, as the batch kernels take them.
+/// Rotations are quaternions x, y, z, w.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+template<int Capacity>
+struct PoseArrays
+{
+  static const int CAPACITY = Capacity;
+
+  int count;
+  float x[Capacity];
+  float y[Capacity];
+  float z[Capacity];
+  float qx[Capacity];
+  float qy[Capacity];
+  float qz[Capacity];
+  float qw[Capacity];
+
+  PoseArrays() : count(0) {}
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Change of coordinate system applied to whole arrays of positions and
+/// rotations in one pass: up axis swap, handedness flip and unit scale.
+/// </summary>
+/// <remarks>
+/// Set picks the FusedTransform instantiation of the conversions
+/// (TransformPolicy.h), which has the coefficients built in. Its kernel
+/// uses AVX2 when the build targets it (/arch:AVX2, -mavx2), SSE2 on any
+/// other x86 build and plain C++ elsewhere; all paths give the same
+/// result to the bit.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class PoseTransform
+{
+public:
+  // Conversions, applied in this order. Several can be combined, except
+  // for the two up axis conversions; given both, only z-up to y-up is
+  // applied.
+  enum Conversion
+  {
+    // Motive z-up to the viewer's y-up: positions (x, z, -y), rotations
+    // followed by -90 degrees about x (as the sample client's renderer).
+    Conversion_ZUpToYUp   = 0x01,
+    // y-up to z-up as the OSC yup2zup option: (x, -z, y).
+    Conversion_YUpToZUp   = 0x02,
+    // Mirror x as the OSC leftHanded option.
+    Conversion_LeftHanded = 0x04
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates a transform.</summary>
+  /// <param name='conversions'>Combination of Conversion values.</param>
+  /// <param name='scale'>Factor applied to positions, e.g. the server's
+  /// UnitsToMillimeters.</param>
+  //////////////////////////////////////////////////////////////////////////
+  explicit PoseTransform(uint32_t conversions = 0, float scale = 1.0f);
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  void Set(uint32_t conversions, float scale);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Transforms <c>count</c> poses in place.</summary>
+  /// <param name='qx'>Rotation arrays; all nullptr to transform positions
+  /// only.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void Apply(float* x, float* y, float* z, float* qx, float* qy, float* qz, float* qw, int count) const;
+
+  template<int Capacity>
+  void Apply(PoseArrays<Capacity>& poses) const
+  {
+    Apply(poses.x, poses.y, poses.z, poses.qx, poses.qy, poses.qz, poses.qw, poses.count);
+  }
+
+  // Transforms positions only.
+  void ApplyToPositions(float* x, float* y, float* z, int count) const
+  {
+    Apply(x, y, z, nullptr, nullptr, nullptr, nullptr, count);
+  }
+
+  uint32_t Conversions() const { return mConversions; }
+  float Scale() const { return mScale; }
+
+  bool IsIdentity() const { return mIdentity; }
+
+private:
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  uint32_t mConversions;
+  float mScale;
+  bool mIdentity;
+  FusedTransformKernel mKernel;
+};
+
+#endif // _POSETRANSFORM_H_
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "RateScheduler.h"
+
+//////////////////////////////////////////////////////////////////////////
+// RateScheduler implementation
+//////////////////////////////////////////////////////////////////////////
+
+RateScheduler::RateScheduler()
+{
+  for (int c = 0; c < EntityClass_Count; c++)
+  {
+    mClasses[c].divisor = 1;
+    mClasses[c].phase = 0;
+    mClasses[c].due = true;
+  }
+}
+
+bool RateScheduler::LessById(const Window& window, int32_t id)
+{
+  return window.id < id;
+}
+
+void RateScheduler::SetDivisor(EntityClass entityClass, int divisor)
+{
+  Class& c = mClasses[entityClass];
+  c.divisor = divisor > 1 ? divisor : 1;
+  c.phase = 0;
+  c.windows.clear();
+}
+
+bool RateScheduler::Averaging() const
+{
+  for (int c = 0; c < EntityClass_Count; c++)
+  {
+    if (mClasses[c].divisor > 1)
+      return true;
+  }
+  return false;
+}
+
+void RateScheduler::BeginFrame()
+{
+  // the last frame of each window is the one sent
+  for (int c = 0; c < EntityClass_Count; c++)
+  {
+    Class& cls = mClasses[c];
+    cls.phase++;
+    cls.due = cls.phase >= cls.divisor;
+    if (cls.due)
+      cls.phase = 0;
+  }
+}
+
+void RateScheduler::Add(EntityClass entityClass, int32_t id, const float* p, const float* q, bool tracked)
+{
+  Class& c = mClasses[entityClass];
+  if (c.divisor == 1)
+    return;
+
+  std::vector<Window>::iterator it = std::lower_bound(c.windows.begin(), c.windows.end(), id, LessById);
+  if (it == c.windows.end() || it->id != id)
+  {
+    Window window;
+    memset(&window, 0, sizeof(window));
+    window.id = id;
+    it = c.windows.insert(it, window);
+  }
+
+  if (!tracked)
+    return;
+
+  it->p[0] += p[0];
+  it->p[1] += p[1];
+  it->p[2] += p[2];
+
+  if (q != nullptr)
+  {
+    // q and -q are the same rotation; flip poses into the hemisphere of
+    // the running sum so they do not cancel out
+    float sign = 1.0f;
+    if (it->count > 0 && q[0] * it->q[0] + q[1] * it->q[1] + q[2] * it->q[2] + q[3] * it->q[3] < 0.0f)
+      sign = -1.0f;
+    it->q[0] += sign * q[0];
+    it->q[1] += sign * q[1];
+    it->q[2] += sign * q[2];
+    it->q[3] += sign * q[3];
+  }
+
+  it->count++;
+}
+
+void RateScheduler::Mean(EntityClass entityClass, int32_t id, float* p, float* q, bool& tracked) const
+{
+  const Class& c = mClasses[entityClass];
+  if (c.divisor == 1)
+    return;
+
+  std::vector<Window>::const_iterator it = std::lower_bound(c.windows.begin(), c.windows.end(), id, LessById);
+  if (it == c.windows.end() || it->id != id)
+    return;
+
+  tracked = it->count > 0;
+  if (!tracked)
+    return;
+
+  const float scale = 1.0f / (float)it->count;
+  p[0] = it->p[0] * scale;
+  p[1] = it->p[1] * scale;
+  p[2] = it->p[2] * scale;
+
+  if (q != nullptr)
+  {
+    const float norm = sqrtf(it->q[0] * it->q[0] + it->q[1] * it->q[1] + it->q[2] * it->q[2] + it->q[3] * it->q[3]);
+    if (norm > 1e-6f)
+    {
+      q[0] = it->q[0] / norm;
+      q[1] = it->q[1] / norm;
+      q[2] = it->q[2] / norm;
+      q[3] = it->q[3] / norm;
+    }
+  }
+}
+
+void RateScheduler::EndFrame()
+{
+  for (int c = 0; c < EntityClass_Count; c++)
+  {
+    Class& cls = mClasses[c];
+    if (!cls.due)
+      continue;
+    for (size_t i = 0; i < cls.windows.size(); i++)
+    {
+      Window& window = cls.windows[i];
+      window.count = 0;
+      memset(window.p, 0, sizeof(window.p));
+      memset(window.q, 0, sizeof(window.q));
+    }
+  }
+}
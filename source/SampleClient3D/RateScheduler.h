@@ -0,0 +1,114 @@
+#ifndef _RATESCHEDULER_H_
+#define _RATESCHEDULER_H_
+
+#include <stdint.h>
+#include <vector>
+
+// Entity classes with their own output rate.
+enum EntityClass
+{
+  EntityClass_RigidBody = 0,
+  EntityClass_Skeleton,          // skeleton bones
+  EntityClass_Marker,            // labeled and unlabeled markers
+  EntityClass_Count
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Output rate of each entity class of one destination, as a divisor of
+/// the frame rate. A decimated class is not sampled: every frame adds the
+/// pose of each entity to a window, and when the class is due the mean
+/// of the window is sent (mean position, normalized mean quaternion).
+/// Slow receivers get less jitter and no aliasing of fast motion.
+/// </summary>
+/// <remarks>
+/// Per frame, call BeginFrame, Add for every entity, Mean for the
+/// entities written in due classes, then EndFrame. Entities are keyed by
+/// streaming ID within a class. Windows are kept in vectors sorted by ID
+/// and only allocate when an ID is seen for the first time.
+///
+/// Averaging delays a decimated class by half its window.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class RateScheduler
+{
+public:
+  //*************************************************************************
+  // Constructors
+  //
+
+  RateScheduler();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends a class every <c>divisor</c> frames; 1 sends every
+  /// frame. Discards the windows of the class.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetDivisor(EntityClass entityClass, int divisor);
+  int Divisor(EntityClass entityClass) const { return mClasses[entityClass].divisor; }
+
+  // True if any class is decimated, i.e. Add has to be called.
+  bool Averaging() const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Advances to the next frame.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void BeginFrame();
+
+  // True if the class is sent this frame.
+  bool Due(EntityClass entityClass) const { return mClasses[entityClass].due; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Adds a pose to the window of an entity. No-op for classes
+  /// sent every frame.</summary>
+  /// <param name='q'>Rotation x, y, z, w; nullptr for markers.</param>
+  /// <param name='tracked'>Untracked poses are left out of the mean.
+  /// </param>
+  //////////////////////////////////////////////////////////////////////////
+  void Add(EntityClass entityClass, int32_t id, const float* p, const float* q, bool tracked);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Replaces a pose by the mean of its window. Leaves it as is
+  /// for classes sent every frame or entities without a window.</summary>
+  /// <param name='tracked'>Set to whether any pose of the window was
+  /// tracked.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void Mean(EntityClass entityClass, int32_t id, float* p, float* q, bool& tracked) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Empties the windows of the classes sent this frame.
+  /// </summary>
+  //////////////////////////////////////////////////////////////////////////
+  void EndFrame();
+
+private:
+  struct Window
+  {
+    int32_t id;
+    int count;                   // tracked poses added
+    float p[3];                  // sums
+    float q[4];
+  };
+
+  struct Class
+  {
+    int divisor;
+    int phase;                   // frames since the class was last sent
+    bool due;
+    std::vector<Window> windows; // sorted by id
+  };
+
+  static bool LessById(const Window& window, int32_t id);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  Class mClasses[EntityClass_Count];
+};
+
+#endif // _RATESCHEDULER_H_
@@ -0,0 +1,31 @@
+#include <cstring>
+
+#include "RigidBodyBlob.h"
+
+//////////////////////////////////////////////////////////////////////////
+// RigidBodyBlob implementation
+//////////////////////////////////////////////////////////////////////////
+
+// The arrays are copied as they are in memory, which is the blob layout
+// on the little endian hosts the client runs on.
+void RigidBodyBlob::Write(uint8_t* out, uint32_t flags, int32_t frame, int32_t timestamp) const
+{
+  RigidBodyBlobHeader header;
+  header.magic = RigidBodyBlobHeader::MAGIC;
+  header.version = RigidBodyBlobHeader::VERSION;
+  header.headerSize = (uint16_t)sizeof(header);
+  header.count = (uint32_t)mCount;
+  header.flags = flags;
+  header.frame = frame;
+  header.timestamp = timestamp;
+  memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+
+  const void* arrays[ARRAY_COUNT] = { mIds, mFlags, mX, mY, mZ, mQx, mQy, mQz, mQw };
+  const size_t bytes = 4 * (size_t)mCount;
+  for (int i = 0; i < ARRAY_COUNT; i++)
+  {
+    memcpy(out, arrays[i], bytes);
+    out += bytes;
+  }
+}
@@ -0,0 +1,115 @@
+#ifndef _RIGIDBODYBLOB_H_
+#define _RIGIDBODYBLOB_H_
+
+#include <stdint.h>
+
+#include "NatNetTypes.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Header of the rigid body blob sent in blob mode as the single argument
+/// of "/rigidbodies". All fields are little endian.
+/// </summary>
+/// <remarks>
+/// The header is followed by <c>count</c> elements of each array, in this
+/// order: int32 id, int32 flags (bit 0: tracked), then float x, y, z,
+/// qx, qy, qz, qw. Arrays start on 4 byte boundaries, so a receiver can
+/// map them straight onto the blob. Positions and rotations are already
+/// transformed as selected by the flags of the header. Receivers should
+/// skip <c>headerSize</c> bytes and reject major versions they do not
+/// know; fields may be appended to the header within a major version.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+struct RigidBodyBlobHeader
+{
+  static const uint32_t MAGIC = 0x4252424E;    // "NBRB"
+  static const uint16_t VERSION = 0x0100;      // major 1, minor 0
+
+  // flags
+  static const uint32_t FLAG_YUP2ZUP = 0x01;
+  static const uint32_t FLAG_LEFTHANDED = 0x02;
+
+  uint32_t magic;
+  uint16_t version;              // major in the high byte
+  uint16_t headerSize;           // bytes before the first array
+  uint32_t count;                // elements per array
+  uint32_t flags;
+  int32_t frame;                 // NatNet frame number
+  int32_t timestamp;             // milliseconds, as in the sparck messages
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Rigid body poses of one frame as structure of arrays, the layout of
+/// the blob (see RigidBodyBlobHeader).
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+class RigidBodyBlob
+{
+public:
+  // Number of arrays in the blob.
+  static const int ARRAY_COUNT = 9;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  RigidBodyBlob() : mCount(0) {}
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  void Clear() { mCount = 0; }
+  int Count() const { return mCount; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Appends a rigid body. Ignored once MAX_RIGIDBODIES are
+  /// stored.</summary>
+  /// <param name='q'>Rotation x, y, z, w.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void Add(int32_t id, bool tracked, const float* p, const float* q)
+  {
+    if (mCount == MAX_RIGIDBODIES)
+      return;
+    mIds[mCount] = id;
+    mFlags[mCount] = tracked ? 1 : 0;
+    mX[mCount] = p[0];
+    mY[mCount] = p[1];
+    mZ[mCount] = p[2];
+    mQx[mCount] = q[0];
+    mQy[mCount] = q[1];
+    mQz[mCount] = q[2];
+    mQw[mCount] = q[3];
+    mCount++;
+  }
+
+  // Size of the blob in bytes.
+  int Size() const { return (int)sizeof(RigidBodyBlobHeader) + ARRAY_COUNT * 4 * mCount; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Writes header and arrays to <c>out</c>, which has room for
+  /// Size() bytes.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Write(uint8_t* out, uint32_t flags, int32_t frame, int32_t timestamp) const;
+
+private:
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  int mCount;
+
+  int32_t mIds[MAX_RIGIDBODIES];
+  int32_t mFlags[MAX_RIGIDBODIES];
+  float mX[MAX_RIGIDBODIES];
+  float mY[MAX_RIGIDBODIES];
+  float mZ[MAX_RIGIDBODIES];
+  float mQx[MAX_RIGIDBODIES];
+  float mQy[MAX_RIGIDBODIES];
+  float mQz[MAX_RIGIDBODIES];
+  float mQw[MAX_RIGIDBODIES];
+};
+
+#endif // _RIGIDBODYBLOB_H_
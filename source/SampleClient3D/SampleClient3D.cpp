@@ -39,9 +39,28 @@
 #include "RigidBodyCollection.h"
 #include "MarkerPositionCollection.h"
 #include "OpenGLDrawingFunctions.h"
-
+#include "FrameDecoder.h"
+#include "FramePool.h"
+#include "FrameSubscription.h"
+#include "FrameView.h"
+#include "CaptureReader.h"
+#include "PacketClient.h"
+#include "LatencyMonitor.h"
+#include "OscWriter.h"
+#include "PoseEuler.h"
+#include "PoseTransform.h"
+#include "SharedFrameWriter.h"
+#include "SkeletonHierarchy.h"
+#include "UdpFanout.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <math.h>
 
@@ -69,18 +88,112 @@ RigidBodyCollection rigidBodies;
 
 std::map<int, std::string> mapIDToName;
 
+// Recycled frames handed from the NatNet callback thread to the frame
+// processing thread.
+FramePool framePool;
+std::thread frameThread;
+std::atomic<bool> frameThreadRunning(false);
+
+// Frame sections the viewer consumes. Toggled from the keyboard; takes
+// effect with the next frame.
+SubscriptionMask subscription;
+
+// Frames received as raw NatNet packets of the stream's bitstream version.
+// The outputs read them through a view of the packet, reused for every
+// packet; only the viewer's sections are decoded, straight into a pool
+// frame.
+struct PacketFrameSource
+{
+    FrameDecodeFn decode;
+    uint8_t version[4];
+    FrameView view;
+    CompactFrame* spare;   // pool frame a packet failed to decode into
+};
+
+// Native receiver of the multicast data stream (/packetClient). NatNetClient
+// still connects, fetches the descriptions and syncs the host clock; the
+// frames are received here in batches instead of through its callback.
+bool usePacketClient = false;
+PacketClient packetClient;
+PacketFrameSource liveFrames;
+
+// Capture file the packet client records every datagram to (/capture <file>).
+const char* capturePath = nullptr;
+CaptureWriter captureWriter;
+
+// Capture file replayed instead of a live connection (/replay <file>).
+CaptureReader captureReader;
+PacketFrameSource replayFrames;
+std::thread replayThread;
+std::atomic<bool> replayRunning(false);
+
+// Longest pause between two datagrams that is replayed, and the longest the
+// replay thread sleeps before checking whether it was stopped.
+const uint64_t kMaxReplayGapNs = 1000000000;
+const std::chrono::milliseconds kReplaySleepStep(50);
+
+// Latency of every stage from camera exposure to our output.
+LatencyMonitor latency;
+
+// Maps Motive host timestamps to NTP time for the OSC bundle timetags.
+NtpClock hostClock;
+
+// OSC destination given on the command line ("address:port") and the
+// entity class rates it receives; -1 takes the global rate.
+struct OscDestination
+{
+    std::string address;
+    int rigidBodyModulo;
+    int skeletonModulo;
+    int markerModulo;
+};
+
+// One OSC writer per distinct set of rates, and the fanout destinations
+// (bits) it sends to.
+struct OscOutput
+{
+    OscWriter* writer;
+    uint32_t destinations;
+};
+
+// OSC output of the live frames (/oscSendIP, /oscDestination), empty if
+// disabled. Every frame is encoded once per output and all datagrams of
+// the frame go out in one fanout batch.
+UdpFanout* oscFanout = nullptr;
+std::vector<OscOutput> oscOutputs;
+
+// Threads encoding the shards of large frames (/encoderThreads), shared by
+// all writers; nullptr encodes on the NatNet thread only.
+WorkerPool* oscPool = nullptr;
+
+// Shared memory ring of the live frames for consumers on this host
+// (/sharedMemory), read with SharedFrameReader.h.
+SharedFrameWriter frameRing;
+
+// Bone hierarchy of the skeleton descriptions; turns bones streamed
+// relative to their parents (/skeletonLocal, /skeletonRestOffsets) into
+// world poses to draw.
+SkeletonHierarchy skeletonHierarchy;
+
 // Ready to render?
 bool render = true;
 
 // Show rigidbody info
 bool showText = true;
 
+// Show latency percentiles
+bool showLatency = false;
+
 // Used for converting NatNet data to the proper units.
 float unitConversion = 1.0f;
 
 // World Up Axis (default to Y)
 int upAxis = 1; // 
 
+// Converts rigid bodies and labeled markers to the renderer's millimeters
+// and Y-up in one batch per frame; set from unitConversion and upAxis.
+PoseTransform viewTransform;
+
 // NatNet server IP address.
 int IPAddress[4] = { 127, 0, 0, 1 };
 
@@ -103,9 +216,30 @@ void RenderOGLScene();
 void Update(HWND hWnd);
 // NatNet
 void NATNET_CALLCONV DataHandler(sFrameOfMocapData* data, void* pUserData);    // receives data from the server
+void RecordHostTimestamps(uint64_t cameraMidExposure, uint64_t transmit);
+void HandleFrame(const sFrameOfMocapData& data, uint64_t receiveTime);
+void HandlePacketFrame(const sPacket* packet, PacketFrameSource& source, uint64_t receiveTime);
+template<class Frame>
+uint32_t EncodeOutputs(const Frame& frame);
+void SendOutputs(uint32_t encodedOutputs, uint64_t processedTime);
+bool StartPacketClient(const char* localAddress, const sServerDescription& server);
+void PacketFrameHandler(const sPacket* packet, void* pUserData);
 void NATNET_CALLCONV MessageHandler(Verbosity msgType, const char* msg);      // receives NatNet error messages
 bool InitNatNet(LPSTR szIPAddress, LPSTR szServerIPAddress, ConnectionType connType);
 bool ParseRigidBodyDescription(sDataDescriptions* pDataDefs);
+void RefreshDescriptions();
+void StartFrameThread();
+void StopFrameThread();
+void FrameThread();
+void ProcessFrame(const CompactFrame& frame);
+bool StartReplay(const char* path);
+void StopReplay();
+void ReplayThread();
+bool ReplaySleepUntil(std::chrono::steady_clock::time_point due);
+void ReplayFrameHandler(const sPacket* packet, void* pUserData);
+bool ParseCommandLine(int argc, char** argv);
+bool StartOsc(const std::vector<OscDestination>& destinations, const OscOptions& options);
+void StopOsc();
 
 //****************************************************************************
 //
@@ -141,6 +275,9 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     if (!InitInstance(hInstance, nCmdShow))
         return false;
 
+    if (!ParseCommandLine(__argc, __argv))
+        return false;
+
     MSG msg;
     while (true)
     {
@@ -254,7 +391,15 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
     case WM_TIMER:
         if (wParam == ID_RENDERTIMER)
+        {
+            latency.Update();
+            bool descriptionsStale = false;
+            for (size_t i = 0; i < oscOutputs.size(); i++)
+                descriptionsStale = oscOutputs[i].writer->TakeDescriptionsStale() || descriptionsStale;
+            if (descriptionsStale)
+                RefreshDescriptions();
             Update(hWnd);
+        }
         break;
 
     case WM_KEYDOWN:
@@ -295,6 +440,22 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         case 't':
             showText = !showText;
             break;
+        case 'M':
+        case 'm':
+            subscription.Toggle(FrameSection_MarkerSets | FrameSection_OtherMarkers | FrameSection_LabeledMarkers);
+            break;
+        case 'R':
+        case 'r':
+            subscription.Toggle(FrameSection_RigidBodies);
+            break;
+        case 'K':
+        case 'k':
+            subscription.Toggle(FrameSection_Skeletons);
+            break;
+        case 'L':
+        case 'l':
+            showLatency = !showLatency;
+            break;
         }
         InvalidateRect(hWnd, NULL, TRUE);
     }
@@ -342,7 +503,13 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     {
         HDC hDC = GetDC(hWnd);
         wglMakeCurrent(hDC, openGLRenderContext);
+        packetClient.Close();
+        captureWriter.Close();
         natnetClient.Disconnect();
+        StopOsc();
+        frameRing.Close();
+        StopReplay();
+        StopFrameThread();
         wglMakeCurrent(0, 0);
         wglDeleteContext(openGLRenderContext);
         ReleaseDC(hWnd, hDC);
@@ -357,6 +524,224 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     return 0;
 }
 
+// Parses the command line:
+//   /replay <capture file>      replay a capture file instead of connecting
+//   /packetClient               receive multicast frames with the native packet client
+//   /capture <capture file>     record the received datagrams (implies /packetClient)
+//   /oscSendIP <address>        send live frames as OSC to this address
+//   /oscSendPort <port>         receiving port of the OSC address
+//   /oscDestination <addr:port> another OSC destination, may be repeated
+//   /oscMode <modes>            OSC format (max, isadora, touch, sparck, ambi, blob)
+//   /frameModulo <n>            send every n-th frame
+//   /rigidBodyModulo <n>        send rigid bodies every n-th frame, averaged
+//   /skeletonModulo <n>         same for skeleton bones
+//   /markerModulo <n>           same for markers
+//   /bundleSize <bytes>         largest OSC bundle sent with /bundled
+//   /deadBand                   send only rigid bodies and bones that moved
+//   /deadBandPosition <mm>      smallest movement sent (default 1)
+//   /deadBandRotation <deg>     smallest rotation sent (default 0.5)
+//   /keyframeInterval <frames>  resend unchanged poses after n frames (default 120)
+//   /encoderThreads <n>         extra threads encoding large frames (default 0)
+//   /sharedMemory <name>        publish live frames to a shared memory ring
+//   /skeletonLocal              Motive streams skeleton bones in local coordinates
+//   /skeletonRestOffsets        same, bones drawn at their description offsets
+//   /sendSkeletons, /sendMarkerInfo, /sendOtherMarkerInfo, /yup2zup,
+//   /leftHanded, /matrix, /invMatrix, /bundled
+// The OSC options match those of the NatNetThree2OSC bridge (see readme.md).
+// The rigid body, skeleton and marker rates given after an /oscDestination
+// apply to that destination only.
+bool ParseCommandLine(int argc, char** argv)
+{
+    const char* replayPath = nullptr;
+    const char* oscAddress = nullptr;
+    const char* ringName = nullptr;
+    int oscPort = 0;
+    std::vector<OscDestination> oscDestinations;
+    OscOptions oscOptions;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool usedValue = false;
+
+        if (_stricmp(arg, "/replay") == 0 && value)
+            replayPath = value, usedValue = true;
+        else if (_stricmp(arg, "/packetClient") == 0)
+            usePacketClient = true;
+        else if (_stricmp(arg, "/capture") == 0 && value)
+            capturePath = value, usePacketClient = true, usedValue = true;
+        else if (_stricmp(arg, "/sharedMemory") == 0 && value)
+            ringName = value, usedValue = true;
+        else if (_stricmp(arg, "/skeletonLocal") == 0)
+            skeletonHierarchy.SetSpace(SkeletonHierarchy::Space_Local, false);
+        else if (_stricmp(arg, "/skeletonRestOffsets") == 0)
+            skeletonHierarchy.SetSpace(SkeletonHierarchy::Space_Local, true);
+        else if (_stricmp(arg, "/oscSendIP") == 0 && value)
+            oscAddress = value, usedValue = true;
+        else if (_stricmp(arg, "/oscSendPort") == 0 && value)
+            oscPort = atoi(value), usedValue = true;
+        else if (_stricmp(arg, "/oscDestination") == 0 && value)
+        {
+            OscDestination destination = { value, -1, -1, -1 };
+            oscDestinations.push_back(destination);
+            usedValue = true;
+        }
+        else if (_stricmp(arg, "/rigidBodyModulo") == 0 && value)
+        {
+            (oscDestinations.empty() ? oscOptions.rigidBodyModulo : oscDestinations.back().rigidBodyModulo) = atoi(value);
+            usedValue = true;
+        }
+        else if (_stricmp(arg, "/skeletonModulo") == 0 && value)
+        {
+            (oscDestinations.empty() ? oscOptions.skeletonModulo : oscDestinations.back().skeletonModulo) = atoi(value);
+            usedValue = true;
+        }
+        else if (_stricmp(arg, "/markerModulo") == 0 && value)
+        {
+            (oscDestinations.empty() ? oscOptions.markerModulo : oscDestinations.back().markerModulo) = atoi(value);
+            usedValue = true;
+        }
+        else if (_stricmp(arg, "/oscMode") == 0 && value)
+            oscOptions.modes = OscOptions::ParseModes(value), usedValue = true;
+        else if (_stricmp(arg, "/bundleSize") == 0 && value)
+            oscOptions.bundleSize = atoi(value), usedValue = true;
+        else if (_stricmp(arg, "/deadBandPosition") == 0 && value)
+            oscOptions.deadBandPosition = (float)atof(value), usedValue = true;
+        else if (_stricmp(arg, "/deadBandRotation") == 0 && value)
+            oscOptions.deadBandRotation = (float)atof(value), usedValue = true;
+        else if (_stricmp(arg, "/keyframeInterval") == 0 && value)
+            oscOptions.keyframeInterval = atoi(value), usedValue = true;
+        else if (_stricmp(arg, "/encoderThreads") == 0 && value)
+            oscOptions.encoderThreads = atoi(value), usedValue = true;
+        else if (_stricmp(arg, "/frameModulo") == 0 && value)
+            oscOptions.frameModulo = atoi(value), usedValue = true;
+        else if (_stricmp(arg, "/sendSkeletons") == 0)
+            oscOptions.sendSkeletons = true;
+        else if (_stricmp(arg, "/sendMarkerInfo") == 0)
+            oscOptions.sendMarkerInfo = true;
+        else if (_stricmp(arg, "/sendOtherMarkerInfo") == 0)
+            oscOptions.sendOtherMarkerInfo = true;
+        else if (_stricmp(arg, "/yup2zup") == 0)
+            oscOptions.yup2zup = true;
+        else if (_stricmp(arg, "/leftHanded") == 0)
+            oscOptions.leftHanded = true;
+        else if (_stricmp(arg, "/matrix") == 0)
+            oscOptions.matrix = true;
+        else if (_stricmp(arg, "/invMatrix") == 0)
+            oscOptions.invMatrix = true;
+        else if (_stricmp(arg, "/bundled") == 0)
+            oscOptions.bundled = true;
+        else if (_stricmp(arg, "/deadBand") == 0)
+            oscOptions.deadBand = true;
+        else
+        {
+            MessageBox(NULL, arg, "Unknown command line option", MB_OK);
+            return false;
+        }
+
+        if (usedValue)
+            i++;
+    }
+
+    if (oscAddress != nullptr)
+    {
+        if (oscPort <= 0 || oscPort > 65535)
+        {
+            MessageBox(NULL, "/oscSendIP needs a valid /oscSendPort", "Invalid OSC options", MB_OK);
+            return false;
+        }
+        OscDestination destination = { std::string(oscAddress) + ":" + std::to_string(oscPort), -1, -1, -1 };
+        oscDestinations.insert(oscDestinations.begin(), destination);
+    }
+
+    if (!oscDestinations.empty())
+    {
+        if (oscOptions.modes == 0)
+        {
+            MessageBox(NULL, "OSC output needs a valid /oscMode", "Invalid OSC options", MB_OK);
+            return false;
+        }
+        if (!StartOsc(oscDestinations, oscOptions))
+            return false;
+    }
+
+    if (ringName != nullptr)
+    {
+        if (!frameRing.Create(ringName, oscOptions))
+            MessageBox(NULL, ringName, "Failed to create shared memory ring", MB_OK);
+        frameRing.SetClock(&hostClock);
+    }
+
+    if (replayPath != nullptr && !StartReplay(replayPath))
+        MessageBox(NULL, replayPath, "Failed to open capture", MB_OK);
+
+    return true;
+}
+
+// Opens the OSC output. Destinations with the same rates share a writer, so
+// their frames are encoded once. Frames are encoded and sent from
+// DataHandler.
+bool StartOsc(const std::vector<OscDestination>& destinations, const OscOptions& options)
+{
+    StopOsc();
+    oscFanout = new UdpFanout();
+    if (options.encoderThreads > 0)
+        oscPool = new WorkerPool(options.encoderThreads);
+    for (size_t i = 0; i < destinations.size(); i++)
+    {
+        const OscDestination& destination = destinations[i];
+        const size_t colon = destination.address.rfind(':');
+        if (colon == std::string::npos ||
+            !oscFanout->AddDestination(destination.address.substr(0, colon).c_str(), atoi(destination.address.c_str() + colon + 1)))
+        {
+            MessageBox(NULL, destination.address.c_str(), "Invalid OSC destination", MB_OK);
+            StopOsc();
+            return false;
+        }
+
+        OscOptions rates = options;
+        if (destination.rigidBodyModulo > 0)
+            rates.rigidBodyModulo = destination.rigidBodyModulo;
+        if (destination.skeletonModulo > 0)
+            rates.skeletonModulo = destination.skeletonModulo;
+        if (destination.markerModulo > 0)
+            rates.markerModulo = destination.markerModulo;
+
+        size_t output = 0;
+        while (output < oscOutputs.size())
+        {
+            const OscOptions& other = oscOutputs[output].writer->Options();
+            if (other.rigidBodyModulo == rates.rigidBodyModulo && other.skeletonModulo == rates.skeletonModulo &&
+                other.markerModulo == rates.markerModulo)
+                break;
+            output++;
+        }
+        if (output == oscOutputs.size())
+        {
+            OscOutput newOutput = { new OscWriter(UdpFanoutSink, oscFanout), 0 };
+            newOutput.writer->SetOptions(rates);
+            newOutput.writer->SetClock(&hostClock);
+            newOutput.writer->SetWorkerPool(oscPool);
+            oscOutputs.push_back(newOutput);
+        }
+        oscOutputs[output].destinations |= 1u << i;
+    }
+    return true;
+}
+
+// Closes the OSC output. The NatNet client must be disconnected first.
+void StopOsc()
+{
+    for (size_t i = 0; i < oscOutputs.size(); i++)
+        delete oscOutputs[i].writer;
+    oscOutputs.clear();
+    delete oscFanout;
+    oscFanout = nullptr;
+    delete oscPool;
+    oscPool = nullptr;
+}
+
 // Update OGL window
 void Update(HWND hwnd)
 {
@@ -391,29 +776,6 @@ void ConvertRHSPosZupToYUp(float& x, float& y, float& z)
     z = -yOriginal;
 }
 
-void ConvertRHSRotZUpToYUp(float& qx, float& qy, float& qz, float& qw)
-{
-    // -90 deg rotation about +X
-    float qRx, qRy, qRz, qRw;
-    float angle = -90.0f * MATH_PI / 180.0f;
-    qRx = sin(angle / 2.0f);
-    qRy = 0.0f;
-    qRz = 0.0f;
-    qRw = cos(angle / 2.0f);
-
-    // rotate quat using quat multiply
-    float qxNew, qyNew, qzNew, qwNew;
-    qxNew = qw*qRx + qx*qRw + qy*qRz - qz*qRy;
-    qyNew = qw*qRy - qx*qRz + qy*qRw + qz*qRx;
-    qzNew = qw*qRz + qx*qRy - qy*qRx + qz*qRw;
-    qwNew = qw*qRw - qx*qRx - qy*qRy - qz*qRz;
-
-    qx = qxNew;
-    qy = qyNew;
-    qz = qzNew;
-    qw = qwNew;
-}
-
 // Render OpenGL scene
 void RenderOGLScene()
 {
@@ -441,6 +803,25 @@ void RenderOGLScene()
     glPrinter.Print(0.0f, 0.0f, szTimecode);
     glPopMatrix();
 
+    // Draw latency percentiles of the last reporting interval
+    if (showLatency)
+    {
+        char szLatency[128];
+        glPushMatrix();
+        glTranslatef(-3200.f, -1350.f, -5000.0f);
+        for (int stage = 0; stage < LatencyStage_Count; stage++)
+        {
+            latency.FormatSummary((LatencyStage)stage, szLatency, sizeof(szLatency));
+            glPrinter.Print(0.0f, -100.0f * stage, szLatency);
+        }
+
+        // frames lost between the receive thread and the viewer
+        glPrinter.Print(0.0f, -100.0f * LatencyStage_Count, "%-20s  %llu published  %llu pool exhausted  %llu overwritten",
+            "frame pool", (unsigned long long)framePool.PublishedCount(),
+            (unsigned long long)framePool.PoolExhaustedCount(), (unsigned long long)framePool.OverwrittenCount());
+        glPopMatrix();
+    }
+
     // Position and rotate the camera
     glTranslatef(g_fEyeX * -1000, g_fEyeY * -1000, g_fEyeZ * -1000);
     glRotatef(g_fRotY, 0, 1, 0);
@@ -472,44 +853,37 @@ void RenderOGLScene()
     float textX = -3200.0f;
     float textY = 2700.0f;
     GLfloat x, y, z;
-    Quat q;
     EulerAngles ea;
-    int order;
+
+    // Convert all rigid bodies to millimeters and, if Motive is streaming
+    // Z-up, to this renderer's Y-up coordinate system in one batch
+    static PoseArrays<RigidBodyCollection::MAX_RIGIDBODY_COUNT> bodyPoses;
+    bodyPoses.count = (int)rigidBodies.Count();
+    for (int i = 0; i < bodyPoses.count; i++)
+    {
+        std::tie(bodyPoses.x[i], bodyPoses.y[i], bodyPoses.z[i]) = rigidBodies.GetCoordinates(i);
+        std::tie(bodyPoses.qx[i], bodyPoses.qy[i], bodyPoses.qz[i], bodyPoses.qw[i]) = rigidBodies.GetQuaternion(i);
+    }
+    viewTransform.Apply(bodyPoses);
+
+    // Convert Motive quaternion output to euler angles, all rigid bodies at once
+    // Motive coordinate conventions : X(Pitch), Y(Yaw), Z(Roll), Relative, RHS
+    static float pitch[RigidBodyCollection::MAX_RIGIDBODY_COUNT];
+    static float yaw[RigidBodyCollection::MAX_RIGIDBODY_COUNT];
+    static float roll[RigidBodyCollection::MAX_RIGIDBODY_COUNT];
+    PoseEulerXYZr(bodyPoses, pitch, yaw, roll);
 
     for (size_t i = 0; i < rigidBodies.Count(); i++)
     {
         // RigidBody position
-        std::tie(x, y, z) = rigidBodies.GetCoordinates(i);
-        // convert to millimeters
-        x *= unitConversion;
-        y *= unitConversion;
-        z *= unitConversion;
+        x = bodyPoses.x[i];
+        y = bodyPoses.y[i];
+        z = bodyPoses.z[i];
 
         // RigidBody orientation
-        GLfloat qx, qy, qz, qw;
-        std::tie(qx, qy, qz, qw) = rigidBodies.GetQuaternion(i);
-        q.x = qx;
-        q.y = qy;
-        q.z = qz;
-        q.w = qw;
-
-        // If Motive is streaming Z-up, convert to this renderer's Y-up coordinate system
-        if (upAxis==2)
-        {
-            // convert position
-            ConvertRHSPosZupToYUp(x, y, z);
-            // convert orientation
-            ConvertRHSRotZUpToYUp(q.x, q.y, q.z, q.w);
-        }
-
-        // Convert Motive quaternion output to euler angles
-        // Motive coordinate conventions : X(Pitch), Y(Yaw), Z(Roll), Relative, RHS
-        order = EulOrdXYZr;
-        ea = Eul_FromQuat(q, order);
-
-        ea.x = NATUtils::RadiansToDegrees(ea.x);
-        ea.y = NATUtils::RadiansToDegrees(ea.y);
-        ea.z = NATUtils::RadiansToDegrees(ea.z);
+        ea.x = NATUtils::RadiansToDegrees(pitch[i]);
+        ea.y = NATUtils::RadiansToDegrees(yaw[i]);
+        ea.z = NATUtils::RadiansToDegrees(roll[i]);
 
         // Draw RigidBody as cube
         glPushAttrib(GL_ALL_ATTRIB_BITS);
@@ -584,22 +958,24 @@ void RenderOGLScene()
     // Draw labeled markers (white)
     glPushAttrib(GL_ALL_ATTRIB_BITS);
     glColor4f(0.8f, 0.8f, 0.8f, 0.8f);
+    static PoseArrays<MarkerPositionCollection::MAX_MARKER_COUNT> labeledPositions;
+    labeledPositions.count = (int)markerPositions.LabeledMarkerPositionCount();
+    for (int i = 0; i < labeledPositions.count; i++)
+    {
+        const sMarker& markerData = markerPositions.GetLabeledMarker(i);
+        labeledPositions.x[i] = markerData.x;
+        labeledPositions.y[i] = markerData.y;
+        labeledPositions.z[i] = markerData.z;
+    }
+    viewTransform.ApplyToPositions(labeledPositions.x, labeledPositions.y, labeledPositions.z, labeledPositions.count);
+
     for (size_t i = 0; i < markerPositions.LabeledMarkerPositionCount(); i++)
     {
         const sMarker& markerData = markerPositions.GetLabeledMarker(i);
-        v[0] = markerData.x * unitConversion;
-        v[1] = markerData.y * unitConversion;
-        v[2] = markerData.z * unitConversion;
         fRadius = markerData.size * unitConversion;
 
-        // If Motive is streaming Z-up, convert to this renderer's Y-up coordinate system
-        if (upAxis == 2)
-        {
-            ConvertRHSPosZupToYUp(v[0], v[1], v[2]);
-        }
-
         glPushMatrix();
-        glTranslatef(v[0], v[1], v[2]);
+        glTranslatef(labeledPositions.x[i], labeledPositions.y[i], labeledPositions.z[i]);
         OpenGLDrawingFunctions::DrawSphere(1, fRadius);
         glPopMatrix();
 
@@ -660,6 +1036,8 @@ LRESULT CALLBACK NatNetDlgProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
             // Try and initialize the NatNet client.
             if (InitNatNet( szMyIPAddress, szServerIPAddress, connType ) == false)
             {
+                packetClient.Close();
+                captureWriter.Close();
                 natnetClient.Disconnect();
                 MessageBox(hDlg, "Failed to connect", "", MB_OK);
             }
@@ -679,11 +1057,22 @@ bool InitNatNet( LPSTR szIPAddress, LPSTR szServerIPAddress, ConnectionType conn
     unsigned char ver[4];
     NatNet_GetVersion(ver);
 
+    // a live connection replaces the replay; both would feed the same outputs
+    StopReplay();
+
+    // frames are processed outside of the NatNet receive thread
+    StartFrameThread();
+
     // Set callback handlers
     // Callback for NatNet messages.
     NatNet_SetLogCallback( MessageHandler );
-    // this function will receive data from the server
-    natnetClient.SetFrameReceivedCallback(DataHandler);
+    // Every connect chooses the receiver anew, so the one of a previous
+    // connection must not keep feeding the outputs next to the new one.
+    // DataHandler receives data from the server, unless the packet client
+    // takes over the data stream once the server is known.
+    packetClient.Close();
+    captureWriter.Close();
+    natnetClient.SetFrameReceivedCallback(usePacketClient ? nullptr : DataHandler);
 
     sNatNetClientConnectParams connectParams;
     connectParams.connectionType = connType;
@@ -706,6 +1095,12 @@ bool InitNatNet( LPSTR szIPAddress, LPSTR szServerIPAddress, ConnectionType conn
             //Unable to connect to server. Host not present
             return false;
         }
+        latency.SetHostClockFrequency(ServerDescription.HighResClockFrequency);
+        hostClock.SetHostClockFrequency(ServerDescription.HighResClockFrequency);
+
+        // unicast servers and unknown bitstreams stay with NatNetClient
+        if (usePacketClient && !StartPacketClient(szIPAddress, ServerDescription))
+            natnetClient.SetFrameReceivedCallback(DataHandler);
     }
 
     // Retrieve RigidBody description from server
@@ -735,13 +1130,29 @@ bool InitNatNet( LPSTR szIPAddress, LPSTR szServerIPAddress, ConnectionType conn
         upAxis = *(long*)response;
     }
 
+    viewTransform.Set(upAxis == 2 ? PoseTransform::Conversion_ZUpToYUp : 0, unitConversion);
+
     return true;
 }
 
+// Fetches the descriptions again after the model list changed. Runs on
+// the UI thread; the frame callback only flags the change.
+void RefreshDescriptions()
+{
+    sDataDescriptions* pDataDefs = NULL;
+    if (natnetClient.GetDataDescriptionList(&pDataDefs) == ErrorCode_OK)
+        ParseRigidBodyDescription(pDataDefs);
+    NatNet_FreeDescriptions( pDataDefs );
+}
+
 bool ParseRigidBodyDescription(sDataDescriptions* pDataDefs)
 {
     mapIDToName.clear();
 
+    for (size_t i = 0; i < oscOutputs.size(); i++)
+        oscOutputs[i].writer->SetDescriptions(pDataDefs);
+    skeletonHierarchy.Build(pDataDefs);
+
     if (pDataDefs == NULL || pDataDefs->nDataDescriptions <= 0)
         return false;
 
@@ -782,37 +1193,335 @@ void NATNET_CALLCONV MessageHandler(Verbosity msgType, const char* msg)
     //	printf("\n[SampleClient] Message received: %s\n", msg);
 }
 
-// NatNet data callback function. Stores rigid body and marker data in the file level 
-// variables markerPositions, and rigidBodies and sets the file level variable render
-// to true. This signals that we have a frame ready to render.
+// NatNet data callback function. Runs on the NatNet receive thread.
 void DataHandler(sFrameOfMocapData* data, void* pUserData)
 {
-    int mcount = min(MarkerPositionCollection::MAX_MARKER_COUNT, data->MocapData->nMarkers);
-    markerPositions.SetMarkerPositions(data->MocapData->Markers, mcount);
+    const uint64_t receiveTime = LatencyMonitor::Now();
+    RecordHostTimestamps(data->CameraMidExposureTimestamp, data->TransmitTimestamp);
+    HandleFrame(*data, receiveTime);
+}
+
+// Feeds the host timestamps of a live frame to the latency histograms and
+// the NTP clock of the OSC timetags.
+void RecordHostTimestamps(uint64_t cameraMidExposure, uint64_t transmit)
+{
+    const double secondsSinceTransmit = natnetClient.SecondsSinceHostTimestamp(transmit);
+    latency.RecordReceived(cameraMidExposure, transmit, secondsSinceTransmit);
+    hostClock.Update(transmit, secondsSinceTransmit);
+}
+
+// Handles a received frame on the thread that received it, so it only copies
+// the subscribed sections of the frame into a recycled pool frame and hands
+// it to the frame thread. Frames arriving while every pool frame is in use
+// are dropped (and counted by the pool) rather than delaying the next
+// datagram. The frame is stamped with its receive time for the latency
+// histograms.
+// With OSC output enabled the frame is also encoded into the OSC writer's
+// preallocated buffer and sent right here, without allocating, to all
+// destinations in one batch. Destinations with their own rates have their
+// own writer. With a shared memory ring the poses are copied into it as
+// well; local consumers then read them without any socket in between.
+// The frame counts as processed once it is encoded, in the ring and in the
+// pool; the send stage starts exactly where that stage ended.
+void HandleFrame(const sFrameOfMocapData& data, uint64_t receiveTime)
+{
+    const uint32_t encodedOutputs = EncodeOutputs(data);
+    framePool.Publish(data, subscription.Get(), receiveTime);
+    const uint64_t processedTime = latency.RecordSince(LatencyStage_CallbackToProcessed, receiveTime);
+    SendOutputs(encodedOutputs, processedTime);
+}
+
+// Handles a frame packet the source's view is attached to like HandleFrame,
+// without a decoded copy of the frame: the outputs read the entities
+// straight from the packet, and only the viewer's sections are decoded,
+// into the pool frame. A pool frame the packet does not decode into is kept
+// for the next packet, as only the frame thread returns frames to the pool.
+void HandlePacketFrame(const sPacket* packet, PacketFrameSource& source, uint64_t receiveTime)
+{
+    const uint32_t encodedOutputs = EncodeOutputs(source.view);
+
+    CompactFrame* frame = source.spare != nullptr ? source.spare : framePool.Acquire();
+    source.spare = nullptr;
+    if (frame != nullptr)
+    {
+        if (source.decode(packet, subscription.Get(), *frame))
+        {
+            frame->SetReceiveTime(receiveTime);
+            framePool.Publish(frame);
+        }
+        else
+            source.spare = frame;
+    }
+
+    const uint64_t processedTime = latency.RecordSince(LatencyStage_CallbackToProcessed, receiveTime);
+    SendOutputs(encodedOutputs, processedTime);
+}
+
+// Encodes a frame (an sFrameOfMocapData or a FrameView) for every OSC output
+// and writes it into the shared memory ring. Returns one bit per output that
+// encoded anything (there are at most 32 destinations).
+template<class Frame>
+uint32_t EncodeOutputs(const Frame& frame)
+{
+    uint32_t encodedOutputs = 0;
+    for (size_t i = 0; i < oscOutputs.size(); i++)
+    {
+        if (oscOutputs[i].writer->Encode(frame) != 0)
+            encodedOutputs |= 1u << i;
+    }
+    frameRing.Write(frame);
+    return encodedOutputs;
+}
+
+// Sends the frame encoded last by the outputs set in encodedOutputs.
+void SendOutputs(uint32_t encodedOutputs, uint64_t processedTime)
+{
+    if (encodedOutputs == 0)
+        return;
+    for (size_t i = 0; i < oscOutputs.size(); i++)
+    {
+        if ((encodedOutputs & (1u << i)) == 0)
+            continue;
+        oscFanout->SetDestinationMask(oscOutputs[i].destinations);
+        oscOutputs[i].writer->Send();
+    }
+    oscFanout->Flush();
+    latency.RecordSince(LatencyStage_ProcessedToSent, processedTime);
+}
+
+// Receives the server's multicast data stream with the packet client. Fails
+// for unicast servers, whose frames only reach the connected NatNetClient,
+// and for bitstream versions without a decoder.
+bool StartPacketClient(const char* localAddress, const sServerDescription& server)
+{
+    if (!server.bConnectionInfoValid || !server.ConnectionMulticast)
+        return false;
+
+    liveFrames.decode = SelectFrameDecoder(server.NatNetVersion);
+    if (liveFrames.decode == nullptr)
+        return false;
+    memcpy(liveFrames.version, server.NatNetVersion, sizeof(liveFrames.version));
+
+    char multicastAddress[16];
+    sprintf_s(multicastAddress, sizeof(multicastAddress), "%d.%d.%d.%d",
+        server.ConnectionMulticastAddress[0], server.ConnectionMulticastAddress[1],
+        server.ConnectionMulticastAddress[2], server.ConnectionMulticastAddress[3]);
+    if (!packetClient.Open(localAddress, multicastAddress, server.ConnectionDataPort))
+        return false;
+
+    // datagrams are recorded before they are dispatched, fragments included
+    packetClient.SetCapture(nullptr);
+    if (capturePath != nullptr)
+    {
+        if (captureWriter.Open(capturePath, server.NatNetVersion))
+            packetClient.SetCapture(&captureWriter);
+        else
+            MessageBox(NULL, capturePath, "Failed to open capture", MB_OK);
+    }
+
+    packetClient.SetHandler(NAT_FRAMEOFDATA, PacketFrameHandler, &liveFrames);
+    return packetClient.Start();
+}
+
+// Frame handler of the packet client, on its receive thread.
+void PacketFrameHandler(const sPacket* packet, void* pUserData)
+{
+    const uint64_t receiveTime = LatencyMonitor::Now();
+    PacketFrameSource* source = (PacketFrameSource*)pUserData;
+    if (!source->view.Attach(packet, source->version))
+        return;
+    RecordHostTimestamps(source->view.CameraMidExposureTimestamp(), source->view.TransmitTimestamp());
+    HandlePacketFrame(packet, *source, receiveTime);
+}
+
+// Starts the thread that processes the frames published by DataHandler.
+void StartFrameThread()
+{
+    if (frameThreadRunning.exchange(true))
+        return;
+    frameThread = std::thread(FrameThread);
+}
+
+// Stops the frame processing thread.
+void StopFrameThread()
+{
+    if (!frameThreadRunning.exchange(false))
+        return;
+    if (frameThread.joinable())
+        frameThread.join();
+}
+
+// Frame processing thread. Only the newest pending frame is processed;
+// stale frames are counted as overwritten by the pool.
+void FrameThread()
+{
+    while (frameThreadRunning)
+    {
+        CompactFrame* frame = framePool.ConsumeLatest();
+        if (frame == nullptr)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            continue;
+        }
+
+        ProcessFrame(*frame);
+        latency.RecordSince(LatencyStage_CallbackToViewer, frame->ReceiveTime());
+        framePool.Release(frame);
+    }
+}
+
+// Maps a capture file and starts replaying it in real time, looping at the end.
+// Captured datagrams go through the same decoding, outputs and frame pool as
+// live data.
+bool StartReplay(const char* path)
+{
+    StopReplay();
+    if (!captureReader.Open(path))
+        return false;
+
+    replayFrames.decode = SelectFrameDecoder(captureReader.BitstreamVersion());
+    if (replayFrames.decode == nullptr)
+    {
+        captureReader.Close();
+        return false;
+    }
+    memcpy(replayFrames.version, captureReader.BitstreamVersion(), sizeof(replayFrames.version));
+
+    StartFrameThread();
+    replayRunning = true;
+    replayThread = std::thread(ReplayThread);
+    return true;
+}
+
+// Stops the replay thread and unmaps the capture file.
+void StopReplay()
+{
+    if (!replayRunning.exchange(false))
+        return;
+    if (replayThread.joinable())
+        replayThread.join();
+    captureReader.Close();
+}
+
+// Replay thread. Datagrams are dispatched at their captured receive times;
+// fragmented frames are reassembled by the dispatcher. Pauses are shortened
+// to kMaxReplayGapNs, and receive times going backwards (where a capture
+// was appended to) are dispatched right away.
+void ReplayThread()
+{
+    PacketClient dispatcher;
+    dispatcher.SetHandler(NAT_FRAMEOFDATA, ReplayFrameHandler, &replayFrames);
+
+    while (replayRunning)
+    {
+        CaptureReader::Record record;
+        if (!captureReader.Next(record))
+        {
+            captureReader.Rewind();
+            if (!captureReader.Next(record))
+                break;
+        }
+
+        uint64_t previousNs = record.receiveTimeNs;
+        std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+        do
+        {
+            if (record.receiveTimeNs > previousNs)
+            {
+                const uint64_t gapNs = record.receiveTimeNs - previousNs;
+                due += std::chrono::nanoseconds(gapNs < kMaxReplayGapNs ? gapNs : kMaxReplayGapNs);
+            }
+            previousNs = record.receiveTimeNs;
+
+            if (!ReplaySleepUntil(due))
+                break;
+            dispatcher.Dispatch(record.data, record.bytes);
+        } while (captureReader.Next(record));
+    }
+}
+
+// Sleeps until due in steps of at most kReplaySleepStep, so StopReplay does
+// not wait for a long pause to end. Returns false if the replay was stopped.
+bool ReplaySleepUntil(std::chrono::steady_clock::time_point due)
+{
+    while (replayRunning)
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= due)
+            return true;
+        const std::chrono::steady_clock::duration wait = due - now;
+        std::this_thread::sleep_for(wait < kReplaySleepStep ? wait : std::chrono::steady_clock::duration(kReplaySleepStep));
+    }
+    return false;
+}
+
+// Frame handler of the replay dispatcher. Replayed frames reach the outputs
+// like live ones; their host timestamps are stale, so only our own
+// processing latency is measured.
+void ReplayFrameHandler(const sPacket* packet, void* pUserData)
+{
+    const uint64_t receiveTime = LatencyMonitor::Now();
+    PacketFrameSource* source = (PacketFrameSource*)pUserData;
+    if (source->view.Attach(packet, source->version))
+        HandlePacketFrame(packet, *source, receiveTime);
+}
+
+// Stores rigid body and marker data in the file level variables markerPositions,
+// and rigidBodies and sets the file level variable render to true. This signals
+// that we have a frame ready to render.
+void ProcessFrame(const CompactFrame& data)
+{
+    int mcount = 0;
+    if (data.MarkerSetCount() > 0)
+    {
+        mcount = min((int)MarkerPositionCollection::MAX_MARKER_COUNT, data.MarkerSetMarkerCount(0));
+        markerPositions.SetMarkerPositions(data.MarkerSetMarkers(0), mcount);
+    }
+    else
+    {
+        markerPositions.SetMarkerPositions(nullptr, 0);
+    }
 
     // labeled markers
-    markerPositions.SetLabledMarkers(data->LabeledMarkers, data->nLabeledMarkers);
+    markerPositions.SetLabledMarkers(data.LabeledMarkers(), data.LabeledMarkerCount());
 
     // unlabeled markers
-    mcount = min(MarkerPositionCollection::MAX_MARKER_COUNT, data->nOtherMarkers);
-    markerPositions.AppendMarkerPositions(data->OtherMarkers, mcount);
+    mcount = min((int)MarkerPositionCollection::MAX_MARKER_COUNT, data.OtherMarkerCount());
+    markerPositions.AppendMarkerPositions(data.OtherMarkers(), mcount);
 
     // rigid bodies
-    int rbcount = min(RigidBodyCollection::MAX_RIGIDBODY_COUNT, data->nRigidBodies);
-    rigidBodies.SetRigidBodyData(data->RigidBodies, rbcount);
+    int rbcount = min((int)RigidBodyCollection::MAX_RIGIDBODY_COUNT, data.RigidBodyCount());
+    rigidBodies.SetRigidBodyData(data.RigidBodies(), rbcount);
 
-    // skeleton segment (bones) as collection of rigid bodies
-    for (int s = 0; s < data->nSkeletons; s++)
+    // skeleton segment (bones) as collection of rigid bodies, in world
+    // coordinates when they are streamed relative to their parents
+    const bool localBones = skeletonHierarchy.StreamedSpace() == SkeletonHierarchy::Space_Local;
+    if (localBones)
     {
-        rigidBodies.AppendRigidBodyData(data->Skeletons[s].RigidBodyData, data->Skeletons[s].nRigidBodies);
+        for (int s = 0; s < data.SkeletonCount(); s++)
+            skeletonHierarchy.SetBones(data.SkeletonID(s), data.SkeletonBones(s), data.SkeletonBoneCount(s));
+        skeletonHierarchy.Solve();
+    }
+    for (int s = 0; s < data.SkeletonCount(); s++)
+    {
+        const sRigidBodyData* bones = data.SkeletonBones(s);
+        int boneCount = data.SkeletonBoneCount(s);
+        if (localBones)
+        {
+            static sRigidBodyData globalBones[MAX_SKELRIGIDBODIES];
+            boneCount = min(boneCount, (int)MAX_SKELRIGIDBODIES);
+            std::copy(bones, bones + boneCount, globalBones);
+            skeletonHierarchy.GetBones(data.SkeletonID(s), globalBones, boneCount, SkeletonHierarchy::Space_Global);
+            bones = globalBones;
+        }
+        rigidBodies.AppendRigidBodyData(bones, boneCount);
     }
 
     // timecode
-    NatNetClient* pClient = (NatNetClient*)pUserData;
     int hour, minute, second, frame, subframe;
-    NatNet_DecodeTimecode( data->Timecode, data->TimecodeSubframe, &hour, &minute, &second, &frame, &subframe );
+    NatNet_DecodeTimecode( data.Timecode(), data.TimecodeSubframe(), &hour, &minute, &second, &frame, &subframe );
     // decode timecode into friendly string
-    NatNet_TimecodeStringify( data->Timecode, data->TimecodeSubframe, szTimecode, 128 );
+    NatNet_TimecodeStringify( data.Timecode(), data.TimecodeSubframe(), szTimecode, 128 );
 
     render = true;
 }
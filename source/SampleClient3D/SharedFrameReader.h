@@ -0,0 +1,275 @@
+#ifndef _SHAREDFRAMEREADER_H_
+#define _SHAREDFRAMEREADER_H_
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SharedFrameRing.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Reads frames from a shared memory frame ring (see SharedFrameRing.h).
+/// Header only and without NatNet dependencies, so consumers such as a
+/// renderer on the bridge host can include it on its own together with
+/// SharedFrameRing.h.
+/// </summary>
+/// <remarks>
+/// The segment is mapped read only and the reader never writes to it, so
+/// any number of readers can follow one writer without coordination.
+/// Next returns the frames in order; a reader that falls more than
+/// <c>slotCount</c> frames behind skips to the oldest frame still in the
+/// ring and counts the skipped frames in FramesLost. Latest skips straight
+/// to the newest frame, for consumers that only draw the current pose.
+/// A frame is copied out of the ring, so it stays valid until the next
+/// call regardless of the writer.
+/// <code>
+/// SharedFrameReader reader;
+/// if (reader.Open("natnet"))
+///   while (reader.Next())
+///     for (uint32_t i = 0; i &lt; reader.Frame().poseCount; i++)
+///       Draw(reader.Poses()[i]);
+/// </code>
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class SharedFrameReader
+{
+public:
+  //*************************************************************************
+  // Constructors
+  //
+
+  SharedFrameReader()
+    : mRing(nullptr), mSize(0),
+#ifdef _WIN32
+    mMapping(nullptr),
+#endif
+    mNext(1), mFramesRead(0), mFramesLost(0)
+  {
+  }
+
+  ~SharedFrameReader()
+  {
+    Close();
+  }
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Maps the ring of the given name. Reading starts with the
+  /// newest frame published.</summary>
+  /// <returns>false if no writer created the ring or its layout is not
+  /// supported.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Open(const char* name)
+  {
+    Close();
+
+#ifdef _WIN32
+    const std::string path = std::string("Local\\") + name;
+    mMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path.c_str());
+    if (mMapping == nullptr)
+      return false;
+    mRing = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (mRing != nullptr && VirtualQuery(mRing, &info, sizeof(info)) != 0)
+      mSize = info.RegionSize;
+#else
+    const std::string path = std::string("/") + name;
+    const int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    void* ring = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(SharedRingHeader))
+      ring = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring != MAP_FAILED)
+    {
+      mRing = (const uint8_t*)ring;
+      mSize = (size_t)st.st_size;
+    }
+#endif
+
+    const SharedRingHeader* header = Header();
+    if (header == nullptr || mSize < sizeof(SharedRingHeader) ||
+      header->magic != SharedRingHeader::MAGIC || header->version != SharedRingHeader::VERSION ||
+      header->slotCount < 2 || (header->slotCount & (header->slotCount - 1)) != 0 ||
+      header->slotSize < SharedSlotSize(header->maxPoses, header->maxMarkers) ||
+      mSize < header->headerSize + (uint64_t)header->slotCount * header->slotSize)
+    {
+      Close();
+      return false;
+    }
+
+    mFrame.resize(header->slotSize);
+    const uint64_t published = header->published.load(std::memory_order_acquire);
+    mNext = published > 0 ? published : 1;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Unmaps the ring.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Close()
+  {
+#ifdef _WIN32
+    if (mRing != nullptr)
+      UnmapViewOfFile(mRing);
+    if (mMapping != nullptr)
+      CloseHandle(mMapping);
+    mMapping = nullptr;
+#else
+    if (mRing != nullptr)
+      munmap((void*)mRing, mSize);
+#endif
+    mRing = nullptr;
+    mSize = 0;
+    mNext = 1;
+  }
+
+  bool IsOpen() const { return mRing != nullptr; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns true once the writer closed the ring. A writer that
+  /// starts again creates a new ring; Open it again.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  bool WriterClosed() const
+  {
+    return mRing == nullptr || Header()->closed.load(std::memory_order_acquire) != 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Copies the frame after the one read last.</summary>
+  /// <returns>false if no newer frame was published.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Next()
+  {
+    if (mRing == nullptr)
+      return false;
+
+    const SharedRingHeader* header = Header();
+    const uint64_t slotCount = header->slotCount;
+    for (;;)
+    {
+      const uint64_t published = header->published.load(std::memory_order_acquire);
+      if (mNext > published)
+        return false;
+
+      // The writer may be overwriting the oldest slot with frame
+      // published + 1; skip to the oldest frame it leaves alone.
+      if (published - mNext >= slotCount - 1)
+      {
+        const uint64_t oldest = published - slotCount + 2;
+        mFramesLost += oldest - mNext;
+        mNext = oldest;
+      }
+
+      if (Copy(mNext))
+      {
+        mNext++;
+        mFramesRead++;
+        return true;
+      }
+
+      // overwritten while copying
+      mFramesLost++;
+      mNext++;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Copies the newest frame, skipping any frames in between.
+  /// Skipped frames are not counted as lost.</summary>
+  /// <returns>false if no newer frame was published.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Latest()
+  {
+    if (mRing == nullptr)
+      return false;
+
+    const uint64_t published = Header()->published.load(std::memory_order_acquire);
+    if (published > mNext)
+      mNext = published;
+    return Next();
+  }
+
+  // Frame copied last; valid after Next or Latest returned true.
+  const SharedFrameSlot& Frame() const { return *(const SharedFrameSlot*)mFrame.data(); }
+  const SharedPose* Poses() const { return (const SharedPose*)(mFrame.data() + sizeof(SharedFrameSlot)); }
+  const SharedMarker* Markers() const { return (const SharedMarker*)(Poses() + Frame().poseCount); }
+
+  const SharedRingHeader* Header() const { return (const SharedRingHeader*)mRing; }
+
+  uint64_t FramesRead() const { return mFramesRead; }
+  uint64_t FramesLost() const { return mFramesLost; }
+
+private:
+  SharedFrameReader(const SharedFrameReader&); // not implemented
+
+  // Copies frame <c>sequence</c> out of its slot. Fails if the slot holds
+  // another frame before or after the copy.
+  bool Copy(uint64_t sequence)
+  {
+    const SharedRingHeader* header = Header();
+    const uint8_t* slot = mRing + header->headerSize + (sequence & (header->slotCount - 1)) * header->slotSize;
+    const SharedFrameSlot* source = (const SharedFrameSlot*)slot;
+
+    if (source->sequence.load(std::memory_order_acquire) != sequence)
+      return false;
+
+    uint8_t* frame = mFrame.data();
+    memcpy(frame + sizeof(uint64_t), slot + sizeof(uint64_t), sizeof(SharedFrameSlot) - sizeof(uint64_t));
+    SharedFrameSlot* copy = (SharedFrameSlot*)frame;
+    if (copy->poseCount > header->maxPoses)
+      copy->poseCount = header->maxPoses;
+    if (copy->rigidBodyCount > copy->poseCount)
+      copy->rigidBodyCount = copy->poseCount;
+    if (copy->markerCount > header->maxMarkers)
+      copy->markerCount = header->maxMarkers;
+    const size_t bytes = copy->poseCount * sizeof(SharedPose) + copy->markerCount * sizeof(SharedMarker);
+    memcpy(frame + sizeof(SharedFrameSlot), slot + sizeof(SharedFrameSlot), bytes);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (source->sequence.load(std::memory_order_relaxed) != sequence)
+      return false;
+
+    copy->sequence.store(sequence, std::memory_order_relaxed);
+    return true;
+  }
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  const uint8_t* mRing;
+  size_t mSize;
+#ifdef _WIN32
+  HANDLE mMapping;
+#endif
+
+  uint64_t mNext;                // sequence of the next frame to read
+  std::vector<uint8_t> mFrame;   // copy of the frame read last
+
+  uint64_t mFramesRead;
+  uint64_t mFramesLost;
+};
+
+#endif // _SHAREDFRAMEREADER_H_
@@ -0,0 +1,99 @@
+#ifndef _SHAREDFRAMERING_H_
+#define _SHAREDFRAMERING_H_
+
+#include <atomic>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Layout of the shared memory frame ring, a named segment (/dev/shm/name
+/// on Linux, "Local\name" on Windows) that one SharedFrameWriter fills and
+/// any number of SharedFrameReader processes on the same host read. The
+/// segment is one SharedRingHeader followed by <c>slotCount</c> slots of
+/// <c>slotSize</c> bytes. A slot holds one frame: a SharedFrameSlot, then
+/// <c>poseCount</c> SharedPose and <c>markerCount</c> SharedMarker.
+/// </summary>
+/// <remarks>
+/// Frames are numbered by a sequence counter starting at 1 and frame n is
+/// written to slot n % slotCount, overwriting frame n - slotCount. The
+/// writer clears a slot's sequence before writing it and sets it after,
+/// then advances <c>published</c>. Readers never write; they take a copy
+/// of a slot and keep it only if its sequence was the expected one before
+/// and after the copy, so a reader that falls more than slotCount frames
+/// behind detects the overrun instead of reading a torn frame.
+///
+/// Positions are in meters, rotations unit quaternions x, y, z, w, in the
+/// coordinate system given by the header flags. Fields are in host byte
+/// order; the ring never leaves the host.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+
+struct SharedRingHeader
+{
+  static const uint32_t MAGIC = 0x52534E4E;      // "NNSR" in little endian
+  static const uint16_t VERSION = 0x0100;
+
+  // coordinate system of the poses, as RigidBodyBlobHeader
+  static const uint32_t FLAG_YUP2ZUP = 0x01;
+  static const uint32_t FLAG_LEFTHANDED = 0x02;
+
+  uint32_t magic;                // MAGIC
+  uint16_t version;              // VERSION
+  uint16_t headerSize;           // offset of the first slot
+  uint32_t slotCount;            // power of two
+  uint32_t slotSize;             // bytes per slot, multiple of 64
+  uint32_t maxPoses;             // capacity of a slot
+  uint32_t maxMarkers;
+  uint32_t flags;
+  std::atomic<uint32_t> closed;  // set when the writer closes the ring
+
+  // Sequence of the last complete frame, 0 before the first one.
+  alignas(64) std::atomic<uint64_t> published;
+};
+
+struct SharedFrameSlot
+{
+  std::atomic<uint64_t> sequence; // frame sequence, 0 while the slot is written
+  int32_t frame;                 // NatNet frame number
+  uint32_t poseCount;            // rigid bodies first, then skeleton bones
+  uint32_t rigidBodyCount;
+  uint32_t markerCount;
+  double timestamp;              // fTimestamp, seconds since the take started
+  uint64_t exposureTimestamp;    // camera mid exposure, Motive host clock ticks
+  uint64_t ntpTime;              // NTP time of the mid exposure, 0 if unknown
+  uint32_t params;               // NatNet frame params: 0x01 recording, 0x02 model list changed
+  uint32_t reserved[3];
+};
+
+struct SharedPose
+{
+  static const uint32_t FLAG_TRACKED = 0x01;
+  static const uint32_t FLAG_BONE = 0x02;
+
+  int32_t id;                    // streaming ID; bones: skeleton ID << 16 | bone ID
+  uint32_t flags;
+  float x, y, z;
+  float qx, qy, qz, qw;
+};
+
+struct SharedMarker
+{
+  int32_t id;                    // model ID << 16 | marker ID, as NatNet
+  uint32_t params;               // NatNet marker params: 0x01 occluded, ...
+  float x, y, z;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring needs lock free 64 bit atomics");
+static_assert(sizeof(SharedRingHeader) == 128, "unexpected SharedRingHeader layout");
+static_assert(sizeof(SharedFrameSlot) == 64, "unexpected SharedFrameSlot layout");
+static_assert(sizeof(SharedPose) == 36, "unexpected SharedPose layout");
+static_assert(sizeof(SharedMarker) == 20, "unexpected SharedMarker layout");
+
+// Bytes of a slot holding up to the given number of poses and markers.
+inline uint32_t SharedSlotSize(uint32_t maxPoses, uint32_t maxMarkers)
+{
+  const uint32_t bytes = (uint32_t)(sizeof(SharedFrameSlot) + maxPoses * sizeof(SharedPose) + maxMarkers * sizeof(SharedMarker));
+  return (bytes + 63) & ~63u;
+}
+
+#endif // _SHAREDFRAMERING_H_
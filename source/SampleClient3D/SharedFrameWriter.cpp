@@ -0,0 +1,269 @@
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <cstring>
+#include <stdio.h>
+
+#include "SharedFrameWriter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// SharedFrameWriter implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Header rounded up to whole cache lines, so slots start on one.
+  const uint32_t kHeaderSize = (sizeof(SharedRingHeader) + 63) & ~63u;
+}
+
+template<class Frame>
+struct SharedFrameWriter::EntityWriterSelector
+{
+  typedef SlotCounts (SharedFrameWriter::*Result)(uint8_t* slot, const Frame& frame);
+
+  template<class Transform>
+  static Result Get() { return &SharedFrameWriter::WriteEntities<Transform, Frame>; }
+};
+
+
+SharedFrameWriter::SharedFrameWriter()
+  :mWriteEntities(nullptr),
+  mWriteViewEntities(nullptr),
+  mClock(nullptr),
+  mRing(nullptr),
+  mSize(0),
+#ifdef _WIN32
+  mMapping(nullptr),
+#endif
+  mSequence(0),
+  mEntitiesDropped(0)
+{
+  mName[0] = '\0';
+}
+
+SharedFrameWriter::~SharedFrameWriter()
+{
+  Close();
+}
+
+bool SharedFrameWriter::Create(const char* name, const OscOptions& options, uint32_t slotCount,
+  uint32_t maxPoses, uint32_t maxMarkers)
+{
+  Close();
+
+  uint32_t slots = 2;
+  while (slots < slotCount && slots < 0x10000)
+    slots <<= 1;
+  const uint32_t slotSize = SharedSlotSize(maxPoses, maxMarkers);
+  const uint64_t size = kHeaderSize + (uint64_t)slots * slotSize;
+
+#ifdef _WIN32
+  snprintf(mName, sizeof(mName), "Local\\%s", name);
+  mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+    (DWORD)(size >> 32), (DWORD)size, mName);
+  if (mMapping == nullptr)
+    return false;
+  mRing = (uint8_t*)MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+  if (mRing == nullptr)
+  {
+    Close();
+    return false;
+  }
+  // a mapping that already existed keeps the content of the old writer
+  memset(mRing, 0, (size_t)size);
+#else
+  snprintf(mName, sizeof(mName), "/%s", name);
+
+  // readers of a previous ring keep their mapping of it
+  shm_unlink(mName);
+  const int fd = shm_open(mName, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return false;
+
+  void* ring = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0)
+    ring = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring == MAP_FAILED)
+  {
+    shm_unlink(mName);
+    mName[0] = '\0';
+    return false;
+  }
+  mRing = (uint8_t*)ring;
+#endif
+
+  mSize = (size_t)size;
+  mOptions = options;
+  const UpAxisConversion upAxis = options.yup2zup ? UpAxis_YUpToZUp : UpAxis_Same;
+  mWriteEntities = SelectFusedTransform<EntityWriterSelector<LegacyFrameView> >(upAxis, options.leftHanded, false);
+  mWriteViewEntities = SelectFusedTransform<EntityWriterSelector<FrameView> >(upAxis, options.leftHanded, false);
+  mSequence = 0;
+
+  // the magic goes in last; readers check it before anything else
+  SharedRingHeader* header = Header();
+  header->version = SharedRingHeader::VERSION;
+  header->headerSize = (uint16_t)kHeaderSize;
+  header->slotCount = slots;
+  header->slotSize = slotSize;
+  header->maxPoses = maxPoses;
+  header->maxMarkers = maxMarkers;
+  header->flags = (options.yup2zup ? SharedRingHeader::FLAG_YUP2ZUP : 0) |
+    (options.leftHanded ? SharedRingHeader::FLAG_LEFTHANDED : 0);
+  header->closed.store(0, std::memory_order_relaxed);
+  header->published.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = SharedRingHeader::MAGIC;
+  return true;
+}
+
+void SharedFrameWriter::Close()
+{
+  if (mRing != nullptr)
+    Header()->closed.store(1, std::memory_order_release);
+
+#ifdef _WIN32
+  if (mRing != nullptr)
+    UnmapViewOfFile(mRing);
+  if (mMapping != nullptr)
+    CloseHandle(mMapping);
+  mMapping = nullptr;
+#else
+  if (mRing != nullptr)
+    munmap(mRing, mSize);
+  if (mName[0] != '\0')
+    shm_unlink(mName);
+#endif
+
+  mRing = nullptr;
+  mSize = 0;
+  mName[0] = '\0';
+}
+
+void SharedFrameWriter::Write(const sFrameOfMocapData& data)
+{
+  WriteSlot(LegacyFrameView(data), mWriteEntities);
+}
+
+void SharedFrameWriter::Write(const FrameView& frame)
+{
+  WriteSlot(frame, mWriteViewEntities);
+}
+
+template<class Frame>
+void SharedFrameWriter::WriteSlot(const Frame& frame, SlotCounts (SharedFrameWriter::*writeEntities)(uint8_t* slot, const Frame& frame))
+{
+  if (mRing == nullptr)
+    return;
+
+  SharedRingHeader* header = Header();
+  const uint64_t sequence = mSequence + 1;
+  uint8_t* slot = mRing + header->headerSize + (sequence & (header->slotCount - 1)) * header->slotSize;
+  SharedFrameSlot* out = (SharedFrameSlot*)slot;
+
+  // invalidate the slot before overwriting it, see SharedFrameReader::Copy
+  out->sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const SlotCounts counts = (this->*writeEntities)(slot, frame);
+
+  const uint64_t exposure = frame.CameraMidExposureTimestamp();
+  out->frame = frame.FrameNumber();
+  out->poseCount = counts.poses;
+  out->rigidBodyCount = counts.rigidBodies;
+  out->markerCount = counts.markers;
+  out->timestamp = frame.Timestamp();
+  out->exposureTimestamp = exposure;
+  out->ntpTime = (mClock != nullptr && exposure != 0 && mClock->Calibrated()) ? mClock->ToNtp(exposure) : 0;
+  out->params = (uint32_t)(uint16_t)frame.Params();
+
+  out->sequence.store(sequence, std::memory_order_release);
+  header->published.store(sequence, std::memory_order_release);
+  mSequence = sequence;
+}
+
+// Writes the poses and markers of a frame behind the slot header.
+template<class Transform, class Frame>
+SharedFrameWriter::SlotCounts SharedFrameWriter::WriteEntities(uint8_t* slot, const Frame& frame)
+{
+  SlotCounts counts;
+  SharedPose* poses = (SharedPose*)(slot + sizeof(SharedFrameSlot));
+  sRigidBodyData rb;
+  counts.poses = 0;
+  for (int i = 0; i < frame.RigidBodyCount(); i++)
+  {
+    frame.GetRigidBody(i, rb);
+    AddPose<Transform>(poses, counts.poses, rb, 0);
+  }
+  counts.rigidBodies = counts.poses;
+
+  if (mOptions.sendSkeletons)
+  {
+    for (int i = 0; i < frame.SkeletonCount(); i++)
+    {
+      for (int j = 0; j < frame.SkeletonBoneCount(i); j++)
+      {
+        frame.GetSkeletonBone(i, j, rb);
+        AddPose<Transform>(poses, counts.poses, rb, SharedPose::FLAG_BONE);
+      }
+    }
+  }
+
+  SharedMarker* markers = (SharedMarker*)(poses + counts.poses);
+  const uint32_t maxMarkers = Header()->maxMarkers;
+  counts.markers = 0;
+  if (mOptions.sendMarkerInfo)
+  {
+    for (int i = 0; i < frame.LabeledMarkerCount(); i++)
+    {
+      if (counts.markers == maxMarkers)
+      {
+        mEntitiesDropped += frame.LabeledMarkerCount() - i;
+        break;
+      }
+      sMarker marker;
+      frame.GetLabeledMarker(i, marker);
+      SharedMarker& out = markers[counts.markers++];
+      out.id = marker.ID;
+      out.params = (uint32_t)(uint16_t)marker.params;
+      float p[3] = { marker.x, marker.y, marker.z };
+      Transform::TransformPosition(p, 1.0f);
+      out.x = p[0];
+      out.y = p[1];
+      out.z = p[2];
+    }
+  }
+  return counts;
+}
+
+template<class Transform>
+void SharedFrameWriter::AddPose(SharedPose* poses, uint32_t& count, const sRigidBodyData& rb, uint32_t flags)
+{
+  if (count == Header()->maxPoses)
+  {
+    mEntitiesDropped++;
+    return;
+  }
+
+  SharedPose& pose = poses[count++];
+  pose.id = rb.ID;
+  pose.flags = flags | ((rb.params & 0x01) ? SharedPose::FLAG_TRACKED : 0);
+
+  float p[3] = { rb.x, rb.y, rb.z };
+  float q[4] = { rb.qx, rb.qy, rb.qz, rb.qw };
+  Transform::TransformPosition(p, 1.0f);
+  Transform::TransformRotation(q);
+  pose.x = p[0];
+  pose.y = p[1];
+  pose.z = p[2];
+  pose.qx = q[0];
+  pose.qy = q[1];
+  pose.qz = q[2];
+  pose.qw = q[3];
+}
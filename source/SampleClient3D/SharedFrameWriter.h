@@ -0,0 +1,134 @@
+#ifndef _SHAREDFRAMEWRITER_H_
+#define _SHAREDFRAMEWRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "NatNetTypes.h"
+#include "FrameView.h"
+#include "NtpClock.h"
+#include "OscOptions.h"
+#include "SharedFrameRing.h"
+#include "TransformPolicy.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Publishes frames into a shared memory frame ring (SharedFrameRing.h)
+/// for consumers on the same host, which read them with
+/// SharedFrameReader. Publishing a frame is a copy of its poses into the
+/// mapped segment: no system call, no kernel copy and no allocation.
+/// </summary>
+/// <remarks>
+/// Rigid bodies are always published, skeleton bones and labeled markers
+/// with <c>sendSkeletons</c> and <c>sendMarkerInfo</c>; poses are
+/// transformed as the OSC output (<c>yup2zup</c>, <c>leftHanded</c>) by
+/// a FusedTransform instantiation of the entity loop chosen in Create.
+/// Entities beyond the capacity of a slot are left out. The segment is
+/// removed when the writer closes it; readers that still map it see
+/// <c>closed</c> set.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class SharedFrameWriter
+{
+public:
+  static const uint32_t DEFAULT_SLOT_COUNT = 64;
+  static const uint32_t DEFAULT_MAX_POSES = MAX_RIGIDBODIES + 4 * MAX_SKELRIGIDBODIES;
+  static const uint32_t DEFAULT_MAX_MARKERS = MAX_LABELED_MARKERS;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  SharedFrameWriter();
+  ~SharedFrameWriter();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Creates the ring, replacing any ring of the same name left
+  /// behind by a previous writer.</summary>
+  /// <param name='name'>Segment name without a leading '/'.</param>
+  /// <param name='slotCount'>Frames kept, rounded up to a power of two.
+  /// </param>
+  /// <returns>false if the segment cannot be created.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Create(const char* name, const OscOptions& options, uint32_t slotCount = DEFAULT_SLOT_COUNT,
+    uint32_t maxPoses = DEFAULT_MAX_POSES, uint32_t maxMarkers = DEFAULT_MAX_MARKERS);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Marks the ring closed and removes it.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Close();
+
+  bool IsOpen() const { return mRing != nullptr; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the clock used to fill in the NTP time of a frame's
+  /// mid exposure. Without a calibrated clock it is 0.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetClock(const NtpClock* clock) { mClock = clock; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Publishes a frame. Meant to be called from the NatNet frame
+  /// callback; one thread only.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Write(const sFrameOfMocapData& data);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Publishes a frame received as a raw packet, reading the
+  /// poses straight from the packet.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Write(const FrameView& frame);
+
+  uint64_t FramesWritten() const { return mSequence; }
+  uint64_t EntitiesDropped() const { return mEntitiesDropped; }
+
+private:
+  SharedFrameWriter(const SharedFrameWriter&); // not implemented
+
+  // Counts of the entities written into a slot.
+  struct SlotCounts
+  {
+    uint32_t poses;
+    uint32_t rigidBodies;
+    uint32_t markers;
+  };
+
+  typedef SlotCounts (SharedFrameWriter::*WriteEntitiesFunction)(uint8_t* slot, const LegacyFrameView& frame);
+  typedef SlotCounts (SharedFrameWriter::*WriteViewEntitiesFunction)(uint8_t* slot, const FrameView& frame);
+  template<class Frame>
+  struct EntityWriterSelector;
+
+  SharedRingHeader* Header() const { return (SharedRingHeader*)mRing; }
+
+  template<class Frame>
+  void WriteSlot(const Frame& frame, SlotCounts (SharedFrameWriter::*writeEntities)(uint8_t* slot, const Frame& frame));
+  template<class Transform, class Frame>
+  SlotCounts WriteEntities(uint8_t* slot, const Frame& frame);
+  template<class Transform>
+  void AddPose(SharedPose* poses, uint32_t& count, const sRigidBodyData& rb, uint32_t flags);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  OscOptions mOptions;
+  WriteEntitiesFunction mWriteEntities; // instantiations for mOptions
+  WriteViewEntitiesFunction mWriteViewEntities;
+  const NtpClock* mClock;
+
+  uint8_t* mRing;
+  size_t mSize;
+  char mName[256];
+#ifdef _WIN32
+  void* mMapping;
+#endif
+
+  uint64_t mSequence;            // sequence of the frame written last
+  uint64_t mEntitiesDropped;
+};
+
+#endif // _SHAREDFRAMEWRITER_H_
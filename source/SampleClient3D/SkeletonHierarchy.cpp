@@ -0,0 +1,481 @@
+#include <algorithm>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define SKELETONHIERARCHY_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define SKELETONHIERARCHY_SSE2
+#endif
+
+#include "SkeletonHierarchy.h"
+
+//////////////////////////////////////////////////////////////////////////
+// SkeletonHierarchy implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  // Largest bone ID looked up; frame data keeps it in the low 16 bits.
+  const int32_t kMaxBoneID = 0xFFFF;
+
+#ifdef SKELETONHIERARCHY_AVX2
+  struct Avx2HierarchyLanes
+  {
+    typedef __m256 V;
+    static const int WIDTH = 8;
+
+    static V Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V Neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+  };
+#endif
+
+#ifdef SKELETONHIERARCHY_SSE2
+  struct Sse2HierarchyLanes
+  {
+    typedef __m128 V;
+    static const int WIDTH = 4;
+
+    static V Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V Add(V a, V b) { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V Neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+  };
+#endif
+
+  struct ScalarHierarchyLanes
+  {
+    typedef float V;
+    static const int WIDTH = 1;
+
+    static V Load(const float* p) { return *p; }
+    static void Store(float* p, V v) { *p = v; }
+    static V Add(V a, V b) { return a + b; }
+    static V Sub(V a, V b) { return a - b; }
+    static V Mul(V a, V b) { return a * b; }
+    static V Neg(V a) { return -a; }
+  };
+
+  // r = a * b for quaternions x, y, z, w.
+  template<class Lanes>
+  void Multiply(const typename Lanes::V* a, const typename Lanes::V* b, typename Lanes::V* r)
+  {
+    typedef Lanes L;
+    r[0] = L::Add(L::Sub(L::Add(L::Mul(a[3], b[0]), L::Mul(a[0], b[3])), L::Mul(a[2], b[1])), L::Mul(a[1], b[2]));
+    r[1] = L::Add(L::Sub(L::Add(L::Mul(a[3], b[1]), L::Mul(a[1], b[3])), L::Mul(a[0], b[2])), L::Mul(a[2], b[0]));
+    r[2] = L::Add(L::Sub(L::Add(L::Mul(a[3], b[2]), L::Mul(a[2], b[3])), L::Mul(a[1], b[0])), L::Mul(a[0], b[1]));
+    r[3] = L::Sub(L::Sub(L::Sub(L::Mul(a[3], b[3]), L::Mul(a[0], b[0])), L::Mul(a[1], b[1])), L::Mul(a[2], b[2]));
+  }
+
+  // r = v rotated by the unit quaternion q: v + w t + q.xyz x t with
+  // t = 2 q.xyz x v.
+  template<class Lanes>
+  void Rotate(const typename Lanes::V* q, const typename Lanes::V* v, typename Lanes::V* r)
+  {
+    typedef Lanes L;
+    typedef typename Lanes::V V;
+    V t[3];
+    t[0] = L::Sub(L::Mul(q[1], v[2]), L::Mul(q[2], v[1]));
+    t[1] = L::Sub(L::Mul(q[2], v[0]), L::Mul(q[0], v[2]));
+    t[2] = L::Sub(L::Mul(q[0], v[1]), L::Mul(q[1], v[0]));
+    t[0] = L::Add(t[0], t[0]);
+    t[1] = L::Add(t[1], t[1]);
+    t[2] = L::Add(t[2], t[2]);
+    r[0] = L::Add(L::Add(v[0], L::Mul(q[3], t[0])), L::Sub(L::Mul(q[1], t[2]), L::Mul(q[2], t[1])));
+    r[1] = L::Add(L::Add(v[1], L::Mul(q[3], t[1])), L::Sub(L::Mul(q[2], t[0]), L::Mul(q[0], t[2])));
+    r[2] = L::Add(L::Add(v[2], L::Mul(q[3], t[2])), L::Sub(L::Mul(q[0], t[1]), L::Mul(q[1], t[0])));
+  }
+
+  // Poses of one block, [bone][component][lane], 7 components.
+  const int kStride = 7 * SkeletonHierarchy::LANES;
+
+  // global = global of parent * local, parents first. offsets replace the
+  // local positions unless nullptr.
+  template<class Lanes>
+  void LocalToGlobal(const int* parents, int boneCount, const float* local, const float* offsets, float* global)
+  {
+    typedef typename Lanes::V V;
+    for (int l = 0; l < SkeletonHierarchy::LANES; l += Lanes::WIDTH)
+    {
+      for (int b = 0; b < boneCount; b++)
+      {
+        const float* in = local + b * kStride + l;
+        const float* position = offsets != nullptr ? offsets + b * 3 * SkeletonHierarchy::LANES + l : in;
+        float* out = global + b * kStride + l;
+        const V p[3] =
+        {
+          Lanes::Load(position),
+          Lanes::Load(position + SkeletonHierarchy::LANES),
+          Lanes::Load(position + 2 * SkeletonHierarchy::LANES)
+        };
+        const V q[4] =
+        {
+          Lanes::Load(in + 3 * SkeletonHierarchy::LANES),
+          Lanes::Load(in + 4 * SkeletonHierarchy::LANES),
+          Lanes::Load(in + 5 * SkeletonHierarchy::LANES),
+          Lanes::Load(in + 6 * SkeletonHierarchy::LANES)
+        };
+
+        V rp[3], rq[4];
+        if (parents[b] < 0)
+        {
+          std::copy(p, p + 3, rp);
+          std::copy(q, q + 4, rq);
+        }
+        else
+        {
+          const float* parent = global + parents[b] * kStride + l;
+          V pp[3], pq[4];
+          for (int c = 0; c < 3; c++)
+            pp[c] = Lanes::Load(parent + c * SkeletonHierarchy::LANES);
+          for (int c = 0; c < 4; c++)
+            pq[c] = Lanes::Load(parent + (3 + c) * SkeletonHierarchy::LANES);
+
+          Multiply<Lanes>(pq, q, rq);
+          Rotate<Lanes>(pq, p, rp);
+          for (int c = 0; c < 3; c++)
+            rp[c] = Lanes::Add(pp[c], rp[c]);
+        }
+
+        for (int c = 0; c < 3; c++)
+          Lanes::Store(out + c * SkeletonHierarchy::LANES, rp[c]);
+        for (int c = 0; c < 4; c++)
+          Lanes::Store(out + (3 + c) * SkeletonHierarchy::LANES, rq[c]);
+      }
+    }
+  }
+
+  // local = inverse of the parent's global * global. Only reads globals,
+  // so the order of the bones does not matter.
+  template<class Lanes>
+  void GlobalToLocal(const int* parents, int boneCount, const float* global, float* local)
+  {
+    typedef typename Lanes::V V;
+    for (int l = 0; l < SkeletonHierarchy::LANES; l += Lanes::WIDTH)
+    {
+      for (int b = 0; b < boneCount; b++)
+      {
+        const float* in = global + b * kStride + l;
+        float* out = local + b * kStride + l;
+        V p[3], q[4];
+        for (int c = 0; c < 3; c++)
+          p[c] = Lanes::Load(in + c * SkeletonHierarchy::LANES);
+        for (int c = 0; c < 4; c++)
+          q[c] = Lanes::Load(in + (3 + c) * SkeletonHierarchy::LANES);
+
+        V rp[3], rq[4];
+        if (parents[b] < 0)
+        {
+          std::copy(p, p + 3, rp);
+          std::copy(q, q + 4, rq);
+        }
+        else
+        {
+          const float* parent = global + parents[b] * kStride + l;
+          V d[3], inverse[4];
+          for (int c = 0; c < 3; c++)
+            d[c] = Lanes::Sub(p[c], Lanes::Load(parent + c * SkeletonHierarchy::LANES));
+          for (int c = 0; c < 3; c++)
+            inverse[c] = Lanes::Neg(Lanes::Load(parent + (3 + c) * SkeletonHierarchy::LANES));
+          inverse[3] = Lanes::Load(parent + 6 * SkeletonHierarchy::LANES);
+
+          Multiply<Lanes>(inverse, q, rq);
+          Rotate<Lanes>(inverse, d, rp);
+        }
+
+        for (int c = 0; c < 3; c++)
+          Lanes::Store(out + c * SkeletonHierarchy::LANES, rp[c]);
+        for (int c = 0; c < 4; c++)
+          Lanes::Store(out + (3 + c) * SkeletonHierarchy::LANES, rq[c]);
+      }
+    }
+  }
+
+  // Topological order of the bones of a description, parents before
+  // children and otherwise in description order. order receives the
+  // description index per position, parents the position of the parent
+  // per position (-1 for roots). Bones whose parent is not a bone of the
+  // skeleton, or that are part of a cycle, become roots.
+  void SortBones(const sSkeletonDescription& skeleton, std::vector<int>& order, std::vector<int>& parents)
+  {
+    const int count = std::min(skeleton.nRigidBodies, (int)MAX_SKELRIGIDBODIES);
+    std::vector<int> parentIndex(count, -1);
+    for (int i = 0; i < count; i++)
+    {
+      for (int j = 0; j < count; j++)
+      {
+        if (j != i && skeleton.RigidBodies[j].ID == skeleton.RigidBodies[i].parentID)
+        {
+          parentIndex[i] = j;
+          break;
+        }
+      }
+    }
+
+    std::vector<int> position(count, -1);
+    order.clear();
+    parents.clear();
+    while ((int)order.size() < count)
+    {
+      const size_t before = order.size();
+      for (int i = 0; i < count; i++)
+      {
+        if (position[i] >= 0)
+          continue;
+        const int parent = parentIndex[i];
+        if (parent >= 0 && position[parent] < 0)
+          continue;
+        position[i] = (int)order.size();
+        order.push_back(i);
+        parents.push_back(parent >= 0 ? position[parent] : -1);
+      }
+      // no progress: the rest is cyclic, cut it at its first bone
+      if (order.size() == before)
+      {
+        for (int i = 0; i < count; i++)
+        {
+          if (position[i] < 0)
+          {
+            parentIndex[i] = -1;
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+SkeletonHierarchy::SkeletonHierarchy()
+  :mStreamed(Space_Global),
+  mRestOffsets(false),
+  mSolved(false)
+{
+}
+
+void SkeletonHierarchy::Build(const sDataDescriptions* pDataDefs)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  mGroups.clear();
+  mSkeletons.clear();
+  mSolved = false;
+  if (pDataDefs == nullptr)
+    return;
+
+  std::vector<const sSkeletonDescription*> descriptions;
+  std::vector<std::vector<int> > orders;
+  for (int i = 0; i < pDataDefs->nDataDescriptions; i++)
+  {
+    if (pDataDefs->arrDataDescriptions[i].type != Descriptor_Skeleton)
+      continue;
+    const sSkeletonDescription& skeleton = *pDataDefs->arrDataDescriptions[i].Data.SkeletonDescription;
+
+    std::vector<int> order, parents;
+    SortBones(skeleton, order, parents);
+
+    int g = 0;
+    while (g < (int)mGroups.size() && mGroups[g].parents != parents)
+      g++;
+    if (g == (int)mGroups.size())
+    {
+      mGroups.push_back(Group());
+      mGroups.back().boneCount = (int)parents.size();
+      mGroups.back().skeletonCount = 0;
+      mGroups.back().parents = parents;
+    }
+    Group& group = mGroups[g];
+
+    SkeletonEntry entry;
+    entry.skeletonID = skeleton.skeletonID;
+    entry.group = g;
+    entry.block = group.skeletonCount / LANES;
+    entry.lane = group.skeletonCount % LANES;
+    group.skeletonCount++;
+
+    int32_t maxID = -1;
+    for (size_t b = 0; b < order.size(); b++)
+      maxID = std::max(maxID, std::min(skeleton.RigidBodies[order[b]].ID, kMaxBoneID));
+    entry.slots.assign(maxID + 1, -1);
+    for (size_t b = 0; b < order.size(); b++)
+    {
+      const int32_t id = skeleton.RigidBodies[order[b]].ID;
+      if (id >= 0 && id <= kMaxBoneID)
+        entry.slots[id] = (int)b;
+    }
+
+    mSkeletons.push_back(entry);
+    descriptions.push_back(&skeleton);
+    orders.push_back(order);
+  }
+
+  for (size_t g = 0; g < mGroups.size(); g++)
+    Reset(mGroups[g]);
+
+  for (size_t s = 0; s < mSkeletons.size(); s++)
+  {
+    const SkeletonEntry& entry = mSkeletons[s];
+    Group& group = mGroups[entry.group];
+    float* offsets = group.offsets.data() + (size_t)entry.block * group.boneCount * 3 * LANES + entry.lane;
+    for (size_t b = 0; b < orders[s].size(); b++)
+    {
+      const sRigidBodyDescription& bone = descriptions[s]->RigidBodies[orders[s][b]];
+      offsets[(b * 3 + 0) * LANES] = bone.offsetx;
+      offsets[(b * 3 + 1) * LANES] = bone.offsety;
+      offsets[(b * 3 + 2) * LANES] = bone.offsetz;
+    }
+  }
+
+  std::sort(mSkeletons.begin(), mSkeletons.end(), SkeletonEntry::Less);
+}
+
+void SkeletonHierarchy::SetSpace(Space streamed, bool restOffsets)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  mStreamed = streamed;
+  mRestOffsets = restOffsets;
+  mSolved = false;
+}
+
+bool SkeletonHierarchy::SetBones(int32_t skeletonID, const sRigidBodyData* bones, int count)
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  const SkeletonEntry* entry = Find(skeletonID);
+  if (entry == nullptr)
+    return false;
+
+  Group& group = mGroups[entry->group];
+  float* poses = group.poses[mStreamed].data() + entry->block * group.BlockSize() + entry->lane;
+  for (int i = 0; i < count; i++)
+  {
+    const sRigidBodyData& bone = bones[i];
+    const int32_t id = bone.ID & kMaxBoneID;
+    if (id >= (int32_t)entry->slots.size() || entry->slots[id] < 0)
+      continue;
+
+    float* pose = poses + entry->slots[id] * kStride;
+    pose[Component_X * LANES] = bone.x;
+    pose[Component_Y * LANES] = bone.y;
+    pose[Component_Z * LANES] = bone.z;
+    pose[Component_QX * LANES] = bone.qx;
+    pose[Component_QY * LANES] = bone.qy;
+    pose[Component_QZ * LANES] = bone.qz;
+    pose[Component_QW * LANES] = bone.qw;
+  }
+  return true;
+}
+
+void SkeletonHierarchy::Solve()
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  for (size_t g = 0; g < mGroups.size(); g++)
+  {
+    Group& group = mGroups[g];
+    const int* parents = group.parents.data();
+    const int blocks = (group.skeletonCount + LANES - 1) / LANES;
+    for (int k = 0; k < blocks; k++)
+    {
+      float* global = group.poses[Space_Global].data() + k * group.BlockSize();
+      float* local = group.poses[Space_Local].data() + k * group.BlockSize();
+      if (mStreamed == Space_Local)
+      {
+        const float* offsets = mRestOffsets ? group.offsets.data() + (size_t)k * group.boneCount * 3 * LANES : nullptr;
+#if defined(SKELETONHIERARCHY_AVX2)
+        LocalToGlobal<Avx2HierarchyLanes>(parents, group.boneCount, local, offsets, global);
+#elif defined(SKELETONHIERARCHY_SSE2)
+        LocalToGlobal<Sse2HierarchyLanes>(parents, group.boneCount, local, offsets, global);
+#else
+        LocalToGlobal<ScalarHierarchyLanes>(parents, group.boneCount, local, offsets, global);
+#endif
+      }
+      else
+      {
+#if defined(SKELETONHIERARCHY_AVX2)
+        GlobalToLocal<Avx2HierarchyLanes>(parents, group.boneCount, global, local);
+#elif defined(SKELETONHIERARCHY_SSE2)
+        GlobalToLocal<Sse2HierarchyLanes>(parents, group.boneCount, global, local);
+#else
+        GlobalToLocal<ScalarHierarchyLanes>(parents, group.boneCount, global, local);
+#endif
+      }
+    }
+  }
+  mSolved = true;
+}
+
+bool SkeletonHierarchy::GetBones(int32_t skeletonID, sRigidBodyData* bones, int count, Space space) const
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  const SkeletonEntry* entry = Find(skeletonID);
+  if (entry == nullptr || !Known(space))
+    return false;
+
+  const Group& group = mGroups[entry->group];
+  const float* poses = group.poses[space].data() + entry->block * group.BlockSize() + entry->lane;
+  for (int i = 0; i < count; i++)
+  {
+    sRigidBodyData& bone = bones[i];
+    const int32_t id = bone.ID & kMaxBoneID;
+    if (id >= (int32_t)entry->slots.size() || entry->slots[id] < 0)
+      continue;
+
+    const float* pose = poses + entry->slots[id] * kStride;
+    bone.x = pose[Component_X * LANES];
+    bone.y = pose[Component_Y * LANES];
+    bone.z = pose[Component_Z * LANES];
+    bone.qx = pose[Component_QX * LANES];
+    bone.qy = pose[Component_QY * LANES];
+    bone.qz = pose[Component_QZ * LANES];
+    bone.qw = pose[Component_QW * LANES];
+  }
+  return true;
+}
+
+bool SkeletonHierarchy::GetBone(int32_t id, Space space, float* p, float* q) const
+{
+  std::lock_guard<std::mutex> lock(mLock);
+  const SkeletonEntry* entry = Find((int32_t)((uint32_t)id >> 16));
+  const int32_t boneID = id & kMaxBoneID;
+  if (entry == nullptr || !Known(space) || boneID >= (int32_t)entry->slots.size() || entry->slots[boneID] < 0)
+    return false;
+
+  const Group& group = mGroups[entry->group];
+  const float* pose = group.poses[space].data() + entry->block * group.BlockSize() + entry->lane +
+    entry->slots[boneID] * kStride;
+  for (int c = 0; c < 3; c++)
+    p[c] = pose[(Component_X + c) * LANES];
+  for (int c = 0; c < 4; c++)
+    q[c] = pose[(Component_QX + c) * LANES];
+  return true;
+}
+
+const SkeletonHierarchy::SkeletonEntry* SkeletonHierarchy::Find(int32_t skeletonID) const
+{
+  SkeletonEntry key;
+  key.skeletonID = skeletonID;
+  std::vector<SkeletonEntry>::const_iterator it =
+    std::lower_bound(mSkeletons.begin(), mSkeletons.end(), key, SkeletonEntry::Less);
+  if (it == mSkeletons.end() || it->skeletonID != skeletonID)
+    return nullptr;
+  return &*it;
+}
+
+// Sizes the arrays of a group and sets all poses to the identity.
+void SkeletonHierarchy::Reset(Group& group)
+{
+  const int blocks = (group.skeletonCount + LANES - 1) / LANES;
+  group.offsets.assign((size_t)blocks * group.boneCount * 3 * LANES, 0.0f);
+  for (int s = 0; s < 2; s++)
+  {
+    std::vector<float>& poses = group.poses[s];
+    poses.assign(blocks * group.BlockSize(), 0.0f);
+    for (size_t b = 0; b < (size_t)blocks * group.boneCount; b++)
+      std::fill_n(poses.begin() + b * kStride + Component_QW * LANES, LANES, 1.0f);
+  }
+}
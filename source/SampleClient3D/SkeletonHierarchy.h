@@ -0,0 +1,165 @@
+#ifndef _SKELETONHIERARCHY_H_
+#define _SKELETONHIERARCHY_H_
+
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "NatNetTypes.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Global and parent relative (local) poses of all skeleton bones, each
+/// computed from the other through the bone hierarchy of the skeleton
+/// descriptions (<c>parentID</c>, <c>offsetx/y/z</c>).
+/// </summary>
+/// <remarks>
+/// Motive streams skeleton bones either in global or in local
+/// coordinates (SetSpace). Build sorts the bones of every description
+/// into a topological order, parents before children, once; skeletons
+/// with the same hierarchy share a group, so a solve is a single pass
+/// over the bones of each group in that order.
+///
+/// Poses are stored per group in blocks of LANES skeletons, component by
+/// component, as [block][bone][x y z qx qy qz qw][lane]: one load reads a
+/// pose component of LANES skeletons and Solve runs SIMD over skeletons
+/// (AVX2, SSE2 or plain C++ as the build allows). Unused lanes hold the
+/// identity.
+///
+/// Build and the per frame functions may run on different threads; they
+/// are serialized by an internal lock.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class SkeletonHierarchy
+{
+public:
+  // Skeletons per block.
+  static const int LANES = 8;
+
+  // Coordinates of bone poses.
+  enum Space
+  {
+    Space_Global = 0,       // world coordinates
+    Space_Local             // relative to the parent bone; roots are global
+  };
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  SkeletonHierarchy();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sorts the bones of every skeleton description and groups
+  /// skeletons with the same hierarchy. All poses are reset to the
+  /// identity.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Build(const sDataDescriptions* pDataDefs);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sets the coordinates the server streams skeletons in.
+  /// </summary>
+  /// <param name='restOffsets'>Local to global only: place bones at the
+  /// description offsets from their parents instead of the streamed
+  /// local positions, which keeps bone lengths at the rest pose.</param>
+  //////////////////////////////////////////////////////////////////////////
+  void SetSpace(Space streamed, bool restOffsets);
+
+  Space StreamedSpace() const { return mStreamed; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Stores the streamed bone poses of a skeleton; bones without
+  /// a description are ignored and bones missing from the frame keep
+  /// their previous pose.</summary>
+  /// <returns>false if the skeleton has no description.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool SetBones(int32_t skeletonID, const sRigidBodyData* bones, int count);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Computes the poses in the other space from the streamed ones
+  /// for all bones of all skeletons.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Solve();
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Overwrites the poses of bones (x to qw, found by their frame
+  /// data ID) with their poses in <c>space</c> of the last Solve.</summary>
+  /// <returns>false if the skeleton has no description, or if
+  /// <c>space</c> is not the streamed one and was not solved since Build
+  /// or SetSpace.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool GetBones(int32_t skeletonID, sRigidBodyData* bones, int count, Space space) const;
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Pose of one bone by its frame data ID (skeleton ID &lt;&lt;
+  /// 16 | bone ID).</summary>
+  /// <returns>false if the bone has no description or <c>space</c> was
+  /// not solved, as for GetBones.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool GetBone(int32_t id, Space space, float* p, float* q) const;
+
+  int SkeletonCount() const { return (int)mSkeletons.size(); }
+  int GroupCount() const { return (int)mGroups.size(); }
+
+private:
+  SkeletonHierarchy(const SkeletonHierarchy&); // not implemented
+
+  // Pose components of a bone.
+  enum Component
+  {
+    Component_X = 0,
+    Component_Y,
+    Component_Z,
+    Component_QX,
+    Component_QY,
+    Component_QZ,
+    Component_QW,
+    Component_Count
+  };
+
+  // Skeletons with the same hierarchy.
+  struct Group
+  {
+    int boneCount;
+    int skeletonCount;
+    std::vector<int> parents;       // per bone in topological order, -1 for roots
+    std::vector<float> offsets;     // [block][bone][x y z][lane]
+    std::vector<float> poses[2];    // per Space, [block][bone][component][lane]
+
+    size_t BlockSize() const { return (size_t)boneCount * Component_Count * LANES; }
+  };
+
+  // Location of a skeleton's poses.
+  struct SkeletonEntry
+  {
+    int32_t skeletonID;
+    int group;
+    int block;
+    int lane;
+    std::vector<int> slots;         // topological index per bone ID, -1 if none
+
+    static bool Less(const SkeletonEntry& a, const SkeletonEntry& b) { return a.skeletonID < b.skeletonID; }
+  };
+
+  const SkeletonEntry* Find(int32_t skeletonID) const;
+  bool Known(Space space) const { return space == mStreamed || mSolved; }
+  void Reset(Group& group);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  mutable std::mutex mLock;
+  std::vector<Group> mGroups;
+  std::vector<SkeletonEntry> mSkeletons;  // sorted by skeleton ID
+  Space mStreamed;
+  bool mRestOffsets;
+  bool mSolved;                           // the other space holds solved poses
+};
+
+#endif // _SKELETONHIERARCHY_H_
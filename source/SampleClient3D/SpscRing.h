@@ -0,0 +1,78 @@
+#ifndef _SPSCRING_H_
+#define _SPSCRING_H_
+
+#include <atomic>
+#include <stddef.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Bounded lock-free ring buffer for exactly one producer thread and
+/// exactly one consumer thread.
+/// </summary>
+/// <typeparam name='T'>Element type. Should be cheap to copy (e.g. a
+/// pointer or an index).</typeparam>
+/// <typeparam name='Capacity'>Number of slots. Must be a power of two.
+/// </typeparam>
+//////////////////////////////////////////////////////////////////////////
+template<typename T, size_t Capacity>
+class SpscRing
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  SpscRing() : mHead(0), mTail(0) {}
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Appends an element. Producer thread only.</summary>
+  /// <returns>false if the ring is full.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool TryPush(const T& value)
+  {
+    const size_t head = mHead.load(std::memory_order_relaxed);
+    if (head - mTail.load(std::memory_order_acquire) == Capacity)
+      return false;
+
+    mSlots[head & (Capacity - 1)] = value;
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Removes the oldest element. Consumer thread only.</summary>
+  /// <returns>false if the ring is empty.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool TryPop(T& value)
+  {
+    const size_t tail = mTail.load(std::memory_order_relaxed);
+    if (mHead.load(std::memory_order_acquire) == tail)
+      return false;
+
+    value = mSlots[tail & (Capacity - 1)];
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Returns the number of queued elements. Only a snapshot when
+  /// called while the other side is active.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  size_t Size() const
+  {
+    return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+private:
+  SpscRing(const SpscRing&);
+  SpscRing& operator=(const SpscRing&);
+
+  T mSlots[Capacity];
+
+  // Producer and consumer indices live on separate cache lines so the two
+  // threads do not invalidate each other on every push/pop.
+  alignas(64) std::atomic<size_t> mHead;
+  alignas(64) std::atomic<size_t> mTail;
+};
+
+#endif // _SPSCRING_H_
@@ -0,0 +1,113 @@
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define TRANSFORMPOLICY_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define TRANSFORMPOLICY_SSE2
+#endif
+
+#include "TransformPolicy.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FusedTransform batch kernels
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+#ifdef TRANSFORMPOLICY_AVX2
+  struct Avx2Lanes
+  {
+    typedef __m256 V;
+    static const int WIDTH = 8;
+
+    static V Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V Set1(float f) { return _mm256_set1_ps(f); }
+    static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V Neg(V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+  };
+#endif
+
+#ifdef TRANSFORMPOLICY_SSE2
+  struct Sse2Lanes
+  {
+    typedef __m128 V;
+    static const int WIDTH = 4;
+
+    static V Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V Set1(float f) { return _mm_set1_ps(f); }
+    static V Add(V a, V b) { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V Neg(V a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+  };
+#endif
+
+  // Transforms whole blocks of Lanes::WIDTH poses from index i on.
+  // Returns the index of the first pose left.
+  template<class Transform, class Lanes>
+  int ApplyLanes(float* const* position, float* const* rotation, int i, int count, float scale)
+  {
+    typedef typename Lanes::V V;
+    const V factor = Lanes::Set1(scale);
+
+    int k = i;
+    for (; k + Lanes::WIDTH <= count; k += Lanes::WIDTH)
+    {
+      V p[3] = { Lanes::Load(position[0] + k), Lanes::Load(position[1] + k), Lanes::Load(position[2] + k) };
+      Transform::template Position<Lanes>(p, factor);
+      Lanes::Store(position[0] + k, p[0]);
+      Lanes::Store(position[1] + k, p[1]);
+      Lanes::Store(position[2] + k, p[2]);
+    }
+
+    if (rotation[0] != nullptr)
+    {
+      for (k = i; k + Lanes::WIDTH <= count; k += Lanes::WIDTH)
+      {
+        V q[4] = { Lanes::Load(rotation[0] + k), Lanes::Load(rotation[1] + k),
+          Lanes::Load(rotation[2] + k), Lanes::Load(rotation[3] + k) };
+        Transform::template Rotation<Lanes>(q);
+        Lanes::Store(rotation[0] + k, q[0]);
+        Lanes::Store(rotation[1] + k, q[1]);
+        Lanes::Store(rotation[2] + k, q[2]);
+        Lanes::Store(rotation[3] + k, q[3]);
+      }
+    }
+    return k;
+  }
+
+  template<class Transform>
+  void ApplyFused(float* x, float* y, float* z, float* qx, float* qy, float* qz, float* qw, int count, float scale)
+  {
+    float* const position[3] = { x, y, z };
+    float* const rotation[4] = { qx, qy, qz, qw };
+
+    int i = 0;
+#ifdef TRANSFORMPOLICY_AVX2
+    i = ApplyLanes<Transform, Avx2Lanes>(position, rotation, i, count, scale);
+#endif
+#ifdef TRANSFORMPOLICY_SSE2
+    i = ApplyLanes<Transform, Sse2Lanes>(position, rotation, i, count, scale);
+#endif
+    ApplyLanes<Transform, ScalarLanes>(position, rotation, i, count, scale);
+  }
+
+  struct KernelSelector
+  {
+    typedef FusedTransformKernel Result;
+
+    template<class Transform>
+    static Result Get() { return &ApplyFused<Transform>; }
+  };
+}
+
+
+FusedTransformKernel SelectFusedTransformKernel(UpAxisConversion upAxis, bool leftHanded, bool scaled)
+{
+  return SelectFusedTransform<KernelSelector>(upAxis, leftHanded, scaled);
+}
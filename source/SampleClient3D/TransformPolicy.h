@@ -0,0 +1,261 @@
+#ifndef _TRANSFORMPOLICY_H_
+#define _TRANSFORMPOLICY_H_
+
+//////////////////////////////////////////////////////////////////////////
+// Coordinate system policies. Each one is a signed permutation of the
+// position and quaternion components and, for the up axis, a constant
+// rotation multiplied onto every quaternion:
+//   p'[i] = PositionSign(i) * p[PositionSource(i)]
+//   q'    = (RotationSign(i) * q[RotationSource(i)]) * Offset
+// Quaternions are stored x, y, z, w.
+//////////////////////////////////////////////////////////////////////////
+
+// Keeps the up axis.
+struct SameUpAxis
+{
+  static constexpr int PositionSource(int i) { return i; }
+  static constexpr float PositionSign(int) { return 1.0f; }
+  static constexpr int RotationSource(int i) { return i; }
+  static constexpr float RotationSign(int) { return 1.0f; }
+  static constexpr float Offset(int i) { return i == 3 ? 1.0f : 0.0f; }
+};
+
+// y-up to z-up as the OSC yup2zup option: (x, -z, y), rotations alike.
+struct YUpToZUp
+{
+  static constexpr int PositionSource(int i) { return i == 1 ? 2 : i == 2 ? 1 : i; }
+  static constexpr float PositionSign(int i) { return i == 1 ? -1.0f : 1.0f; }
+  static constexpr int RotationSource(int i) { return PositionSource(i); }
+  static constexpr float RotationSign(int i) { return PositionSign(i); }
+  static constexpr float Offset(int i) { return i == 3 ? 1.0f : 0.0f; }
+};
+
+// Motive z-up to the viewer's y-up: (x, z, -y), rotations followed by
+// -90 degrees about x as in the sample client's renderer.
+struct ZUpToYUp
+{
+  static constexpr int PositionSource(int i) { return i == 1 ? 2 : i == 2 ? 1 : i; }
+  static constexpr float PositionSign(int i) { return i == 2 ? -1.0f : 1.0f; }
+  static constexpr int RotationSource(int i) { return i; }
+  static constexpr float RotationSign(int) { return 1.0f; }
+  static constexpr float Offset(int i) { return i == 0 ? -0.707106781f : i == 3 ? 0.707106781f : 0.0f; }
+};
+
+struct RightHanded
+{
+  static constexpr float PositionSign(int) { return 1.0f; }
+  static constexpr float RotationSign(int) { return 1.0f; }
+};
+
+// Mirrors x as the OSC leftHanded option.
+struct LeftHanded
+{
+  static constexpr float PositionSign(int i) { return i == 0 ? -1.0f : 1.0f; }
+  static constexpr float RotationSign(int i) { return i == 1 || i == 2 ? -1.0f : 1.0f; }
+};
+
+struct UnitScale
+{
+  static const bool SCALED = false;
+};
+
+// Positions are multiplied by a factor given at run time, e.g. the
+// server's UnitsToMillimeters.
+struct Scaled
+{
+  static const bool SCALED = true;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>Scalar lanes for FusedTransform; the SIMD lanes are in
+/// TransformPolicy.cpp.</summary>
+//////////////////////////////////////////////////////////////////////////
+struct ScalarLanes
+{
+  typedef float V;
+  static const int WIDTH = 1;
+
+  static V Load(const float* p) { return *p; }
+  static void Store(float* p, V v) { *p = v; }
+  static V Set1(float f) { return f; }
+  static V Add(V a, V b) { return a + b; }
+  static V Sub(V a, V b) { return a - b; }
+  static V Mul(V a, V b) { return a * b; }
+  static V Neg(V a) { return -a; }
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// An up axis, handedness and scale policy fused into one transform at
+/// compile time.
+/// </summary>
+/// <remarks>
+/// The handedness mirror is a conjugation of the quaternion, so it
+/// distributes over the product with the up axis offset; the fused
+/// transform is therefore a single signed permutation of the components
+/// followed by one constant quaternion. All coefficients are constant
+/// expressions: once inlined, zero terms drop out, signs become negations
+/// and the unit scale costs nothing, so the code has no branches left.
+/// Pick the instantiation once from the run time configuration with
+/// SelectFusedTransform.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+template<class UpAxis, class Handedness, class Scale>
+struct FusedTransform
+{
+  static const bool SCALED = Scale::SCALED;
+
+  static constexpr int PositionSource(int i) { return UpAxis::PositionSource(i); }
+  static constexpr float PositionSign(int i) { return Handedness::PositionSign(i) * UpAxis::PositionSign(i); }
+  static constexpr int RotationSource(int i) { return UpAxis::RotationSource(i); }
+  static constexpr float RotationSign(int i) { return Handedness::RotationSign(i) * UpAxis::RotationSign(i); }
+  static constexpr float Offset(int i) { return Handedness::RotationSign(i) * UpAxis::Offset(i); }
+
+  static constexpr bool HasOffset()
+  {
+    return Offset(0) != 0.0f || Offset(1) != 0.0f || Offset(2) != 0.0f || Offset(3) != 1.0f;
+  }
+
+  // Transforms a position in place.
+  template<class Lanes>
+  static void Position(typename Lanes::V* p, typename Lanes::V scale)
+  {
+    typedef typename Lanes::V V;
+    const V in[3] = { p[0], p[1], p[2] };
+    V out[3];
+    out[0] = Signed<Lanes>(PositionSign(0), in[PositionSource(0)]);
+    out[1] = Signed<Lanes>(PositionSign(1), in[PositionSource(1)]);
+    out[2] = Signed<Lanes>(PositionSign(2), in[PositionSource(2)]);
+    for (int i = 0; i < 3; i++)
+      p[i] = SCALED ? Lanes::Mul(scale, out[i]) : out[i];
+  }
+
+  // Transforms a quaternion in place.
+  template<class Lanes>
+  static void Rotation(typename Lanes::V* q)
+  {
+    typedef typename Lanes::V V;
+    const V in[4] = { q[0], q[1], q[2], q[3] };
+    V a[4];
+    a[0] = Signed<Lanes>(RotationSign(0), in[RotationSource(0)]);
+    a[1] = Signed<Lanes>(RotationSign(1), in[RotationSource(1)]);
+    a[2] = Signed<Lanes>(RotationSign(2), in[RotationSource(2)]);
+    a[3] = Signed<Lanes>(RotationSign(3), in[RotationSource(3)]);
+    if (!HasOffset())
+    {
+      for (int i = 0; i < 4; i++)
+        q[i] = a[i];
+      return;
+    }
+
+    // a * offset, terms with a zero coefficient left out
+    const float rx = Offset(0), ry = Offset(1), rz = Offset(2), rw = Offset(3);
+    q[0] = Sum<Lanes>(rx, a[3], rw, a[0], rz, a[1], -ry, a[2]);
+    q[1] = Sum<Lanes>(ry, a[3], -rz, a[0], rw, a[1], rx, a[2]);
+    q[2] = Sum<Lanes>(rz, a[3], ry, a[0], -rx, a[1], rw, a[2]);
+    q[3] = Sum<Lanes>(rw, a[3], -rx, a[0], -ry, a[1], -rz, a[2]);
+  }
+
+  static void TransformPosition(float* p, float scale) { Position<ScalarLanes>(p, scale); }
+  static void TransformRotation(float* q) { Rotation<ScalarLanes>(q); }
+
+private:
+  template<class Lanes>
+  static typename Lanes::V Signed(float sign, typename Lanes::V v)
+  {
+    return sign < 0.0f ? Lanes::Neg(v) : v;
+  }
+
+  // c0 * v0 + c1 * v1 + c2 * v2 + c3 * v3 for constant coefficients; a
+  // coefficient of 0 drops its term, one of +-1 its multiply.
+  template<class Lanes>
+  static typename Lanes::V Sum(float c0, typename Lanes::V v0, float c1, typename Lanes::V v1,
+    float c2, typename Lanes::V v2, float c3, typename Lanes::V v3)
+  {
+    typename Lanes::V sum = Lanes::Set1(0.0f);
+    bool any = false;
+    Accumulate<Lanes>(sum, any, c0, v0);
+    Accumulate<Lanes>(sum, any, c1, v1);
+    Accumulate<Lanes>(sum, any, c2, v2);
+    Accumulate<Lanes>(sum, any, c3, v3);
+    return sum;
+  }
+
+  template<class Lanes>
+  static void Accumulate(typename Lanes::V& sum, bool& any, float c, typename Lanes::V v)
+  {
+    if (c == 0.0f)
+      return;
+    if (!any)
+      sum = c == 1.0f ? v : c == -1.0f ? Lanes::Neg(v) : Lanes::Mul(Lanes::Set1(c), v);
+    else if (c == 1.0f)
+      sum = Lanes::Add(sum, v);
+    else if (c == -1.0f)
+      sum = Lanes::Sub(sum, v);
+    else
+      sum = Lanes::Add(sum, Lanes::Mul(Lanes::Set1(c), v));
+    any = true;
+  }
+};
+
+// Up axis conversions that SelectFusedTransform chooses from.
+enum UpAxisConversion
+{
+  UpAxis_Same = 0,
+  UpAxis_YUpToZUp,
+  UpAxis_ZUpToYUp
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>Picks the FusedTransform instantiation of a run time
+/// configuration and returns <c>Selector::Get&lt;Transform&gt;()</c>,
+/// typically a pointer to a function instantiated for it. Called once
+/// when the configuration is set, so the per pose code is the
+/// instantiation alone.</summary>
+//////////////////////////////////////////////////////////////////////////
+template<class Selector, class UpAxis, class Handedness>
+typename Selector::Result SelectFusedTransform(bool scaled)
+{
+  return scaled ?
+    Selector::template Get<FusedTransform<UpAxis, Handedness, Scaled> >() :
+    Selector::template Get<FusedTransform<UpAxis, Handedness, UnitScale> >();
+}
+
+template<class Selector, class UpAxis>
+typename Selector::Result SelectFusedTransform(bool leftHanded, bool scaled)
+{
+  return leftHanded ?
+    SelectFusedTransform<Selector, UpAxis, LeftHanded>(scaled) :
+    SelectFusedTransform<Selector, UpAxis, RightHanded>(scaled);
+}
+
+template<class Selector>
+typename Selector::Result SelectFusedTransform(UpAxisConversion upAxis, bool leftHanded, bool scaled)
+{
+  switch (upAxis)
+  {
+  case UpAxis_YUpToZUp:
+    return SelectFusedTransform<Selector, YUpToZUp>(leftHanded, scaled);
+  case UpAxis_ZUpToYUp:
+    return SelectFusedTransform<Selector, ZUpToYUp>(leftHanded, scaled);
+  default:
+    return SelectFusedTransform<Selector, SameUpAxis>(leftHanded, scaled);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>Transforms <c>count</c> poses in structure of arrays layout
+/// in place; <c>qx</c> to <c>qw</c> may all be nullptr to transform
+/// positions only. <c>scale</c> is ignored by unit scale instantiations.
+/// </summary>
+//////////////////////////////////////////////////////////////////////////
+typedef void (*FusedTransformKernel)(float* x, float* y, float* z, float* qx, float* qy, float* qz, float* qw,
+  int count, float scale);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>Returns the batch kernel of a configuration, vectorized with
+/// AVX2 or SSE2 as the build allows.</summary>
+//////////////////////////////////////////////////////////////////////////
+FusedTransformKernel SelectFusedTransformKernel(UpAxisConversion upAxis, bool leftHanded, bool scaled);
+
+#endif // _TRANSFORMPOLICY_H_
@@ -0,0 +1,221 @@
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <arpa/inet.h>
+#  include <netdb.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#include "UdpFanout.h"
+
+#if defined(__linux__)
+#  define UDPFANOUT_HAVE_SENDMMSG 1
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// UdpFanout implementation
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+#ifdef _WIN32
+  typedef SOCKET SocketHandle;
+  const SocketHandle kInvalidSocket = INVALID_SOCKET;
+
+  void CloseSocket(SocketHandle s) { closesocket(s); }
+#else
+  typedef int SocketHandle;
+  const SocketHandle kInvalidSocket = -1;
+
+  void CloseSocket(SocketHandle s) { close(s); }
+#endif
+
+  bool Resolve(const char* address, int port, sockaddr_in& result)
+  {
+    memset(&result, 0, sizeof(result));
+    result.sin_family = AF_INET;
+    result.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, address, &result.sin_addr) == 1)
+      return true;
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* info = nullptr;
+    if (getaddrinfo(address, nullptr, &hints, &info) != 0 || info == nullptr)
+      return false;
+    result.sin_addr = ((const sockaddr_in*)info->ai_addr)->sin_addr;
+    freeaddrinfo(info);
+    return true;
+  }
+}
+
+struct UdpFanout::Batch
+{
+  SocketHandle socket;
+  sockaddr_in destinations[MAX_DESTINATIONS];
+
+  // queued datagrams, back to back in buffer
+  std::vector<uint8_t> buffer;
+  int used;
+  int offsets[MAX_BATCH_DATAGRAMS];
+  int sizes[MAX_BATCH_DATAGRAMS];
+  uint32_t masks[MAX_BATCH_DATAGRAMS];
+  int count;
+
+#ifdef UDPFANOUT_HAVE_SENDMMSG
+  // one message per datagram and destination, sharing the iovecs
+  iovec iov[MAX_BATCH_DATAGRAMS];
+  mmsghdr messages[MAX_BATCH_DATAGRAMS * MAX_DESTINATIONS];
+#endif
+
+  Batch() : socket(kInvalidSocket), buffer(BATCH_BUFFER_SIZE), used(0), count(0) {}
+};
+
+
+UdpFanout::UdpFanout()
+  :mBatch(new Batch()),
+  mDestinationCount(0),
+  mDestinationMask(ALL_DESTINATIONS),
+  mDatagramsSent(0),
+  mSendCalls(0),
+  mSendErrors(0)
+{
+#ifdef _WIN32
+  WSADATA wsaData;
+  WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+UdpFanout::~UdpFanout()
+{
+  if (mBatch->socket != kInvalidSocket)
+    CloseSocket(mBatch->socket);
+  delete mBatch;
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+bool UdpFanout::AddDestination(const char* address, int port)
+{
+  if (mDestinationCount >= MAX_DESTINATIONS || port <= 0 || port > 65535)
+    return false;
+
+  if (!Resolve(address, port, mBatch->destinations[mDestinationCount]))
+    return false;
+
+  if (mBatch->socket == kInvalidSocket)
+  {
+    mBatch->socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (mBatch->socket == kInvalidSocket)
+      return false;
+  }
+
+  mDestinationCount++;
+  return true;
+}
+
+bool UdpFanout::Queue(const uint8_t* data, int bytes)
+{
+  if (bytes < 0 || bytes > MAX_DATAGRAM_SIZE)
+    return false;
+
+  bool ok = true;
+  Batch& batch = *mBatch;
+  if (batch.count == MAX_BATCH_DATAGRAMS || batch.used + bytes > (int)batch.buffer.size())
+    ok = Flush();
+
+  memcpy(batch.buffer.data() + batch.used, data, bytes);
+  batch.offsets[batch.count] = batch.used;
+  batch.sizes[batch.count] = bytes;
+  batch.masks[batch.count] = mDestinationMask;
+  batch.used += bytes;
+  batch.count++;
+  return ok;
+}
+
+bool UdpFanout::Flush()
+{
+  Batch& batch = *mBatch;
+  const int count = batch.count;
+  batch.count = 0;
+  batch.used = 0;
+
+  if (count == 0 || mDestinationCount == 0)
+    return true;
+
+  bool ok = true;
+
+#ifdef UDPFANOUT_HAVE_SENDMMSG
+  // datagram major, so every destination sees the frame at the same pace
+  int total = 0;
+  for (int i = 0; i < count; i++)
+  {
+    batch.iov[i].iov_base = batch.buffer.data() + batch.offsets[i];
+    batch.iov[i].iov_len = (size_t)batch.sizes[i];
+    for (int d = 0; d < mDestinationCount; d++)
+    {
+      if ((batch.masks[i] & (1u << d)) == 0)
+        continue;
+      msghdr& header = batch.messages[total++].msg_hdr;
+      memset(&header, 0, sizeof(header));
+      header.msg_name = &batch.destinations[d];
+      header.msg_namelen = sizeof(sockaddr_in);
+      header.msg_iov = &batch.iov[i];
+      header.msg_iovlen = 1;
+    }
+  }
+
+  for (int sent = 0; sent < total; )
+  {
+    const int chunk = (total - sent < MAX_MESSAGES_PER_CALL) ? total - sent : MAX_MESSAGES_PER_CALL;
+    const int result = sendmmsg(batch.socket, batch.messages + sent, (unsigned int)chunk, 0);
+    mSendCalls++;
+    if (result <= 0)
+    {
+      // skip the message that failed and go on with the rest
+      mSendErrors++;
+      ok = false;
+      sent++;
+      continue;
+    }
+    mDatagramsSent += result;
+    sent += result;
+  }
+#else
+  for (int i = 0; i < count; i++)
+  {
+    const char* data = (const char*)batch.buffer.data() + batch.offsets[i];
+    for (int d = 0; d < mDestinationCount; d++)
+    {
+      if ((batch.masks[i] & (1u << d)) == 0)
+        continue;
+      const int result = sendto(batch.socket, data, batch.sizes[i], 0,
+        (const sockaddr*)&batch.destinations[d], sizeof(sockaddr_in));
+      mSendCalls++;
+      if (result < 0)
+      {
+        mSendErrors++;
+        ok = false;
+      }
+      else
+        mDatagramsSent++;
+    }
+  }
+#endif
+
+  return ok;
+}
+
+bool UdpFanoutSink(const uint8_t* data, int bytes, void* fanout)
+{
+  return ((UdpFanout*)fanout)->Queue(data, bytes);
+}
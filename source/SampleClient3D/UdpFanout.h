@@ -0,0 +1,117 @@
+#ifndef _UDPFANOUT_H_
+#define _UDPFANOUT_H_
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Sends the same datagrams to several UDP destinations from one socket.
+/// Datagrams are queued while a frame is encoded and go out together on
+/// Flush, so a frame is encoded once however many receivers there are.
+/// </summary>
+/// <remarks>
+/// Modeled on cSlipStream (NatNetRepeater.h), which opens one socket per
+/// destination and sends each datagram with its own call. Where
+/// sendmmsg is available the whole batch, every datagram to every
+/// destination, is handed to the kernel in one call (in chunks of
+/// MAX_MESSAGES_PER_CALL); elsewhere Flush falls back to one sendto per
+/// datagram and destination.
+///
+/// Each datagram goes to the destinations selected when it was queued
+/// (SetDestinationMask), so outputs that differ per destination share one
+/// batch.
+///
+/// Datagrams are copied into a preallocated batch buffer, so queueing and
+/// flushing do not allocate. Not thread safe; queue and flush from the
+/// thread that encodes the frames.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class UdpFanout
+{
+public:
+  static const int MAX_DESTINATIONS = 8;
+  static const uint32_t ALL_DESTINATIONS = 0xFFFFFFFFu;
+
+  // Capacity of one batch. A frame that exceeds it is sent in several.
+  static const int MAX_BATCH_DATAGRAMS = 1024;
+  static const int BATCH_BUFFER_SIZE = 1024 * 1024;
+
+  // Largest UDP payload over IPv4.
+  static const int MAX_DATAGRAM_SIZE = 65507;
+
+  // Most messages the kernel takes per sendmmsg call (UIO_MAXIOV).
+  static const int MAX_MESSAGES_PER_CALL = 1024;
+
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  UdpFanout();
+  ~UdpFanout();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Adds a destination by IPv4 address or host name.</summary>
+  /// <returns>false if the address does not resolve, the socket could
+  /// not be opened or MAX_DESTINATIONS are already set.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool AddDestination(const char* address, int port);
+  int DestinationCount() const { return mDestinationCount; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Selects the destinations of the datagrams queued from now
+  /// on; bit i stands for the i-th destination added.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void SetDestinationMask(uint32_t mask) { mDestinationMask = mask; }
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Queues a datagram for the selected destinations. Flushes
+  /// first if the batch is full.</summary>
+  /// <returns>false if the datagram is larger than MAX_DATAGRAM_SIZE or
+  /// an implicit flush failed.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Queue(const uint8_t* data, int bytes);
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Sends every queued datagram to its destinations and empties
+  /// the batch.</summary>
+  /// <returns>false if any datagram could not be sent.</returns>
+  //////////////////////////////////////////////////////////////////////////
+  bool Flush();
+
+  uint64_t DatagramsSent() const { return mDatagramsSent; }
+  uint64_t SendCalls() const { return mSendCalls; }
+  uint64_t SendErrors() const { return mSendErrors; }
+
+private:
+  UdpFanout(const UdpFanout&); // not implemented
+
+  // Platform specific socket state and the preallocated batch.
+  struct Batch;
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  Batch* mBatch;
+  int mDestinationCount;
+  uint32_t mDestinationMask;
+
+  uint64_t mDatagramsSent;
+  uint64_t mSendCalls;
+  uint64_t mSendErrors;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>DatagramSink (see FrameFragmenter.h) that queues into a
+/// UdpFanout passed as user data. Call UdpFanout::Flush once the frame is
+/// complete.</summary>
+//////////////////////////////////////////////////////////////////////////
+bool UdpFanoutSink(const uint8_t* data, int bytes, void* fanout);
+
+#endif // _UDPFANOUT_H_
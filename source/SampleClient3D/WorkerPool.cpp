@@ -0,0 +1,102 @@
+#include "WorkerPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+// WorkerPool implementation
+//////////////////////////////////////////////////////////////////////////
+
+WorkerPool::WorkerPool(int threadCount)
+  :mTask(nullptr),
+  mContext(nullptr),
+  mCount(0),
+  mBatch(0),
+  mBusy(0),
+  mStopping(false),
+  mNext(0),
+  mBatchesRun(0)
+{
+  if (threadCount < 0)
+    threadCount = 0;
+  else if (threadCount > MAX_THREADS)
+    threadCount = MAX_THREADS;
+
+  for (int i = 0; i < threadCount; i++)
+    mThreads.push_back(std::thread(&WorkerPool::WorkerThread, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+    mStopping = true;
+  }
+  mStart.notify_all();
+  for (size_t i = 0; i < mThreads.size(); i++)
+    mThreads[i].join();
+}
+
+void WorkerPool::Run(WorkerTask task, void* pContext, int count)
+{
+  if (count <= 0)
+    return;
+  mBatchesRun++;
+
+  // not worth waking anyone
+  if (mThreads.empty() || count == 1)
+  {
+    for (int i = 0; i < count; i++)
+      task(pContext, i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+    mTask = task;
+    mContext = pContext;
+    mCount = count;
+    mNext = 0;
+    mBusy = (int)mThreads.size();
+    mBatch++;
+  }
+  mStart.notify_all();
+
+  RunTasks(task, pContext, count);
+
+  std::unique_lock<std::mutex> lock(mLock);
+  while (mBusy > 0)
+    mFinished.wait(lock);
+}
+
+void WorkerPool::WorkerThread()
+{
+  uint64_t batch = 0;
+  for (;;)
+  {
+    WorkerTask task;
+    void* pContext;
+    int count;
+    {
+      std::unique_lock<std::mutex> lock(mLock);
+      while (!mStopping && mBatch == batch)
+        mStart.wait(lock);
+      if (mStopping)
+        return;
+      batch = mBatch;
+      task = mTask;
+      pContext = mContext;
+      count = mCount;
+    }
+
+    RunTasks(task, pContext, count);
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (--mBusy == 0)
+      mFinished.notify_one();
+  }
+}
+
+// Claims and runs tasks of the current batch until none are left.
+void WorkerPool::RunTasks(WorkerTask task, void* pContext, int count)
+{
+  for (int i = mNext++; i < count; i = mNext++)
+    task(pContext, i);
+}
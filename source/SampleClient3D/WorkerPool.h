@@ -0,0 +1,89 @@
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// Runs task number <c>index</c> of a batch.
+typedef void (*WorkerTask)(void* pContext, int index);
+
+//////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Small fixed pool of threads that runs batches of independent tasks,
+/// such as the shards of a frame, and returns once all of them are done.
+/// </summary>
+/// <remarks>
+/// The calling thread takes part in every batch, so a pool of n threads
+/// runs n + 1 tasks at a time and a pool without threads runs the batch
+/// inline. Tasks are claimed one at a time in index order; which thread
+/// runs a task is not defined, so tasks must only write state of their
+/// own. Batches are started from one thread at a time.
+/// </remarks>
+//////////////////////////////////////////////////////////////////////////
+class WorkerPool
+{
+public:
+  // Largest number of threads started.
+  static const int MAX_THREADS = 15;
+
+  //*************************************************************************
+  // Constructors
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Starts the threads.</summary>
+  /// <param name='threadCount'>Threads besides the calling thread,
+  /// clamped to [0, MAX_THREADS].</param>
+  //////////////////////////////////////////////////////////////////////////
+  explicit WorkerPool(int threadCount);
+  ~WorkerPool();
+
+
+  //*************************************************************************
+  // Member Functions
+  //
+
+  //////////////////////////////////////////////////////////////////////////
+  /// <summary>Runs <c>task</c> for every index in [0, count) and waits
+  /// for all of them.</summary>
+  //////////////////////////////////////////////////////////////////////////
+  void Run(WorkerTask task, void* pContext, int count);
+
+  // Number of tasks run at a time, the calling thread included.
+  int Concurrency() const { return (int)mThreads.size() + 1; }
+
+  uint64_t BatchesRun() const { return mBatchesRun; }
+
+private:
+  WorkerPool(const WorkerPool&); // not implemented
+
+  void WorkerThread();
+  void RunTasks(WorkerTask task, void* pContext, int count);
+
+  //*************************************************************************
+  // Instance Variables
+  //
+
+  std::vector<std::thread> mThreads;
+
+  // Current batch, guarded by mLock. A batch only ends once every thread
+  // has left it, so threads never pick up tasks of the next one.
+  std::mutex mLock;
+  std::condition_variable mStart;
+  std::condition_variable mFinished;
+  WorkerTask mTask;
+  void* mContext;
+  int mCount;
+  uint64_t mBatch;               // number of the current batch
+  int mBusy;                     // threads still working on it
+  bool mStopping;
+
+  std::atomic<int> mNext;        // next task index to claim
+  uint64_t mBatchesRun;
+};
+
+#endif // _WORKERPOOL_H_